@@ -0,0 +1,264 @@
+/*
+ * AS-level topology scaling
+ *
+ * Builds exercise01's core / IXP router pattern for thousands of ASes with
+ * AsTopologyBuilder (wan-as-topology.h) and reports, phase by phase, how
+ * long setup takes and how much memory it needs, so that an Internet-scale
+ * run can be sized before it is attempted.
+ *
+ * The AS graph comes from a CAIDA AS relationship file (--asRelFile, e.g.
+ * 20240101.as-rel2.txt from https://publicdata.caida.org/datasets/as-relationships/,
+ * decompressed) cut down to the --ases best-connected ASes, or without a
+ * file from a synthetic three-tier hierarchy of --ases ASes. --helpers builds
+ * the same topology through PointToPointHelper / Ipv4AddressHelper for
+ * comparison. --bgp adds a BgpSpeaker to every router and --time runs the
+ * simulation so that BGP converges.
+ *
+ * --timerWheel runs the BGP timers (and with --bfdInterval the BFD sessions
+ * on the inter-AS links) on a TimerWheel (wan-timer-wheel.h) instead of
+ * simulator events; the BGP RUN report gives the events per second and the
+ * peak number of timer entries in the scheduler heap for either mode.
+ *
+ * With --mpi the ASes are spread over the MPI ranks (wan-mpi.h), inter-AS
+ * links being the only cross-rank links; rank 0 prints the results summed
+ * over all ranks. exercise01-mpi-speedup.sh runs the sequential and
+ * distributed versions for growing AS counts and reports the speedup.
+ *
+ * Example: ./ns3 run "scratch/exercise01-as-topology-scaling --ases=5000"
+ *          ./ns3 run "scratch/exercise01-as-topology-scaling --ases=2500 --bgp --time=60 --holdTime=9 --bfdInterval=100 --timerWheel=1"
+ *          (about 10k BGP and 10k BFD sessions; rerun with --timerWheel=0 to compare)
+ *          mpirun -np 4 ./ns3 run --no-build "scratch/exercise01-as-topology-scaling --ases=5000 --bgp --time=30 --mpi"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-as-topology.h"
+#include "wan-bfd.h"
+#include "wan-timer-wheel.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("AsTopologyScaling");
+
+// Tier-1 clique, transit ASes buying from tier-1s or bigger transits, stubs buying from transits
+void GenerateHierarchy(AsTopologyBuilder& builder, uint32_t ases, std::mt19937& rng)
+{
+    uint32_t tier1 = std::min<uint32_t>(12, ases);
+    uint32_t transit = std::max<uint32_t>(tier1, ases / 7);
+    for (uint32_t a = 1; a <= tier1; ++a) {
+        for (uint32_t b = a + 1; b <= tier1; ++b) {
+            builder.AddLink(a, b, 0);
+        }
+    }
+    for (uint32_t as = tier1 + 1; as <= ases; ++as) {
+        uint32_t upstreams = as <= transit ? 1 + rng() % 3 : 1 + rng() % 2;
+        uint32_t pool = std::min(as - 1, transit);
+        for (uint32_t u = 0; u < upstreams; ++u) {
+            builder.AddLink(1 + rng() % pool, as, -1);
+        }
+        if (as <= transit && rng() % 2 == 0) {
+            uint32_t peer = tier1 + 1 + rng() % (transit - tier1);
+            if (peer != as) {
+                builder.AddLink(std::min(as, peer), std::max(as, peer), 0);
+            }
+        }
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string asRelFile = "";
+    uint32_t ases = 1000;
+    uint32_t borders = 2;
+    uint32_t hosts = 1;
+    bool helpers = false;
+    bool bgp = false;
+    double simTime = 0.0;
+    uint32_t targetAses = 75000;
+    uint32_t seed = 1;
+    bool mpi = false;
+    bool nullMessage = false;
+    double timerWheel = 0;
+    double holdTime = 90;
+    double bfdInterval = 0;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("asRelFile", "CAIDA AS relationship file (without: synthetic hierarchy)", asRelFile);
+    cmd.AddValue("ases", "Number of ASes to build (the best-connected ones of asRelFile)", ases);
+    cmd.AddValue("borders", "Border (IXP) routers per AS", borders);
+    cmd.AddValue("hosts", "Hosts behind each border router", hosts);
+    cmd.AddValue("helpers", "Build with PointToPointHelper/Ipv4AddressHelper instead of in bulk", helpers);
+    cmd.AddValue("bgp", "Run a BGP speaker on every router", bgp);
+    cmd.AddValue("time", "Simulation time in seconds (0: setup only)", simTime);
+    cmd.AddValue("targetAses", "Extrapolate setup cost to this many ASes", targetAses);
+    cmd.AddValue("seed", "Seed of the synthetic hierarchy", seed);
+    cmd.AddValue("mpi", "Distributed run, ASes partitioned over the MPI ranks", mpi);
+    cmd.AddValue("nullMessage", "Use the null message synchronisation algorithm with --mpi", nullMessage);
+    cmd.AddValue("timerWheel", "Run BGP and BFD timers on a timer wheel of this resolution in ms (0: simulator events)", timerWheel);
+    cmd.AddValue("holdTime", "BGP hold time in seconds (keepalives every third of it)", holdTime);
+    cmd.AddValue("bfdInterval", "BFD transmit interval in ms on the inter-AS links with --bgp (0: no BFD)", bfdInterval);
+    cmd.Parse(argc, argv);
+
+    if (mpi) {
+        WanMpi::Enable(&argc, &argv, nullMessage);
+    }
+    if (WanMpi::GetRank() != 0) {
+        std::cout.setstate(std::ios::badbit); // rank 0 reports for everybody
+    }
+
+    int64_t residentStart = GetResidentBytes();
+    AsTopologyBuilder builder;
+    builder.SetMaxAses(ases);
+    builder.SetBordersPerAs(borders);
+    builder.SetHostsPerBorder(hosts);
+    builder.SetUseHelpers(helpers);
+    builder.SetPartitions(WanMpi::GetSize());
+    if (!asRelFile.empty()) {
+        NS_ABORT_MSG_UNLESS(builder.Load(asRelFile), builder.GetError());
+    } else {
+        std::mt19937 rng(seed);
+        GenerateHierarchy(builder, ases, rng);
+    }
+    builder.Build();
+    std::unique_ptr<TimerWheel> wheel;
+    if (timerWheel > 0) {
+        wheel.reset(new TimerWheel(MicroSeconds(int64_t(timerWheel * 1000))));
+    } else {
+        ProtocolTimer::EnableQueueTracking();
+    }
+    if (bgp) {
+        BgpHelper bgpHelper;
+        bgpHelper.SetAttribute("StartTime", TimeValue(Seconds(1.0)));
+        bgpHelper.SetAttribute("HoldTime", TimeValue(Seconds(holdTime)));
+        bgpHelper.SetTimerWheel(wheel.get());
+        builder.InstallBgp(bgpHelper);
+        if (bfdInterval > 0) {
+            BfdHelper bfdHelper;
+            bfdHelper.SetAttribute("DesiredMinTxInterval", TimeValue(MicroSeconds(int64_t(bfdInterval * 1000))));
+            bfdHelper.SetAttribute("RequiredMinRxInterval", TimeValue(MicroSeconds(int64_t(bfdInterval * 1000))));
+            bfdHelper.SetTimerWheel(wheel.get());
+            for (const AsTopologyBuilder::Link& link : builder.GetLinks()) {
+                bfdHelper.InstallLink(NetDeviceContainer(link.deviceA, link.deviceB));
+            }
+        }
+    }
+
+    uint32_t nLinks = builder.GetLinks().size();
+    uint32_t nRouters = builder.GetRouters().GetN();
+    uint32_t nHosts = builder.GetHosts().GetN();
+    std::cout << "AS graph:  " << builder.GetNInputAses() << " ASes, "
+              << builder.GetRelationships().GetNLinks() << " relationships"
+              << (asRelFile.empty() ? " (synthetic)" : " from " + asRelFile) << "\n";
+    std::cout << "Built:     " << builder.GetNAses() << " ASes, " << nLinks << " inter-AS links, "
+              << nRouters << " routers, " << nHosts << " hosts ("
+              << (helpers ? "helpers" : "bulk") << ")\n";
+    if (WanMpi::GetSize() > 1) {
+        std::cout << "Partition: " << WanMpi::GetSize() << " ranks, " << builder.GetNCrossPartitionLinks()
+                  << " cross-rank links (lookahead " << builder.GetInterAsDelay().GetMilliSeconds() << " ms)\n";
+    }
+    std::cout << "\n";
+
+    std::cout << "========== SETUP PHASES ==========\n";
+    std::cout << "Phase                        Time (s)   Memory (MiB)\n";
+    double totalSeconds = 0;
+    int64_t totalBytes = 0;
+    for (const AsTopologyBuilder::Phase& phase : builder.GetPhases()) {
+        std::cout << std::left << std::setw(27) << phase.name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(10) << phase.seconds << std::setprecision(1)
+                  << std::setw(15) << phase.residentBytes / 1048576.0 << "\n";
+        totalSeconds += phase.seconds;
+        totalBytes += phase.residentBytes;
+    }
+    std::cout << std::left << std::setw(27) << "total" << std::right << std::setprecision(3)
+              << std::setw(10) << totalSeconds << std::setprecision(1) << std::setw(15)
+              << totalBytes / 1048576.0 << "\n";
+    std::cout << "Process resident set: "
+              << (GetResidentBytes() - residentStart) / 1048576.0 << " MiB\n\n";
+
+    uint32_t nNodes = nRouters + nHosts;
+    uint32_t nInternalLinks = nRouters - builder.GetNAses() + nHosts;
+    std::cout << "Per AS:    " << std::setprecision(0) << double(totalBytes) / builder.GetNAses()
+              << " bytes, " << std::setprecision(1) << totalSeconds * 1e6 / builder.GetNAses() << " us\n";
+    std::cout << "Per node:  " << std::setprecision(0) << double(totalBytes) / nNodes << " bytes ("
+              << nLinks + nInternalLinks << " links, " << 2 * (nLinks + nInternalLinks) << " devices)\n";
+    if (targetAses > builder.GetNAses()) {
+        double scale = double(targetAses) / builder.GetNAses();
+        std::cout << "Linear extrapolation to " << targetAses << " ASes: " << std::setprecision(1)
+                  << totalSeconds * scale << " s, " << totalBytes * scale / 1073741824.0 << " GiB\n";
+    }
+
+    if (bgp && simTime > 0) {
+        std::cout << "\n========== BGP RUN ==========\n";
+        Simulator::Stop(Seconds(simTime));
+        int64_t residentBefore = GetResidentBytes();
+        auto runStart = std::chrono::steady_clock::now();
+        Simulator::Run();
+        double runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+
+        // Speakers of other ranks' ASes are inert here, so plain sums add up across ranks
+        // routes, UPDATEs, events, resident bytes, BGP peerings, BFD sessions, BFD up, timer entries, wheel ticks
+        std::vector<uint64_t> totals(9, 0);
+        double lastChange = 0;
+        for (uint32_t i = 0; i < builder.GetNAses(); ++i) {
+            const AsTopologyBuilder::AutonomousSystem& as = builder.GetAs(i);
+            totals[0] += as.coreSpeaker->GetNRoutes();
+            totals[4] += as.coreSpeaker->GetNPeers();
+            for (const auto& speaker : as.borderSpeakers) {
+                totals[1] += speaker->GetStatistics().updatesSent;
+                totals[4] += speaker->GetNPeers();
+                lastChange = std::max(lastChange, speaker->GetStatistics().lastBestPathChange.GetSeconds());
+            }
+        }
+        NodeContainer routers = builder.GetRouters();
+        for (uint32_t r = 0; r < routers.GetN(); ++r) {
+            for (uint32_t app = 0; app < routers.Get(r)->GetNApplications(); ++app) {
+                Ptr<BfdAgent> agent = DynamicCast<BfdAgent>(routers.Get(r)->GetApplication(app));
+                for (uint32_t s = 0; agent && s < agent->GetNSessions(); ++s) {
+                    totals[5]++;
+                    totals[6] += agent->IsUp(s);
+                }
+            }
+        }
+        totals[2] = Simulator::GetEventCount();
+        totals[3] = GetResidentBytes() - residentBefore;
+        totals[7] = wheel ? wheel->GetStatistics().maxPending : ProtocolTimer::GetMaxQueued();
+        totals[8] = wheel ? wheel->GetStatistics().ticks : 0;
+        WanMpi::Sum(totals);
+        lastChange = WanMpi::Max(lastChange);
+        runSeconds = WanMpi::Max(runSeconds);
+
+        std::cout << "Wall-clock:        " << std::setprecision(3) << runSeconds << " s for " << simTime
+                  << " s simulated, " << totals[2] << " events\n";
+        std::cout << "Converged at:      " << lastChange << " s\n";
+        std::cout << "Core Loc-RIB size: " << std::setprecision(1) << double(totals[0]) / builder.GetNAses()
+                  << " prefixes on average (" << builder.GetNAses() << " originated)\n";
+        std::cout << "Border UPDATEs:    " << totals[1] << "\n";
+        std::cout << "BGP memory:        " << totals[3] / 1048576.0 << " MiB over "
+                  << WanMpi::GetSize() << " rank(s)\n";
+        std::cout << "Sessions:          " << totals[4] / 2 << " BGP, " << totals[5] / 2 << " BFD ("
+                  << totals[6] / 2 << " up)\n";
+        std::cout << "Events/s:          " << std::setprecision(0) << totals[2] / std::max(runSeconds, 1e-9)
+                  << "\n";
+        if (wheel) {
+            std::cout << "Timers:            wheel (" << timerWheel << " ms), " << totals[7]
+                      << " armed at peak (one tick event in the scheduler heap), "
+                      << totals[8] << " ticks\n";
+        } else {
+            std::cout << "Timers:            simulator events, " << totals[7]
+                      << " heap entries at peak (cancelled ones included)\n";
+        }
+    }
+
+    Simulator::Destroy();
+    WanMpi::Disable();
+    return 0;
+}
@@ -0,0 +1,218 @@
+/*
+ * BGP RIB memory: attribute copies vs. interned attribute handles
+ *
+ * Models the RIBs of one AS border router from exercise01 carrying a full
+ * table: an Adj-RIB-In per peer, the Loc-RIB and an Adj-RIB-Out per peer
+ * (2 * peers + 1 tables). Each table is a std::map<BgpPrefix, ...> like in
+ * BgpSpeaker, built twice:
+ *
+ *   before: every entry holds its own BgpPathAttributes (AS_PATH vector included)
+ *   after:  every entry holds a BgpAttributeHandle into the BgpAttributeStore
+ *
+ * Memory is measured by counting live heap bytes (operator new/delete are
+ * instrumented in this program), so both layouts are measured exactly and
+ * the "after" numbers include the store itself.
+ *
+ * Routes come from --ribFile (any format MrtRibLoader reads) or, without a
+ * file, from a synthetic table where --attributeSets distinct AS paths are
+ * shared by the prefixes with a skewed (few paths carry most prefixes)
+ * distribution, which is what real tables look like.
+ *
+ * Example: ./ns3 run "scratch/exercise01-attribute-store-benchmark --prefixes=100000,1000000"
+ */
+
+#include "ns3/core-module.h"
+#include "wan-bgp-speaker.h"
+#include "wan-mrt-loader.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <malloc.h>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <type_traits>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("AttributeStoreBenchmark");
+
+// ========== HEAP ACCOUNTING ==========
+// Kept out of line so the compiler does not pair the inlined free() with new
+static int64_t g_liveBytes = 0;
+
+__attribute__((noinline)) void* operator new(std::size_t size)
+{
+    void* p = std::malloc(size ? size : 1);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    g_liveBytes += malloc_usable_size(p);
+    return p;
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept
+{
+    if (p) {
+        g_liveBytes -= malloc_usable_size(p);
+        std::free(p);
+    }
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    operator delete(p);
+}
+
+struct Route
+{
+    BgpPrefix prefix;
+    BgpPathAttributes attributes;
+};
+
+// Synthetic full table: unique prefixes sharing a few thousand attribute sets
+std::vector<Route> GenerateRoutes(uint32_t count, uint32_t attributeSets, std::mt19937& rng)
+{
+    std::vector<BgpPathAttributes> sets(attributeSets);
+    std::uniform_int_distribution<uint32_t> asDistribution(1, 400000);
+    for (auto& set : sets) {
+        uint32_t length = 2 + rng() % 6;
+        for (uint32_t i = 0; i < length; ++i) {
+            set.asPath.push_back(asDistribution(rng));
+        }
+        set.origin = rng() % 8 == 0 ? 2 : 0;
+        set.med = rng() % 4 == 0 ? rng() % 100 : 0;
+        set.nextHop = Ipv4Address("192.168.100.2");
+    }
+
+    std::vector<Route> routes;
+    std::set<BgpPrefix> seen;
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    while (routes.size() < count) {
+        uint8_t length = 16 + rng() % 9;
+        BgpPrefix prefix(0x01000000 + rng() % 0xde000000, length);
+        if (!seen.insert(prefix).second) {
+            continue;
+        }
+        double u = uniform(rng);
+        routes.push_back({prefix, sets[static_cast<uint32_t>(attributeSets * u * u * u)]});
+    }
+    return routes;
+}
+
+// Attributes as stored in each table of the router
+BgpPathAttributes AdjRibInAttributes(const BgpPathAttributes& a, uint32_t peer)
+{
+    BgpPathAttributes in = a;
+    in.asPath.insert(in.asPath.begin(), 64600 + peer); // peer AS in front
+    in.nextHop = Ipv4Address(0xc0a86402 + (peer << 8));
+    return in;
+}
+
+BgpPathAttributes AdjRibOutAttributes(const BgpPathAttributes& best, uint32_t peer)
+{
+    BgpPathAttributes out = best;
+    out.asPath.insert(out.asPath.begin(), 65002); // exercise01 transit AS
+    out.nextHop = Ipv4Address(0xc0a86401 + (peer << 8)); // next-hop-self
+    out.med = 0;
+    return out;
+}
+
+template <class Value, class Make>
+int64_t BuildRouterRibs(const std::vector<Route>& routes, uint32_t peers, Make make)
+{
+    int64_t before = g_liveBytes;
+    {
+        std::vector<std::map<BgpPrefix, Value>> tables(2 * peers + 1);
+        for (const Route& route : routes) {
+            for (uint32_t peer = 0; peer < peers; ++peer) {
+                tables[peer].emplace(route.prefix, make(AdjRibInAttributes(route.attributes, peer)));
+            }
+            BgpPathAttributes best = AdjRibInAttributes(route.attributes, 0);
+            tables[peers].emplace(route.prefix, make(best));
+            for (uint32_t peer = 0; peer < peers; ++peer) {
+                tables[peers + 1 + peer].emplace(route.prefix, make(AdjRibOutAttributes(best, peer)));
+            }
+        }
+        int64_t used = g_liveBytes - before;
+        if (std::is_same<Value, BgpAttributeHandle>::value) {
+            std::cout << "    attribute store: " << BgpAttributeStore::Get().GetNEntries()
+                      << " distinct sets for " << BgpAttributeStore::Get().GetNReferences()
+                      << " RIB entries\n";
+        }
+        return used;
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string prefixList = "100000,1000000";
+    std::string ribFile = "";
+    uint32_t attributeSets = 5000;
+    uint32_t peers = 2;
+    uint32_t seed = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("prefixes", "Comma-separated table sizes to measure", prefixList);
+    cmd.AddValue("ribFile", "Take routes from this RIB dump instead of a synthetic table", ribFile);
+    cmd.AddValue("attributeSets", "Distinct attribute sets in the synthetic table", attributeSets);
+    cmd.AddValue("peers", "BGP peers of the modelled router (one Adj-RIB-In/Out each)", peers);
+    cmd.AddValue("seed", "Seed of the synthetic table", seed);
+    cmd.Parse(argc, argv);
+
+    std::vector<uint32_t> sizes;
+    std::stringstream list(prefixList);
+    for (std::string item; std::getline(list, item, ',');) {
+        sizes.push_back(std::stoul(item));
+    }
+    uint32_t largest = *std::max_element(sizes.begin(), sizes.end());
+
+    std::vector<Route> allRoutes;
+    if (!ribFile.empty()) {
+        MrtRibLoader loader;
+        NS_ABORT_MSG_UNLESS(loader.Open(ribFile), loader.GetError());
+        loader.SetMaxRoutes(largest);
+        loader.Load([&allRoutes](const BgpPrefix& prefix, const BgpPathAttributes& attributes) {
+            allRoutes.push_back({prefix, attributes});
+        });
+        std::cout << "Loaded " << allRoutes.size() << " routes from " << ribFile << "\n";
+    } else {
+        std::mt19937 rng(seed);
+        allRoutes = GenerateRoutes(largest, attributeSets, rng);
+        std::cout << "Synthetic table: " << allRoutes.size() << " prefixes, " << attributeSets
+                  << " attribute sets\n";
+    }
+
+    uint32_t tables = 2 * peers + 1;
+    std::cout << "Router RIBs: " << peers << " Adj-RIB-In + Loc-RIB + " << peers << " Adj-RIB-Out = "
+              << tables << " tables\n\n";
+
+    std::cout << "========== RIB MEMORY ==========\n";
+    std::cout << "Prefixes   Layout                 MiB    Bytes/route  Bytes/RIB entry\n";
+    for (uint32_t size : sizes) {
+        std::vector<Route> routes(allRoutes.begin(), allRoutes.begin() + std::min<std::size_t>(size, allRoutes.size()));
+        uint32_t n = routes.size();
+
+        int64_t copies = BuildRouterRibs<BgpPathAttributes>(routes, peers,
+            [](const BgpPathAttributes& a) { return a; });
+        int64_t interned = BuildRouterRibs<BgpAttributeHandle>(routes, peers,
+            [](const BgpPathAttributes& a) { return BgpAttributeHandle(a); });
+
+        for (int i = 0; i < 2; ++i) {
+            int64_t bytes = i == 0 ? copies : interned;
+            std::cout << std::left << std::setw(11) << n << std::setw(21)
+                      << (i == 0 ? "attribute copies" : "interned handles") << std::right
+                      << std::fixed << std::setprecision(1) << std::setw(6) << bytes / 1048576.0
+                      << std::setw(15) << double(bytes) / n
+                      << std::setw(17) << double(bytes) / (double(n) * tables) << "\n";
+        }
+        std::cout << std::left << std::setw(11) << n << std::setw(21) << "saving" << std::right
+                  << std::setw(5) << std::setprecision(0) << 100.0 * (copies - interned) / copies
+                  << "%\n";
+    }
+    return 0;
+}
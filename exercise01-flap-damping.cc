@@ -0,0 +1,229 @@
+/*
+ * Flapping IXP: UPDATE churn and simulator events with and without route flap damping
+ *
+ * The IXP situation of exercise01 reduced to five routers: R1 and R2 of
+ * AS65001 are connected by iBGP, R1 peers with X1 (AS65002) over IXP-A and
+ * R2 with X2 (AS65002) over IXP-B, and D (AS65010) is a customer of R2.
+ * X1 and X2 both announce --prefixes prefixes; X2 prepends its AS, so
+ * IXP-A carries every best path and IXP-B is the backup.
+ *
+ * From 10s on, IXP-A goes down for --downTime every --period, --flaps
+ * times. Every flap drops R1's session to X1, moves all prefixes to IXP-B
+ * and back again, and D sees each prefix change twice. The scenario is run
+ * twice:
+ *
+ *   off:     no damping, every flap is passed on to R2 and D;
+ *   damping: R1 and R2 damp routes from their eBGP neighbours
+ *            (BgpSpeaker's RouteFlapDamping with its default parameters).
+ *            After three flaps R1 suppresses X1's routes and AS65001 stays
+ *            on IXP-B until the penalties have decayed.
+ *
+ * The report gives the UPDATE messages and prefix changes sent by all
+ * routers, the best-path changes at D and the executed simulator events
+ * (Simulator::GetEventCount()) of the flapping phase, and of the quiet
+ * phase after it, which lasts --quiet minutes. The quiet phase
+ * shows that suppressed prefixes cost nothing while idle: their penalties
+ * decay without events and all of them are brought back by a single reuse
+ * event, so both modes spend about the same events on keepalives.
+ *
+ * Example: ./ns3 run "scratch/exercise01-flap-damping --prefixes=100000 --flaps=20"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-bgp-speaker.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("FlapDamping");
+
+// Counters summed over all speakers, with the simulator's event count
+struct ChurnTotals
+{
+    uint64_t updatesSent = 0;
+    uint64_t prefixChanges = 0; ///< prefixes advertised and withdrawn
+    uint64_t events = 0;
+};
+
+struct FlapRun
+{
+    ChurnTotals flapping;
+    ChurnTotals quiet;
+    uint64_t downstreamChanges = 0; ///< best-path changes at D while flapping
+    uint32_t suppressed = 0;        ///< routes suppressed at R1 after the last flap
+    uint64_t reused = 0;
+    uint32_t finalRoutes = 0;       ///< routes at D at the end
+    uint32_t sampled = 0;
+    uint32_t viaIxpA = 0;           ///< sampled prefixes D reaches over IXP-A at the end
+};
+
+// i-th flapping prefix: consecutive /24s from 20.0.0.0
+BgpPrefix FlapPrefix(uint32_t i)
+{
+    return BgpPrefix(0x14000000 + (i << 8), 24);
+}
+
+ChurnTotals Snapshot(const std::vector<Ptr<BgpSpeaker>>& speakers)
+{
+    ChurnTotals totals;
+    for (const auto& speaker : speakers) {
+        const BgpSpeaker::Statistics& stats = speaker->GetStatistics();
+        totals.updatesSent += stats.updatesSent;
+        totals.prefixChanges += stats.prefixesAdvertised + stats.prefixesWithdrawn;
+    }
+    totals.events = Simulator::GetEventCount();
+    return totals;
+}
+
+ChurnTotals Difference(const ChurnTotals& after, const ChurnTotals& before)
+{
+    ChurnTotals delta;
+    delta.updatesSent = after.updatesSent - before.updatesSent;
+    delta.prefixChanges = after.prefixChanges - before.prefixChanges;
+    delta.events = after.events - before.events;
+    return delta;
+}
+
+// Both ends of IXP-A go down or come back
+void SetIxpA(NetDeviceContainer devices, bool up)
+{
+    for (uint32_t i = 0; i < devices.GetN(); ++i) {
+        Ptr<Ipv4> ipv4 = devices.Get(i)->GetNode()->GetObject<Ipv4>();
+        uint32_t interface = ipv4->GetInterfaceForDevice(devices.Get(i));
+        if (up) {
+            ipv4->SetUp(interface);
+        } else {
+            ipv4->SetDown(interface);
+        }
+    }
+}
+
+void RunUntil(Time stop)
+{
+    Simulator::Stop(stop - Simulator::Now());
+    Simulator::Run();
+}
+
+FlapRun RunFlapping(uint32_t prefixes, uint32_t flaps, double period, double downTime, Time quiet, bool damping)
+{
+    NodeContainer routers;
+    routers.Create(5); // R1, R2, X1, X2, D
+    InternetStackHelper stack;
+    stack.Install(routers);
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    Ipv4AddressHelper address;
+    address.SetBase("192.168.100.0", "255.255.255.252");
+    NetDeviceContainer ixpADevices = p2p.Install(routers.Get(0), routers.Get(2));
+    Ipv4InterfaceContainer ixpA = address.Assign(ixpADevices);
+    address.SetBase("192.168.200.0", "255.255.255.252");
+    Ipv4InterfaceContainer ixpB = address.Assign(p2p.Install(routers.Get(1), routers.Get(3)));
+    address.SetBase("10.1.0.0", "255.255.255.252");
+    Ipv4InterfaceContainer internal = address.Assign(p2p.Install(routers.Get(0), routers.Get(1)));
+    address.SetBase("10.3.0.0", "255.255.255.252");
+    Ipv4InterfaceContainer customer = address.Assign(p2p.Install(routers.Get(1), routers.Get(4)));
+
+    BgpHelper bgp;
+    bgp.SetAttribute("StartTime", TimeValue(Seconds(0.5)));
+    BgpHelper borderBgp;
+    borderBgp.SetAttribute("StartTime", TimeValue(Seconds(0.5)));
+    borderBgp.SetAttribute("RouteFlapDamping", BooleanValue(damping));
+    Ptr<BgpSpeaker> r1 = borderBgp.Install(routers.Get(0), 65001);
+    Ptr<BgpSpeaker> r2 = borderBgp.Install(routers.Get(1), 65001);
+    Ptr<BgpSpeaker> x1 = bgp.Install(routers.Get(2), 65002);
+    Ptr<BgpSpeaker> x2 = bgp.Install(routers.Get(3), 65002);
+    Ptr<BgpSpeaker> d = bgp.Install(routers.Get(4), 65010);
+    BgpHelper::Peer(r1, ixpA.GetAddress(0), x1, ixpA.GetAddress(1));
+    BgpHelper::Peer(r2, ixpB.GetAddress(0), x2, ixpB.GetAddress(1));
+    BgpHelper::Peer(r1, internal.GetAddress(0), r2, internal.GetAddress(1));
+    BgpHelper::Peer(r2, customer.GetAddress(0), d, customer.GetAddress(1));
+    std::vector<Ptr<BgpSpeaker>> speakers{r1, r2, x1, x2, d};
+
+    BgpPathAttributes prepended;
+    prepended.asPath.push_back(65002);
+    for (uint32_t i = 0; i < prefixes; ++i) {
+        x1->AddRoute(FlapPrefix(i), BgpPathAttributes());
+        x2->AddRoute(FlapPrefix(i), prepended);
+    }
+
+    Time flapStart = Seconds(10);
+    for (uint32_t k = 0; k < flaps; ++k) {
+        Time down = flapStart + Seconds(period * k);
+        Simulator::Schedule(down, &SetIxpA, ixpADevices, false);
+        Simulator::Schedule(down + Seconds(downTime), &SetIxpA, ixpADevices, true);
+    }
+    Time flapEnd = flapStart + Seconds(period * flaps);
+
+    FlapRun run;
+    RunUntil(flapStart);
+    ChurnTotals start = Snapshot(speakers);
+    uint64_t downstreamStart = d->GetStatistics().bestPathChanges;
+    RunUntil(flapEnd);
+    ChurnTotals end = Snapshot(speakers);
+    run.flapping = Difference(end, start);
+    run.downstreamChanges = d->GetStatistics().bestPathChanges - downstreamStart;
+    run.suppressed = r1->GetNSuppressedRoutes();
+    RunUntil(flapEnd + quiet);
+    run.quiet = Difference(Snapshot(speakers), end);
+    run.reused = r1->GetStatistics().routesReused;
+
+    run.finalRoutes = d->GetNRoutes();
+    uint32_t step = std::max<uint32_t>(1, prefixes / 1000);
+    for (uint32_t i = 0; i < prefixes; i += step) {
+        run.sampled++;
+        const BgpPathAttributes* path = d->GetBestPath(FlapPrefix(i).GetAddress(), Ipv4Mask("255.255.255.0"));
+        if (path && path->asPath.size() == 2) { // 65001 65002, not prepended
+            run.viaIxpA++;
+        }
+    }
+    Simulator::Destroy();
+    return run;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t prefixes = 10000;
+    uint32_t flaps = 10;
+    double period = 60;
+    double downTime = 10;
+    double quiet = 65;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("prefixes", "Prefixes announced over both IXPs", prefixes);
+    cmd.AddValue("flaps", "Number of IXP-A outages", flaps);
+    cmd.AddValue("period", "Seconds from one IXP-A outage to the next", period);
+    cmd.AddValue("downTime", "Seconds IXP-A stays down per outage", downTime);
+    cmd.AddValue("quiet", "Minutes simulated after the last outage", quiet);
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_UNLESS(downTime < period, "--downTime must be shorter than --period");
+
+    std::cout << "========== IXP-A FLAPPING " << flaps << " TIMES, " << prefixes << " PREFIXES ==========\n";
+    std::cout << "                    ------------- flapping -------------   --------------- quiet ---------------\n";
+    std::cout << "Mode     Suppressed  UPDATEs  Prefix changes  D changes    Events  UPDATEs  Reused    Events  Via IXP-A\n";
+    bool restored = true;
+    for (bool damping : {false, true}) {
+        FlapRun run = RunFlapping(prefixes, flaps, period, downTime, Minutes(quiet), damping);
+        std::cout << std::left << std::setw(8) << (damping ? "damping" : "off") << std::right << std::setw(11)
+                  << run.suppressed << std::setw(9) << run.flapping.updatesSent << std::setw(16)
+                  << run.flapping.prefixChanges << std::setw(11) << run.downstreamChanges << std::setw(10)
+                  << run.flapping.events << std::setw(9) << run.quiet.updatesSent << std::setw(8) << run.reused
+                  << std::setw(10) << run.quiet.events << std::setw(7) << run.viaIxpA << "/" << run.sampled << "\n";
+        restored = restored && run.finalRoutes == prefixes && run.viaIxpA == run.sampled;
+    }
+    std::cout << "\nD changes: best-path changes at the customer of AS65001.\n"
+              << "Events: simulator events executed in the phase, packets and timers of all nodes.\n"
+              << "Via IXP-A: sampled prefixes back on IXP-A at the end (reused after the quiet phase).\n";
+    if (!restored) {
+        std::cout << "ERROR: D did not return to IXP-A for every prefix; make --quiet longer than "
+                     "DampingMaxSuppressTime\n";
+    }
+    return restored ? 0 : 1;
+}
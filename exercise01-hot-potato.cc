@@ -0,0 +1,283 @@
+/*
+ * Hot-potato routing: choosing the exit by IGP distance instead of a fixed primary
+ *
+ * AS65001 is a chain W - M1 - M2 - E of 10ms links; W reaches AS65002 at
+ * IXP-A (router XA) and E at IXP-B (router XB). XA and XB are 10ms apart
+ * and each of them announces both destination networks, D1 behind XA and
+ * D2 behind XB. Source S1 hangs off M1, so IXP-A is one IGP hop closer to
+ * it, and S2 off M2, closer to IXP-B. AS65001's interior runs
+ * IncrementalSpfRouting (wan-incremental-spf.h) as its IGP, and a gravity
+ * traffic matrix (wan-traffic-matrix.h) sends between the sources and the
+ * destinations in both directions. The scenario is run three times:
+ *
+ *   primary:    XB prepends its AS, so IXP-B is a backup and all of
+ *               AS65001 leaves over IXP-A;
+ *   router-id:  both exits are equal and, with no IGP distance in the
+ *               decision process, M1 and M2 both pick the exit whose
+ *               border router has the lower router id;
+ *   hot-potato: both exits are equal and every BgpSpeaker is given its IGP
+ *               distance to the next hops (SetIgpCostCallback()), so each
+ *               source leaves at the exit closest to it.
+ *
+ * The report gives the load of IXP-A and IXP-B and of the two links the
+ * traffic may have to cross inside an AS (M1-M2 and XA-XB), both
+ * directions summed, the mean one-way delay of the flows from S1 and from
+ * S2 (FlowMonitor) and the exit each source uses at the end.
+ *
+ * With --reweight=<t> the metric of W-M1 is raised to 10 at t seconds and
+ * the IGP updated; in hot-potato mode M1's speaker is told through
+ * NotifyIgpChange() and S1 moves to IXP-B, which is now closer.
+ *
+ * Example: ./ns3 run "scratch/exercise01-hot-potato --load=40Mbps --reweight=15"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/flow-monitor-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-bgp-speaker.h"
+#include "wan-incremental-spf.h"
+#include "wan-traffic-matrix.h"
+
+#include <iomanip>
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("HotPotato");
+
+enum ExitMode
+{
+    PRIMARY,
+    ROUTER_ID,
+    HOT_POTATO
+};
+
+// Links whose load is reported: IXP-A, IXP-B, M1-M2, XA-XB
+static constexpr uint32_t N_LINKS = 4;
+
+struct HotPotatoRun
+{
+    double utilisation[N_LINKS] = {0, 0, 0, 0}; ///< fraction of both directions' capacity
+    double s1DelayMs = 0;
+    double s2DelayMs = 0;
+    std::string s1Exit;
+    std::string s2Exit;
+};
+
+std::vector<uint64_t> g_linkBytes(N_LINKS, 0);
+Time g_measureStart;
+
+void LinkTx(uint32_t link, Ptr<const Packet> packet)
+{
+    if (Simulator::Now() >= g_measureStart) {
+        g_linkBytes[link] += packet->GetSize();
+    }
+}
+
+// Raise the metric of one link on both ends and let the IGP catch up
+void Reweight(IncrementalSpfRouting* igp, NetDeviceContainer devices, uint16_t metric)
+{
+    for (uint32_t i = 0; i < devices.GetN(); ++i) {
+        Ptr<Ipv4> ipv4 = devices.Get(i)->GetNode()->GetObject<Ipv4>();
+        ipv4->SetMetric(ipv4->GetInterfaceForDevice(devices.Get(i)), metric);
+    }
+    igp->Update();
+}
+
+// Which IXP a router of AS65001 leaves through for a destination
+std::string ExitOf(Ptr<BgpSpeaker> speaker, Ipv4Address destination, Ipv4Address w, Ipv4Address e)
+{
+    const BgpPathAttributes* path = speaker->GetBestPath(destination, Ipv4Mask("255.255.255.0"));
+    if (!path) {
+        return "none";
+    }
+    return path->nextHop == w ? "IXP-A" : path->nextHop == e ? "IXP-B" : "?";
+}
+
+HotPotatoRun RunExits(ExitMode mode, double load, double start, double stop, double reweight)
+{
+    NodeContainer nodes;
+    nodes.Create(10); // W, M1, M2, E, XA, XB, S1, S2, D1, D2
+    Ptr<Node> w = nodes.Get(0), m1 = nodes.Get(1), m2 = nodes.Get(2), e = nodes.Get(3);
+    Ptr<Node> xa = nodes.Get(4), xb = nodes.Get(5);
+    Ptr<Node> s1 = nodes.Get(6), s2 = nodes.Get(7), d1 = nodes.Get(8), d2 = nodes.Get(9);
+    InternetStackHelper stack;
+    stack.Install(nodes);
+
+    PointToPointHelper longHaul;
+    longHaul.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
+    longHaul.SetChannelAttribute("Delay", StringValue("10ms"));
+    PointToPointHelper access;
+    access.SetDeviceAttribute("DataRate", StringValue("100Mbps"));
+    access.SetChannelAttribute("Delay", StringValue("1ms"));
+
+    // AS interiors first, so the IGP never sees the IXP links
+    Ipv4AddressHelper address;
+    NetDeviceContainer wm1Devices = longHaul.Install(w, m1);
+    NetDeviceContainer m12Devices = longHaul.Install(m1, m2);
+    NetDeviceContainer xabDevices = longHaul.Install(xa, xb);
+    address.SetBase("10.1.0.0", "255.255.255.252");
+    Ipv4InterfaceContainer wm1 = address.Assign(wm1Devices);
+    address.SetBase("10.1.0.4", "255.255.255.252");
+    Ipv4InterfaceContainer m12 = address.Assign(m12Devices);
+    address.SetBase("10.1.0.8", "255.255.255.252");
+    Ipv4InterfaceContainer m2e = address.Assign(longHaul.Install(m2, e));
+    address.SetBase("10.1.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer s1Access = address.Assign(access.Install(m1, s1));
+    address.SetBase("10.1.2.0", "255.255.255.0");
+    Ipv4InterfaceContainer s2Access = address.Assign(access.Install(m2, s2));
+    address.SetBase("10.2.0.0", "255.255.255.252");
+    Ipv4InterfaceContainer xab = address.Assign(xabDevices);
+    address.SetBase("10.2.1.0", "255.255.255.0");
+    Ipv4InterfaceContainer d1Access = address.Assign(access.Install(xa, d1));
+    address.SetBase("10.2.2.0", "255.255.255.0");
+    Ipv4InterfaceContainer d2Access = address.Assign(access.Install(xb, d2));
+
+    IncrementalSpfRouting igp;
+    igp.Populate(nodes);
+
+    NetDeviceContainer ixpADevices = access.Install(w, xa);
+    NetDeviceContainer ixpBDevices = access.Install(e, xb);
+    address.SetBase("192.168.100.0", "255.255.255.252");
+    Ipv4InterfaceContainer ixpA = address.Assign(ixpADevices);
+    address.SetBase("192.168.200.0", "255.255.255.252");
+    Ipv4InterfaceContainer ixpB = address.Assign(ixpBDevices);
+
+    Ipv4StaticRoutingHelper staticRouting;
+    staticRouting.GetStaticRouting(s1->GetObject<Ipv4>())->SetDefaultRoute(s1Access.GetAddress(0), 1);
+    staticRouting.GetStaticRouting(s2->GetObject<Ipv4>())->SetDefaultRoute(s2Access.GetAddress(0), 1);
+    staticRouting.GetStaticRouting(d1->GetObject<Ipv4>())->SetDefaultRoute(d1Access.GetAddress(0), 1);
+    staticRouting.GetStaticRouting(d2->GetObject<Ipv4>())->SetDefaultRoute(d2Access.GetAddress(0), 1);
+
+    // Every router is known by one address inside its AS
+    BgpHelper bgp;
+    bgp.SetAttribute("StartTime", TimeValue(Seconds(0.5)));
+    std::vector<Ptr<Node>> as65001{w, m1, m2, e};
+    std::vector<Ipv4Address> as65001Addresses{wm1.GetAddress(0), wm1.GetAddress(1), m12.GetAddress(1),
+                                              m2e.GetAddress(1)};
+    std::vector<Ptr<BgpSpeaker>> speakers;
+    for (Ptr<Node> router : as65001) {
+        speakers.push_back(bgp.Install(router, 65001));
+    }
+    for (uint32_t a = 0; a < speakers.size(); ++a) {
+        for (uint32_t b = a + 1; b < speakers.size(); ++b) {
+            BgpHelper::Peer(speakers[a], as65001Addresses[a], speakers[b], as65001Addresses[b]);
+        }
+    }
+    Ptr<BgpSpeaker> xaBgp = bgp.Install(xa, 65002);
+    Ptr<BgpSpeaker> xbBgp = bgp.Install(xb, 65002);
+    BgpHelper::Peer(xaBgp, xab.GetAddress(0), xbBgp, xab.GetAddress(1));
+    BgpHelper::Peer(speakers[0], ixpA.GetAddress(0), xaBgp, ixpA.GetAddress(1));
+    BgpHelper::Peer(speakers[3], ixpB.GetAddress(0), xbBgp, ixpB.GetAddress(1));
+    speakers[0]->AddNetwork(Ipv4Address("10.1.0.0"), Ipv4Mask("255.255.0.0"));
+    speakers[3]->AddNetwork(Ipv4Address("10.1.0.0"), Ipv4Mask("255.255.0.0"));
+    BgpPathAttributes xbAttributes;
+    if (mode == PRIMARY) {
+        xbAttributes.asPath.push_back(65002);
+    }
+    for (BgpPrefix destination : {BgpPrefix(0x0a020100, 24), BgpPrefix(0x0a020200, 24)}) {
+        xaBgp->AddRoute(destination, BgpPathAttributes());
+        xbBgp->AddRoute(destination, xbAttributes);
+    }
+    if (mode == HOT_POTATO) {
+        for (uint32_t i = 0; i < speakers.size(); ++i) {
+            speakers[i]->SetIgpCostCallback(igp.GetCostCallback(as65001[i]));
+            igp.AddCostChangeCallback(MakeCallback(&BgpSpeaker::NotifyIgpChange, speakers[i]));
+        }
+    }
+    if (reweight > 0) {
+        Simulator::Schedule(Seconds(reweight), &Reweight, &igp, wm1Devices, 10);
+    }
+
+    TrafficMatrix matrix;
+    matrix.AddEndpoint(s1, s1Access.GetAddress(1), 65001);
+    matrix.AddEndpoint(s2, s2Access.GetAddress(1), 65001);
+    matrix.AddEndpoint(d1, d1Access.GetAddress(1), 65002);
+    matrix.AddEndpoint(d2, d2Access.GetAddress(1), 65002);
+    matrix.Gravity(load, true);
+    TrafficMatrixHelper matrixHelper;
+    ApplicationContainer apps = matrixHelper.Install(matrix);
+    apps.Start(Seconds(start));
+    apps.Stop(Seconds(stop));
+
+    g_linkBytes.assign(N_LINKS, 0);
+    g_measureStart = Seconds(start);
+    NetDeviceContainer links[N_LINKS] = {ixpADevices, ixpBDevices, m12Devices, xabDevices};
+    for (uint32_t link = 0; link < N_LINKS; ++link) {
+        for (uint32_t end = 0; end < 2; ++end) {
+            links[link].Get(end)->TraceConnectWithoutContext("MacTx", MakeBoundCallback(&LinkTx, link));
+        }
+    }
+    FlowMonitorHelper flowmon;
+    Ptr<FlowMonitor> monitor = flowmon.InstallAll();
+
+    Simulator::Stop(Seconds(stop + 1));
+    Simulator::Run();
+
+    HotPotatoRun run;
+    double capacity = 2 * 100e6 * (stop - start); // both directions, bits
+    for (uint32_t link = 0; link < N_LINKS; ++link) {
+        run.utilisation[link] = g_linkBytes[link] * 8.0 / capacity;
+    }
+    monitor->CheckForLostPackets();
+    Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
+    Time delay[2];
+    uint64_t packets[2] = {0, 0};
+    for (const auto& flow : monitor->GetFlowStats()) {
+        Ipv4Address source = classifier->FindFlow(flow.first).sourceAddress;
+        for (uint32_t i = 0; i < 2; ++i) {
+            if (source == (i == 0 ? s1Access : s2Access).GetAddress(1)) {
+                delay[i] += flow.second.delaySum;
+                packets[i] += flow.second.rxPackets;
+            }
+        }
+    }
+    run.s1DelayMs = packets[0] ? delay[0].GetSeconds() * 1000.0 / packets[0] : 0;
+    run.s2DelayMs = packets[1] ? delay[1].GetSeconds() * 1000.0 / packets[1] : 0;
+    run.s1Exit = ExitOf(speakers[1], Ipv4Address("10.2.1.0"), as65001Addresses[0], as65001Addresses[3]);
+    run.s2Exit = ExitOf(speakers[2], Ipv4Address("10.2.1.0"), as65001Addresses[0], as65001Addresses[3]);
+    Simulator::Destroy();
+    return run;
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string load = "40Mbps";
+    double start = 5;
+    double time = 20;
+    double reweight = 0;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("load", "Total offered inter-AS traffic", load);
+    cmd.AddValue("start", "Seconds before the traffic starts (BGP converges first)", start);
+    cmd.AddValue("time", "Simulated seconds", time);
+    cmd.AddValue("reweight", "Raise the W-M1 metric to 10 at this time in seconds (0: never)", reweight);
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_UNLESS(start < time, "--start must be before --time");
+
+    std::cout << "========== HOT-POTATO EXITS, " << load << " BETWEEN AS65001 AND AS65002 ==========\n";
+    std::cout << "Mode        IXP-A   IXP-B   M1-M2   XA-XB   S1 delay (ms)  S2 delay (ms)  S1 exit  S2 exit\n";
+    const char* names[] = {"primary", "router-id", "hot-potato"};
+    bool split = false;
+    for (ExitMode mode : {PRIMARY, ROUTER_ID, HOT_POTATO}) {
+        HotPotatoRun run = RunExits(mode, DataRate(load).GetBitRate(), start, time, reweight);
+        std::cout << std::left << std::setw(10) << names[mode] << std::right << std::fixed << std::setprecision(1);
+        for (uint32_t link = 0; link < N_LINKS; ++link) {
+            std::cout << std::setw(7) << run.utilisation[link] * 100.0 << "%";
+        }
+        std::cout << std::setprecision(2) << std::setw(15) << run.s1DelayMs << std::setw(15) << run.s2DelayMs
+                  << std::setw(9) << run.s1Exit << std::setw(9) << run.s2Exit << "\n";
+        if (mode == HOT_POTATO) {
+            split = run.s2Exit == "IXP-B" && run.s1Exit == (reweight > 0 && reweight < time ? "IXP-B" : "IXP-A");
+        }
+    }
+    std::cout << "\nLoad: bytes sent in both directions over the link's capacity while the traffic runs.\n"
+              << "Delay: mean one-way delay of the flows from the source, to both destinations.\n";
+    if (!split) {
+        std::cout << "ERROR: in hot-potato mode the sources did not leave at their closest exit\n";
+    }
+    return split ? 0 : 1;
+}
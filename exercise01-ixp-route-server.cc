@@ -0,0 +1,137 @@
+/*
+ * IXP route server: per-peer UPDATEs vs. update groups as membership grows
+ *
+ * IXP-A of exercise01 as a real exchange: --members routers on one
+ * switched peering LAN (wan-ixp-fabric.h), each in its own AS and
+ * originating --prefixes prefixes, plus a route server (BgpSpeaker with
+ * RouteServer). Members only peer with the route server, which passes
+ * every member's routes on to all the others with the originator's
+ * AS_PATH and NEXT_HOP, so traffic between members never crosses it.
+ *
+ * Every membership size is run twice:
+ *
+ *   per-peer: the route server keeps an Adj-RIB-Out per member and builds
+ *             and encodes every UPDATE once per member;
+ *   groups:   UpdateGroups puts all members into one update group, so
+ *             each UPDATE is built once and the encoded message is queued
+ *             to every member.
+ *
+ * The report gives the process CPU time to converge (all members hold the
+ * routes of all others), the UPDATE messages the route server encoded and
+ * sent and the memory of its RIBs (BgpSpeaker::GetMemoryUsage()). Members
+ * receive the same routes in both modes, so the difference in CPU time is
+ * the route server's.
+ *
+ * Example: ./ns3 run "scratch/exercise01-ixp-route-server --members=10,100,1000"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "wan-bgp-speaker.h"
+#include "wan-ixp-fabric.h"
+
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("IxpRouteServer");
+
+static constexpr uint32_t ROUTE_SERVER_AS = 64500;
+static constexpr uint32_t FIRST_MEMBER_AS = 100000;
+
+struct RouteServerRun
+{
+    double cpuSeconds = 0;
+    uint64_t updatesEncoded = 0;
+    uint64_t updatesSent = 0;
+    uint32_t groups = 0;
+    std::size_t ribBytes = 0;
+    uint32_t convergedMembers = 0;
+};
+
+RouteServerRun RunExchange(uint32_t members, uint32_t prefixes, bool updateGroups)
+{
+    NodeContainer routers;
+    routers.Create(members + 1); // route server last
+    InternetStackHelper stack;
+    stack.Install(routers);
+    IxpFabricHelper fabricHelper;
+    IxpFabric fabric = fabricHelper.Install(routers, "80.81.192.0", "255.255.240.0");
+
+    BgpHelper memberBgp;
+    memberBgp.SetAttribute("StartTime", TimeValue(Seconds(1)));
+    BgpHelper serverBgp;
+    serverBgp.SetAttribute("StartTime", TimeValue(Seconds(1)));
+    serverBgp.SetAttribute("RouteServer", BooleanValue(true));
+    serverBgp.SetAttribute("UpdateGroups", BooleanValue(updateGroups));
+    Ptr<BgpSpeaker> routeServer = serverBgp.Install(routers.Get(members), ROUTE_SERVER_AS);
+    Ipv4Address serverAddress = fabric.addresses.GetAddress(members);
+
+    std::vector<Ptr<BgpSpeaker>> speakers;
+    for (uint32_t i = 0; i < members; ++i) {
+        Ptr<BgpSpeaker> speaker = memberBgp.Install(routers.Get(i), FIRST_MEMBER_AS + i);
+        BgpHelper::Peer(speaker, fabric.addresses.GetAddress(i), routeServer, serverAddress);
+        for (uint32_t k = 0; k < prefixes; ++k) {
+            speaker->AddNetwork(Ipv4Address(0x64000000 + ((i * prefixes + k) << 8)), "255.255.255.0");
+        }
+        speakers.push_back(speaker);
+    }
+
+    std::clock_t start = std::clock();
+    Simulator::Stop(Seconds(5));
+    Simulator::Run();
+
+    RouteServerRun run;
+    run.cpuSeconds = double(std::clock() - start) / CLOCKS_PER_SEC;
+    const BgpSpeaker::Statistics& stats = routeServer->GetStatistics();
+    run.updatesEncoded = stats.updatesEncoded;
+    run.updatesSent = stats.updatesSent;
+    run.groups = routeServer->GetNUpdateGroups();
+    run.ribBytes = routeServer->GetMemoryUsage();
+    for (const auto& speaker : speakers) {
+        if (speaker->GetNRoutes() == members * prefixes) {
+            run.convergedMembers++;
+        }
+    }
+    Simulator::Destroy();
+    return run;
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string memberList = "10,100,1000";
+    uint32_t prefixes = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("members", "Comma-separated numbers of IXP members to measure", memberList);
+    cmd.AddValue("prefixes", "Prefixes originated by every member", prefixes);
+    cmd.Parse(argc, argv);
+
+    std::vector<uint32_t> sizes;
+    std::stringstream list(memberList);
+    for (std::string item; std::getline(list, item, ',');) {
+        sizes.push_back(std::stoul(item));
+    }
+
+    std::cout << "========== ROUTE SERVER, " << prefixes << " PREFIXES PER MEMBER ==========\n";
+    std::cout << "Members  Mode      Groups  CPU (s)  UPDATEs encoded  UPDATEs sent  RIB (MiB)  Converged\n";
+    bool converged = true;
+    for (uint32_t members : sizes) {
+        for (bool updateGroups : {false, true}) {
+            RouteServerRun run = RunExchange(members, prefixes, updateGroups);
+            std::cout << std::setw(7) << members << "  " << std::left << std::setw(8)
+                      << (updateGroups ? "groups" : "per-peer") << std::right << std::setw(8) << run.groups
+                      << std::fixed << std::setprecision(2) << std::setw(9) << run.cpuSeconds << std::setw(17)
+                      << run.updatesEncoded << std::setw(14) << run.updatesSent << std::setw(11)
+                      << run.ribBytes / 1048576.0 << std::setw(7) << run.convergedMembers << "/" << members
+                      << "\n";
+            converged = converged && run.convergedMembers == members;
+        }
+    }
+    return converged ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+#!/bin/sh
+#
+# Speedup of the distributed inter-AS scenario
+#
+# Runs exercise01-as-topology-scaling with BGP for growing AS counts, once
+# sequentially and once under mpirun for each rank count, and prints the
+# BGP run's wall-clock times and the speedup over the sequential run.
+#
+# Usage: copy next to the exercise scripts in scratch/ and run from the ns-3
+# root (ns-3 configured with --enable-mpi and built), e.g.
+#   sh scratch/exercise01-mpi-speedup.sh "250 500 1000 2000" "2 4" 30
+#
+
+ASES=${1:-"250 500 1000 2000"}
+RANKS=${2:-"2 4"}
+TIME=${3:-30}
+SCRIPT=scratch/exercise01-as-topology-scaling
+
+# Seconds of the "Wall-clock:" line of a run's output
+wallclock() {
+    grep '^Wall-clock:' | awk '{ print $2 }'
+}
+
+printf "%8s %12s" "ASes" "sequential"
+for n in $RANKS; do
+    printf " %12s %8s" "$n ranks" "speedup"
+done
+printf "\n"
+
+for ases in $ASES; do
+    args="--ases=$ases --bgp --time=$TIME"
+    seq=$(./ns3 run --no-build "$SCRIPT $args" | wallclock)
+    printf "%8s %11ss" "$ases" "$seq"
+    for n in $RANKS; do
+        par=$(mpirun -np "$n" ./ns3 run --no-build "$SCRIPT $args --mpi" | wallclock)
+        printf " %11ss %7sx" "$par" "$(echo "$seq $par" | awk '{ printf "%.2f", $1 / $2 }')"
+    done
+    printf "\n"
+done
@@ -0,0 +1,168 @@
+/*
+ * BGP failover time against table size: flat FIB vs. prefix-independent convergence
+ *
+ * The border situation of exercise01 reduced to one router: R (AS65001)
+ * learns the same --sizes prefixes from two eBGP neighbours in AS65002,
+ * X over the IXP-A link and Y over the IXP-B link. Y prepends its AS, so
+ * every best path goes through X and every prefix has Y as second path.
+ * Once converged, the session to X is torn down (as BFD or a hold timer
+ * expiry would do) and the program measures the wall-clock time of that
+ * call, which is the time until R forwards every prefix over Y again:
+ *
+ *   flat: the decision process runs for every prefix learned from X and
+ *         rewrites its FIB entry, so the failover grows with the table;
+ *   pic:  BgpSpeaker's PrefixIndependentConvergence; the FIB entries point
+ *         to a next-hop group {X, backup Y} and only X's next-hop entry is
+ *         written. The per-prefix decision process runs afterwards, while
+ *         traffic already flows over Y; its time is reported separately.
+ *
+ * After the failover a sample of prefixes is looked up through R's
+ * RouteOutput() and must leave towards Y, or the program fails.
+ *
+ * Example: ./ns3 run "scratch/exercise01-pic-failover-benchmark --sizes=10,1000,100000,1000000"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-bgp-speaker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("PicFailoverBenchmark");
+
+struct FailoverResult
+{
+    double failoverSeconds = 0;
+    double reconvergeSeconds = 0;
+    uint64_t fibWrites = 0;
+    uint64_t backgroundFibWrites = 0;
+    uint32_t groups = 0;
+    uint32_t wrongNextHop = 0;
+};
+
+// i-th benchmark prefix: consecutive /24s from 20.0.0.0
+BgpPrefix BenchmarkPrefix(uint32_t i)
+{
+    return BgpPrefix(0x14000000 + (i << 8), 24);
+}
+
+double Elapsed(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+FailoverResult RunFailover(uint32_t prefixes, bool pic)
+{
+    NodeContainer routers;
+    routers.Create(3); // R, X, Y
+    InternetStackHelper stack;
+    stack.Install(routers);
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("10Gbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    Ipv4AddressHelper address;
+    address.SetBase("192.168.100.0", "255.255.255.252");
+    Ipv4InterfaceContainer ixpA = address.Assign(p2p.Install(routers.Get(0), routers.Get(1)));
+    address.SetBase("192.168.200.0", "255.255.255.252");
+    Ipv4InterfaceContainer ixpB = address.Assign(p2p.Install(routers.Get(0), routers.Get(2)));
+
+    BgpHelper bgp;
+    bgp.SetAttribute("StartTime", TimeValue(Seconds(0.1)));
+    bgp.SetAttribute("PrefixIndependentConvergence", BooleanValue(pic));
+    Ptr<BgpSpeaker> r = bgp.Install(routers.Get(0), 65001);
+    Ptr<BgpSpeaker> x = bgp.Install(routers.Get(1), 65002);
+    Ptr<BgpSpeaker> y = bgp.Install(routers.Get(2), 65002);
+    BgpHelper::Peer(r, ixpA.GetAddress(0), x, ixpA.GetAddress(1));
+    BgpHelper::Peer(r, ixpB.GetAddress(0), y, ixpB.GetAddress(1));
+
+    BgpPathAttributes prepended;
+    prepended.asPath.push_back(65002);
+    for (uint32_t i = 0; i < prefixes; ++i) {
+        x->AddRoute(BenchmarkPrefix(i), BgpPathAttributes());
+        y->AddRoute(BenchmarkPrefix(i), prepended);
+    }
+
+    // Converge; the updates of a full table take a few ms of simulated time
+    for (Time stop = Seconds(1); r->GetNRoutes() < prefixes && stop <= Seconds(60); stop += Seconds(1)) {
+        Simulator::Stop(stop - Simulator::Now());
+        Simulator::Run();
+    }
+    NS_ABORT_MSG_UNLESS(r->GetNRoutes() == prefixes,
+                        "R did not converge: " << r->GetNRoutes() << "/" << prefixes << " routes");
+
+    FailoverResult result;
+    const BgpSpeaker::Statistics& stats = r->GetStatistics();
+    uint64_t writesBefore = stats.fibUpdates + stats.nextHopsDown;
+    auto start = std::chrono::steady_clock::now();
+    r->NotifyPeerDown(ixpA.GetAddress(1));
+    result.failoverSeconds = Elapsed(start);
+    result.fibWrites = stats.fibUpdates + stats.nextHopsDown - writesBefore;
+
+    // Forwarding must already use Y, before any background work has run
+    Ipv4Header header;
+    Socket::SocketErrno err;
+    uint32_t step = std::max<uint32_t>(1, prefixes / 1000);
+    for (uint32_t i = 0; i < prefixes; i += step) {
+        header.SetDestination(Ipv4Address(BenchmarkPrefix(i).address + 1));
+        Ptr<Ipv4Route> route = r->RouteOutput(nullptr, header, nullptr, err);
+        if (!route || route->GetGateway() != ixpB.GetAddress(1)) {
+            result.wrongNextHop++;
+        }
+    }
+
+    uint64_t fibUpdatesBefore = stats.fibUpdates;
+    start = std::chrono::steady_clock::now();
+    Simulator::Stop(MilliSeconds(1));
+    Simulator::Run();
+    result.reconvergeSeconds = Elapsed(start);
+    result.backgroundFibWrites = stats.fibUpdates - fibUpdatesBefore;
+    result.groups = r->GetNFibGroups();
+
+    Simulator::Destroy();
+    return result;
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string sizeList = "10,100,1000,10000,100000,1000000";
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("sizes", "Comma-separated numbers of prefixes learned over each IXP", sizeList);
+    cmd.Parse(argc, argv);
+
+    std::vector<uint32_t> sizes;
+    std::stringstream list(sizeList);
+    for (std::string item; std::getline(list, item, ',');) {
+        sizes.push_back(std::stoul(item));
+    }
+
+    std::cout << "========== IXP-A FAILOVER AT R ==========\n";
+    std::cout << "Prefixes  FIB    Failover (ms)  FIB writes  Groups  Background (ms)  Background writes\n";
+    uint32_t failures = 0;
+    for (uint32_t size : sizes) {
+        for (bool pic : {false, true}) {
+            FailoverResult result = RunFailover(size, pic);
+            std::cout << std::setw(8) << size << "  " << std::left << std::setw(5) << (pic ? "pic" : "flat")
+                      << std::right << std::fixed << std::setprecision(3) << std::setw(15)
+                      << result.failoverSeconds * 1000.0 << std::setw(12) << result.fibWrites << std::setw(8)
+                      << result.groups << std::setw(17) << result.reconvergeSeconds * 1000.0 << std::setw(19)
+                      << result.backgroundFibWrites << "\n";
+            if (result.wrongNextHop > 0) {
+                std::cout << "  ERROR: " << result.wrongNextHop << " sampled prefixes not forwarded to Y\n";
+                failures++;
+            }
+        }
+    }
+    std::cout << "\nFailover: NotifyPeerDown() until every prefix forwards over Y.\n"
+              << "Background: the per-prefix decision process PIC defers (flat FIB: UPDATE work only).\n";
+    return failures == 0 ? 0 : 1;
+}
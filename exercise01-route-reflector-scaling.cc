@@ -0,0 +1,204 @@
+/*
+ * iBGP scaling inside one AS: full mesh vs. route reflector hierarchy
+ *
+ * AS65001 of exercise01 grown to --sizes routers. All of them share one
+ * switched LAN (wan-ixp-fabric.h), so every iBGP session is a single hop
+ * and no IGP is needed; router 0 is the border router and learns
+ * --prefixes prefixes over eBGP from X (AS65002). Every size is run twice:
+ *
+ *   mesh: every router has an iBGP session to every other one,
+ *         n(n-1)/2 sessions;
+ *   rr:   routers 1 and 2 are route reflectors of one cluster and every
+ *         other router is a client of both. Beyond --clusterSize clients
+ *         the hierarchy gets a second level: the clients are split into
+ *         clusters of --clusterSize, each with two reflectors of its own
+ *         that are clients of routers 1 and 2. About 2n sessions.
+ *
+ * All speakers use UpdateGroups, so a router encodes each UPDATE once
+ * whatever its number of iBGP peers. The report gives the iBGP sessions,
+ * the largest number of sessions on one router, the UPDATE messages sent,
+ * the memory of all RIBs (BgpSpeaker::GetMemoryUsage(), TCP sockets not
+ * included) and the convergence time from the session start to the last
+ * best-path change in AS65001. A router counts as converged when it holds
+ * every prefix with router 0 as next hop, so reflected routes must not
+ * have had their NEXT_HOP rewritten.
+ *
+ * Example: ./ns3 run "scratch/exercise01-route-reflector-scaling --sizes=3,10,50,100,500"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-bgp-speaker.h"
+#include "wan-ixp-fabric.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("RouteReflectorScaling");
+
+struct IbgpRun
+{
+    uint32_t sessions = 0;
+    uint32_t maxPeers = 0;
+    uint32_t reflectors = 0;
+    uint64_t updatesSent = 0;
+    std::size_t ribBytes = 0;
+    double convergenceSeconds = 0;
+    uint32_t converged = 0;
+};
+
+// i-th external prefix: consecutive /24s from 20.0.0.0
+BgpPrefix ExternalPrefix(uint32_t i)
+{
+    return BgpPrefix(0x14000000 + (i << 8), 24);
+}
+
+IbgpRun RunAs(uint32_t routers, uint32_t prefixes, bool reflection, uint32_t clusterSize, Time stop)
+{
+    NodeContainer nodes;
+    nodes.Create(routers + 1); // AS65001 routers, then X
+    InternetStackHelper stack;
+    stack.Install(nodes);
+    NodeContainer as65001;
+    for (uint32_t i = 0; i < routers; ++i) {
+        as65001.Add(nodes.Get(i));
+    }
+    IxpFabricHelper lanHelper;
+    IxpFabric lan = lanHelper.Install(as65001, "10.1.0.0", "255.255.0.0");
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    Ipv4AddressHelper address;
+    address.SetBase("192.168.100.0", "255.255.255.252");
+    Ipv4InterfaceContainer ixp = address.Assign(p2p.Install(nodes.Get(0), nodes.Get(routers)));
+
+    Time start = Seconds(1);
+    BgpHelper bgp;
+    bgp.SetAttribute("StartTime", TimeValue(start));
+    bgp.SetAttribute("UpdateGroups", BooleanValue(true));
+    std::vector<Ptr<BgpSpeaker>> speakers;
+    for (uint32_t i = 0; i < routers; ++i) {
+        speakers.push_back(bgp.Install(nodes.Get(i), 65001));
+    }
+    Ptr<BgpSpeaker> x = bgp.Install(nodes.Get(routers), 65002);
+    BgpHelper::Peer(speakers[0], ixp.GetAddress(0), x, ixp.GetAddress(1));
+    for (uint32_t i = 0; i < prefixes; ++i) {
+        x->AddRoute(ExternalPrefix(i), BgpPathAttributes());
+    }
+
+    IbgpRun run;
+    auto peer = [&](uint32_t a, uint32_t b) {
+        BgpHelper::Peer(speakers[a], lan.addresses.GetAddress(a), speakers[b], lan.addresses.GetAddress(b));
+        run.sessions++;
+    };
+    auto client = [&](uint32_t reflector, uint32_t c) {
+        BgpHelper::ReflectorClient(speakers[reflector], lan.addresses.GetAddress(reflector), speakers[c],
+                                   lan.addresses.GetAddress(c));
+        run.sessions++;
+    };
+    if (!reflection || routers < 3) {
+        for (uint32_t a = 0; a < routers; ++a) {
+            for (uint32_t b = a + 1; b < routers; ++b) {
+                peer(a, b);
+            }
+        }
+    } else {
+        // Top level: routers 1 and 2, one cluster, meshed with each other
+        peer(1, 2);
+        run.reflectors = 2;
+        for (uint32_t top : {1u, 2u}) {
+            speakers[top]->SetAttribute("ClusterId", Ipv4AddressValue(Ipv4Address("10.255.0.1")));
+        }
+        std::vector<uint32_t> direct{0};
+        if (routers - 3 <= clusterSize) {
+            for (uint32_t i = 3; i < routers; ++i) {
+                direct.push_back(i);
+            }
+        } else {
+            // Second level: clusters of clusterSize, the first two routers of each reflect
+            for (uint32_t first = 3, cluster = 2; first < routers; first += clusterSize, ++cluster) {
+                uint32_t last = std::min(routers, first + clusterSize);
+                uint32_t reflectors = std::min<uint32_t>(2, last - first);
+                for (uint32_t r = first; r < first + reflectors; ++r) {
+                    direct.push_back(r);
+                    speakers[r]->SetAttribute("ClusterId", Ipv4AddressValue(Ipv4Address(0x0aff0000 + cluster)));
+                    for (uint32_t c = first + reflectors; c < last; ++c) {
+                        client(r, c);
+                    }
+                }
+                run.reflectors += reflectors;
+            }
+        }
+        for (uint32_t c : direct) {
+            client(1, c);
+            client(2, c);
+        }
+    }
+
+    Simulator::Stop(stop);
+    Simulator::Run();
+
+    Time lastChange;
+    Ipv4Address border = lan.addresses.GetAddress(0);
+    for (uint32_t i = 0; i < routers; ++i) {
+        const BgpSpeaker::Statistics& stats = speakers[i]->GetStatistics();
+        run.updatesSent += stats.updatesSent;
+        run.ribBytes += speakers[i]->GetMemoryUsage();
+        run.maxPeers = std::max(run.maxPeers, speakers[i]->GetNPeers() - (i == 0 ? 1 : 0));
+        lastChange = std::max(lastChange, stats.lastBestPathChange);
+        const BgpPathAttributes* path =
+            speakers[i]->GetBestPath(ExternalPrefix(0).GetAddress(), Ipv4Mask("255.255.255.0"));
+        if (speakers[i]->GetNRoutes() == prefixes && path && (i == 0 || path->nextHop == border)) {
+            run.converged++;
+        }
+    }
+    run.convergenceSeconds = (lastChange - start).GetSeconds();
+    Simulator::Destroy();
+    return run;
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string sizeList = "3,10,50,100,500";
+    uint32_t prefixes = 1000;
+    uint32_t clusterSize = 50;
+    double time = 30;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("sizes", "Comma-separated numbers of routers in the AS", sizeList);
+    cmd.AddValue("prefixes", "Prefixes learned by the border router", prefixes);
+    cmd.AddValue("clusterSize", "Clients per reflector pair before a second reflector level is added", clusterSize);
+    cmd.AddValue("time", "Simulated seconds per run", time);
+    cmd.Parse(argc, argv);
+    NS_ABORT_MSG_UNLESS(clusterSize >= 3, "--clusterSize must leave room for two reflectors and a client");
+
+    std::vector<uint32_t> sizes;
+    std::stringstream list(sizeList);
+    for (std::string item; std::getline(list, item, ',');) {
+        sizes.push_back(std::stoul(item));
+    }
+
+    std::cout << "========== iBGP IN AS65001, " << prefixes << " EXTERNAL PREFIXES ==========\n";
+    std::cout << "Routers  Mode  Reflectors  Sessions  Max/router  UPDATEs  RIB (MiB)  Convergence (ms)  Converged\n";
+    bool converged = true;
+    for (uint32_t routers : sizes) {
+        for (bool reflection : {false, true}) {
+            IbgpRun run = RunAs(routers, prefixes, reflection, clusterSize, Seconds(time));
+            std::cout << std::setw(7) << routers << "  " << std::left << std::setw(4) << (reflection ? "rr" : "mesh")
+                      << std::right << std::setw(12) << run.reflectors << std::setw(10) << run.sessions
+                      << std::setw(12) << run.maxPeers << std::setw(9) << run.updatesSent << std::fixed
+                      << std::setprecision(2) << std::setw(11) << run.ribBytes / 1048576.0 << std::setw(18)
+                      << run.convergenceSeconds * 1000.0 << std::setw(7) << run.converged << "/" << routers
+                      << "\n";
+            converged = converged && run.converged == routers;
+        }
+    }
+    return converged ? 0 : 1;
+}
@@ -0,0 +1,244 @@
+/*
+ * Cost of BGP import validation at full-table scale
+ *
+ * Times the checks BgpRouteValidator (wan-route-validation.h) runs for every
+ * route an IXP router of exercise01 receives: RPKI origin validation against
+ * a ROA table and the valley-free check of the AS_PATH. Each check is timed
+ * on its own and combined, in nanoseconds per route, over a full table.
+ *
+ * Inputs are real files when given (--roaFile: validator CSV export,
+ * --asRelFile: CAIDA as-rel, --ribFile: any format MrtRibLoader reads) and
+ * synthetic otherwise:
+ *  - ROAs on random /16 - /24 prefixes (mostly /24s), a quarter of them with
+ *    more specific ROAs nested inside;
+ *  - a three-tier AS hierarchy (tier-1 clique, transit, stubs) and routes
+ *    whose AS_PATH follows it up and down, with --leakPercent of the paths
+ *    leaked through a transit AS (a valley);
+ *  - routes that are sub-prefixes of ROAs (valid, or invalid through a
+ *    wrong origin or too long a prefix) or unrelated (not found).
+ *
+ * Example: ./ns3 run "scratch/exercise01-route-validation-benchmark --roas=500000 --routes=1000000"
+ */
+
+#include "ns3/core-module.h"
+#include "wan-mrt-loader.h"
+#include "wan-route-validation.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("RouteValidationBenchmark");
+
+static const uint32_t LOCAL_AS = 65001;
+static const uint32_t TIER1 = 16;
+static const uint32_t TRANSIT = 4000;
+static const uint32_t STUBS = 60000;
+
+struct Route
+{
+    BgpPrefix prefix;
+    BgpPathAttributes attributes;
+};
+
+// AS numbers: tier 1 = 1..TIER1, transit = next TRANSIT, stubs after that
+uint32_t TransitAs(uint32_t i) { return 1 + TIER1 + i; }
+uint32_t StubAs(uint32_t i) { return 1 + TIER1 + TRANSIT + i; }
+uint32_t ProviderOfTransit(uint32_t transit) { return 1 + (transit * 7) % TIER1; }
+uint32_t ProviderOfStub(uint32_t stub) { return TransitAs((stub * 13) % TRANSIT); }
+
+void BuildHierarchy(AsRelationships& relationships)
+{
+    for (uint32_t a = 1; a <= TIER1; ++a) {
+        for (uint32_t b = a + 1; b <= TIER1; ++b) {
+            relationships.AddPeers(a, b);
+        }
+    }
+    for (uint32_t i = 0; i < TRANSIT; ++i) {
+        relationships.AddProviderCustomer(ProviderOfTransit(i), TransitAs(i));
+        relationships.AddProviderCustomer(1, TransitAs(i)); // every transit AS also buys from AS 1
+    }
+    for (uint32_t i = 0; i < STUBS; ++i) {
+        relationships.AddProviderCustomer(ProviderOfStub(i), StubAs(i));
+    }
+    relationships.AddProviderCustomer(1, LOCAL_AS); // our transit comes from tier-1 AS 1
+}
+
+// AS_PATH from a stub origin up to its tier-1, across to AS 1 and down to us
+std::vector<uint32_t> HierarchyPath(uint32_t origin, bool leak, std::mt19937& rng)
+{
+    uint32_t transit = ProviderOfStub(origin - StubAs(0));
+    uint32_t tier1 = ProviderOfTransit(transit - TransitAs(0));
+    std::vector<uint32_t> path{1};
+    if (leak) {
+        // A customer of the tier-1 re-exports the route to its other provider, AS 1
+        uint32_t leaker = rng() % TRANSIT;
+        while (ProviderOfTransit(leaker) != tier1) {
+            leaker = (leaker + 1) % TRANSIT;
+        }
+        path.push_back(TransitAs(leaker));
+    }
+    if (tier1 != 1 || leak) {
+        path.push_back(tier1);
+    }
+    path.push_back(transit);
+    path.push_back(origin);
+    return path;
+}
+
+void GenerateRoas(RoaTable& roas, std::vector<std::pair<BgpPrefix, uint32_t>>& authorized,
+                  uint32_t count, std::mt19937& rng)
+{
+    while (authorized.size() < count) {
+        uint8_t length = rng() % 3 == 0 ? 16 + rng() % 9 : 24; // most ROAs are for /24s
+        BgpPrefix prefix(0x01000000 + rng() % 0xde000000, length);
+        uint32_t origin = StubAs(rng() % STUBS);
+        uint8_t maxLength = std::min<uint8_t>(24, length + (rng() % 2 ? 0 : rng() % 4));
+        roas.Add(prefix, maxLength, origin);
+        authorized.emplace_back(BgpPrefix(prefix.address, maxLength), origin);
+        if (rng() % 4 == 0 && length < 24) {
+            uint8_t nestedLength = length + 1 + rng() % (24 - length);
+            BgpPrefix nested(prefix.address | (rng() & ~(0xffffffffu << (32 - length))), nestedLength);
+            uint32_t nestedOrigin = StubAs(rng() % STUBS);
+            roas.Add(nested, nestedLength, nestedOrigin);
+            authorized.emplace_back(nested, nestedOrigin);
+        }
+    }
+    roas.Build();
+}
+
+std::vector<Route> GenerateRoutes(const std::vector<std::pair<BgpPrefix, uint32_t>>& authorized,
+                                  uint32_t count, uint32_t leakPercent, std::mt19937& rng)
+{
+    std::vector<Route> routes(count);
+    for (Route& route : routes) {
+        uint32_t origin = StubAs(rng() % STUBS);
+        uint32_t kind = rng() % 10;
+        if (kind < 6 && !authorized.empty()) {
+            // Under a ROA: mostly valid, sometimes a wrong origin or too specific
+            const auto& roa = authorized[rng() % authorized.size()];
+            uint8_t length = roa.first.length;
+            if (kind == 5) {
+                length = std::min(32, length + 1 + static_cast<int>(rng() % 4));
+            } else if (kind != 4) {
+                origin = roa.second;
+            }
+            route.prefix = BgpPrefix(roa.first.address | (rng() & ~(0xffffffffu << (32 - roa.first.length))),
+                                     length);
+        } else {
+            route.prefix = BgpPrefix(0x01000000 + rng() % 0xde000000, 16 + rng() % 9);
+        }
+        route.attributes.asPath = HierarchyPath(origin, rng() % 100 < leakPercent, rng);
+    }
+    return routes;
+}
+
+template <class F>
+double NanosecondsPerRoute(const std::vector<Route>& routes, uint32_t rounds, F check)
+{
+    uint64_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t r = 0; r < rounds; ++r) {
+        for (const Route& route : routes) {
+            sink += check(route);
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    volatile uint64_t keep = sink;
+    (void)keep;
+    return seconds * 1e9 / (double(routes.size()) * rounds);
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t roaCount = 500000;
+    uint32_t routeCount = 1000000;
+    uint32_t leakPercent = 2;
+    uint32_t rounds = 3;
+    uint32_t seed = 1;
+    std::string roaFile = "";
+    std::string asRelFile = "";
+    std::string ribFile = "";
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("roas", "Synthetic ROAs (without --roaFile)", roaCount);
+    cmd.AddValue("routes", "Routes to validate (synthetic, or the first ones of --ribFile)", routeCount);
+    cmd.AddValue("leakPercent", "Synthetic routes leaked through a transit AS", leakPercent);
+    cmd.AddValue("rounds", "Passes over the routes per measurement", rounds);
+    cmd.AddValue("seed", "Seed of the synthetic data", seed);
+    cmd.AddValue("roaFile", "ROA CSV export (ASN,IP Prefix,Max Length)", roaFile);
+    cmd.AddValue("asRelFile", "CAIDA AS relationship file", asRelFile);
+    cmd.AddValue("ribFile", "RIB dump whose routes are validated", ribFile);
+    cmd.Parse(argc, argv);
+
+    std::mt19937 rng(seed);
+    RoaTable roas;
+    std::vector<std::pair<BgpPrefix, uint32_t>> authorized;
+    auto buildStart = std::chrono::steady_clock::now();
+    if (!roaFile.empty()) {
+        NS_ABORT_MSG_UNLESS(roas.Load(roaFile), roas.GetError());
+    } else {
+        GenerateRoas(roas, authorized, roaCount, rng);
+    }
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+
+    AsRelationships relationships;
+    if (!asRelFile.empty()) {
+        NS_ABORT_MSG_UNLESS(relationships.Load(asRelFile), relationships.GetError());
+    } else {
+        BuildHierarchy(relationships);
+    }
+
+    std::vector<Route> routes;
+    if (!ribFile.empty()) {
+        MrtRibLoader loader;
+        NS_ABORT_MSG_UNLESS(loader.Open(ribFile), loader.GetError());
+        loader.SetMaxRoutes(routeCount);
+        loader.Load([&routes](const BgpPrefix& prefix, const BgpPathAttributes& attributes) {
+            routes.push_back({prefix, attributes});
+        });
+    } else {
+        routes = GenerateRoutes(authorized, routeCount, leakPercent, rng);
+    }
+    NS_ABORT_MSG_IF(routes.empty(), "no routes to validate");
+
+    std::cout << "ROA table:     " << roas.GetNRoas() << " ROAs on " << roas.GetNPrefixes()
+              << " prefixes, " << std::fixed << std::setprecision(1)
+              << roas.GetMemoryUsage() / 1048576.0 << " MiB, built in " << buildSeconds << " s\n";
+    std::cout << "Relationships: " << relationships.GetNLinks() << " AS links\n";
+    std::cout << "Routes:        " << routes.size() << (ribFile.empty() ? " synthetic" : " from " + ribFile)
+              << "\n\n";
+
+    BgpRouteValidator validator(LOCAL_AS, &roas, &relationships);
+    for (const Route& route : routes) {
+        validator.Validate(route.prefix, route.attributes);
+    }
+    const BgpRouteValidator::Statistics& stats = validator.GetStatistics();
+    std::cout << "========== RESULTS ==========\n";
+    std::cout << "RPKI valid:     " << stats.rpkiValid << "\n";
+    std::cout << "RPKI invalid:   " << stats.rpkiInvalid << "\n";
+    std::cout << "RPKI not found: " << stats.rpkiNotFound << "\n";
+    std::cout << "Valleys:        " << stats.valleys << "\n";
+    std::cout << "Rejected:       " << stats.rejected << "\n\n";
+
+    double rpki = NanosecondsPerRoute(routes, rounds, [&roas](const Route& route) {
+        return route.attributes.asPath.empty()
+                   ? 0
+                   : static_cast<uint32_t>(roas.Validate(route.prefix, route.attributes.asPath.back()));
+    });
+    double valley = NanosecondsPerRoute(routes, rounds, [&relationships](const Route& route) {
+        return static_cast<uint32_t>(relationships.IsValleyFree(LOCAL_AS, route.attributes.asPath));
+    });
+    double combined = NanosecondsPerRoute(routes, rounds, [&validator](const Route& route) {
+        return static_cast<uint32_t>(validator.Validate(route.prefix, route.attributes));
+    });
+    std::cout << "========== COST PER ROUTE ==========\n";
+    std::cout << "RPKI origin validation: " << std::setw(7) << rpki << " ns\n";
+    std::cout << "Valley-free check:      " << std::setw(7) << valley << " ns\n";
+    std::cout << "BgpRouteValidator:      " << std::setw(7) << combined << " ns\n";
+    return 0;
+}
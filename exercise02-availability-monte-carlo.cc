@@ -0,0 +1,420 @@
+/*
+ * Availability of a WAN under random link failures: parallel Monte Carlo
+ *
+ * Every link fails and is repaired at random: it stays up for an
+ * exponentially distributed time with mean MTBF, then stays down for one
+ * with mean MTTR, and so on. A scenario draws one such history for every
+ * link over --horizon seconds and runs it as its own simulation, with
+ * RngRun = --firstRun + scenario number:
+ *
+ *   - each link starts up or down as it would be at a random moment of a
+ *     long life (down with probability MTTR / (MTBF + MTTR)), so the
+ *     horizon is a sample of steady state rather than of a fresh network;
+ *   - the history is replayed by a FaultInjector (wan-fault-injector.h);
+ *     --convergence ms after a failure or repair IncrementalSpfRouting
+ *     (wan-incremental-spf.h) reroutes around it;
+ *   - probes of 64 bytes, one every --probeInterval seconds per flow,
+ *     measure the service: availability is delivered / sent. Every router
+ *     has a /32 loopback address that the probes are sent to, so a router
+ *     stays reachable while any of its links is up.
+ *
+ * Topologies (--topology): "triangle" is exercise02's HQ / Branch / DC
+ * (links hq-branch, hq-dc and branch-dc), "ring" and "mesh" (a ring plus
+ * random chords, --degree links per router) have --nodes routers and links
+ * named "<a>-<b>". Every link has --mtbf and --mttr hours unless the
+ * --linkFile gives its own, one "<link> <mtbf h> <mttr h>" line per link.
+ * --flows probes random router pairs (0: every ordered pair).
+ *
+ * The scenarios run in --workers worker processes (wan-monte-carlo.h; 0:
+ * one per core). Results stream back as the scenarios end, and the mean
+ * availability is printed with its 95% confidence interval as it
+ * converges, then the distribution over the scenarios. --output writes one
+ * CSV line per scenario.
+ *
+ * Example: ./ns3 run "scratch/exercise02-availability-monte-carlo --scenarios=10000 --topology=mesh --nodes=20"
+ */
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-fault-injector.h"
+#include "wan-incremental-spf.h"
+#include "wan-monte-carlo.h"
+
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("AvailabilityMonteCarlo");
+
+struct WanLink
+{
+    uint32_t a;
+    uint32_t b;
+    std::string name;
+    double mtbf; ///< seconds
+    double mttr; ///< seconds
+};
+
+struct Config
+{
+    uint32_t nodes;
+    std::vector<WanLink> links;
+    std::vector<std::pair<uint32_t, uint32_t>> flows; ///< (source, destination)
+    double horizon;
+    double probeInterval;
+    double convergence; ///< seconds
+    uint32_t firstRun;
+};
+
+// The topology is plain data, built once before the workers start
+bool BuildTopology(Config& config, const std::string& topology, uint32_t nodes, uint32_t degree, uint32_t seed)
+{
+    config.links.clear();
+    if (topology == "triangle")
+    {
+        config.nodes = 3;
+        config.links = {{0, 1, "hq-branch"}, {0, 2, "hq-dc"}, {1, 2, "branch-dc"}};
+        return true;
+    }
+    if ((topology != "ring" && topology != "mesh") || nodes < 3)
+    {
+        return false;
+    }
+    config.nodes = nodes;
+    std::set<std::pair<uint32_t, uint32_t>> seen;
+    auto add = [&](uint32_t a, uint32_t b) {
+        if (a != b && seen.insert({std::min(a, b), std::max(a, b)}).second)
+        {
+            config.links.push_back({std::min(a, b), std::max(a, b),
+                                    std::to_string(std::min(a, b)) + "-" + std::to_string(std::max(a, b))});
+        }
+    };
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        add(i, (i + 1) % nodes);
+    }
+    if (topology == "mesh")
+    {
+        std::mt19937 rng(seed);
+        uint64_t chords = uint64_t(nodes) * (std::max<uint32_t>(degree, 2) - 2) / 2;
+        for (uint64_t c = 0; c < chords; ++c)
+        {
+            add(rng() % nodes, rng() % nodes);
+        }
+    }
+    return true;
+}
+
+// "<link> <mtbf hours> <mttr hours>" lines, # comments
+bool LoadLinkFile(Config& config, const std::string& path)
+{
+    std::ifstream input(path);
+    if (!input)
+    {
+        std::cerr << "Cannot open " << path << "\n";
+        return false;
+    }
+    std::map<std::string, WanLink*> byName;
+    for (WanLink& link : config.links)
+    {
+        byName[link.name] = &link;
+    }
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(input, line))
+    {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string name;
+        double mtbf;
+        double mttr;
+        if (!(fields >> name))
+        {
+            continue;
+        }
+        auto found = byName.find(name);
+        if (!(fields >> mtbf >> mttr) || mtbf <= 0 || mttr <= 0 || found == byName.end())
+        {
+            std::cerr << path << ":" << lineNumber << ": expected \"<link> <mtbf h> <mttr h>\" for a known link\n";
+            return false;
+        }
+        found->second->mtbf = mtbf * 3600;
+        found->second->mttr = mttr * 3600;
+    }
+    return true;
+}
+
+void CountPacket(uint64_t* counter, Ptr<const Packet> packet)
+{
+    (*counter)++;
+}
+
+// A /32 on a device without a channel: reachable over any link that is up
+void AddLoopback(Ptr<Node> node, Ipv4Address address)
+{
+    Ptr<SimpleNetDevice> device = CreateObject<SimpleNetDevice>();
+    device->SetAddress(Mac48Address::Allocate());
+    node->AddDevice(device);
+    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+    uint32_t interface = ipv4->AddInterface(device);
+    ipv4->AddAddress(interface, Ipv4InterfaceAddress(address, Ipv4Mask("255.255.255.255")));
+    ipv4->SetUp(interface);
+}
+
+ScenarioResult RunScenario(const Config& config, uint32_t scenario)
+{
+    RngSeedManager::SetRun(config.firstRun + scenario);
+    ScenarioResult result{scenario, 0, 0, 0, 0};
+
+    NodeContainer routers;
+    routers.Create(config.nodes);
+    InternetStackHelper stack;
+    stack.Install(routers);
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    Ipv4AddressHelper address;
+    address.SetBase("10.0.0.0", "255.255.255.252");
+    FaultInjector faults;
+    std::vector<Ipv4InterfaceContainer> interfaces;
+    for (const WanLink& link : config.links)
+    {
+        NetDeviceContainer devices = p2p.Install(routers.Get(link.a), routers.Get(link.b));
+        interfaces.push_back(address.Assign(devices));
+        address.NewNetwork();
+        faults.AddLink(link.name, devices);
+    }
+    for (uint32_t i = 0; i < config.nodes; ++i)
+    {
+        AddLoopback(routers.Get(i), Ipv4Address(0xc0a80000 + 1 + i)); // 192.168.0.1, ...
+    }
+
+    // Fixed streams: the history depends on RngRun only, not on the worker
+    Ptr<UniformRandomVariable> uniform = CreateObject<UniformRandomVariable>();
+    uniform->SetStream(0);
+    Ptr<ExponentialRandomVariable> exponential = CreateObject<ExponentialRandomVariable>();
+    exponential->SetStream(1);
+    for (uint32_t l = 0; l < config.links.size(); ++l)
+    {
+        const WanLink& link = config.links[l];
+        bool down = uniform->GetValue() < link.mttr / (link.mtbf + link.mttr);
+        if (down)
+        {
+            for (uint32_t end = 0; end < 2; ++end) // down before routing starts
+            {
+                interfaces[l].Get(end).first->SetDown(interfaces[l].Get(end).second);
+            }
+        }
+        // Exponential times are memoryless: the first one is drawn like the others
+        for (double t = 0; t < config.horizon; down = !down)
+        {
+            double period = exponential->GetValue(down ? link.mttr : link.mtbf, 0);
+            if (down)
+            {
+                result.linkDownSeconds += std::min(period, config.horizon - t);
+            }
+            t += period;
+            if (t < config.horizon)
+            {
+                faults.AddFault(Seconds(t), link.name, down ? FaultInjector::UP : FaultInjector::DOWN);
+                result.faults++;
+            }
+        }
+    }
+
+    IncrementalSpfRouting spf;
+    spf.Populate(routers);
+    bool updatePending = false;
+    faults.AddFaultCallback([&](const FaultInjector::Fault&) {
+        if (!updatePending) // faults within one convergence time share the update
+        {
+            updatePending = true;
+            Simulator::Schedule(Seconds(config.convergence), [&]() {
+                updatePending = false;
+                spf.Update();
+            });
+        }
+    });
+    faults.Schedule();
+
+    uint16_t port = 9;
+    std::set<uint32_t> servers;
+    for (uint32_t f = 0; f < config.flows.size(); ++f)
+    {
+        uint32_t destination = config.flows[f].second;
+        if (servers.insert(destination).second)
+        {
+            UdpServerHelper server(port);
+            ApplicationContainer app = server.Install(routers.Get(destination));
+            app.Start(Seconds(0));
+            app.Get(0)->TraceConnectWithoutContext("Rx", MakeBoundCallback(&CountPacket, &result.delivered));
+        }
+        UdpClientHelper client(Ipv4Address(0xc0a80000 + 1 + destination), port);
+        client.SetAttribute("MaxPackets", UintegerValue(uint32_t(config.horizon / config.probeInterval) + 1));
+        client.SetAttribute("Interval", TimeValue(Seconds(config.probeInterval)));
+        client.SetAttribute("PacketSize", UintegerValue(64));
+        ApplicationContainer app = client.Install(routers.Get(config.flows[f].first));
+        // Spread the flows over one interval
+        app.Start(Seconds(config.probeInterval * f / config.flows.size()));
+        app.Stop(Seconds(config.horizon));
+        app.Get(0)->TraceConnectWithoutContext("Tx", MakeBoundCallback(&CountPacket, &result.sent));
+    }
+
+    Simulator::Stop(Seconds(config.horizon + 1)); // let the last probes arrive
+    Simulator::Run();
+    Simulator::Destroy();
+    return result;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t scenarios = 10000;
+    uint32_t workers = 0;
+    uint32_t firstRun = 1;
+    std::string topology = "triangle";
+    uint32_t nodes = 10;
+    uint32_t degree = 3;
+    uint32_t seed = 1;
+    double mtbf = 500;
+    double mttr = 4;
+    std::string linkFile;
+    uint32_t flows = 0;
+    double horizon = 3600;
+    double probeInterval = 1;
+    double convergence = 200;
+    uint32_t progress = 1000;
+    std::string output;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("scenarios", "Number of failure scenarios", scenarios);
+    cmd.AddValue("workers", "Worker processes (0: one per core)", workers);
+    cmd.AddValue("firstRun", "RngRun of scenario 0; scenario i uses firstRun + i", firstRun);
+    cmd.AddValue("topology", "triangle, ring or mesh", topology);
+    cmd.AddValue("nodes", "Routers of a ring or mesh", nodes);
+    cmd.AddValue("degree", "Average links per router of a mesh", degree);
+    cmd.AddValue("seed", "Seed of the mesh chords and of the probed pairs", seed);
+    cmd.AddValue("mtbf", "Mean time between failures of a link (hours)", mtbf);
+    cmd.AddValue("mttr", "Mean time to repair a link (hours)", mttr);
+    cmd.AddValue("linkFile", "Per-link \"<link> <mtbf h> <mttr h>\" lines", linkFile);
+    cmd.AddValue("flows", "Probed router pairs (0: every ordered pair)", flows);
+    cmd.AddValue("horizon", "Simulated time per scenario (s)", horizon);
+    cmd.AddValue("probeInterval", "Time between probes of one flow (s)", probeInterval);
+    cmd.AddValue("convergence", "Delay from a link event to rerouting (ms)", convergence);
+    cmd.AddValue("progress", "Print the running estimate every this many scenarios", progress);
+    cmd.AddValue("output", "CSV file with one line per scenario", output);
+    cmd.Parse(argc, argv);
+
+    Config config;
+    if (!BuildTopology(config, topology, nodes, degree, seed))
+    {
+        std::cerr << "Unknown topology \"" << topology << "\" or fewer than 3 nodes\n";
+        return 1;
+    }
+    for (WanLink& link : config.links)
+    {
+        link.mtbf = mtbf * 3600;
+        link.mttr = mttr * 3600;
+    }
+    if (!linkFile.empty() && !LoadLinkFile(config, linkFile))
+    {
+        return 1;
+    }
+    uint64_t pairs = uint64_t(config.nodes) * (config.nodes - 1);
+    if (flows == 0 || flows >= pairs)
+    {
+        for (uint32_t a = 0; a < config.nodes; ++a)
+        {
+            for (uint32_t b = 0; b < config.nodes; ++b)
+            {
+                if (a != b)
+                {
+                    config.flows.emplace_back(a, b);
+                }
+            }
+        }
+    }
+    else
+    {
+        std::mt19937 rng(seed);
+        std::set<std::pair<uint32_t, uint32_t>> chosen;
+        while (chosen.size() < flows)
+        {
+            uint32_t a = rng() % config.nodes;
+            uint32_t b = rng() % config.nodes;
+            if (a != b && chosen.insert({a, b}).second)
+            {
+                config.flows.emplace_back(a, b);
+            }
+        }
+    }
+    config.horizon = horizon;
+    config.probeInterval = probeInterval;
+    config.convergence = convergence / 1000.0;
+    config.firstRun = firstRun;
+
+    MonteCarloRunner runner;
+    runner.SetWorkers(workers);
+    std::cout << "=== Availability: " << topology << ", " << config.nodes << " routers, " << config.links.size()
+              << " links, " << config.flows.size() << " flows ===\n";
+    std::cout << scenarios << " scenarios of " << horizon << " s (RngRun " << firstRun << " - "
+              << firstRun + scenarios - 1 << ") on " << runner.GetWorkers(scenarios) << " worker processes\n";
+
+    std::ofstream csv;
+    if (!output.empty())
+    {
+        csv.open(output);
+        csv << "scenario,run,faults,link_down_s,sent,delivered,availability\n";
+    }
+    AvailabilityAggregate aggregate;
+    auto start = std::chrono::steady_clock::now();
+    std::cout << std::fixed;
+    bool complete = runner.Run(
+        scenarios,
+        [&config](uint32_t scenario) { return RunScenario(config, scenario); },
+        [&](const ScenarioResult& result) {
+            aggregate.Add(result);
+            if (csv.is_open())
+            {
+                csv << result.scenario << "," << firstRun + result.scenario << "," << result.faults << ","
+                    << result.linkDownSeconds << "," << result.sent << "," << result.delivered << ","
+                    << result.GetAvailability() << "\n";
+            }
+            if (progress && aggregate.GetN() % progress == 0)
+            {
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                std::cout << std::setw(8) << aggregate.GetN() << " scenarios  availability " << std::setprecision(6)
+                          << aggregate.GetMean() << " +/- " << aggregate.GetHalfWidth() << "  ("
+                          << std::setprecision(1) << aggregate.GetN() / elapsed << " scenarios/s)\n";
+            }
+        });
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!complete)
+    {
+        std::cerr << runner.GetError() << "\n";
+    }
+
+    std::cout << "\n--- " << aggregate.GetN() << " scenarios in " << std::setprecision(1) << elapsed << " s ---\n";
+    std::cout << std::setprecision(6);
+    std::cout << "Mean availability:     " << aggregate.GetMean() << " +/- " << aggregate.GetHalfWidth()
+              << " (95% CI), std dev " << aggregate.GetStdDev() << "\n";
+    std::cout << "Pooled delivered/sent: " << aggregate.GetPooled() << "\n";
+    std::cout << "Percentiles:           p1 " << aggregate.GetPercentile(0.01) << "  p5 "
+              << aggregate.GetPercentile(0.05) << "  p50 " << aggregate.GetPercentile(0.5) << "\n";
+    std::cout << "Without loss:          " << aggregate.GetNPerfect() << " scenarios ("
+              << std::setprecision(2) << 100.0 * aggregate.GetNPerfect() / std::max<uint64_t>(1, aggregate.GetN())
+              << "%)\n";
+    std::cout << "Link events:           " << aggregate.GetMeanFaults() << " per scenario\n";
+    return complete ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+/*
+ * FIB lookup microbenchmark: Ipv4StaticRouting vs. Ipv4LpmRouting
+ *
+ * Builds the HQ router of the triangular WAN (exercise02-multi-link-wan.cc)
+ * with its static routes, then loads a synthetic Internet-like table on top:
+ *
+ *   - Ipv4StaticRouting of HQ, with --staticPrefixes routes (linear scan)
+ *   - Ipv4LpmRouting bound to HQ, with the same routes (equal-size comparison)
+ *   - Ipv4LpmRouting bound to HQ, with --prefixes routes (full-table scale)
+ *
+ * and reports ns/lookup through RouteOutput() and bytes/prefix (resident
+ * memory growth while the table is loaded). The raw LpmTrie lookup without
+ * building an Ipv4Route is reported too, as the pure data-plane cost.
+ *
+ * Prefix lengths follow the shape of a public BGP table (mostly /24, then
+ * /22, /23, /21, /20 ...). Next hops alternate between Branch (10.1.1.2)
+ * and DC (10.1.2.2). Every lookup on the equal-size tables is cross-checked,
+ * so a mismatch between the two protocols is reported as an error.
+ *
+ * Example: ./ns3 run "scratch/exercise02-fib-lookup-benchmark --prefixes=1000000"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-lpm-fib.h"
+#include "wan-setup-phases.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("FibLookupBenchmark");
+
+struct SyntheticPrefix
+{
+    uint32_t address;
+    uint8_t length;
+    uint32_t interface; // 1 = towards Branch, 2 = towards DC
+};
+
+// Unique random prefixes with a BGP-table-like length distribution, outside 10.0.0.0/8
+std::vector<SyntheticPrefix> GeneratePrefixes(uint32_t count, std::mt19937& rng)
+{
+    // Relative weight of prefix lengths 8..32
+    const double weights[] = {0.1, 0.1, 0.2, 0.4, 0.8, 1.5, 2.5, 3.0, 1.5, 1.5, 2.5, 3.5, 5.0,
+                              5.5, 12.0, 9.5, 58.0, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.1, 0.3};
+    std::discrete_distribution<int> lengthDistribution(std::begin(weights), std::end(weights));
+    std::uniform_int_distribution<uint32_t> addressDistribution(0x01000000, 0xdfffffff);
+
+    std::vector<SyntheticPrefix> prefixes;
+    std::unordered_set<uint64_t> seen;
+    prefixes.reserve(count);
+    while (prefixes.size() < count)
+    {
+        uint8_t length = 8 + lengthDistribution(rng);
+        uint32_t address = addressDistribution(rng) & (0xffffffffu << (32 - length));
+        if ((address >> 24) == 10 || !seen.insert((uint64_t(address) << 8) | length).second)
+        {
+            continue;
+        }
+        prefixes.push_back({address, length, 1 + static_cast<uint32_t>(rng() % 2)});
+    }
+    return prefixes;
+}
+
+// Destinations: mostly inside the table, some random (default route / misses)
+std::vector<uint32_t> GenerateDestinations(const std::vector<SyntheticPrefix>& prefixes,
+                                           uint32_t tableSize,
+                                           uint32_t count,
+                                           std::mt19937& rng)
+{
+    std::vector<uint32_t> destinations;
+    destinations.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (rng() % 10 == 0 || tableSize == 0)
+        {
+            destinations.push_back(rng());
+            continue;
+        }
+        const SyntheticPrefix& prefix = prefixes[rng() % tableSize];
+        uint32_t hostBits = prefix.length == 32 ? 0 : rng() & (0xffffffffu >> prefix.length);
+        destinations.push_back(prefix.address | hostBits);
+    }
+    return destinations;
+}
+
+// Average RouteOutput() time in nanoseconds
+double TimeRouteOutput(Ptr<Ipv4RoutingProtocol> routing, const std::vector<uint32_t>& destinations, uint64_t& routed)
+{
+    Ipv4Header header;
+    Socket::SocketErrno sockerr;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t destination : destinations)
+    {
+        header.SetDestination(Ipv4Address(destination));
+        if (routing->RouteOutput(nullptr, header, nullptr, sockerr))
+        {
+            routed++;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / destinations.size();
+}
+
+void PrintRow(std::string table, uint32_t prefixes, double nsPerLookup, double bytesPerPrefix)
+{
+    std::cout << std::left << std::setw(26) << table << std::right << std::setw(10) << prefixes
+              << std::setw(14) << std::fixed << std::setprecision(1) << nsPerLookup
+              << std::setw(15) << bytesPerPrefix << "\n";
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nPrefixes = 1000000;
+    uint32_t nStaticPrefixes = 20000;
+    uint32_t nLookups = 2000000;
+    uint32_t nStaticLookups = 20000;
+    uint32_t seed = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("prefixes", "Prefixes in the full-size LPM table", nPrefixes);
+    cmd.AddValue("staticPrefixes", "Prefixes in the equal-size static vs. LPM comparison", nStaticPrefixes);
+    cmd.AddValue("lookups", "Lookups timed on the full-size LPM table", nLookups);
+    cmd.AddValue("staticLookups", "Lookups timed (and cross-checked) on the equal-size tables", nStaticLookups);
+    cmd.AddValue("seed", "Seed of the prefix and destination generator", seed);
+    cmd.Parse(argc, argv);
+    nStaticPrefixes = std::min(nStaticPrefixes, nPrefixes);
+
+    // *** HQ router of the triangular WAN (same links and addresses as exercise02) ***
+    NodeContainer nodes;
+    nodes.Create(3);
+    Ptr<Node> n0 = nodes.Get(0); // HQ
+    Ptr<Node> n1 = nodes.Get(1); // Branch
+    Ptr<Node> n2 = nodes.Get(2); // Data Center
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    NetDeviceContainer devicesHQ_Branch = p2p.Install(n0, n1);
+    NetDeviceContainer devicesHQ_DC = p2p.Install(n0, n2);
+    NetDeviceContainer devicesBranch_DC = p2p.Install(n1, n2);
+
+    InternetStackHelper stack;
+    stack.Install(nodes);
+
+    Ipv4AddressHelper address;
+    address.SetBase("10.1.1.0", "255.255.255.0");
+    address.Assign(devicesHQ_Branch); // HQ: 10.1.1.1, Branch: 10.1.1.2
+    address.SetBase("10.1.2.0", "255.255.255.0");
+    address.Assign(devicesHQ_DC); // HQ: 10.1.2.1, DC: 10.1.2.2
+    address.SetBase("10.1.3.0", "255.255.255.0");
+    address.Assign(devicesBranch_DC);
+
+    Ptr<Ipv4> ipv4HQ = n0->GetObject<Ipv4>();
+    Ipv4StaticRoutingHelper staticRoutingHelper;
+    Ptr<Ipv4StaticRouting> staticRoutingHQ = staticRoutingHelper.GetStaticRouting(ipv4HQ);
+    staticRoutingHQ->AddNetworkRouteTo(Ipv4Address("10.1.3.0"), Ipv4Mask("255.255.255.0"), Ipv4Address("10.1.1.2"), 1, 0);
+    staticRoutingHQ->AddNetworkRouteTo(Ipv4Address("10.1.3.0"), Ipv4Mask("255.255.255.0"), Ipv4Address("10.1.2.2"), 2, 10);
+
+    // The LPM tables are bound to HQ's Ipv4 but not added to its routing list,
+    // so both protocols are timed in isolation. They only keep the best
+    // (metric 0) route of exercise02's pair.
+    Ptr<Ipv4LpmRouting> lpmSmall = CreateObject<Ipv4LpmRouting>();
+    Ptr<Ipv4LpmRouting> lpmFull = CreateObject<Ipv4LpmRouting>();
+    lpmSmall->SetIpv4(ipv4HQ);
+    lpmFull->SetIpv4(ipv4HQ);
+    lpmSmall->AddNetworkRouteTo(Ipv4Address("10.1.3.0"), Ipv4Mask("255.255.255.0"), Ipv4Address("10.1.1.2"), 1);
+    lpmFull->AddNetworkRouteTo(Ipv4Address("10.1.3.0"), Ipv4Mask("255.255.255.0"), Ipv4Address("10.1.1.2"), 1);
+
+    // *** Synthetic table ***
+    std::mt19937 rng(seed);
+    std::cout << "Generating " << nPrefixes << " prefixes...\n";
+    std::vector<SyntheticPrefix> prefixes = GeneratePrefixes(nPrefixes, rng);
+    const Ipv4Address gateways[] = {Ipv4Address::GetZero(), Ipv4Address("10.1.1.2"), Ipv4Address("10.1.2.2")};
+
+    int64_t rss = GetResidentBytes();
+    for (uint32_t i = 0; i < nStaticPrefixes; ++i)
+    {
+        const SyntheticPrefix& p = prefixes[i];
+        staticRoutingHQ->AddNetworkRouteTo(Ipv4Address(p.address), Ipv4Mask(~0u << (32 - p.length)), gateways[p.interface], p.interface);
+    }
+    int64_t staticBytes = GetResidentBytes() - rss;
+
+    rss = GetResidentBytes();
+    for (uint32_t i = 0; i < nStaticPrefixes; ++i)
+    {
+        const SyntheticPrefix& p = prefixes[i];
+        lpmSmall->AddNetworkRouteTo(Ipv4Address(p.address), Ipv4Mask(~0u << (32 - p.length)), gateways[p.interface], p.interface);
+    }
+    int64_t lpmSmallBytes = GetResidentBytes() - rss;
+
+    rss = GetResidentBytes();
+    auto loadStart = std::chrono::steady_clock::now();
+    for (const SyntheticPrefix& p : prefixes)
+    {
+        lpmFull->AddNetworkRouteTo(Ipv4Address(p.address), Ipv4Mask(~0u << (32 - p.length)), gateways[p.interface], p.interface);
+    }
+    double loadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+    int64_t lpmFullBytes = GetResidentBytes() - rss;
+
+    // *** Cross-check the equal-size tables ***
+    std::vector<uint32_t> staticDestinations = GenerateDestinations(prefixes, nStaticPrefixes, nStaticLookups, rng);
+    uint32_t mismatches = 0;
+    Ipv4Header header;
+    Socket::SocketErrno sockerr;
+    for (uint32_t destination : staticDestinations)
+    {
+        header.SetDestination(Ipv4Address(destination));
+        Ptr<Ipv4Route> a = staticRoutingHQ->RouteOutput(nullptr, header, nullptr, sockerr);
+        Ptr<Ipv4Route> b = lpmSmall->RouteOutput(nullptr, header, nullptr, sockerr);
+        if (bool(a) != bool(b) || (a && (a->GetGateway() != b->GetGateway() ||
+                                         a->GetOutputDevice() != b->GetOutputDevice())))
+        {
+            mismatches++;
+        }
+    }
+
+    // *** Timing ***
+    uint64_t routed = 0;
+    double staticNs = TimeRouteOutput(staticRoutingHQ, staticDestinations, routed);
+    double lpmSmallNs = TimeRouteOutput(lpmSmall, staticDestinations, routed);
+
+    std::vector<uint32_t> fullDestinations = GenerateDestinations(prefixes, nPrefixes, nLookups, rng);
+    double lpmFullNs = TimeRouteOutput(lpmFull, fullDestinations, routed);
+
+    const LpmTrie& trie = lpmFull->GetTrie();
+    uint64_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t destination : fullDestinations)
+    {
+        checksum += trie.Lookup(destination);
+    }
+    double trieNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                    fullDestinations.size();
+
+    // *** Results ***
+    std::cout << "\n=== FIB Lookup Benchmark (HQ router, exercise02 topology) ===\n";
+    std::cout << "Table                       Prefixes     ns/lookup   bytes/prefix\n";
+    PrintRow("Ipv4StaticRouting", nStaticPrefixes, staticNs, double(staticBytes) / nStaticPrefixes);
+    PrintRow("Ipv4LpmRouting", nStaticPrefixes, lpmSmallNs, double(lpmSmallBytes) / nStaticPrefixes);
+    PrintRow("Ipv4LpmRouting", nPrefixes, lpmFullNs, double(lpmFullBytes) / nPrefixes);
+    PrintRow("LpmTrie::Lookup (raw)", nPrefixes, trieNs, double(trie.GetLookupMemory()) / nPrefixes);
+
+    std::cout << "\nFull table: " << trie.GetNChunks() << " chunks, "
+              << trie.GetLookupMemory() / (1024 * 1024) << " MiB lookup structure, "
+              << trie.GetIndexMemory() / (1024 * 1024) << " MiB prefix index, "
+              << lpmFull->GetNNextHops() << " next hops, loaded in " << std::setprecision(2)
+              << loadSeconds << " s\n";
+    std::cout << "Speedup at " << nStaticPrefixes << " prefixes: " << std::setprecision(1)
+              << staticNs / lpmSmallNs << "x\n";
+    std::cout << "Cross-check: " << mismatches << " mismatches in " << staticDestinations.size()
+              << " lookups (routed " << routed << ", checksum " << checksum << ")\n";
+    std::cout << "bytes/prefix is resident memory growth while loading; the raw trie row\n"
+              << "counts only the lookup structure.\n";
+
+    Simulator::Destroy();
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+/*
+ * Forwarding benchmark: Ipv4StaticRouting vs. Ipv4IndexedStaticRouting
+ *
+ * Builds the HQ router of the triangular WAN (exercise02-multi-link-wan.cc)
+ * and gives it tables of 100, 10k and 100k static routes (--sizes). As in
+ * exercise02, every prefix has a primary route (metric 0) and a backup
+ * route (metric 10) through the other neighbour, so a table of n routes
+ * holds n/2 prefixes. Both protocols get the same routes; they are bound to
+ * HQ's Ipv4 but not added to its routing list, so each is timed alone.
+ *
+ * For every size it reports the time to add the routes and the forwarding
+ * cost per packet: RouteInput() on HQ's Branch-facing interface up to the
+ * unicast forward callback, i.e. the routing part of forwarding a transit
+ * packet. Ipv4StaticRouting scans every route per packet, so it is timed
+ * on fewer packets at the large sizes (--staticBudget route visits).
+ * Every packet timed on both is cross-checked: the two must pick the same
+ * gateway and output device.
+ *
+ * Example: ./ns3 run "scratch/exercise02-indexed-static-benchmark --sizes=100,10000,100000"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-indexed-static-routing.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <unordered_set>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("IndexedStaticBenchmark");
+
+struct SyntheticPrefix
+{
+    uint32_t address;
+    uint8_t length;
+    uint32_t primary; // interface of the metric-0 route: 1 = Branch, 2 = DC
+};
+
+// Where the last forwarded packet went, for the cross-check
+Ptr<Ipv4Route> g_forwarded;
+uint64_t g_forwardedPackets = 0;
+
+void
+Forward(Ptr<Ipv4Route> route, Ptr<const Packet> packet, const Ipv4Header& header)
+{
+    g_forwarded = route;
+    g_forwardedPackets++;
+}
+
+void
+Drop(Ptr<const Packet> packet, const Ipv4Header& header, Socket::SocketErrno error)
+{
+    g_forwarded = nullptr;
+}
+
+// Unique random prefixes outside 10.0.0.0/8, mostly /24 with some /16 - /23 and /32
+std::vector<SyntheticPrefix>
+GeneratePrefixes(uint32_t count, std::mt19937& rng)
+{
+    const uint8_t lengths[] = {16, 18, 20, 22, 23, 24, 24, 24, 24, 24, 24, 32};
+    std::vector<SyntheticPrefix> prefixes;
+    std::unordered_set<uint64_t> seen;
+    prefixes.reserve(count);
+    while (prefixes.size() < count)
+    {
+        uint8_t length = lengths[rng() % (sizeof(lengths))];
+        uint32_t address = (0x0b000000 + rng() % 0xd5000000) & (0xffffffffu << (32 - length));
+        if (!seen.insert((uint64_t(address) << 8) | length).second)
+        {
+            continue;
+        }
+        prefixes.push_back({address, length, 1 + static_cast<uint32_t>(rng() % 2)});
+    }
+    return prefixes;
+}
+
+// Destinations inside the table, one in ten random (misses)
+std::vector<uint32_t>
+GenerateDestinations(const std::vector<SyntheticPrefix>& prefixes, uint32_t count, std::mt19937& rng)
+{
+    std::vector<uint32_t> destinations;
+    destinations.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (rng() % 10 == 0)
+        {
+            destinations.push_back(0x0b000000 + rng() % 0xd5000000);
+            continue;
+        }
+        const SyntheticPrefix& prefix = prefixes[rng() % prefixes.size()];
+        uint32_t hostBits = prefix.length == 32 ? 0 : rng() & (0xffffffffu >> prefix.length);
+        destinations.push_back(prefix.address | hostBits);
+    }
+    return destinations;
+}
+
+// Add the primary and backup route of every prefix; returns ns per route
+template <class Routing>
+double
+LoadRoutes(Ptr<Routing> routing, const std::vector<SyntheticPrefix>& prefixes)
+{
+    const Ipv4Address gateways[] = {Ipv4Address::GetZero(), Ipv4Address("10.1.1.2"), Ipv4Address("10.1.2.2")};
+    auto start = std::chrono::steady_clock::now();
+    for (const SyntheticPrefix& p : prefixes)
+    {
+        Ipv4Mask mask(~0u << (32 - p.length));
+        uint32_t backup = 3 - p.primary;
+        routing->AddNetworkRouteTo(Ipv4Address(p.address), mask, gateways[p.primary], p.primary, 0);
+        routing->AddNetworkRouteTo(Ipv4Address(p.address), mask, gateways[backup], backup, 10);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / (2 * prefixes.size());
+}
+
+// Average RouteInput() time in nanoseconds over the first count destinations
+double
+TimeForwarding(Ptr<Ipv4RoutingProtocol> routing,
+               Ptr<NetDevice> inputDevice,
+               const std::vector<uint32_t>& destinations,
+               uint32_t count)
+{
+    Ptr<Packet> packet = Create<Packet>(64);
+    Ipv4Header header;
+    header.SetSource(Ipv4Address("10.1.1.2"));
+    auto ucb = MakeCallback(&Forward);
+    auto ecb = MakeCallback(&Drop);
+    Ipv4RoutingProtocol::MulticastForwardCallback mcb;
+    Ipv4RoutingProtocol::LocalDeliverCallback lcb;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        header.SetDestination(Ipv4Address(destinations[i]));
+        routing->RouteInput(packet, header, inputDevice, ucb, mcb, lcb, ecb);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    g_forwarded = nullptr;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+// The route RouteInput() forwards one packet on, null if it is dropped
+Ptr<Ipv4Route>
+ForwardOne(Ptr<Ipv4RoutingProtocol> routing, Ptr<NetDevice> inputDevice, uint32_t destination)
+{
+    Ptr<Packet> packet = Create<Packet>(64);
+    Ipv4Header header;
+    header.SetSource(Ipv4Address("10.1.1.2"));
+    header.SetDestination(Ipv4Address(destination));
+    g_forwarded = nullptr;
+    routing->RouteInput(packet,
+                        header,
+                        inputDevice,
+                        MakeCallback(&Forward),
+                        Ipv4RoutingProtocol::MulticastForwardCallback(),
+                        Ipv4RoutingProtocol::LocalDeliverCallback(),
+                        MakeCallback(&Drop));
+    Ptr<Ipv4Route> route = g_forwarded;
+    g_forwarded = nullptr;
+    return route;
+}
+
+void
+PrintRow(std::string table, uint32_t routes, double loadNs, double forwardNs, uint32_t packets)
+{
+    std::cout << std::left << std::setw(26) << table << std::right << std::setw(9) << routes
+              << std::setw(13) << std::fixed << std::setprecision(1) << loadNs << std::setw(14)
+              << forwardNs << std::setw(10) << packets << "\n";
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string sizes = "100,10000,100000";
+    uint32_t nPackets = 1000000;
+    double staticBudget = 2e8;
+    uint32_t seed = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("sizes", "Comma-separated table sizes in routes (two routes per prefix)", sizes);
+    cmd.AddValue("packets", "Packets timed per table", nPackets);
+    cmd.AddValue("staticBudget", "Ipv4StaticRouting is timed on at most this many routes visited in total", staticBudget);
+    cmd.AddValue("seed", "Seed of the prefix and destination generator", seed);
+    cmd.Parse(argc, argv);
+
+    // *** HQ router of the triangular WAN (same links and addresses as exercise02) ***
+    NodeContainer nodes;
+    nodes.Create(3);
+    Ptr<Node> n0 = nodes.Get(0); // HQ
+    Ptr<Node> n1 = nodes.Get(1); // Branch
+    Ptr<Node> n2 = nodes.Get(2); // Data Center
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("5Mbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("2ms"));
+    NetDeviceContainer devicesHQ_Branch = p2p.Install(n0, n1);
+    NetDeviceContainer devicesHQ_DC = p2p.Install(n0, n2);
+    NetDeviceContainer devicesBranch_DC = p2p.Install(n1, n2);
+
+    InternetStackHelper stack;
+    stack.Install(nodes);
+
+    Ipv4AddressHelper address;
+    address.SetBase("10.1.1.0", "255.255.255.0");
+    address.Assign(devicesHQ_Branch); // HQ: 10.1.1.1, Branch: 10.1.1.2
+    address.SetBase("10.1.2.0", "255.255.255.0");
+    address.Assign(devicesHQ_DC); // HQ: 10.1.2.1, DC: 10.1.2.2
+    address.SetBase("10.1.3.0", "255.255.255.0");
+    address.Assign(devicesBranch_DC);
+
+    Ptr<Ipv4> ipv4HQ = n0->GetObject<Ipv4>();
+    ipv4HQ->SetAttribute("IpForward", BooleanValue(true));
+    Ptr<NetDevice> inputDevice = devicesHQ_Branch.Get(0);
+
+    std::mt19937 rng(seed);
+    uint32_t mismatches = 0;
+    std::cout << "\n=== Static Routing Forwarding Benchmark (HQ router, exercise02 topology) ===\n";
+    std::cout << "Table                        Routes     ns/route    ns/packet   packets\n";
+
+    std::istringstream sizeList(sizes);
+    std::string sizeText;
+    while (std::getline(sizeList, sizeText, ','))
+    {
+        uint32_t routes = std::stoul(sizeText);
+        std::vector<SyntheticPrefix> prefixes = GeneratePrefixes(std::max<uint32_t>(routes / 2, 1), rng);
+        std::vector<uint32_t> destinations = GenerateDestinations(prefixes, nPackets, rng);
+
+        // Both bound to HQ, both start with HQ's connected routes
+        Ptr<Ipv4StaticRouting> staticRouting = CreateObject<Ipv4StaticRouting>();
+        Ptr<Ipv4IndexedStaticRouting> indexed = CreateObject<Ipv4IndexedStaticRouting>();
+        staticRouting->SetIpv4(ipv4HQ);
+        indexed->SetIpv4(ipv4HQ);
+        double staticLoadNs = LoadRoutes(staticRouting, prefixes);
+        double indexedLoadNs = LoadRoutes(indexed, prefixes);
+
+        // Cross-check on the packets both are timed on
+        uint32_t staticPackets =
+            std::max<uint32_t>(100, std::min<double>(nPackets, staticBudget / staticRouting->GetNRoutes()));
+        staticPackets = std::min(staticPackets, nPackets);
+        for (uint32_t i = 0; i < staticPackets; ++i)
+        {
+            Ptr<Ipv4Route> a = ForwardOne(staticRouting, inputDevice, destinations[i]);
+            Ptr<Ipv4Route> b = ForwardOne(indexed, inputDevice, destinations[i]);
+            if (bool(a) != bool(b) || (a && (a->GetGateway() != b->GetGateway() ||
+                                             a->GetOutputDevice() != b->GetOutputDevice())))
+            {
+                mismatches++;
+            }
+        }
+
+        double staticNs = TimeForwarding(staticRouting, inputDevice, destinations, staticPackets);
+        double indexedNs = TimeForwarding(indexed, inputDevice, destinations, nPackets);
+        PrintRow("Ipv4StaticRouting", staticRouting->GetNRoutes(), staticLoadNs, staticNs, staticPackets);
+        PrintRow("Ipv4IndexedStaticRouting", indexed->GetNRoutes(), indexedLoadNs, indexedNs, nPackets);
+        std::cout << "  speedup " << std::setprecision(1) << staticNs / indexedNs << "x, "
+                  << indexed->GetNPrefixes() << " prefixes\n";
+
+        staticRouting->Dispose();
+        indexed->Dispose();
+    }
+
+    std::cout << "\nRoute counts include HQ's connected routes. ns/route is the time to add\n"
+              << "one route while loading the table.\n";
+    std::cout << "Cross-check: " << mismatches << " mismatches (" << g_forwardedPackets
+              << " packets forwarded)\n";
+
+    Simulator::Destroy();
+    return mismatches == 0 ? 0 : 1;
+}
@@ -15,32 +15,82 @@
  * - Branch (n1): Connects to both HQ and DC
  * - DC (n2): Connects to both HQ and Branch
  * - All links: 5Mbps, 2ms
- * - Static routes configured for redundant paths
+ * - Static routes configured for redundant paths, read from
+ *   exercise02-triad-wan.routes (wan-route-table.h, --routeFile), into
+ *   Ipv4StaticRouting or, with --indexed, Ipv4IndexedStaticRouting
+ *
+ * The HQ-DC link fails at t=6 s, as exercise02-triad-wan.faults says
+ * (wan-fault-injector.h; --faultTrace replays another history). A probe sends a small packet from DC to
+ * HQ's 10.1.1.1 every --probeInterval ms over that link and reports the
+ * packet-loss window: the longest gap in its arrivals, less one interval.
+ * With --frr every node precomputes loop-free alternates (wan-fast-reroute.h)
+ * and switches to them when the interface goes down. Compare the window
+ * with and without --frr on the routes without hand-written backups:
+ *
+ *   --routeFile=scratch/exercise02-triad-wan-primary.routes [--frr]
+ *
+ * The animation (wan-anim-writer.h) shows one packet in --animSample, or the
+ * first --animFlowPackets packets of every flow.
  */
 
 #include "ns3/applications-module.h"
 #include "ns3/core-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/mobility-module.h"
-#include "ns3/netanim-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "wan-anim-writer.h"
+#include "wan-fast-reroute.h"
+#include "wan-fault-injector.h"
+#include "wan-indexed-static-routing.h"
+#include "wan-route-table.h"
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("TriangularWAN");
 
-// Helper function to disable an interface on a node
-void DisableInterface(Ptr<Node> node, uint32_t interfaceIndex)
+// Packet-loss window of the DC -> HQ probe
+struct ProbeStats
+{
+    Time interval;
+    Time lastArrival;
+    int64_t lastSequence{-1};
+    uint64_t received{0};
+    uint64_t lost{0};
+    Time window;      ///< longest gap in arrivals less one interval
+    Time windowStart; ///< arrival time of the last probe before that gap
+};
+
+ProbeStats g_probe;
+
+void
+ProbeReceived(Ptr<const Packet> packet)
 {
-    Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
-    if (ipv4)
+    SeqTsHeader seqTs;
+    packet->PeekHeader(seqTs);
+    int64_t sequence = seqTs.GetSeq();
+    Time now = Simulator::Now();
+    if (g_probe.lastSequence >= 0 && sequence > g_probe.lastSequence + 1)
     {
-        ipv4->SetDown(interfaceIndex);
-        std::cout << "Interface " << interfaceIndex << " on node " << node->GetId() 
-                  << " disabled at t=" << Simulator::Now().GetSeconds() << "s\n";
+        g_probe.lost += sequence - g_probe.lastSequence - 1;
+        if (now - g_probe.lastArrival - g_probe.interval > g_probe.window)
+        {
+            g_probe.window = now - g_probe.lastArrival - g_probe.interval;
+            g_probe.windowStart = g_probe.lastArrival;
+        }
     }
+    g_probe.lastSequence = std::max(g_probe.lastSequence, sequence);
+    g_probe.lastArrival = now;
+    g_probe.received++;
+}
+
+void
+FastReroute(Ptr<Node> node, uint32_t interface, uint32_t prefixes, bool down)
+{
+    std::cout << "Node " << node->GetId() << " interface " << interface << (down ? " down" : " up") << " at t="
+              << Simulator::Now().GetSeconds() << "s: " << prefixes << " prefixes "
+              << (down ? "switched to their loop-free alternates" : "back on their primaries") << "\n";
 }
 
 int
@@ -50,6 +100,24 @@ main(int argc, char* argv[])
     LogComponentEnable("UdpEchoClientApplication", LOG_LEVEL_INFO);
     LogComponentEnable("UdpEchoServerApplication", LOG_LEVEL_INFO);
 
+    uint32_t animSample = 1;
+    uint32_t animFlowPackets = 0;
+    std::string routeFile = "scratch/exercise02-triad-wan.routes";
+    std::string faultTrace = "scratch/exercise02-triad-wan.faults";
+    bool indexed = false;
+    bool frr = false;
+    double probeInterval = 1.0;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("routeFile", "Static route specification (routing table text or binary)", routeFile);
+    cmd.AddValue("faultTrace", "Link failure and repair history (hq-branch, hq-dc, branch-dc)", faultTrace);
+    cmd.AddValue("indexed", "Use Ipv4IndexedStaticRouting in place of Ipv4StaticRouting", indexed);
+    cmd.AddValue("frr", "Precompute loop-free alternates and switch to them on interface down", frr);
+    cmd.AddValue("probeInterval", "Interval of the DC -> HQ loss-window probe in ms", probeInterval);
+    cmd.AddValue("animSample", "Animate one packet in this many (0 = none)", animSample);
+    cmd.AddValue("animFlowPackets", "Animate only the first packets of every flow (0 = all)", animFlowPackets);
+    cmd.Parse(argc, argv);
+
     // Create three nodes: HQ, Branch, and Data Center
     NodeContainer nodes;
     nodes.Create(3);
@@ -92,6 +160,14 @@ main(int argc, char* argv[])
 
     // Install Internet stack on all nodes
     InternetStackHelper stack;
+    if (indexed)
+    {
+        // In a list, like the default static routing, so --frr can add itself in front
+        Ipv4IndexedStaticRoutingHelper indexedRoutingHelper;
+        Ipv4ListRoutingHelper listRoutingHelper;
+        listRoutingHelper.Add(indexedRoutingHelper, 0);
+        stack.SetRoutingHelper(listRoutingHelper);
+    }
     stack.Install(nodes);
 
     // Assign IP addresses to all three networks
@@ -123,68 +199,36 @@ main(int argc, char* argv[])
     // Get static routing protocol helper
     Ipv4StaticRoutingHelper staticRoutingHelper;
 
-    // Configure routing on HQ (n0)
-    Ptr<Ipv4StaticRouting> staticRoutingHQ = 
-        staticRoutingHelper.GetStaticRouting(n0->GetObject<Ipv4>());
-    
-    // Route to Branch-DC network via Branch (primary path to 10.1.3.0/24)
-    staticRoutingHQ->AddNetworkRouteTo(
-        Ipv4Address("10.1.3.0"),   // Destination network
-        Ipv4Mask("255.255.255.0"), // Network mask
-        Ipv4Address("10.1.1.2"),   // Next hop: Branch (10.1.1.2)
-        1,                         // Interface index to HQ-Branch link
-        0                          // Metric (lower = higher priority)
-    );
-    // Alternative route via DC (backup path to 10.1.3.0/24)
-    staticRoutingHQ->AddNetworkRouteTo(
-        Ipv4Address("10.1.3.0"),
-        Ipv4Mask("255.255.255.0"),
-        Ipv4Address("10.1.2.2"),   // Next hop: DC (10.1.2.2)
-        2,                         // Interface index to HQ-DC link
-        10                         // Higher metric (lower priority)
-    );
-
-    // Configure routing on Branch (n1)
-    Ptr<Ipv4StaticRouting> staticRoutingBranch = 
-        staticRoutingHelper.GetStaticRouting(n1->GetObject<Ipv4>());
-    
-    // Route to HQ-DC network via HQ (primary path to 10.1.2.0/24)
-    staticRoutingBranch->AddNetworkRouteTo(
-        Ipv4Address("10.1.2.0"),
-        Ipv4Mask("255.255.255.0"),
-        Ipv4Address("10.1.1.1"),   // Next hop: HQ (10.1.1.1)
-        1,                         // Interface index to HQ-Branch link
-        0                          // Metric
-    );
-    // Alternative route via DC (backup path to 10.1.2.0/24)
-    staticRoutingBranch->AddNetworkRouteTo(
-        Ipv4Address("10.1.2.0"),
-        Ipv4Mask("255.255.255.0"),
-        Ipv4Address("10.1.3.2"),   // Next hop: DC (10.1.3.2)
-        2,                         // Interface index to Branch-DC link
-        10                         // Higher metric
-    );
-
-    // Configure routing on DC (n2)
-    Ptr<Ipv4StaticRouting> staticRoutingDC = 
-        staticRoutingHelper.GetStaticRouting(n2->GetObject<Ipv4>());
-    
-    // Route to HQ-Branch network via HQ (primary path to 10.1.1.0/24)
-    staticRoutingDC->AddNetworkRouteTo(
-        Ipv4Address("10.1.1.0"),
-        Ipv4Mask("255.255.255.0"),
-        Ipv4Address("10.1.2.1"),   // Next hop: HQ (10.1.2.1)
-        1,                         // Interface index to HQ-DC link
-        0                          // Metric
-    );
-    // Alternative route via Branch (backup path to 10.1.1.0/24)
-    staticRoutingDC->AddNetworkRouteTo(
-        Ipv4Address("10.1.1.0"),
-        Ipv4Mask("255.255.255.0"),
-        Ipv4Address("10.1.3.1"),   // Next hop: Branch (10.1.3.1)
-        2,                         // Interface index to Branch-DC link
-        10                         // Higher metric
-    );
+    // Primary (metric 0) and backup (metric 10) routes of every node come
+    // from the route specification, checked against the topology above
+    RouteTable routes;
+    bool installed = indexed ? routes.Load(routeFile) &&
+                                   routes.Install<Ipv4IndexedStaticRouting>(
+                                       &Ipv4IndexedStaticRoutingHelper::GetIndexedStaticRouting)
+                             : routes.Load(routeFile) && routes.Install();
+    if (!installed)
+    {
+        std::cerr << "Route table " << routeFile << ": " << routes.GetError() << "\n";
+        return 1;
+    }
+    std::cout << "Installed " << routes.GetStatistics().installed << " static routes from " << routeFile
+              << "\n";
+
+    // Alternates are computed from the routes just installed
+    if (frr)
+    {
+        FastRerouteHelper frrHelper;
+        frrHelper.Install(nodes);
+        const FastRerouteHelper::Statistics& frrStats = frrHelper.GetStatistics();
+        std::cout << "Fast reroute: " << frrStats.protectedPrefixes << " of " << frrStats.prefixes
+                  << " prefixes have a loop-free alternate (" << frrStats.nodeProtecting
+                  << " node-protecting)\n";
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            FastRerouteHelper::GetFastReroute(nodes.Get(i)->GetObject<Ipv4>())
+                ->TraceConnectWithoutContext("Reroute", MakeBoundCallback(&FastReroute, nodes.Get(i)));
+        }
+    }
 
     // Print routing tables for verification
     Ptr<OutputStreamWrapper> routingStream =
@@ -259,17 +303,45 @@ main(int argc, char* argv[])
     clientAppsBranchtoDC.Start(Seconds(2.2)); // Slightly offset
     clientAppsBranchtoDC.Stop(Seconds(15.0));
 
-    // Schedule link failure at t=6 seconds (disable primary HQ-DC link)
-    // Disable the interface on HQ (interface 2) and DC (interface 1)
-    Simulator::Schedule(Seconds(6.0), &DisableInterface, n0, 2);
-    Simulator::Schedule(Seconds(6.0), &DisableInterface, n2, 1);
+    // Loss-window probe: DC -> HQ's 10.1.1.1, primary route over the HQ-DC link
+    g_probe.interval = Seconds(probeInterval / 1000.0);
+    UdpServerHelper probeServer(5000);
+    ApplicationContainer probeServerApps = probeServer.Install(n0);
+    probeServerApps.Start(Seconds(1.0));
+    probeServerApps.Stop(Seconds(15.0));
+    probeServerApps.Get(0)->TraceConnectWithoutContext("Rx", MakeCallback(&ProbeReceived));
+    UdpClientHelper probeClient(interfacesHQ_Branch.GetAddress(0), 5000);
+    probeClient.SetAttribute("MaxPackets", UintegerValue(0xffffffff));
+    probeClient.SetAttribute("Interval", TimeValue(g_probe.interval));
+    probeClient.SetAttribute("PacketSize", UintegerValue(64));
+    ApplicationContainer probeClientApps = probeClient.Install(n2);
+    probeClientApps.Start(Seconds(2.5));
+    probeClientApps.Stop(Seconds(12.0));
+
+    // Link failures from the fault trace; by default the primary HQ-DC link
+    // goes down at t=6 seconds (the interfaces on HQ and DC are disabled)
+    FaultInjector faults;
+    faults.AddLink("hq-branch", devicesHQ_Branch);
+    faults.AddLink("hq-dc", devicesHQ_DC);
+    faults.AddLink("branch-dc", devicesBranch_DC);
+    if (!faults.Load(faultTrace))
+    {
+        std::cerr << "Fault trace " << faultTrace << ": " << faults.GetError() << "\n";
+        return 1;
+    }
+    faults.AddFaultCallback([&faults](const FaultInjector::Fault& fault) {
+        std::cout << "Fault at t=" << Simulator::Now().GetSeconds() << "s: " << faults.Describe(fault) << "\n";
+    });
+    faults.Schedule();
 
     // Install FlowMonitor for performance analysis
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
 
     // *** NetAnim Configuration ***
-    AnimationInterface anim("scratch/triangular-wan.xml");
+    AnimStreamWriter anim("scratch/triangular-wan.xml");
+    anim.SetSampling(animSample);
+    anim.SetFlowSampling(animFlowPackets);
 
     // Set node descriptions
     anim.UpdateNodeDescription(n0, "HQ\n10.1.1.1 | 10.1.2.1");
@@ -281,7 +353,7 @@ main(int argc, char* argv[])
     anim.UpdateNodeColor(n1, 255, 165, 0); // Orange for Branch
     anim.UpdateNodeColor(n2, 0, 0, 255);   // Blue for DC
 
-    // Track packet flows
+    // Track packet flows (headers of the sampled packets only)
     anim.EnablePacketMetadata(true);
 
     // Enable PCAP tracing on all devices for Wireshark analysis
@@ -296,12 +368,30 @@ main(int argc, char* argv[])
     Ptr<Ipv4FlowClassifier> classifier = DynamicCast<Ipv4FlowClassifier>(flowmon.GetClassifier());
     std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats();
 
+    std::cout << "\n=== Loss Window (DC -> HQ probe, " << probeInterval << " ms interval"
+              << (frr ? ", fast reroute" : "") << ") ===\n";
+    std::cout << "  Probes received: " << g_probe.received << ", lost: " << g_probe.lost << "\n";
+    if (g_probe.lost > 0)
+    {
+        std::cout << "  Loss window: " << g_probe.window.GetMilliSeconds() << " ms, from t="
+                  << g_probe.windowStart.GetSeconds() << "s\n";
+    }
+    if (g_probe.received == 0 || g_probe.lastArrival < Seconds(11.0))
+    {
+        std::cout << "  No probe arrived after t=" << g_probe.lastArrival.GetSeconds()
+                  << "s: the probe never recovered\n";
+    }
+
     std::cout << "\n=== Flow Analysis ===\n";
-    std::cout << "Note: Link failure occurs at t=6 seconds\n\n";
+    std::cout << "Note: Link failure occurs at t=6 seconds (default fault trace)\n\n";
     
     for (auto &flow : stats)
     {
         Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow(flow.first);
+        if (t.destinationPort == 5000)
+        {
+            continue; // the probe, reported above
+        }
         std::cout << "Flow " << flow.first << " (" << t.sourceAddress << " -> " 
                   << t.destinationAddress << ")\n";
         std::cout << "  Tx Packets: " << flow.second.txPackets << "\n";
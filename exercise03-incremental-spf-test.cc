@@ -0,0 +1,115 @@
+/*
+ * IncrementalSpfRouting self-test: a failed link's subnet is withdrawn
+ *
+ * Three routers A, B and C in a triangle of /30 links. When B-C goes down
+ * (both interfaces, as exercise03's link failure does) and Update() runs,
+ * no router may keep a route to B-C's /30: A would send the traffic to B
+ * or C, and B and C, which have lost their connected route, would route it
+ * to each other through A until the TTL runs out. Global routing stops
+ * advertising a down interface; IncrementalSpfRouting (wan-incremental-spf.h)
+ * must do the same. When the link comes back, A must have the route again.
+ *
+ * It exits with 1 on any error.
+ *
+ * Example: ./ns3 run "scratch/exercise03-incremental-spf-test"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-incremental-spf.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("IncrementalSpfTest");
+
+uint32_t g_errors = 0;
+
+void Check(bool condition, const std::string& what)
+{
+    if (!condition)
+    {
+        std::cout << "FAIL: " << what << "\n";
+        g_errors++;
+    }
+}
+
+// True if the node's Ipv4LpmRouting has a route to exactly network/length
+bool HasRoute(Ptr<Node> node, Ipv4Address network, uint8_t length)
+{
+    Ptr<Ipv4LpmRouting> lpm = Ipv4LpmRoutingHelper::GetLpmRouting(node->GetObject<Ipv4>());
+    bool found = false;
+    lpm->ForEachRoute([&](Ipv4Address address, uint8_t routeLength, Ipv4Address, uint32_t) {
+        found = found || (address == network && routeLength == length);
+    });
+    return found;
+}
+
+void SetLink(const NetDeviceContainer& link, bool up)
+{
+    for (uint32_t i = 0; i < link.GetN(); ++i)
+    {
+        Ptr<Ipv4> ipv4 = link.Get(i)->GetNode()->GetObject<Ipv4>();
+        uint32_t interface = ipv4->GetInterfaceForDevice(link.Get(i));
+        if (up)
+        {
+            ipv4->SetUp(interface);
+        }
+        else
+        {
+            ipv4->SetDown(interface);
+        }
+    }
+}
+
+int
+main(int argc, char* argv[])
+{
+    CommandLine cmd(__FILE__);
+    cmd.Parse(argc, argv);
+
+    NodeContainer routers;
+    routers.Create(3);
+    Ptr<Node> a = routers.Get(0);
+    Ptr<Node> b = routers.Get(1);
+    Ptr<Node> c = routers.Get(2);
+    InternetStackHelper stack;
+    stack.Install(routers);
+
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("1ms"));
+    NetDeviceContainer ab = p2p.Install(a, b);
+    NetDeviceContainer bc = p2p.Install(b, c);
+    NetDeviceContainer ca = p2p.Install(c, a);
+    Ipv4AddressHelper address;
+    address.SetBase("10.0.1.0", "255.255.255.252");
+    address.Assign(ab);
+    address.SetBase("10.0.2.0", "255.255.255.252");
+    address.Assign(bc);
+    address.SetBase("10.0.3.0", "255.255.255.252");
+    address.Assign(ca);
+
+    IncrementalSpfRouting spf;
+    spf.Populate(routers);
+    Ipv4Address failed("10.0.2.0");
+    Check(HasRoute(a, failed, 30), "A has no route to B-C before the failure");
+
+    SetLink(bc, false);
+    spf.Update();
+    Check(!HasRoute(a, failed, 30), "A keeps its route to the failed link's /30");
+    Check(!HasRoute(b, failed, 30), "B routes the failed link's /30 towards C");
+    Check(!HasRoute(c, failed, 30), "C routes the failed link's /30 towards B");
+    Check(HasRoute(b, Ipv4Address("10.0.3.0"), 30), "B lost its route to C-A");
+
+    SetLink(bc, true);
+    spf.Update();
+    Check(HasRoute(a, failed, 30), "A has no route to B-C after the repair");
+
+    std::cout << (g_errors == 0 ? "PASS" : "FAIL") << ": " << g_errors << " errors\n";
+    Simulator::Destroy();
+    return g_errors == 0 ? 0 : 1;
+}
@@ -21,6 +21,38 @@
  *
  * Simulation tests static routing with manual failover vs
  * Ipv4GlobalRouting (simulates dynamic routing behavior)
+ * vs IncrementalSpfRouting (wan-incremental-spf.h), which recomputes only
+ * the routes a link change affects
+ *
+ * With --bfd every link runs a BFD session (wan-bfd.h) and failover starts
+ * when the primary link's session goes down, instead of a fixed 2 s
+ * (manual-failover) or 0.1 s (global/spf) after the failure: the router
+ * takes the interface out of routing and the backup path takes over.
+ *
+ * --routeFile replaces the hand-written static routes of the static and
+ * manual-failover modes by a route specification (wan-route-table.h).
+ *
+ * The primary link fails at --failure by dropping its rate to 1 bps, the
+ * interfaces staying up. Without BFD the link-state modes never see such a
+ * failure. With --linkDown the interfaces go down instead (loss of
+ * carrier) and the 0.1 s recompute routes around them: incremental SPF
+ * keeps DR-B's 10.1.4.2, the echo target, reachable over the backup;
+ * Ipv4GlobalRouting withdraws the failed link's subnet with it.
+ * --faultTrace replays a failure and repair history instead
+ * (wan-fault-injector.h; use down faults for global/spf without --bfd);
+ * failover is then timed from its first fault.
+ *
+ * --snapshot=<file> warm-starts global routing: the first run assigns the
+ * addresses, populates the routing tables and saves them with
+ * RoutingSnapshot (wan-routing-snapshot.h); later runs map the file and
+ * restore addresses and FIBs instead. The restored FIBs sit below
+ * Ipv4GlobalRouting in the routing list, so the recompute after a failure
+ * takes over from them.
+ *
+ * The downtime reported is estimated from the routing mode and the failover
+ * time. With --linkDown it is measured: the longest gap between echo
+ * requests arriving at DR-B, less the 0.1 s send interval, or the time from
+ * the last arrival to the last request sent if the outage is still open.
  */
 
 #include "ns3/applications-module.h"
@@ -31,6 +63,13 @@
 #include "ns3/flow-monitor-module.h"
 #include "ns3/ipv4-static-routing-helper.h"
 #include "ns3/ipv4-list-routing-helper.h"
+#include "wan-bfd.h"
+#include "wan-fault-injector.h"
+#include "wan-incremental-spf.h"
+#include "wan-route-table.h"
+#include "wan-routing-snapshot.h"
+
+#include <unistd.h>
 
 using namespace ns3;
 
@@ -43,12 +82,18 @@ Time convergenceStartTime;
 Time convergenceEndTime;
 bool failureOccurred = false;
 bool backupRouteActivated = false;
+std::string g_routingType;
+IncrementalSpfRouting* g_spfRouting = nullptr;
+Time g_lastTx;     // last echo request sent
+Time g_lastRx;     // arrival of the last echo request at DR-B
+Time g_longestGap; // longest time between two arrivals
 
 // Callback function for Tx trace
 void
 TxTrace(std::string context, Ptr<const Packet> packet)
 {
     totalPacketsSent++;
+    g_lastTx = Simulator::Now();
     if (Simulator::Now().GetSeconds() > 1.9) { // Avoid initial setup noise
         std::cout << Simulator::Now().GetSeconds() << "s: " 
                   << context << " TX packet " << packet->GetSize() << " bytes" 
@@ -61,6 +106,8 @@ void
 RxTrace(std::string context, Ptr<const Packet> packet)
 {
     totalPacketsReceived++;
+    g_longestGap = std::max(g_longestGap, Simulator::Now() - g_lastRx);
+    g_lastRx = Simulator::Now();
     if (Simulator::Now().GetSeconds() > 1.9) {
         std::cout << Simulator::Now().GetSeconds() << "s: " 
                   << context << " RX packet " << packet->GetSize() << " bytes" 
@@ -68,16 +115,16 @@ RxTrace(std::string context, Ptr<const Packet> packet)
     }
 }
 
-// Function to simulate link failure by making the link extremely slow
+// A fault from the fault trace; the first failure starts the convergence clock
 void
-SimulateLinkFailure(Ptr<PointToPointNetDevice> device)
+LinkFault(const FaultInjector* faults, const FaultInjector::Fault& fault)
 {
-    std::cout << "\n=== LINK FAILURE EVENT at " << Simulator::Now().GetSeconds() << "s ===" << std::endl;
-    std::cout << "Simulating primary network link failure..." << std::endl;
-    
-    // Make the data rate extremely slow to simulate link failure
-    // This will cause packets to be dropped due to buffer overflow
-    device->SetDataRate(DataRate("1bps")); // Extremely slow rate
+    std::cout << "\n=== LINK FAULT at " << Simulator::Now().GetSeconds() << "s: " << faults->Describe(fault)
+              << " ===" << std::endl;
+    bool repair = fault.action == FaultInjector::UP || fault.value == FaultInjector::DEFAULT;
+    if (repair || failureOccurred) {
+        return;
+    }
     
     failureOccurred = true;
     convergenceStartTime = Simulator::Now();
@@ -119,6 +166,62 @@ ActivateBackupRoute(Ptr<Node> node, Ipv4Address destNetwork, Ipv4Mask mask,
     }
 }
 
+// BFD declared a session down: take the interface out of routing, so that
+// static routing falls back to the backup routes and link-state routing
+// recomputes around it
+void
+BfdSessionState(Ptr<Node> node, Ipv4Address peer, uint32_t interface, bool up)
+{
+    if (up || !failureOccurred) {
+        return;
+    }
+    std::cout << "\n=== BFD DOWN at " << Simulator::Now().GetSeconds() << "s ===" << std::endl;
+    std::cout << "Node " << node->GetId() << " lost " << peer << " on interface " << interface
+              << ", detected " << (Simulator::Now() - convergenceStartTime).GetMilliSeconds()
+              << " ms after the failure" << std::endl;
+    node->GetObject<Ipv4>()->SetDown(interface);
+    if (g_routingType == "global") {
+        Ipv4GlobalRoutingHelper::RecomputeRoutingTables();
+    } else if (g_routingType == "spf") {
+        g_spfRouting->Update();
+    }
+    if (g_routingType != "static" && !backupRouteActivated) {
+        backupRouteActivated = true;
+        convergenceEndTime = Simulator::Now();
+        std::cout << "Rerouted in " << (convergenceEndTime - convergenceStartTime).GetSeconds()
+                  << " seconds" << std::endl;
+    }
+}
+
+// Interfaces of a link's devices, for a topology restored from a snapshot
+Ipv4InterfaceContainer
+RestoredInterfaces(const NetDeviceContainer& devices)
+{
+    Ipv4InterfaceContainer interfaces;
+    for (uint32_t i = 0; i < devices.GetN(); ++i) {
+        Ptr<Ipv4> ipv4 = devices.Get(i)->GetNode()->GetObject<Ipv4>();
+        interfaces.Add(ipv4, ipv4->GetInterfaceForDevice(devices.Get(i)));
+    }
+    return interfaces;
+}
+
+// Link-state recompute a fixed delay after the failure (without BFD)
+void
+LinkStateReroute()
+{
+    if (g_routingType == "global") {
+        Ipv4GlobalRoutingHelper::RecomputeRoutingTables();
+    } else {
+        g_spfRouting->Update();
+    }
+    if (failureOccurred && !backupRouteActivated) {
+        backupRouteActivated = true;
+        convergenceEndTime = Simulator::Now();
+        std::cout << "Rerouted in " << (convergenceEndTime - convergenceStartTime).GetSeconds()
+                  << " seconds" << std::endl;
+    }
+}
+
 int
 main(int argc, char* argv[])
 {
@@ -128,19 +231,41 @@ main(int argc, char* argv[])
     LogComponentEnable("RegionalBankWAN", LOG_LEVEL_INFO);
     
     // Simulation parameters
-    std::string routingType = "static"; // "static", "manual-failover", or "global"
+    std::string routingType = "static"; // "static", "manual-failover", "global" or "spf"
     double simulationTime = 20.0;
     double failureTime = 5.0;
     std::string dataRate = "10Mbps";
     uint32_t packetSize = 1024;
+    bool bfd = false;
+    bool linkDown = false;
+    double bfdInterval = 50.0;
+    uint32_t bfdMultiplier = 3;
+    std::string routeFile = "";
+    std::string faultTrace = "";
+    std::string snapshotFile = "";
     
     CommandLine cmd(__FILE__);
-    cmd.AddValue("routing", "Routing type (static/manual-failover/global)", routingType);
+    cmd.AddValue("routing", "Routing type (static/manual-failover/global/spf)", routingType);
     cmd.AddValue("time", "Simulation time in seconds", simulationTime);
     cmd.AddValue("failure", "Link failure time", failureTime);
+    cmd.AddValue("faultTrace", "Fault history replayed instead of the failure at --failure "
+                 "(links: access, primary, backup, backup-path-1, backup-path-2)", faultTrace);
     cmd.AddValue("rate", "Data rate of primary link", dataRate);
     cmd.AddValue("packetSize", "Packet size in bytes", packetSize);
+    cmd.AddValue("linkDown", "Fail the primary link by taking its interfaces down and measure the downtime",
+                 linkDown);
+    cmd.AddValue("bfd", "Detect the failure with BFD on every link and fail over on session down", bfd);
+    cmd.AddValue("bfdInterval", "BFD transmit and receive interval in milliseconds", bfdInterval);
+    cmd.AddValue("bfdMultiplier", "BFD detect multiplier", bfdMultiplier);
+    cmd.AddValue("routeFile", "Static route specification used instead of the built-in static routes", routeFile);
+    cmd.AddValue("snapshot", "Routing snapshot (global routing): restored if the file exists, "
+                 "else written after the routing tables are populated", snapshotFile);
     cmd.Parse(argc, argv);
+    g_routingType = routingType;
+    if (!snapshotFile.empty() && routingType != "global") {
+        std::cerr << "--snapshot needs --routing=global" << std::endl;
+        return 1;
+    }
     
     std::cout << "\n==============================================" << std::endl;
     std::cout << "RegionalBank WAN Resilience Simulation" << std::endl;
@@ -148,6 +273,9 @@ main(int argc, char* argv[])
     std::cout << "Routing Type: " << routingType << std::endl;
     std::cout << "Simulation Time: " << simulationTime << " seconds" << std::endl;
     std::cout << "Link Failure at: " << failureTime << " seconds" << std::endl;
+    if (bfd) {
+        std::cout << "BFD: " << bfdInterval << " ms x " << bfdMultiplier << std::endl;
+    }
     std::cout << "==============================================\n" << std::endl;
     
     // Create 4 nodes: Branch-C (client), DC-A (router), DR-B (server), Backup-Router
@@ -192,28 +320,44 @@ main(int argc, char* argv[])
     InternetStackHelper stack;
     stack.Install(nodes);
     
-    // Assign IP addresses
-    Ipv4AddressHelper address;
-    
-    // Network 1: 10.1.1.0/24 (Branch-C ↔ DC-A)
-    address.SetBase("10.1.1.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces1 = address.Assign(net1Devices);
-    
-    // Network 4: 10.1.4.0/24 (DC-A ↔ DR-B Primary)
-    address.SetBase("10.1.4.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces4 = address.Assign(net4Devices);
-    
-    // Network 3: 10.1.3.0/24 (DC-A ↔ DR-B Backup)
-    address.SetBase("10.1.3.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces3 = address.Assign(net3Devices);
-    
-    // Network 5: 10.1.5.0/24 (DC-A ↔ Backup-Router)
-    address.SetBase("10.1.5.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces5 = address.Assign(net5Devices);
-    
-    // Network 6: 10.1.6.0/24 (Backup-Router ↔ DR-B)
-    address.SetBase("10.1.6.0", "255.255.255.0");
-    Ipv4InterfaceContainer interfaces6 = address.Assign(net6Devices);
+    // Assign IP addresses, or restore them with the FIBs from a snapshot
+    bool warm = !snapshotFile.empty() && access(snapshotFile.c_str(), R_OK) == 0;
+    RoutingSnapshot snapshot;
+    Ipv4InterfaceContainer interfaces1, interfaces4, interfaces3, interfaces5, interfaces6;
+    if (warm) {
+        snapshot.SetPriority(-20); // below Ipv4GlobalRouting (-10)
+        if (!snapshot.Open(snapshotFile) || !snapshot.Restore(nodes)) {
+            std::cerr << "Snapshot " << snapshotFile << ": " << snapshot.GetError() << std::endl;
+            return 1;
+        }
+        interfaces1 = RestoredInterfaces(net1Devices);
+        interfaces4 = RestoredInterfaces(net4Devices);
+        interfaces3 = RestoredInterfaces(net3Devices);
+        interfaces5 = RestoredInterfaces(net5Devices);
+        interfaces6 = RestoredInterfaces(net6Devices);
+    } else {
+        Ipv4AddressHelper address;
+        
+        // Network 1: 10.1.1.0/24 (Branch-C ↔ DC-A)
+        address.SetBase("10.1.1.0", "255.255.255.0");
+        interfaces1 = address.Assign(net1Devices);
+        
+        // Network 4: 10.1.4.0/24 (DC-A ↔ DR-B Primary)
+        address.SetBase("10.1.4.0", "255.255.255.0");
+        interfaces4 = address.Assign(net4Devices);
+        
+        // Network 3: 10.1.3.0/24 (DC-A ↔ DR-B Backup)
+        address.SetBase("10.1.3.0", "255.255.255.0");
+        interfaces3 = address.Assign(net3Devices);
+        
+        // Network 5: 10.1.5.0/24 (DC-A ↔ Backup-Router)
+        address.SetBase("10.1.5.0", "255.255.255.0");
+        interfaces5 = address.Assign(net5Devices);
+        
+        // Network 6: 10.1.6.0/24 (Backup-Router ↔ DR-B)
+        address.SetBase("10.1.6.0", "255.255.255.0");
+        interfaces6 = address.Assign(net6Devices);
+    }
     
     // Print network configuration
     std::cout << "\n=== NETWORK CONFIGURATION ===" << std::endl;
@@ -231,7 +375,18 @@ main(int argc, char* argv[])
               << interfaces6.GetAddress(0) << std::endl;
     
     // Configure static routing for non-global routing types
-    if (routingType != "global") {
+    bool linkState = routingType == "global" || routingType == "spf";
+    if (!linkState && !routeFile.empty()) {
+        std::cout << "\n=== LOADING STATIC ROUTES ===" << std::endl;
+        dcA->GetObject<Ipv4>()->SetAttribute("IpForward", BooleanValue(true));
+        RouteTable routes;
+        if (!routes.Load(routeFile) || !routes.Install()) {
+            std::cerr << "Route table " << routeFile << ": " << routes.GetError() << std::endl;
+            return 1;
+        }
+        std::cout << "Installed " << routes.GetStatistics().installed << " static routes on "
+                  << routes.GetStatistics().nodes << " nodes from " << routeFile << std::endl;
+    } else if (!linkState) {
         std::cout << "\n=== CONFIGURING STATIC ROUTES ===" << std::endl;
         
         // Enable IP forwarding on router
@@ -340,8 +495,24 @@ main(int argc, char* argv[])
     }
     
     // Populate routing tables for global routing
-    if (routingType == "global") {
+    IncrementalSpfRouting spfRouting;
+    g_spfRouting = &spfRouting;
+    if (routingType == "global" && warm) {
+        std::cout << "Warm start: " << snapshot.GetStatistics().routes << " routes and "
+                  << snapshot.GetStatistics().addresses << " addresses restored from " << snapshotFile << std::endl;
+    } else if (routingType == "global") {
         Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+        if (!snapshotFile.empty()) {
+            if (!snapshot.Save(snapshotFile, nodes)) {
+                std::cerr << "Snapshot " << snapshotFile << ": " << snapshot.GetError() << std::endl;
+                return 1;
+            }
+            std::cout << "Routing snapshot saved to " << snapshotFile << std::endl;
+        }
+    } else if (routingType == "spf") {
+        spfRouting.Populate(nodes);
+        std::cout << "Incremental SPF: " << spfRouting.GetStatistics().fibRoutes << " routes installed on "
+                  << nodes.GetN() << " nodes" << std::endl;
     }
     
     // Create UDP Echo Server on DR-B
@@ -352,36 +523,79 @@ main(int argc, char* argv[])
     serverApps.Stop(Seconds(simulationTime));
     
     // Create UDP Echo Client on Branch-C
+    Time echoInterval = Seconds(0.1); // 10 packets per second
     UdpEchoClientHelper echoClient(interfaces4.GetAddress(1), port); // Primary DR-B IP
     echoClient.SetAttribute("MaxPackets", UintegerValue(1000)); // Large number for continuous flow
-    echoClient.SetAttribute("Interval", TimeValue(Seconds(0.1))); // 10 packets per second
+    echoClient.SetAttribute("Interval", TimeValue(echoInterval));
     echoClient.SetAttribute("PacketSize", UintegerValue(packetSize));
     
     ApplicationContainer clientApps = echoClient.Install(branchC);
     clientApps.Start(Seconds(2.0));
     clientApps.Stop(Seconds(simulationTime - 1));
+    g_lastRx = Seconds(2.0); // the downtime clock counts from the first request
     
     // Install trace callbacks for detailed monitoring
     Config::Connect("/NodeList/0/ApplicationList/*/Tx", MakeCallback(&TxTrace));
     Config::Connect("/NodeList/2/ApplicationList/*/Rx", MakeCallback(&RxTrace));
     
-    // Schedule link failure at specified time
+    // Schedule link failure at specified time, or replay a fault trace
     std::cout << "\n=== SCHEDULING LINK FAILURE ===" << std::endl;
-    std::cout << "Primary link (Network 4) will fail at t=" << failureTime << "s" << std::endl;
-    
-    // Get the PointToPointNetDevice objects
-    Ptr<PointToPointNetDevice> dcAPrimaryDev = DynamicCast<PointToPointNetDevice>(net4Devices.Get(0));
-    Ptr<PointToPointNetDevice> drBPrimaryDev = DynamicCast<PointToPointNetDevice>(net4Devices.Get(1));
-    
-    if (dcAPrimaryDev && drBPrimaryDev) {
-        Simulator::Schedule(Seconds(failureTime), &SimulateLinkFailure, dcAPrimaryDev);
-        Simulator::Schedule(Seconds(failureTime), &SimulateLinkFailure, drBPrimaryDev);
+    FaultInjector faults;
+    faults.AddLink("access", net1Devices);
+    faults.AddLink("primary", net4Devices);
+    faults.AddLink("backup", net3Devices);
+    faults.AddLink("backup-path-1", net5Devices);
+    faults.AddLink("backup-path-2", net6Devices);
+    if (faultTrace.empty()) {
+        if (linkDown) {
+            // Loss of carrier: the interfaces go down, which link-state routing sees
+            faults.AddFault(Seconds(failureTime), "primary", FaultInjector::DOWN);
+        } else {
+            // Make the data rate extremely slow to simulate link failure
+            // This will cause packets to be dropped due to buffer overflow
+            faults.AddFault(Seconds(failureTime), "primary", FaultInjector::RATE, 1);
+        }
+        std::cout << "Primary link (Network 4) will fail at t=" << failureTime << "s" << std::endl;
+    } else if (faults.Load(faultTrace) && faults.GetNFaults() > 0) {
+        // Recovery below is scheduled relative to the first fault
+        failureTime = faults.GetFirstFaultTime().GetSeconds();
+        std::cout << faults.GetNFaults() << " faults from " << faultTrace << ", the first at t=" << failureTime
+                  << "s" << std::endl;
     } else {
-        std::cout << "WARNING: Could not get PointToPointNetDevice for link failure simulation" << std::endl;
+        std::cerr << "Fault trace " << faultTrace << ": "
+                  << (faults.GetError().empty() ? "no faults" : faults.GetError()) << std::endl;
+        return 1;
+    }
+    faults.AddFaultCallback([&faults](const FaultInjector::Fault& fault) { LinkFault(&faults, fault); });
+    faults.Schedule();
+    
+    // BFD sessions on every link; DC-A and DR-B act on the primary link's
+    std::vector<Ptr<BfdAgent>> bfdAgents;
+    if (bfd) {
+        BfdHelper bfdHelper;
+        bfdHelper.SetAttribute("DesiredMinTxInterval", TimeValue(Seconds(bfdInterval / 1000.0)));
+        bfdHelper.SetAttribute("RequiredMinRxInterval", TimeValue(Seconds(bfdInterval / 1000.0)));
+        bfdHelper.SetAttribute("DetectMultiplier", UintegerValue(bfdMultiplier));
+        for (const NetDeviceContainer& link : {net1Devices, net4Devices, net3Devices, net5Devices, net6Devices}) {
+            bfdHelper.InstallLink(link);
+        }
+        for (uint32_t i = 0; i < nodes.GetN(); ++i) {
+            Ptr<BfdAgent> agent = bfdHelper.Install(nodes.Get(i));
+            agent->SetStartTime(Seconds(1.0));
+            agent->SetStopTime(Seconds(simulationTime));
+            bfdAgents.push_back(agent);
+        }
+        for (Ptr<Node> node : {dcA, drB}) {
+            bfdHelper.Install(node)->TraceConnectWithoutContext("SessionState",
+                                                                MakeBoundCallback(&BfdSessionState, node));
+        }
+        std::cout << "BFD on 5 links: failover starts when the primary link's session goes down" << std::endl;
     }
     
     // Schedule appropriate recovery based on routing type
-    if (routingType == "manual-failover") {
+    if (bfd) {
+        // Driven by BfdSessionState
+    } else if (routingType == "manual-failover") {
         // Simulate manual failover after 2 seconds (like an admin intervention)
         std::cout << "Manual failover scheduled 2 seconds after failure" << std::endl;
         Simulator::Schedule(Seconds(failureTime + 2.0), &ActivateBackupRoute, 
@@ -391,7 +605,11 @@ main(int argc, char* argv[])
         // Global routing will automatically recalculate
         std::cout << "Global routing will automatically recalculate routes" << std::endl;
         // Force routing recalculation after link failure
-        Simulator::Schedule(Seconds(failureTime + 0.1), &Ipv4GlobalRoutingHelper::RecomputeRoutingTables);
+        Simulator::Schedule(Seconds(failureTime + 0.1), &LinkStateReroute);
+    } else if (routingType == "spf") {
+        // Only the links whose state or metric changed are recomputed
+        std::cout << "Incremental SPF will update the affected routes" << std::endl;
+        Simulator::Schedule(Seconds(failureTime + 0.1), &LinkStateReroute);
     }
     
     // Install FlowMonitor for comprehensive statistics
@@ -422,6 +640,33 @@ main(int argc, char* argv[])
         Time convergenceTime = convergenceEndTime - convergenceStartTime;
         std::cout << "Failover Time: " << convergenceTime.GetSeconds() << " seconds" << std::endl;
     }
+    if (bfd) {
+        // Control packets and timer expiries are what BFD adds to the event queue
+        uint64_t controlSent = 0;
+        uint64_t timerEvents = 0;
+        Time detection;
+        for (Ptr<BfdAgent> agent : bfdAgents) {
+            controlSent += agent->GetStatistics().controlSent;
+            timerEvents += agent->GetStatistics().timerEvents;
+            for (uint32_t s = 0; s < agent->GetNSessions(); ++s) {
+                detection = std::max(detection, agent->GetDetectionTime(s));
+            }
+        }
+        double bfdSeconds = simulationTime - 1.0;
+        std::cout << "BFD detection time: " << detection.GetMilliSeconds() << " ms" << std::endl;
+        if (backupRouteActivated) {
+            std::cout << "Detection-to-reroute: " << (convergenceEndTime - convergenceStartTime).GetMilliSeconds()
+                      << " ms after the failure" << std::endl;
+        }
+        std::cout << "BFD cost: " << controlSent << " control packets (" << controlSent / bfdSeconds / 5
+                  << " per second per link), " << timerEvents << " timer events; "
+                  << Simulator::GetEventCount() << " simulator events in total" << std::endl;
+    }
+    if (routingType == "spf") {
+        const IncrementalSpfRouting::Statistics& spfStats = spfRouting.GetStatistics();
+        std::cout << "Incremental SPF: " << spfStats.updates << " update(s), " << spfStats.linkChanges
+                  << " link change(s), " << spfStats.fibUpdates << " FIB entries rewritten" << std::endl;
+    }
     
     // Generate FlowMonitor statistics
     monitor->CheckForLostPackets();
@@ -510,19 +755,30 @@ main(int argc, char* argv[])
     std::cout << "\n=== BUSINESS IMPACT ANALYSIS ===" << std::endl;
     
     double downtime = 0;
-    if (routingType == "static") {
+    if (linkDown) {
+        // Longest delivery gap, or the outage still open when the traffic stopped
+        Time openOutage = g_lastTx + echoInterval - g_lastRx;
+        downtime = std::max(std::max(g_longestGap, openOutage) - echoInterval, Seconds(0)).GetSeconds();
+    } else if (routingType == "static") {
         downtime = simulationTime - failureTime; // Permanent outage
     } else if (routingType == "manual-failover") {
         downtime = (backupRouteActivated && convergenceEndTime.IsPositive()) ? 
                    (convergenceEndTime.GetSeconds() - failureTime) : 
                    (simulationTime - failureTime);
-    } else if (routingType == "global") {
+    } else if (linkState && bfd) {
+        downtime = backupRouteActivated ? (convergenceEndTime.GetSeconds() - failureTime) :
+                   (simulationTime - failureTime);
+    } else if (linkState) {
         // Global routing typically converges quickly
         downtime = 1.0; // Estimate for global routing
     }
     
     std::cout << "Routing Type: " << routingType << std::endl;
-    std::cout << "Estimated Downtime: " << downtime << " seconds" << std::endl;
+    if (linkDown) {
+        std::cout << "Measured Downtime: " << downtime << " seconds (longest gap in delivery at DR-B)" << std::endl;
+    } else {
+        std::cout << "Estimated Downtime: " << downtime << " seconds" << std::endl;
+    }
     
     // Business impact calculations
     double transactionsPerSecond = 10.0;
@@ -562,8 +818,8 @@ main(int argc, char* argv[])
         if (downtime > 2.0) {
             std::cout << "Consider automated monitoring systems for faster failover" << std::endl;
         }
-    } else if (routingType == "global") {
-        std::cout << "GLOBAL ROUTING: Automatic recovery with " << downtime << "s downtime" << std::endl;
+    } else if (linkState) {
+        std::cout << (routingType == "spf" ? "INCREMENTAL SPF" : "GLOBAL ROUTING") << ": Automatic recovery with " << downtime << "s downtime" << std::endl;
         std::cout << "Most resilient option for WAN environments" << std::endl;
     }
     
@@ -0,0 +1,282 @@
+/*
+ * Link-state recompute benchmark: full Dijkstra vs. incremental SPF
+ *
+ * exercise03's "global" mode reacts to a link failure with
+ * Ipv4GlobalRoutingHelper::RecomputeRoutingTables(), which reruns Dijkstra
+ * for every node. This benchmark measures what that costs on large meshes
+ * and what IncrementalSpf (wan-incremental-spf.h) costs for the same link
+ * events:
+ *
+ *   - meshes of --sizes nodes: a ring plus random chords, --degree links
+ *     per node on average, random metrics 1 - 100;
+ *   - --roots routers spread over the mesh keep a shortest-path tree (all
+ *     N trees would not fit in memory at 50k nodes; the per-tree cost is
+ *     extrapolated to every router);
+ *   - --events random link events: a link fails, a failed link comes back,
+ *     or a metric changes.
+ *
+ * After the events every tree is cross-checked against a full recompute.
+ * With --ns3Nodes the same kind of mesh is also built out of ns-3 nodes and
+ * RecomputeRoutingTables() is timed against IncrementalSpfRouting::Update()
+ * after a real interface failure, with the FIB entries each one rewrote.
+ *
+ * Example: ./ns3 run "scratch/exercise03-spf-benchmark --sizes=1000,10000,50000 --ns3Nodes=1000"
+ */
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-incremental-spf.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE("SpfBenchmark");
+
+struct MeshLink
+{
+    uint32_t a;
+    uint32_t b;
+    uint32_t metric;
+};
+
+// Ring (so the mesh is connected) plus random chords, metrics 1 - 100
+std::vector<MeshLink> GenerateMesh(uint32_t nodes, uint32_t degree, std::mt19937& rng)
+{
+    std::vector<MeshLink> links;
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        links.push_back({i, (i + 1) % nodes, 1 + static_cast<uint32_t>(rng() % 100)});
+    }
+    uint64_t chords = uint64_t(nodes) * (std::max<uint32_t>(degree, 2) - 2) / 2;
+    for (uint64_t c = 0; c < chords; ++c)
+    {
+        uint32_t a = rng() % nodes;
+        uint32_t b = rng() % nodes;
+        if (a != b)
+        {
+            links.push_back({a, b, 1 + static_cast<uint32_t>(rng() % 100)});
+        }
+    }
+    return links;
+}
+
+// Both directions of every mesh link: link 2k is a -> b, 2k + 1 is b -> a
+void BuildGraph(IncrementalSpf& spf, uint32_t nodes, const std::vector<MeshLink>& links, uint32_t roots)
+{
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        spf.AddNode();
+    }
+    for (const MeshLink& link : links)
+    {
+        spf.AddLink(link.a, link.b, link.metric);
+        spf.AddLink(link.b, link.a, link.metric);
+    }
+    for (uint32_t r = 0; r < roots; ++r)
+    {
+        spf.AddRoot(uint64_t(r) * nodes / roots);
+    }
+}
+
+double ElapsedSeconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Returns the number of trees that disagree with a full recompute
+uint32_t BenchmarkMesh(uint32_t nodes, uint32_t degree, uint32_t roots, uint32_t events, std::mt19937& rng)
+{
+    roots = std::min(roots, nodes);
+    std::vector<MeshLink> links = GenerateMesh(nodes, degree, rng);
+    IncrementalSpf spf;
+    BuildGraph(spf, nodes, links, roots);
+
+    auto start = std::chrono::steady_clock::now();
+    spf.ComputeAll();
+    double fullSeconds = ElapsedSeconds(start);
+
+    // Link events, applied to both directions as an interface failure would be
+    std::vector<bool> failed(links.size(), false);
+    std::vector<std::pair<uint32_t, uint32_t>> changes; // (mesh link, new metric)
+    for (uint32_t e = 0; e < events; ++e)
+    {
+        uint32_t link = rng() % links.size();
+        uint32_t kind = rng() % 3;
+        uint32_t metric;
+        if (failed[link])
+        {
+            metric = links[link].metric; // comes back
+        }
+        else if (kind == 0)
+        {
+            metric = IncrementalSpf::INFINITE;
+        }
+        else
+        {
+            metric = 1 + rng() % 100;
+            links[link].metric = metric;
+        }
+        failed[link] = metric == IncrementalSpf::INFINITE;
+        changes.emplace_back(link, metric);
+    }
+
+    IncrementalSpf::Statistics before = spf.GetStatistics();
+    start = std::chrono::steady_clock::now();
+    for (const auto& change : changes)
+    {
+        spf.SetMetric(2 * change.first, change.second);
+        spf.SetMetric(2 * change.first + 1, change.second);
+    }
+    double incrementalSeconds = ElapsedSeconds(start);
+    const IncrementalSpf::Statistics& after = spf.GetStatistics();
+
+    // Cross-check against trees computed from scratch on the final metrics
+    std::vector<MeshLink> final = links;
+    for (uint32_t l = 0; l < links.size(); ++l)
+    {
+        if (failed[l])
+        {
+            final[l].metric = IncrementalSpf::INFINITE;
+        }
+    }
+    IncrementalSpf reference;
+    BuildGraph(reference, nodes, final, roots);
+    reference.ComputeAll();
+    uint32_t mismatches = 0;
+    for (uint32_t r = 0; r < roots; ++r)
+    {
+        for (uint32_t n = 0; n < nodes; ++n)
+        {
+            if (spf.GetDistance(r, n) != reference.GetDistance(r, n))
+            {
+                mismatches++;
+                break;
+            }
+        }
+    }
+
+    uint64_t linkChanges = after.linkChanges - before.linkChanges;
+    uint64_t treeUpdates = after.treesUpdated - before.treesUpdated;
+    double fullPerTree = fullSeconds / roots;
+    double incrementalPerTree = incrementalSeconds / std::max<uint64_t>(1, linkChanges) / roots;
+    std::cout << std::setw(8) << nodes << std::setw(9) << links.size() * 2 << std::setw(11)
+              << std::fixed << std::setprecision(3) << fullPerTree * 1e3 << std::setw(13)
+              << incrementalPerTree * 1e3 << std::setw(9) << std::setprecision(0)
+              << fullPerTree / incrementalPerTree << "x" << std::setw(9) << std::setprecision(1)
+              << 100.0 * treeUpdates / std::max<uint64_t>(1, linkChanges * roots) << "%"
+              << std::setw(12) << (after.nodesSettled - before.nodesSettled) / std::max<uint64_t>(1, treeUpdates)
+              << std::setw(11) << std::setprecision(2) << fullPerTree * nodes << std::setw(12)
+              << std::setprecision(4) << incrementalPerTree * nodes << std::setw(6) << mismatches << "\n";
+    return mismatches;
+}
+
+// ns-3 mesh: RecomputeRoutingTables() vs. IncrementalSpfRouting::Update() after an interface failure
+void BenchmarkNs3(uint32_t nodes, uint32_t degree, std::mt19937& rng)
+{
+    std::vector<MeshLink> mesh = GenerateMesh(nodes, degree, rng);
+    NodeContainer routers;
+    routers.Create(nodes);
+    InternetStackHelper stack;
+    stack.Install(routers);
+    PointToPointHelper p2p;
+    p2p.SetDeviceAttribute("DataRate", StringValue("1Gbps"));
+    p2p.SetChannelAttribute("Delay", StringValue("1ms"));
+    Ipv4AddressHelper address;
+    address.SetBase("10.0.0.0", "255.255.255.252");
+    std::vector<Ipv4InterfaceContainer> interfaces;
+    for (const MeshLink& link : mesh)
+    {
+        interfaces.push_back(address.Assign(p2p.Install(routers.Get(link.a), routers.Get(link.b))));
+        address.NewNetwork();
+        for (uint32_t end = 0; end < 2; ++end)
+        {
+            interfaces.back().Get(end).first->SetMetric(interfaces.back().Get(end).second, link.metric);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    double globalPopulate = ElapsedSeconds(start);
+
+    IncrementalSpfRouting spf;
+    start = std::chrono::steady_clock::now();
+    spf.Populate(routers);
+    double spfPopulate = ElapsedSeconds(start);
+
+    // Fail the first chord, or a ring link on a chordless mesh
+    uint32_t victim = mesh.size() > nodes ? nodes : 0;
+    for (uint32_t end = 0; end < 2; ++end)
+    {
+        interfaces[victim].Get(end).first->SetDown(interfaces[victim].Get(end).second);
+    }
+
+    start = std::chrono::steady_clock::now();
+    Ipv4GlobalRoutingHelper::RecomputeRoutingTables();
+    double globalRecompute = ElapsedSeconds(start);
+
+    start = std::chrono::steady_clock::now();
+    spf.Update();
+    double spfUpdate = ElapsedSeconds(start);
+
+    const IncrementalSpfRouting::Statistics& stats = spf.GetStatistics();
+    std::cout << "\n=== ns-3 mesh: " << nodes << " routers, " << mesh.size() << " p2p links ===\n";
+    std::cout << "                                  Populate (s)   Recompute (s)   FIB entries written\n";
+    std::cout << "Ipv4GlobalRoutingHelper        " << std::setw(15) << std::setprecision(3) << globalPopulate
+              << std::setw(16) << std::setprecision(4) << globalRecompute << std::setw(22)
+              << "all (rebuilt)" << "\n";
+    std::cout << "IncrementalSpfRouting          " << std::setw(15) << std::setprecision(3) << spfPopulate
+              << std::setw(16) << std::setprecision(4) << spfUpdate << std::setw(22) << stats.fibUpdates
+              << "\n";
+    std::cout << "IncrementalSpfRouting installed " << stats.fibRoutes << " routes, the failure changed "
+              << stats.linkChanges << " links\n";
+}
+
+int
+main(int argc, char* argv[])
+{
+    std::string sizes = "1000,10000,50000";
+    uint32_t degree = 4;
+    uint32_t roots = 100;
+    uint32_t events = 200;
+    uint32_t ns3Nodes = 0;
+    uint32_t seed = 1;
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("sizes", "Comma-separated mesh sizes (nodes)", sizes);
+    cmd.AddValue("degree", "Average links per node", degree);
+    cmd.AddValue("roots", "Routers whose trees are kept, per mesh", roots);
+    cmd.AddValue("events", "Link events (failure, repair, metric change) per mesh", events);
+    cmd.AddValue("ns3Nodes", "Also compare against Ipv4GlobalRoutingHelper on an ns-3 mesh of this size (0 = skip)", ns3Nodes);
+    cmd.AddValue("seed", "Seed of the mesh and event generator", seed);
+    cmd.Parse(argc, argv);
+
+    std::mt19937 rng(seed);
+    std::cout << "=== SPF recompute per link event (" << roots << " trees per mesh, " << events
+              << " events) ===\n";
+    std::cout << "   Nodes    Links  Full (ms)  Incr. (ms)  Speedup  Trees hit  Nodes/tree"
+              << "  All full (s)  All incr. (s)  Bad\n";
+    uint32_t mismatches = 0;
+    std::istringstream list(sizes);
+    std::string size;
+    while (std::getline(list, size, ','))
+    {
+        mismatches += BenchmarkMesh(std::stoul(size), degree, roots, events, rng);
+    }
+    std::cout << "Full and Incr. are per tree and link event; the All columns extrapolate them\n"
+              << "to one tree per node, i.e. what RecomputeRoutingTables() would redo.\n";
+
+    if (ns3Nodes > 0)
+    {
+        BenchmarkNs3(ns3Nodes, degree, rng);
+    }
+
+    Simulator::Destroy();
+    return mismatches == 0 ? 0 : 1;
+}
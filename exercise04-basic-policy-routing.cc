@@ -5,7 +5,7 @@
 #include "ns3/internet-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/applications-module.h"
-#include "ns3/netanim-module.h"
+#include "wan-anim-writer.h"
 
 using namespace ns3;
 
@@ -15,8 +15,13 @@ int main(int argc, char *argv[])
 {
     double simTime = 15.0;
     std::string animFile = "pbr-twopaths.xml";
+    uint32_t animSample = 1;
+    uint32_t animFlowPackets = 0;
     
     CommandLine cmd(__FILE__);
+    cmd.AddValue("animFile", "NetAnim output file (a .gz name is gzip-compressed)", animFile);
+    cmd.AddValue("animSample", "Animate one packet in this many (0 = none)", animSample);
+    cmd.AddValue("animFlowPackets", "Animate only the first packets of every flow (0 = all)", animFlowPackets);
     cmd.Parse(argc, argv);
     
     Time::SetResolution(Time::NS);
@@ -111,7 +116,9 @@ int main(int argc, char *argv[])
     dataClientApp.Stop(Seconds(12.0));
     
     // Create NetAnim XML
-    AnimationInterface anim(animFile);
+    AnimStreamWriter anim(animFile);
+    anim.SetSampling(animSample);
+    anim.SetFlowSampling(animFlowPackets);
     
     // Set node descriptions
     anim.UpdateNodeDescription(0, "Studio Host");
@@ -14,16 +14,18 @@
  *     - Interface 1: 10.1.1.2 (connected to n0)
  *     - Interface 2: 10.1.2.1 (connected to n2)
  * - n2 is on network 10.1.2.0/24 (IP: 10.1.2.2)
- * - Static routes configured on n0 and n2 to reach each other through n1
+ * - Static routes configured on n0 and n2 to reach each other through n1,
+ *   read from exercise04-edge-fixed-paths.routes (wan-route-table.h)
  */
 
 #include "ns3/applications-module.h"
 #include "ns3/core-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/mobility-module.h"
-#include "ns3/netanim-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
+#include "wan-anim-writer.h"
+#include "wan-route-table.h"
 
 using namespace ns3;
 
@@ -36,6 +38,12 @@ main(int argc, char* argv[])
     LogComponentEnable("UdpEchoClientApplication", LOG_LEVEL_INFO);
     LogComponentEnable("UdpEchoServerApplication", LOG_LEVEL_INFO);
 
+    std::string routeFile = "scratch/exercise04-edge-fixed-paths.routes";
+
+    CommandLine cmd(__FILE__);
+    cmd.AddValue("routeFile", "Static route specification (routing table text or binary)", routeFile);
+    cmd.Parse(argc, argv);
+
     // Create three nodes: n0 (client), n1 (router), n2 (server)
     NodeContainer nodes;
     nodes.Create(3);
@@ -99,29 +107,15 @@ main(int argc, char* argv[])
     // Get static routing protocol helper
     Ipv4StaticRoutingHelper staticRoutingHelper;
 
-    // Configure routing on n0 (client)
-    // n0 needs to know that to reach 10.1.2.0/24, it should go through 10.1.1.2 (router's
-    // interface)
-    Ptr<Ipv4StaticRouting> staticRoutingN0 =
-        staticRoutingHelper.GetStaticRouting(n0->GetObject<Ipv4>());
-    staticRoutingN0->AddNetworkRouteTo(
-        Ipv4Address("10.1.2.0"),   // Destination network
-        Ipv4Mask("255.255.255.0"), // Network mask
-        Ipv4Address("10.1.1.2"),   // Next hop (router's interface on network 1)
-        1                          // Interface index
-    );
-
-    // Configure routing on n2 (server)
-    // n2 needs to know that to reach 10.1.1.0/24, it should go through 10.1.2.1 (router's
-    // interface)
-    Ptr<Ipv4StaticRouting> staticRoutingN2 =
-        staticRoutingHelper.GetStaticRouting(n2->GetObject<Ipv4>());
-    staticRoutingN2->AddNetworkRouteTo(
-        Ipv4Address("10.1.1.0"),   // Destination network
-        Ipv4Mask("255.255.255.0"), // Network mask
-        Ipv4Address("10.1.2.1"),   // Next hop (router's interface on network 2)
-        1                          // Interface index
-    );
+    // n0 reaches 10.1.2.0/24 through 10.1.1.2 and n2 reaches 10.1.1.0/24
+    // through 10.1.2.1 (the router's interfaces); the routes come from the
+    // route specification, checked against the topology above
+    RouteTable routes;
+    if (!routes.Load(routeFile) || !routes.Install())
+    {
+        std::cerr << "Route table " << routeFile << ": " << routes.GetError() << "\n";
+        return 1;
+    }
 
     // Note: Router (n1) doesn't need explicit routes as it's directly connected to both networks
 
@@ -155,7 +149,7 @@ main(int argc, char* argv[])
     clientApps.Stop(Seconds(10.0));
 
     // *** NetAnim Configuration ***
-    AnimationInterface anim("scratch/router-static-routing.xml");
+    AnimStreamWriter anim("scratch/router-static-routing.xml");
 
     // Node positions are already set via MobilityModel above
     // NetAnim will automatically use the mobility model positions
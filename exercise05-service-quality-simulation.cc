@@ -14,17 +14,22 @@
  * - Class 2: FTP-like traffic (1500-byte packets, bursty, DSCP BE)
  * - Simple priority queuing using DSCP marking
  * - Performance measurement using FlowMonitor
+ * - NetAnim output (wan-anim-writer.h) animates one packet in 10 by default
+ *   (--animSample); the window can be narrowed with --animStart/--animStop
+ * - Static routes installed through RouteTable (wan-route-table.h), or read
+ *   from --routeFile
  */
 
 #include "ns3/applications-module.h"
 #include "ns3/core-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/mobility-module.h"
-#include "ns3/netanim-module.h"
 #include "ns3/network-module.h"
 #include "ns3/point-to-point-module.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-module.h"
+#include "wan-anim-writer.h"
+#include "wan-route-table.h"
 
 using namespace ns3;
 
@@ -159,11 +164,21 @@ main(int argc, char* argv[])
     bool enableQoS = true;
     uint32_t nFtpFlows = 3; // Number of FTP-like flows for congestion
     uint32_t queueSize = 100; // Packets
+    uint32_t animSample = 10;
+    uint32_t animFlowPackets = 0;
+    double animStart = 0.0;
+    double animStop = 15.0;
+    std::string routeFile = "";
     
     CommandLine cmd;
     cmd.AddValue("qos", "Enable QoS (true/false)", enableQoS);
     cmd.AddValue("ftpflows", "Number of FTP flows", nFtpFlows);
     cmd.AddValue("queuesize", "Queue size in packets", queueSize);
+    cmd.AddValue("animSample", "Animate one packet in this many (0 = none)", animSample);
+    cmd.AddValue("animFlowPackets", "Animate only the first packets of every flow (0 = all)", animFlowPackets);
+    cmd.AddValue("animStart", "Animate packets sent from this time on", animStart);
+    cmd.AddValue("animStop", "Animate packets sent before this time", animStop);
+    cmd.AddValue("routeFile", "Static route specification instead of the two built-in routes", routeFile);
     cmd.Parse(argc, argv);
     
     std::cout << "\n=== QoS Simulation Configuration ===\n";
@@ -228,16 +243,19 @@ main(int argc, char* argv[])
     Ptr<Ipv4> ipv4Router = n1->GetObject<Ipv4>();
     ipv4Router->SetAttribute("IpForward", BooleanValue(true));
     
-    // Configure static routing
-    Ipv4StaticRoutingHelper staticRoutingHelper;
-    
-    // Route on n0
-    Ptr<Ipv4StaticRouting> staticRoutingN0 = staticRoutingHelper.GetStaticRouting(n0->GetObject<Ipv4>());
-    staticRoutingN0->AddNetworkRouteTo(Ipv4Address("10.1.2.0"), Ipv4Mask("255.255.255.0"), Ipv4Address("10.1.1.2"), 1);
-    
-    // Route on n2
-    Ptr<Ipv4StaticRouting> staticRoutingN2 = staticRoutingHelper.GetStaticRouting(n2->GetObject<Ipv4>());
-    staticRoutingN2->AddNetworkRouteTo(Ipv4Address("10.1.1.0"), Ipv4Mask("255.255.255.0"), Ipv4Address("10.1.2.1"), 1);
+    // Configure static routing: n0 and n2 reach each other through the router
+    RouteTable routes;
+    if (routeFile.empty()) {
+        routes.AddRoute(n0->GetId(), Ipv4Address("10.1.2.0"), 24, Ipv4Address("10.1.1.2"), 1);
+        routes.AddRoute(n2->GetId(), Ipv4Address("10.1.1.0"), 24, Ipv4Address("10.1.2.1"), 1);
+    } else if (!routes.Load(routeFile)) {
+        std::cerr << "Route table " << routeFile << ": " << routes.GetError() << "\n";
+        return 1;
+    }
+    if (!routes.Install()) {
+        std::cerr << "Static routes: " << routes.GetError() << "\n";
+        return 1;
+    }
     
     // ========== SIMPLE QoS CONFIGURATION ==========
     // Using DSCP marking and simple queue management
@@ -318,7 +336,10 @@ main(int argc, char* argv[])
     // ========== SIMULATION SETUP ==========
     
     // NetAnim Configuration
-    AnimationInterface anim("scratch/qos-simulation.xml");
+    AnimStreamWriter anim("scratch/qos-simulation.xml");
+    anim.SetSampling(animSample);
+    anim.SetFlowSampling(animFlowPackets);
+    anim.SetWindow(Seconds(animStart), Seconds(animStop));
     
     // Set node descriptions
     anim.UpdateNodeDescription(n0, "Client\n10.1.1.1\nVoIP+FTP");
@@ -330,7 +351,7 @@ main(int argc, char* argv[])
     anim.UpdateNodeColor(n1, 255, 255, 0); // Yellow
     anim.UpdateNodeColor(n2, 0, 0, 255);   // Blue
     
-    // Color packets by DSCP in animation
+    // Color packets by DSCP in animation (headers of the sampled packets only)
     anim.EnablePacketMetadata(true);
     
     // Enable PCAP tracing on router interfaces only (to reduce file size)
@@ -0,0 +1,776 @@
+/*
+ * Streaming, sampled NetAnim writer
+ *
+ * AnimationInterface with EnablePacketMetadata(true) records every packet
+ * on every hop, so the XML of a few seconds of saturated traffic runs into
+ * hundreds of megabytes. AnimStreamWriter writes the same NetAnim format
+ * (netanim-3.108) but only for a sample of the packets:
+ *
+ *  - SetSampling(n) keeps one packet in n. The choice is made on the packet
+ *    uid, which ns-3 keeps while a router forwards the packet, so a sampled
+ *    packet is shown on every hop of its path and needs no per-packet state.
+ *  - SetFlowSampling(k) keeps the first k packets of every 5-tuple flow
+ *    (FlowHash, wan-flow-hash.h). Per flow only a count and the highest
+ *    accepted uid are kept: later hops of an accepted packet see a uid at or
+ *    below it, new packets of the flow a higher one.
+ *  - SetWindow(start, stop) drops packets outside a time window.
+ *
+ * Both samplings can be combined; a packet must pass each. Node and link
+ * records are written as they happen; the only state kept is the sampled
+ * transmissions still in flight and the per-flow counts, and writes go
+ * through a 1 MiB stdio buffer. A file name ending in ".gz" is piped
+ * through gzip in a separate process (the name is quoted for the shell);
+ * NetAnim does not read it directly, gunzip it first. A failed write or a
+ * gzip that does not exit cleanly is reported on stderr by Close().
+ *
+ * Only point-to-point and CSMA devices are traced (PhyTxBegin/PhyRxEnd),
+ * which covers every exercise. The writer connects to the devices when the
+ * simulation starts and must stay alive until Simulator::Run() returns;
+ * the file is completed when it is destroyed or Close() is called.
+ *
+ * The node set-up calls (SetConstantPosition, UpdateNodeColor, ...) match
+ * AnimationInterface, so a script switches by changing the declaration.
+ *
+ * Usage: copy this header and wan-flow-hash.h next to the exercise script
+ * in scratch/.
+ */
+
+#ifndef WAN_ANIM_WRITER_H
+#define WAN_ANIM_WRITER_H
+
+#include "wan-flow-hash.h"
+
+#include "ns3/core-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/wait.h>
+
+namespace ns3
+{
+
+/**
+ * NetAnim trace writer that streams a sample of the packets to disk.
+ */
+class AnimStreamWriter
+{
+  public:
+    /// Writer counters
+    struct Statistics
+    {
+        uint64_t packetsSeen{0};    ///< transmissions inside the window
+        uint64_t packetsSampled{0}; ///< transmissions written
+        uint64_t flows{0};          ///< flows tracked by SetFlowSampling
+        uint64_t bytesWritten{0};   ///< uncompressed output
+    };
+
+    /// Start writing to path (".gz" suffix: gzip-compressed); aborts if it cannot be opened
+    explicit AnimStreamWriter(const std::string& path);
+    ~AnimStreamWriter();
+
+    AnimStreamWriter(const AnimStreamWriter&) = delete;
+    AnimStreamWriter& operator=(const AnimStreamWriter&) = delete;
+
+    /// Keep one packet in every n (1 = all, 0 = none)
+    void SetSampling(uint32_t n);
+    /// Keep only the first k packets of every flow (0 = no limit)
+    void SetFlowSampling(uint32_t k);
+    /// Only write packets transmitted in [start, stop)
+    void SetWindow(Time start, Time stop);
+    /// Attach the packet's headers to every sampled packet (enables PacketMetadata)
+    void EnablePacketMetadata(bool enable = true);
+
+    void SetConstantPosition(Ptr<Node> node, double x, double y);
+    void UpdateNodeDescription(Ptr<Node> node, const std::string& description);
+    void UpdateNodeDescription(uint32_t nodeId, const std::string& description);
+    void UpdateNodeColor(Ptr<Node> node, uint8_t r, uint8_t g, uint8_t b);
+    void UpdateNodeColor(uint32_t nodeId, uint8_t r, uint8_t g, uint8_t b);
+    void UpdateNodeSize(uint32_t nodeId, double width, double height);
+    void UpdateLinkDescription(Ptr<Node> from, Ptr<Node> to, const std::string& description);
+
+    /// Disconnect from the devices and complete the file; called by the destructor
+    /// \return false (reported on stderr) if a write or gzip failed
+    bool Close();
+
+    const Statistics& GetStatistics() const;
+
+  private:
+    /// Node attributes set before the topology is written
+    struct NodeSetup
+    {
+        std::string description;
+        bool colored{false};
+        uint8_t r{0}, g{0}, b{0};
+        bool sized{false};
+        double width{0}, height{0};
+    };
+
+    /// A sampled transmission waiting for its receptions
+    struct Transmission
+    {
+        uint32_t from;
+        double firstBitTx;
+        double lastBitTx;
+    };
+
+    /// A traced device and the callbacks to disconnect again
+    struct TracedDevice
+    {
+        Ptr<NetDevice> device;
+        Callback<void, Ptr<const Packet>> txBegin;
+        Callback<void, Ptr<const Packet>> rxEnd;
+    };
+
+    struct FlowSample
+    {
+        uint32_t packets{0};
+        uint64_t highestUid{0};
+    };
+
+    void Start();
+    void WriteTopology();
+    void Connect(Ptr<NetDevice> device);
+    static void TxBeginTrace(AnimStreamWriter* writer, Ptr<NetDevice> device, Ptr<const Packet> packet);
+    static void RxEndTrace(AnimStreamWriter* writer, Ptr<NetDevice> device, Ptr<const Packet> packet);
+    void TxBegin(Ptr<NetDevice> device, Ptr<const Packet> packet);
+    void RxEnd(Ptr<NetDevice> device, Ptr<const Packet> packet);
+    bool Sample(Ptr<NetDevice> device, Ptr<const Packet> packet);
+    static bool FlowOf(Ptr<NetDevice> device, Ptr<const Packet> packet, uint32_t& hash);
+    static Time TransmissionTime(Ptr<NetDevice> device, Ptr<const Packet> packet);
+    static std::string Escape(const std::string& text);
+    static std::string ShellQuote(const std::string& text);
+    static std::string AddressOf(Ptr<NetDevice> device);
+    void Write(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+    std::string m_path;
+    FILE* m_file;
+    bool m_pipe;
+    bool m_writeFailed;
+    std::vector<char> m_buffer;
+    bool m_started;
+    EventId m_startEvent;
+    uint32_t m_every;
+    uint32_t m_flowPackets;
+    Time m_windowStart;
+    Time m_windowStop;
+    bool m_metadata;
+    std::map<uint32_t, NodeSetup> m_setup;
+    std::map<std::pair<uint32_t, uint32_t>, std::string> m_linkDescriptions;
+    std::unordered_map<uint64_t, Transmission> m_inFlight;
+    std::unordered_map<uint32_t, FlowSample> m_flows;
+    std::vector<TracedDevice> m_devices;
+    Statistics m_stats;
+};
+
+inline AnimStreamWriter::AnimStreamWriter(const std::string& path)
+    : m_path(path),
+      m_file(nullptr),
+      m_pipe(path.size() > 3 && path.compare(path.size() - 3, 3, ".gz") == 0),
+      m_writeFailed(false),
+      m_buffer(1 << 20),
+      m_started(false),
+      m_every(1),
+      m_flowPackets(0),
+      m_windowStart(Seconds(0)),
+      m_windowStop(Time::Max()),
+      m_metadata(false)
+{
+    // Create the file here either way, so a bad path aborts now rather than in the shell
+    m_file = std::fopen(path.c_str(), "w");
+    NS_ABORT_MSG_UNLESS(m_file, "AnimStreamWriter: cannot open " << path << ": " << std::strerror(errno));
+    if (m_pipe)
+    {
+        std::fclose(m_file);
+        std::string command = "exec gzip -c > " + ShellQuote(path);
+        m_file = popen(command.c_str(), "w");
+        NS_ABORT_MSG_UNLESS(m_file, "AnimStreamWriter: cannot start gzip: " << std::strerror(errno));
+    }
+    std::setvbuf(m_file, m_buffer.data(), _IOFBF, m_buffer.size());
+    m_startEvent = Simulator::ScheduleNow(&AnimStreamWriter::Start, this);
+}
+
+inline AnimStreamWriter::~AnimStreamWriter()
+{
+    Close();
+}
+
+inline void
+AnimStreamWriter::SetSampling(uint32_t n)
+{
+    m_every = n;
+}
+
+inline void
+AnimStreamWriter::SetFlowSampling(uint32_t k)
+{
+    m_flowPackets = k;
+}
+
+inline void
+AnimStreamWriter::SetWindow(Time start, Time stop)
+{
+    m_windowStart = start;
+    m_windowStop = stop;
+}
+
+inline void
+AnimStreamWriter::EnablePacketMetadata(bool enable)
+{
+    m_metadata = enable;
+    if (enable)
+    {
+        PacketMetadata::Enable();
+    }
+}
+
+inline void
+AnimStreamWriter::SetConstantPosition(Ptr<Node> node, double x, double y)
+{
+    Ptr<ConstantPositionMobilityModel> mobility = node->GetObject<ConstantPositionMobilityModel>();
+    if (!mobility)
+    {
+        mobility = CreateObject<ConstantPositionMobilityModel>();
+        node->AggregateObject(mobility);
+    }
+    mobility->SetPosition(Vector(x, y, 0));
+    if (m_started)
+    {
+        Write("<nu p=\"p\" t=\"%.9f\" id=\"%u\" x=\"%g\" y=\"%g\" />\n",
+              Simulator::Now().GetSeconds(),
+              node->GetId(),
+              x,
+              y);
+    }
+}
+
+inline void
+AnimStreamWriter::UpdateNodeDescription(Ptr<Node> node, const std::string& description)
+{
+    UpdateNodeDescription(node->GetId(), description);
+}
+
+inline void
+AnimStreamWriter::UpdateNodeDescription(uint32_t nodeId, const std::string& description)
+{
+    if (!m_started)
+    {
+        m_setup[nodeId].description = description;
+        return;
+    }
+    Write("<nu p=\"d\" t=\"%.9f\" id=\"%u\" descr=\"%s\" />\n",
+          Simulator::Now().GetSeconds(),
+          nodeId,
+          Escape(description).c_str());
+}
+
+inline void
+AnimStreamWriter::UpdateNodeColor(Ptr<Node> node, uint8_t r, uint8_t g, uint8_t b)
+{
+    UpdateNodeColor(node->GetId(), r, g, b);
+}
+
+inline void
+AnimStreamWriter::UpdateNodeColor(uint32_t nodeId, uint8_t r, uint8_t g, uint8_t b)
+{
+    if (!m_started)
+    {
+        NodeSetup& setup = m_setup[nodeId];
+        setup.colored = true;
+        setup.r = r;
+        setup.g = g;
+        setup.b = b;
+        return;
+    }
+    Write("<nu p=\"c\" t=\"%.9f\" id=\"%u\" r=\"%u\" g=\"%u\" b=\"%u\" />\n",
+          Simulator::Now().GetSeconds(),
+          nodeId,
+          r,
+          g,
+          b);
+}
+
+inline void
+AnimStreamWriter::UpdateNodeSize(uint32_t nodeId, double width, double height)
+{
+    if (!m_started)
+    {
+        NodeSetup& setup = m_setup[nodeId];
+        setup.sized = true;
+        setup.width = width;
+        setup.height = height;
+        return;
+    }
+    Write("<nu p=\"s\" t=\"%.9f\" id=\"%u\" w=\"%g\" h=\"%g\" />\n",
+          Simulator::Now().GetSeconds(),
+          nodeId,
+          width,
+          height);
+}
+
+inline void
+AnimStreamWriter::UpdateLinkDescription(Ptr<Node> from,
+                                        Ptr<Node> to,
+                                        const std::string& description)
+{
+    if (!m_started)
+    {
+        m_linkDescriptions[{from->GetId(), to->GetId()}] = description;
+        return;
+    }
+    Write("<linkupdate t=\"%.9f\" fromId=\"%u\" toId=\"%u\" ld=\"%s\" />\n",
+          Simulator::Now().GetSeconds(),
+          from->GetId(),
+          to->GetId(),
+          Escape(description).c_str());
+}
+
+inline bool
+AnimStreamWriter::Close()
+{
+    if (!m_file)
+    {
+        return true;
+    }
+    if (!m_started)
+    {
+        m_startEvent.Cancel(); // destroyed before Simulator::Run()
+    }
+    for (const TracedDevice& traced : m_devices)
+    {
+        traced.device->TraceDisconnectWithoutContext("PhyTxBegin", traced.txBegin);
+        traced.device->TraceDisconnectWithoutContext("PhyRxEnd", traced.rxEnd);
+    }
+    m_devices.clear();
+    if (m_started)
+    {
+        Write("</anim>\n");
+    }
+    bool ok = std::fflush(m_file) == 0 && !m_writeFailed;
+    if (m_pipe)
+    {
+        int status = pclose(m_file);
+        if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            std::cerr << "AnimStreamWriter: gzip failed writing " << m_path << " (status " << status << ")\n";
+            ok = false;
+        }
+    }
+    else if (std::fclose(m_file) != 0)
+    {
+        ok = false;
+    }
+    if (!ok)
+    {
+        std::cerr << "AnimStreamWriter: " << m_path << " is incomplete\n";
+    }
+    m_file = nullptr;
+    m_inFlight.clear();
+    return ok;
+}
+
+inline const AnimStreamWriter::Statistics&
+AnimStreamWriter::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline void
+AnimStreamWriter::Start()
+{
+    if (!m_file)
+    {
+        return;
+    }
+    WriteTopology();
+    m_started = true;
+    for (uint32_t i = 0; i < NodeList::GetNNodes(); ++i)
+    {
+        Ptr<Node> node = NodeList::GetNode(i);
+        for (uint32_t d = 0; d < node->GetNDevices(); ++d)
+        {
+            Connect(node->GetDevice(d));
+        }
+    }
+}
+
+inline void
+AnimStreamWriter::WriteTopology()
+{
+    // Nodes without a mobility model go on a circle, like AnimationInterface's random layout
+    uint32_t nodes = NodeList::GetNNodes();
+    std::vector<Vector> positions(nodes);
+    double minX = 0, minY = 0, maxX = 1, maxY = 1;
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        Ptr<MobilityModel> mobility = NodeList::GetNode(i)->GetObject<MobilityModel>();
+        if (mobility)
+        {
+            positions[i] = mobility->GetPosition();
+        }
+        else
+        {
+            double angle = 2 * M_PI * i / nodes;
+            positions[i] = Vector(50 + 40 * std::cos(angle), 50 + 40 * std::sin(angle), 0);
+        }
+        minX = std::min(minX, positions[i].x);
+        minY = std::min(minY, positions[i].y);
+        maxX = std::max(maxX, positions[i].x);
+        maxY = std::max(maxY, positions[i].y);
+    }
+    Write("<anim ver=\"netanim-3.108\" filetype=\"animation\" >\n");
+    Write("<topology minX=\"%g\" minY=\"%g\" maxX=\"%g\" maxY=\"%g\" />\n", minX, minY, maxX, maxY);
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        Write("<node id=\"%u\" sysId=\"%u\" locX=\"%g\" locY=\"%g\" />\n",
+              i,
+              NodeList::GetNode(i)->GetSystemId(),
+              positions[i].x,
+              positions[i].y);
+    }
+    for (const auto& [id, setup] : m_setup)
+    {
+        if (setup.colored)
+        {
+            Write("<nu p=\"c\" t=\"0\" id=\"%u\" r=\"%u\" g=\"%u\" b=\"%u\" />\n",
+                  id,
+                  setup.r,
+                  setup.g,
+                  setup.b);
+        }
+        if (!setup.description.empty())
+        {
+            Write("<nu p=\"d\" t=\"0\" id=\"%u\" descr=\"%s\" />\n",
+                  id,
+                  Escape(setup.description).c_str());
+        }
+        if (setup.sized)
+        {
+            Write("<nu p=\"s\" t=\"0\" id=\"%u\" w=\"%g\" h=\"%g\" />\n",
+                  id,
+                  setup.width,
+                  setup.height);
+        }
+    }
+    // One link per pair of devices on a channel, each channel once
+    std::set<Ptr<Channel>> channels;
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        Ptr<Node> node = NodeList::GetNode(i);
+        for (uint32_t d = 0; d < node->GetNDevices(); ++d)
+        {
+            Ptr<Channel> channel = node->GetDevice(d)->GetChannel();
+            if (!channel || !channels.insert(channel).second)
+            {
+                continue;
+            }
+            for (std::size_t a = 0; a < channel->GetNDevices(); ++a)
+            {
+                for (std::size_t b = a + 1; b < channel->GetNDevices(); ++b)
+                {
+                    Ptr<NetDevice> from = channel->GetDevice(a);
+                    Ptr<NetDevice> to = channel->GetDevice(b);
+                    uint32_t fromId = from->GetNode()->GetId();
+                    uint32_t toId = to->GetNode()->GetId();
+                    std::string description;
+                    auto found = m_linkDescriptions.find({fromId, toId});
+                    if (found == m_linkDescriptions.end())
+                    {
+                        found = m_linkDescriptions.find({toId, fromId});
+                    }
+                    if (found != m_linkDescriptions.end())
+                    {
+                        description = found->second;
+                    }
+                    Write("<link fromId=\"%u\" toId=\"%u\" fd=\"%s\" td=\"%s\" ld=\"%s\" />\n",
+                          fromId,
+                          toId,
+                          AddressOf(from).c_str(),
+                          AddressOf(to).c_str(),
+                          Escape(description).c_str());
+                }
+            }
+        }
+    }
+    m_setup.clear();
+    m_linkDescriptions.clear();
+}
+
+inline void
+AnimStreamWriter::Connect(Ptr<NetDevice> device)
+{
+    if (!DynamicCast<PointToPointNetDevice>(device) && !DynamicCast<CsmaNetDevice>(device))
+    {
+        return;
+    }
+    TracedDevice traced{device,
+                        MakeBoundCallback(&AnimStreamWriter::TxBeginTrace, this, device),
+                        MakeBoundCallback(&AnimStreamWriter::RxEndTrace, this, device)};
+    device->TraceConnectWithoutContext("PhyTxBegin", traced.txBegin);
+    device->TraceConnectWithoutContext("PhyRxEnd", traced.rxEnd);
+    m_devices.push_back(traced);
+}
+
+inline void
+AnimStreamWriter::TxBeginTrace(AnimStreamWriter* writer,
+                               Ptr<NetDevice> device,
+                               Ptr<const Packet> packet)
+{
+    writer->TxBegin(device, packet);
+}
+
+inline void
+AnimStreamWriter::RxEndTrace(AnimStreamWriter* writer,
+                             Ptr<NetDevice> device,
+                             Ptr<const Packet> packet)
+{
+    writer->RxEnd(device, packet);
+}
+
+inline void
+AnimStreamWriter::TxBegin(Ptr<NetDevice> device, Ptr<const Packet> packet)
+{
+    Time now = Simulator::Now();
+    if (now < m_windowStart || now >= m_windowStop)
+    {
+        return;
+    }
+    ++m_stats.packetsSeen;
+    if (!Sample(device, packet))
+    {
+        return;
+    }
+    ++m_stats.packetsSampled;
+    // The next hop's transmission replaces the entry; drops leave it behind, so sweep now and then
+    if (m_inFlight.size() >= 4096 && m_stats.packetsSampled % 4096 == 0)
+    {
+        double horizon = now.GetSeconds() - 1.0;
+        for (auto it = m_inFlight.begin(); it != m_inFlight.end();)
+        {
+            it = it->second.firstBitTx < horizon ? m_inFlight.erase(it) : std::next(it);
+        }
+    }
+    m_inFlight[packet->GetUid()] = {device->GetNode()->GetId(),
+                                    now.GetSeconds(),
+                                    (now + TransmissionTime(device, packet)).GetSeconds()};
+}
+
+inline void
+AnimStreamWriter::RxEnd(Ptr<NetDevice> device, Ptr<const Packet> packet)
+{
+    auto found = m_inFlight.find(packet->GetUid());
+    if (found == m_inFlight.end())
+    {
+        return;
+    }
+    const Transmission& tx = found->second;
+    double lastBitRx = Simulator::Now().GetSeconds();
+    double firstBitRx = lastBitRx - (tx.lastBitTx - tx.firstBitTx);
+    if (m_metadata)
+    {
+        std::ostringstream meta;
+        packet->Print(meta);
+        Write("<p fId=\"%u\" fbTx=\"%.9f\" lbTx=\"%.9f\" meta=\"%s\" tId=\"%u\" fbRx=\"%.9f\" "
+              "lbRx=\"%.9f\" />\n",
+              tx.from,
+              tx.firstBitTx,
+              tx.lastBitTx,
+              Escape(meta.str()).c_str(),
+              device->GetNode()->GetId(),
+              firstBitRx,
+              lastBitRx);
+    }
+    else
+    {
+        Write("<p fId=\"%u\" fbTx=\"%.9f\" lbTx=\"%.9f\" tId=\"%u\" fbRx=\"%.9f\" lbRx=\"%.9f\" />\n",
+              tx.from,
+              tx.firstBitTx,
+              tx.lastBitTx,
+              device->GetNode()->GetId(),
+              firstBitRx,
+              lastBitRx);
+    }
+    // A CSMA frame reaches every device on the segment; keep the entry for the others
+    if (DynamicCast<PointToPointNetDevice>(device))
+    {
+        m_inFlight.erase(found);
+    }
+}
+
+inline bool
+AnimStreamWriter::Sample(Ptr<NetDevice> device, Ptr<const Packet> packet)
+{
+    uint64_t uid = packet->GetUid();
+    if (m_every == 0 || uid % m_every != 0)
+    {
+        return false;
+    }
+    if (m_flowPackets == 0)
+    {
+        return true;
+    }
+    uint32_t hash;
+    if (!FlowOf(device, packet, hash))
+    {
+        return true; // not IPv4 (ARP): rare enough to keep
+    }
+    auto [it, added] = m_flows.try_emplace(hash);
+    m_stats.flows += added;
+    FlowSample& flow = it->second;
+    if (flow.packets > 0 && uid <= flow.highestUid)
+    {
+        return true; // a later hop of an accepted packet
+    }
+    if (flow.packets >= m_flowPackets)
+    {
+        return false;
+    }
+    ++flow.packets;
+    flow.highestUid = uid;
+    return true;
+}
+
+inline bool
+AnimStreamWriter::FlowOf(Ptr<NetDevice> device, Ptr<const Packet> packet, uint32_t& hash)
+{
+    Ptr<Packet> copy = packet->Copy();
+    if (DynamicCast<PointToPointNetDevice>(device))
+    {
+        PppHeader ppp;
+        copy->RemoveHeader(ppp);
+        if (ppp.GetProtocol() != 0x0021)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        EthernetHeader ethernet(false);
+        copy->RemoveHeader(ethernet);
+        if (ethernet.GetLengthType() != 0x0800)
+        {
+            return false;
+        }
+    }
+    Ipv4Header ip;
+    copy->RemoveHeader(ip);
+    hash = FlowHash::Hash(ip, copy, 0);
+    return true;
+}
+
+inline Time
+AnimStreamWriter::TransmissionTime(Ptr<NetDevice> device, Ptr<const Packet> packet)
+{
+    DataRateValue rate;
+    if (Ptr<PointToPointNetDevice> p2p = DynamicCast<PointToPointNetDevice>(device))
+    {
+        p2p->GetAttribute("DataRate", rate);
+    }
+    else
+    {
+        device->GetChannel()->GetAttribute("DataRate", rate);
+    }
+    return rate.Get().CalculateBytesTxTime(packet->GetSize());
+}
+
+inline std::string
+AnimStreamWriter::Escape(const std::string& text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"':
+            escaped += "&quot;";
+            break;
+        case '&':
+            escaped += "&amp;";
+            break;
+        case '<':
+            escaped += "&lt;";
+            break;
+        case '>':
+            escaped += "&gt;";
+            break;
+        case '\n':
+            escaped += "&#10;";
+            break;
+        default:
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+inline std::string
+AnimStreamWriter::ShellQuote(const std::string& text)
+{
+    // Single quotes keep everything literal; a quote itself becomes '\''
+    std::string quoted = "'";
+    for (char c : text)
+    {
+        quoted += (c == '\'') ? std::string("'\\''") : std::string(1, c);
+    }
+    return quoted + "'";
+}
+
+inline std::string
+AnimStreamWriter::AddressOf(Ptr<NetDevice> device)
+{
+    Ptr<Ipv4> ipv4 = device->GetNode()->GetObject<Ipv4>();
+    if (!ipv4)
+    {
+        return "";
+    }
+    int32_t interface = ipv4->GetInterfaceForDevice(device);
+    if (interface < 0 || ipv4->GetNAddresses(interface) == 0)
+    {
+        return "";
+    }
+    std::ostringstream address;
+    address << ipv4->GetAddress(interface, 0).GetLocal();
+    return address.str();
+}
+
+inline void
+AnimStreamWriter::Write(const char* format, ...)
+{
+    if (!m_file)
+    {
+        return;
+    }
+    va_list arguments;
+    va_start(arguments, format);
+    int written = std::vfprintf(m_file, format, arguments);
+    va_end(arguments);
+    if (written > 0)
+    {
+        m_stats.bytesWritten += written;
+    }
+    else if (written < 0)
+    {
+        m_writeFailed = true;
+    }
+}
+
+} // namespace ns3
+
+#endif /* WAN_ANIM_WRITER_H */
@@ -0,0 +1,708 @@
+/*
+ * AS-level topology builder
+ *
+ * Turns an AS relationship graph (CAIDA as-rel file, or links added by hand)
+ * into an ns-3 topology where every AS follows the router pattern of
+ * exercise01: a core router, border ("IXP") routers hanging off it and hosts
+ * behind the border routers. Every AS relationship becomes a point-to-point
+ * link between border routers of the two ASes, spread round-robin over
+ * their border routers.
+ *
+ * Thousands of ASes mean tens of thousands of nodes and links, so the
+ * builder does in bulk what the exercises do one call at a time:
+ *  - links are wired directly (channel, two devices, a drop-tail queue
+ *    each) instead of through PointToPointHelper's attribute factories;
+ *  - addresses come from a fixed plan and are put on the interfaces
+ *    directly instead of through Ipv4AddressHelper, whose global address
+ *    registry is searched linearly on every assignment, and no queue disc
+ *    is installed on top of the device queues;
+ *  - only static routing is installed (no global routing, whose route
+ *    computation is quadratic in the number of nodes).
+ * SetUseHelpers(true) builds the same topology the usual way instead, with
+ * one Ipv4AddressHelper::SetBase() per subnet, for comparison.
+ *
+ * Address plan:
+ *  - AS i owns 20.0.0.0/8 + i * /24, announced by its border routers; its
+ *    core-border and border-host links are /30s inside it.
+ *  - inter-AS link k is 10.0.0.0 + k * /30 (up to 4M links).
+ *
+ * Every build step is timed and its resident memory growth recorded (see
+ * GetPhases()), to see how setup scales before attempting a bigger run.
+ *
+ * SetPartitions() spreads the ASes over MPI ranks (wan-mpi.h): all routers
+ * and hosts of an AS share a system id, so only inter-AS links cross ranks
+ * and the lookahead is the inter-AS link delay. ASes are assigned largest
+ * first to the least loaded rank, weighting each by its number of links.
+ *
+ * Usage: copy this header, wan-bgp-speaker.h, wan-lpm-fib.h, wan-mpi.h,
+ * wan-route-validation.h and wan-setup-phases.h next to the exercise script
+ * in scratch/.
+ */
+
+#ifndef WAN_AS_TOPOLOGY_H
+#define WAN_AS_TOPOLOGY_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "ns3/point-to-point-module.h"
+#include "wan-bgp-speaker.h"
+#include "wan-mpi.h"
+#include "wan-route-validation.h"
+#include "wan-setup-phases.h"
+
+#ifdef NS3_MPI
+#include "ns3/mpi-receiver.h"
+#include "ns3/point-to-point-remote-channel.h"
+#endif
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Builds nodes, links, addresses and static routes for an AS graph.
+ */
+class AsTopologyBuilder
+{
+  public:
+    /// One AS of the built topology
+    struct AutonomousSystem
+    {
+        uint32_t asNumber{0};
+        uint32_t degree{0};                       ///< inter-AS links in the built topology
+        uint32_t systemId{0};                     ///< MPI rank simulating the AS
+        BgpPrefix prefix;                         ///< AS block
+        Ptr<Node> core;
+        std::vector<Ptr<Node>> borders;
+        std::vector<Ptr<Node>> hosts;             ///< hostsPerBorder per border, in border order
+        std::vector<Ipv4Address> coreAddresses;   ///< core end of the link to border i
+        std::vector<Ipv4Address> borderAddresses; ///< border i's end of its core link
+        std::vector<Ipv4Address> hostAddresses;
+        Ptr<BgpSpeaker> coreSpeaker;
+        std::vector<Ptr<BgpSpeaker>> borderSpeakers;
+    };
+
+    /// One inter-AS link
+    struct Link
+    {
+        uint32_t a{0}; ///< AS index (GetAs()), a < b
+        uint32_t b{0};
+        AsRelationships::Relationship relationship{AsRelationships::UNKNOWN}; ///< what b is to a
+        uint32_t borderA{0}; ///< border router of a carrying the link
+        uint32_t borderB{0};
+        Ipv4Address addressA;
+        Ipv4Address addressB;
+        Ptr<NetDevice> deviceA;
+        Ptr<NetDevice> deviceB;
+    };
+
+    /// Cost of one build step
+    typedef SetupPhase Phase;
+
+    AsTopologyBuilder();
+
+    /// Read a CAIDA AS relationship file; returns false (see GetError()) on error
+    bool Load(const std::string& fileName);
+
+    /// Add a relationship by hand: CAIDA convention, -1 = a is provider of b, 0 = peers
+    void AddLink(uint32_t a, uint32_t b, int relationship);
+
+    /// Only build the maxAses best-connected ASes (0: all)
+    void SetMaxAses(uint32_t maxAses);
+
+    /// Border routers per AS (ASes with fewer links get one per link)
+    void SetBordersPerAs(uint32_t borders);
+
+    /// Hosts behind each border router
+    void SetHostsPerBorder(uint32_t hosts);
+
+    /// Build with PointToPointHelper / Ipv4AddressHelper instead of in bulk
+    void SetUseHelpers(bool useHelpers);
+
+    /// Spread the ASes over this many MPI ranks (WanMpi::GetSize())
+    void SetPartitions(uint32_t partitions);
+
+    void SetInternalLinks(DataRate rate, Time delay);
+    void SetInterAsLinks(DataRate rate, Time delay);
+
+    /// Create nodes, internet stacks, links, addresses and static routes
+    void Build();
+
+    /**
+     * Run a BgpSpeaker on every router: iBGP full mesh inside each AS, eBGP
+     * on every inter-AS link, each AS block originated by its border routers.
+     * Speakers of ASes simulated by other ranks are inert (see BgpHelper).
+     */
+    void InstallBgp(const BgpHelper& bgp);
+
+    /// All relationships read or added, before SetMaxAses() selection
+    const AsRelationships& GetRelationships() const;
+
+    uint32_t GetNAses() const;
+    /// ASes are indexed by decreasing degree in the input graph
+    const AutonomousSystem& GetAs(uint32_t index) const;
+    const std::vector<Link>& GetLinks() const;
+    const NodeContainer& GetRouters() const;
+    const NodeContainer& GetHosts() const;
+
+    /// Number of ASes in the input graph
+    uint32_t GetNInputAses() const;
+
+    /// Inter-AS links whose ends are simulated by different ranks
+    uint32_t GetNCrossPartitionLinks() const;
+
+    /// Delay of the inter-AS links: the lookahead of a distributed run
+    Time GetInterAsDelay() const;
+
+    const std::vector<Phase>& GetPhases() const;
+    const std::string& GetError() const;
+
+  private:
+    template <class F>
+    void RunPhase(const std::string& name, F f);
+
+    void SelectAses();
+    void Partition();
+    void CreateNodes();
+    void InstallStacks();
+    void CreateLinks();
+    void AssignAddresses();
+    void AddStaticRoutes();
+
+    std::pair<Ptr<NetDevice>, Ptr<NetDevice>> Connect(Ptr<Node> a, Ptr<Node> b, bool interAs);
+    uint32_t AssignAddress(Ptr<NetDevice> device, Ipv4Address address);
+
+    static constexpr uint32_t AS_BLOCK_BASE = 0x14000000;   // 20.0.0.0
+    static constexpr uint32_t INTER_AS_BASE = 0x0a000000;   // 10.0.0.0
+    static constexpr uint32_t MAX_INTER_AS_LINKS = 1u << 22; // /30s in 10.0.0.0/8
+    static constexpr uint32_t LINKS_PER_AS_BLOCK = 64;       // /30s in a /24
+
+    AsRelationships m_relationships;
+    uint32_t m_maxAses;
+    uint32_t m_bordersPerAs;
+    uint32_t m_hostsPerBorder;
+    bool m_useHelpers;
+    uint32_t m_partitions;
+    DataRate m_internalRate;
+    Time m_internalDelay;
+    DataRate m_interAsRate;
+    Time m_interAsDelay;
+
+    uint32_t m_nInputAses;
+    std::vector<AutonomousSystem> m_ases;
+    std::vector<Link> m_links;
+    // Device pairs of the intra-AS links, in address plan order: per AS the
+    // core-border links, then the border-host links
+    std::vector<std::vector<std::pair<Ptr<NetDevice>, Ptr<NetDevice>>>> m_internalDevices;
+    // Interface indices of each AS's core (per border) and of each border (towards the core)
+    std::vector<std::vector<uint32_t>> m_coreInterfaces;
+    std::vector<std::vector<uint32_t>> m_borderInterfaces;
+    std::vector<std::vector<uint32_t>> m_hostInterfaces;
+    NodeContainer m_routers;
+    NodeContainer m_hosts;
+    std::vector<Phase> m_phases;
+    std::string m_error;
+};
+
+inline AsTopologyBuilder::AsTopologyBuilder()
+    : m_maxAses(0),
+      m_bordersPerAs(2),
+      m_hostsPerBorder(1),
+      m_useHelpers(false),
+      m_partitions(1),
+      m_internalRate("100Mbps"),
+      m_internalDelay(MilliSeconds(2)),
+      m_interAsRate("1Gbps"),
+      m_interAsDelay(MilliSeconds(2)),
+      m_nInputAses(0)
+{
+}
+
+inline bool
+AsTopologyBuilder::Load(const std::string& fileName)
+{
+    bool ok = true;
+    RunPhase("read AS relationships", [&]() {
+        ok = m_relationships.Load(fileName);
+        m_error = m_relationships.GetError();
+    });
+    return ok;
+}
+
+inline void
+AsTopologyBuilder::AddLink(uint32_t a, uint32_t b, int relationship)
+{
+    if (relationship == -1)
+    {
+        m_relationships.AddProviderCustomer(a, b);
+    }
+    else
+    {
+        m_relationships.AddPeers(a, b);
+    }
+}
+
+inline void
+AsTopologyBuilder::SetMaxAses(uint32_t maxAses)
+{
+    m_maxAses = maxAses;
+}
+
+inline void
+AsTopologyBuilder::SetBordersPerAs(uint32_t borders)
+{
+    NS_ABORT_MSG_UNLESS(borders >= 1, "AsTopologyBuilder: an AS needs a border router");
+    m_bordersPerAs = borders;
+}
+
+inline void
+AsTopologyBuilder::SetHostsPerBorder(uint32_t hosts)
+{
+    m_hostsPerBorder = hosts;
+}
+
+inline void
+AsTopologyBuilder::SetUseHelpers(bool useHelpers)
+{
+    m_useHelpers = useHelpers;
+}
+
+inline void
+AsTopologyBuilder::SetPartitions(uint32_t partitions)
+{
+    NS_ABORT_MSG_UNLESS(partitions >= 1, "AsTopologyBuilder: need at least one partition");
+    m_partitions = partitions;
+}
+
+inline void
+AsTopologyBuilder::SetInternalLinks(DataRate rate, Time delay)
+{
+    m_internalRate = rate;
+    m_internalDelay = delay;
+}
+
+inline void
+AsTopologyBuilder::SetInterAsLinks(DataRate rate, Time delay)
+{
+    m_interAsRate = rate;
+    m_interAsDelay = delay;
+}
+
+template <class F>
+void
+AsTopologyBuilder::RunPhase(const std::string& name, F f)
+{
+    RunSetupPhase(m_phases, name, f);
+}
+
+inline void
+AsTopologyBuilder::Build()
+{
+    NS_ABORT_MSG_UNLESS(m_bordersPerAs * (1 + m_hostsPerBorder) <= LINKS_PER_AS_BLOCK,
+                        "AsTopologyBuilder: too many internal links for a /24 per AS");
+    RunPhase("select ASes", [this]() { SelectAses(); });
+    RunPhase("partition", [this]() { Partition(); });
+    RunPhase("create nodes", [this]() { CreateNodes(); });
+    RunPhase("install internet stacks", [this]() { InstallStacks(); });
+    RunPhase("create links", [this]() { CreateLinks(); });
+    RunPhase("assign addresses", [this]() { AssignAddresses(); });
+    RunPhase("add static routes", [this]() { AddStaticRoutes(); });
+}
+
+inline void
+AsTopologyBuilder::SelectAses()
+{
+    std::vector<std::pair<uint32_t, uint32_t>> edges; // (a, b), a < b
+    std::vector<AsRelationships::Relationship> relationships;
+    std::unordered_map<uint32_t, uint32_t> degree;
+    m_relationships.ForEach([&](uint32_t a, uint32_t b, AsRelationships::Relationship relationship) {
+        edges.emplace_back(a, b);
+        relationships.push_back(relationship);
+        degree[a]++;
+        degree[b]++;
+    });
+    m_nInputAses = degree.size();
+
+    // Best-connected ASes first: a degree cut keeps the dense, connected core
+    std::vector<std::pair<uint32_t, uint32_t>> order(degree.begin(), degree.end());
+    std::sort(order.begin(), order.end(), [](const auto& x, const auto& y) {
+        return x.second != y.second ? x.second > y.second : x.first < y.first;
+    });
+    if (m_maxAses != 0 && order.size() > m_maxAses)
+    {
+        order.resize(m_maxAses);
+    }
+    NS_ABORT_MSG_IF(order.size() >= (0xe0000000u - AS_BLOCK_BASE) >> 8,
+                    "AsTopologyBuilder: AS blocks run out of unicast space");
+
+    std::unordered_map<uint32_t, uint32_t> index;
+    m_ases.resize(order.size());
+    for (uint32_t i = 0; i < order.size(); ++i)
+    {
+        index[order[i].first] = i;
+        m_ases[i].asNumber = order[i].first;
+        m_ases[i].prefix = BgpPrefix(AS_BLOCK_BASE + (i << 8), 24);
+    }
+
+    m_links.clear();
+    for (std::size_t e = 0; e < edges.size(); ++e)
+    {
+        auto a = index.find(edges[e].first);
+        auto b = index.find(edges[e].second);
+        if (a == index.end() || b == index.end())
+        {
+            continue;
+        }
+        Link link;
+        link.a = std::min(a->second, b->second);
+        link.b = std::max(a->second, b->second);
+        link.relationship = m_relationships.Get(m_ases[link.a].asNumber, m_ases[link.b].asNumber);
+        m_links.push_back(link);
+    }
+    std::sort(m_links.begin(), m_links.end(), [](const Link& x, const Link& y) {
+        return x.a != y.a ? x.a < y.a : x.b < y.b;
+    });
+    NS_ABORT_MSG_IF(m_links.size() > MAX_INTER_AS_LINKS, "AsTopologyBuilder: too many inter-AS links");
+
+    for (Link& link : m_links)
+    {
+        link.borderA = m_ases[link.a].degree++;
+        link.borderB = m_ases[link.b].degree++;
+    }
+    for (Link& link : m_links)
+    {
+        link.borderA %= std::min(m_bordersPerAs, m_ases[link.a].degree);
+        link.borderB %= std::min(m_bordersPerAs, m_ases[link.b].degree);
+    }
+}
+
+inline void
+AsTopologyBuilder::Partition()
+{
+    // Longest processing time first: ASes come sorted by decreasing degree
+    std::vector<uint64_t> load(m_partitions, 0);
+    for (AutonomousSystem& as : m_ases)
+    {
+        as.systemId = std::min_element(load.begin(), load.end()) - load.begin();
+        load[as.systemId] += 1 + as.degree;
+    }
+}
+
+inline void
+AsTopologyBuilder::CreateNodes()
+{
+    for (AutonomousSystem& as : m_ases)
+    {
+        as.core = CreateObject<Node>(as.systemId);
+        m_routers.Add(as.core);
+        uint32_t borders = std::max(1u, std::min(m_bordersPerAs, as.degree));
+        for (uint32_t b = 0; b < borders; ++b)
+        {
+            as.borders.push_back(CreateObject<Node>(as.systemId));
+            m_routers.Add(as.borders.back());
+            for (uint32_t h = 0; h < m_hostsPerBorder; ++h)
+            {
+                as.hosts.push_back(CreateObject<Node>(as.systemId));
+                m_hosts.Add(as.hosts.back());
+            }
+        }
+    }
+}
+
+inline void
+AsTopologyBuilder::InstallStacks()
+{
+    // Static routing in an Ipv4ListRouting, so that BgpHelper can add speakers
+    Ipv4StaticRoutingHelper staticRouting;
+    Ipv4ListRoutingHelper list;
+    list.Add(staticRouting, 0);
+    InternetStackHelper internet;
+    internet.SetRoutingHelper(list);
+    internet.Install(m_routers);
+    internet.Install(m_hosts);
+}
+
+inline std::pair<Ptr<NetDevice>, Ptr<NetDevice>>
+AsTopologyBuilder::Connect(Ptr<Node> a, Ptr<Node> b, bool interAs)
+{
+    DataRate rate = interAs ? m_interAsRate : m_internalRate;
+    Time delay = interAs ? m_interAsDelay : m_internalDelay;
+    if (m_useHelpers)
+    {
+        PointToPointHelper p2p;
+        p2p.SetDeviceAttribute("DataRate", DataRateValue(rate));
+        p2p.SetChannelAttribute("Delay", TimeValue(delay));
+        NetDeviceContainer devices = p2p.Install(a, b);
+        return {devices.Get(0), devices.Get(1)};
+    }
+
+    bool remote = a->GetSystemId() != b->GetSystemId();
+    Ptr<PointToPointChannel> channel;
+    if (remote)
+    {
+#ifdef NS3_MPI
+        channel = CreateObject<PointToPointRemoteChannel>();
+#else
+        NS_ABORT_MSG("AsTopologyBuilder: partitioned topology needs ns-3 built with MPI");
+#endif
+    }
+    else
+    {
+        channel = CreateObject<PointToPointChannel>();
+    }
+    channel->SetAttribute("Delay", TimeValue(delay));
+    Ptr<PointToPointNetDevice> devices[2];
+    Ptr<Node> nodes[2] = {a, b};
+    for (int i = 0; i < 2; ++i)
+    {
+        devices[i] = CreateObject<PointToPointNetDevice>();
+        devices[i]->SetAddress(Mac48Address::Allocate());
+        devices[i]->SetDataRate(rate);
+        devices[i]->SetQueue(CreateObject<DropTailQueue<Packet>>());
+        nodes[i]->AddDevice(devices[i]);
+        devices[i]->Attach(channel);
+#ifdef NS3_MPI
+        if (remote)
+        {
+            // As PointToPointHelper does: packets from the other rank arrive through MPI
+            Ptr<MpiReceiver> receiver = CreateObject<MpiReceiver>();
+            receiver->SetReceiveCallback(MakeCallback(&PointToPointNetDevice::Receive, devices[i]));
+            devices[i]->AggregateObject(receiver);
+        }
+#endif
+    }
+    return {devices[0], devices[1]};
+}
+
+inline void
+AsTopologyBuilder::CreateLinks()
+{
+    m_internalDevices.assign(m_ases.size(), {});
+    for (uint32_t i = 0; i < m_ases.size(); ++i)
+    {
+        const AutonomousSystem& as = m_ases[i];
+        for (Ptr<Node> border : as.borders)
+        {
+            m_internalDevices[i].push_back(Connect(as.core, border, false));
+        }
+        for (uint32_t h = 0; h < as.hosts.size(); ++h)
+        {
+            m_internalDevices[i].push_back(Connect(as.borders[h / m_hostsPerBorder], as.hosts[h], false));
+        }
+    }
+    for (Link& link : m_links)
+    {
+        auto devices = Connect(m_ases[link.a].borders[link.borderA], m_ases[link.b].borders[link.borderB], true);
+        link.deviceA = devices.first;
+        link.deviceB = devices.second;
+    }
+}
+
+inline uint32_t
+AsTopologyBuilder::AssignAddress(Ptr<NetDevice> device, Ipv4Address address)
+{
+    Ptr<Ipv4> ipv4 = device->GetNode()->GetObject<Ipv4>();
+    int32_t interface = ipv4->GetInterfaceForDevice(device);
+    if (interface == -1)
+    {
+        interface = ipv4->AddInterface(device);
+    }
+    ipv4->AddAddress(interface, Ipv4InterfaceAddress(address, Ipv4Mask("255.255.255.252")));
+    ipv4->SetMetric(interface, 1);
+    ipv4->SetUp(interface);
+    return interface;
+}
+
+inline void
+AsTopologyBuilder::AssignAddresses()
+{
+    // The usual way: one SetBase() per subnet, every address checked against
+    // Ipv4AddressGenerator's registry of all addresses handed out so far
+    Ipv4AddressHelper helper;
+    auto assign = [this, &helper](std::pair<Ptr<NetDevice>, Ptr<NetDevice>> devices,
+                                  uint32_t network,
+                                  Ipv4Address& first,
+                                  Ipv4Address& second) {
+        first = Ipv4Address(network + 1);
+        second = Ipv4Address(network + 2);
+        if (m_useHelpers)
+        {
+            NetDeviceContainer container;
+            container.Add(devices.first);
+            container.Add(devices.second);
+            helper.SetBase(Ipv4Address(network), Ipv4Mask("255.255.255.252"));
+            Ipv4InterfaceContainer interfaces = helper.Assign(container);
+            return std::make_pair(interfaces.Get(0).second, interfaces.Get(1).second);
+        }
+        return std::make_pair(AssignAddress(devices.first, first), AssignAddress(devices.second, second));
+    };
+
+    m_coreInterfaces.assign(m_ases.size(), {});
+    m_borderInterfaces.assign(m_ases.size(), {});
+    m_hostInterfaces.assign(m_ases.size(), {});
+    for (uint32_t i = 0; i < m_ases.size(); ++i)
+    {
+        AutonomousSystem& as = m_ases[i];
+        uint32_t borders = as.borders.size();
+        as.coreAddresses.resize(borders);
+        as.borderAddresses.resize(borders);
+        as.hostAddresses.resize(as.hosts.size());
+        for (uint32_t l = 0; l < m_internalDevices[i].size(); ++l)
+        {
+            uint32_t network = as.prefix.address + 4 * l;
+            if (l < borders)
+            {
+                auto interfaces = assign(m_internalDevices[i][l], network, as.coreAddresses[l], as.borderAddresses[l]);
+                m_coreInterfaces[i].push_back(interfaces.first);
+                m_borderInterfaces[i].push_back(interfaces.second);
+            }
+            else
+            {
+                Ipv4Address borderSide;
+                auto interfaces = assign(m_internalDevices[i][l], network, borderSide, as.hostAddresses[l - borders]);
+                m_hostInterfaces[i].push_back(interfaces.second);
+            }
+        }
+    }
+    for (uint32_t k = 0; k < m_links.size(); ++k)
+    {
+        Link& link = m_links[k];
+        assign({link.deviceA, link.deviceB}, INTER_AS_BASE + 4 * k, link.addressA, link.addressB);
+    }
+    m_internalDevices.clear();
+}
+
+inline void
+AsTopologyBuilder::AddStaticRoutes()
+{
+    Ipv4StaticRoutingHelper helper;
+    Ipv4Mask link("255.255.255.252");
+    for (uint32_t i = 0; i < m_ases.size(); ++i)
+    {
+        const AutonomousSystem& as = m_ases[i];
+        Ptr<Ipv4StaticRouting> core = helper.GetStaticRouting(as.core->GetObject<Ipv4>());
+        for (uint32_t b = 0; b < as.borders.size(); ++b)
+        {
+            // Border: the rest of the AS block is behind the core
+            helper.GetStaticRouting(as.borders[b]->GetObject<Ipv4>())
+                ->AddNetworkRouteTo(as.prefix.GetAddress(), as.prefix.GetMask(), as.coreAddresses[b],
+                                    m_borderInterfaces[i][b]);
+        }
+        for (uint32_t h = 0; h < as.hosts.size(); ++h)
+        {
+            uint32_t b = h / m_hostsPerBorder;
+            uint32_t network = as.prefix.address + 4 * (as.borders.size() + h);
+            core->AddNetworkRouteTo(Ipv4Address(network), link, as.borderAddresses[b], m_coreInterfaces[i][b]);
+            // Host: everything through its border router
+            helper.GetStaticRouting(as.hosts[h]->GetObject<Ipv4>())
+                ->SetDefaultRoute(Ipv4Address(network + 1), m_hostInterfaces[i][h]);
+        }
+    }
+}
+
+inline void
+AsTopologyBuilder::InstallBgp(const BgpHelper& bgp)
+{
+    RunPhase("install BGP", [this, &bgp]() {
+        for (AutonomousSystem& as : m_ases)
+        {
+            as.coreSpeaker = bgp.Install(as.core, as.asNumber);
+            for (uint32_t b = 0; b < as.borders.size(); ++b)
+            {
+                as.borderSpeakers.push_back(bgp.Install(as.borders[b], as.asNumber));
+                as.borderSpeakers[b]->AddNetwork(as.prefix.GetAddress(), as.prefix.GetMask());
+                BgpHelper::Peer(as.coreSpeaker, as.coreAddresses[b], as.borderSpeakers[b], as.borderAddresses[b]);
+                for (uint32_t other = 0; other < b; ++other)
+                {
+                    BgpHelper::Peer(as.borderSpeakers[other], as.borderAddresses[other],
+                                    as.borderSpeakers[b], as.borderAddresses[b]);
+                }
+            }
+        }
+        for (const Link& link : m_links)
+        {
+            BgpHelper::Peer(m_ases[link.a].borderSpeakers[link.borderA], link.addressA,
+                            m_ases[link.b].borderSpeakers[link.borderB], link.addressB);
+        }
+    });
+}
+
+inline const AsRelationships&
+AsTopologyBuilder::GetRelationships() const
+{
+    return m_relationships;
+}
+
+inline uint32_t
+AsTopologyBuilder::GetNAses() const
+{
+    return m_ases.size();
+}
+
+inline const AsTopologyBuilder::AutonomousSystem&
+AsTopologyBuilder::GetAs(uint32_t index) const
+{
+    return m_ases[index];
+}
+
+inline const std::vector<AsTopologyBuilder::Link>&
+AsTopologyBuilder::GetLinks() const
+{
+    return m_links;
+}
+
+inline const NodeContainer&
+AsTopologyBuilder::GetRouters() const
+{
+    return m_routers;
+}
+
+inline const NodeContainer&
+AsTopologyBuilder::GetHosts() const
+{
+    return m_hosts;
+}
+
+inline uint32_t
+AsTopologyBuilder::GetNInputAses() const
+{
+    return m_nInputAses;
+}
+
+inline uint32_t
+AsTopologyBuilder::GetNCrossPartitionLinks() const
+{
+    uint32_t count = 0;
+    for (const Link& link : m_links)
+    {
+        count += m_ases[link.a].systemId != m_ases[link.b].systemId ? 1 : 0;
+    }
+    return count;
+}
+
+inline Time
+AsTopologyBuilder::GetInterAsDelay() const
+{
+    return m_interAsDelay;
+}
+
+inline const std::vector<AsTopologyBuilder::Phase>&
+AsTopologyBuilder::GetPhases() const
+{
+    return m_phases;
+}
+
+inline const std::string&
+AsTopologyBuilder::GetError() const
+{
+    return m_error;
+}
+
+} // namespace ns3
+
+#endif /* WAN_AS_TOPOLOGY_H */
@@ -0,0 +1,613 @@
+/*
+ * Bidirectional Forwarding Detection for the WAN exercises
+ *
+ * A link that fails without its interface going down (a dead IXP switch, a
+ * degraded carrier circuit) is invisible to routing until a protocol timer
+ * runs out: BGP's hold time is 90 s, and the scripts so far only fail links
+ * by calling SetDown() themselves. BfdAgent runs single-hop BFD sessions
+ * (RFC 5880/5881) over UDP port 3784: both ends send small control packets
+ * every few milliseconds and declare the session down when none has arrived
+ * for DetectMultiplier intervals. The SessionState trace fires on every
+ * transition to or from Up, which is where a script withdraws routes or
+ * switches to a backup path.
+ *
+ * Sessions run the three-way Down/Init/Up handshake and negotiate their
+ * intervals like RFC 5880: each side transmits at the larger of its own
+ * DesiredMinTxInterval and the peer's RequiredMinRxInterval, reduced by up
+ * to 25% of random jitter, and detects failure after the peer's detect
+ * multiplier times the interval the peer transmits at.
+ *
+ * The detection timer is not cancelled and rescheduled for every received
+ * packet: it fires once per detection time and re-arms itself from the
+ * time of the last packet, so a healthy session costs one simulator event
+ * per transmitted packet plus one per detection time.
+ *
+ * Simplifications compared to a full implementation:
+ *  - no authentication, demand mode or echo function;
+ *  - interval changes take effect immediately, without a Poll sequence;
+ *  - both ends transmit at the fast rate right away; there is no 1 s rate
+ *    while the session is coming up.
+ *
+ * Like BgpSpeaker, an agent can run its timers on a shared TimerWheel
+ * (SetTimerWheel(), wan-timer-wheel.h) instead of simulator events.
+ *
+ * Usage: copy this header, wan-mpi.h and wan-timer-wheel.h next to the
+ * exercise script in scratch/.
+ */
+
+#ifndef WAN_BFD_H
+#define WAN_BFD_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "wan-mpi.h"
+#include "wan-timer-wheel.h"
+
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Single-hop BFD sessions of one node, run as an Application.
+ *
+ * Sessions are configured with AddSession() before the application starts.
+ */
+class BfdAgent : public Application
+{
+  public:
+    static constexpr uint16_t BFD_PORT = 3784;
+    static constexpr uint32_t BFD_CONTROL_SIZE = 24;
+
+    /// Session states (RFC 5880, section 4.1)
+    enum State
+    {
+        ADMIN_DOWN = 0,
+        DOWN = 1,
+        INIT = 2,
+        UP = 3
+    };
+
+    /// Diagnostic codes sent with a state change
+    enum Diagnostic
+    {
+        DIAG_NONE = 0,
+        DIAG_DETECTION_EXPIRED = 1,
+        DIAG_NEIGHBOR_DOWN = 3,
+        DIAG_ADMIN_DOWN = 7
+    };
+
+    /// Per-agent counters
+    struct Statistics
+    {
+        uint64_t controlSent{0};
+        uint64_t controlReceived{0};
+        uint64_t controlDropped{0}; ///< malformed or for an unknown session
+        uint64_t timerEvents{0};    ///< transmit and detection timer expiries
+        uint64_t sessionsUp{0};
+        uint64_t sessionsDown{0};
+        uint64_t detectionExpired{0}; ///< ...of which because nothing was received
+        Time lastDown;
+    };
+
+    static TypeId GetTypeId();
+
+    BfdAgent();
+    ~BfdAgent() override;
+
+    /**
+     * Run a session to a directly connected neighbour.
+     * \param interface local interface the neighbour is reached over
+     * \param peerAddress address of the neighbour on that interface
+     * \return the session index
+     */
+    uint32_t AddSession(uint32_t interface, Ipv4Address peerAddress);
+
+    uint32_t GetNSessions() const;
+    bool IsUp(uint32_t session) const;
+    Ipv4Address GetPeerAddress(uint32_t session) const;
+    uint32_t GetInterface(uint32_t session) const;
+
+    /// Time without packets after which the session is declared down (zero before it is negotiated)
+    Time GetDetectionTime(uint32_t session) const;
+
+    const Statistics& GetStatistics() const;
+
+    /// Run the transmit and detection timers on a shared wheel (nullptr: simulator events)
+    void SetTimerWheel(TimerWheel* wheel);
+
+    /**
+     * TracedCallback signature for session state changes.
+     * \param peer neighbour address
+     * \param interface local interface of the session
+     * \param up true when the session reached Up, false when it left Up
+     */
+    typedef void (*SessionStateTracedCallback)(Ipv4Address peer, uint32_t interface, bool up);
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    struct Session
+    {
+        uint32_t interface{0};
+        Ipv4Address localAddress;
+        Ipv4Address peerAddress;
+        Ptr<Socket> socket;
+        State state{DOWN};
+        uint8_t diagnostic{DIAG_NONE};
+        uint32_t localDiscriminator{0};
+        uint32_t remoteDiscriminator{0};
+        State remoteState{DOWN};
+        uint8_t remoteMultiplier{0};
+        Time remoteMinTx; ///< peer's DesiredMinTxInterval
+        Time remoteMinRx; ///< peer's RequiredMinRxInterval
+        Time lastReceived;
+        ProtocolTimer txTimer;
+        ProtocolTimer detectionTimer;
+    };
+
+    void StartApplication() override;
+    void StopApplication() override;
+
+    void ScheduleTransmit(uint32_t session);
+    void Transmit(uint32_t session);
+    void SendControl(uint32_t session);
+    void HandleRead(Ptr<Socket> socket);
+    void Receive(uint32_t session, const uint8_t* data, uint32_t size);
+    void DetectionTimerExpired(uint32_t session);
+    void SetState(uint32_t session, State state, Diagnostic diagnostic);
+    Time GetTxInterval(uint32_t session) const;
+
+    std::vector<Session> m_sessions;
+    Time m_minTx;
+    Time m_minRx;
+    uint32_t m_multiplier;
+    bool m_running;
+    TimerWheel* m_timerWheel;
+    Ptr<UniformRandomVariable> m_jitter;
+    Statistics m_stats;
+
+    TracedCallback<Ipv4Address, uint32_t, bool> m_sessionStateTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(BfdAgent);
+
+inline TypeId
+BfdAgent::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::BfdAgent")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<BfdAgent>()
+            .AddAttribute("DesiredMinTxInterval",
+                          "Fastest rate this end wants to send control packets at",
+                          TimeValue(MilliSeconds(50)),
+                          MakeTimeAccessor(&BfdAgent::m_minTx),
+                          MakeTimeChecker(MicroSeconds(1)))
+            .AddAttribute("RequiredMinRxInterval",
+                          "Fastest rate this end is willing to receive control packets at",
+                          TimeValue(MilliSeconds(50)),
+                          MakeTimeAccessor(&BfdAgent::m_minRx),
+                          MakeTimeChecker(MicroSeconds(1)))
+            .AddAttribute("DetectMultiplier",
+                          "Missed packets after which the peer declares the session down",
+                          UintegerValue(3),
+                          MakeUintegerAccessor(&BfdAgent::m_multiplier),
+                          MakeUintegerChecker<uint32_t>(1, 255))
+            .AddTraceSource("SessionState",
+                            "A session reached or left the Up state",
+                            MakeTraceSourceAccessor(&BfdAgent::m_sessionStateTrace),
+                            "ns3::BfdAgent::SessionStateTracedCallback");
+    return tid;
+}
+
+inline BfdAgent::BfdAgent()
+    : m_minTx(MilliSeconds(50)),
+      m_minRx(MilliSeconds(50)),
+      m_multiplier(3),
+      m_running(false),
+      m_timerWheel(nullptr),
+      m_jitter(CreateObject<UniformRandomVariable>())
+{
+}
+
+inline BfdAgent::~BfdAgent()
+{
+}
+
+inline void
+BfdAgent::DoDispose()
+{
+    for (auto& session : m_sessions)
+    {
+        session.txTimer.Cancel();
+        session.detectionTimer.Cancel();
+        if (session.socket)
+        {
+            session.socket->Close();
+            session.socket = nullptr;
+        }
+    }
+    m_sessions.clear();
+    Application::DoDispose();
+}
+
+inline uint32_t
+BfdAgent::AddSession(uint32_t interface, Ipv4Address peerAddress)
+{
+    Session session;
+    session.interface = interface;
+    session.peerAddress = peerAddress;
+    m_sessions.push_back(session);
+    return m_sessions.size() - 1;
+}
+
+inline uint32_t
+BfdAgent::GetNSessions() const
+{
+    return m_sessions.size();
+}
+
+inline bool
+BfdAgent::IsUp(uint32_t session) const
+{
+    return m_sessions[session].state == UP;
+}
+
+inline Ipv4Address
+BfdAgent::GetPeerAddress(uint32_t session) const
+{
+    return m_sessions[session].peerAddress;
+}
+
+inline uint32_t
+BfdAgent::GetInterface(uint32_t session) const
+{
+    return m_sessions[session].interface;
+}
+
+inline Time
+BfdAgent::GetDetectionTime(uint32_t session) const
+{
+    const Session& s = m_sessions[session];
+    return MicroSeconds(s.remoteMultiplier * std::max(m_minRx, s.remoteMinTx).GetMicroSeconds());
+}
+
+inline const BfdAgent::Statistics&
+BfdAgent::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline void
+BfdAgent::SetTimerWheel(TimerWheel* wheel)
+{
+    m_timerWheel = wheel;
+}
+
+inline Time
+BfdAgent::GetTxInterval(uint32_t session) const
+{
+    return std::max(m_minTx, m_sessions[session].remoteMinRx);
+}
+
+inline void
+BfdAgent::StartApplication()
+{
+    m_running = true;
+    Ptr<Ipv4> ipv4 = GetNode()->GetObject<Ipv4>();
+    for (uint32_t i = 0; i < m_sessions.size(); ++i)
+    {
+        Session& s = m_sessions[i];
+        s.localAddress = ipv4->GetAddress(s.interface, 0).GetLocal();
+        s.localDiscriminator = (GetNode()->GetId() << 12) | (i + 1);
+        s.state = DOWN;
+        // Bound to the link's device: control packets must never be routed
+        // around a failed link, or the session would stay up over the backup path
+        s.socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        s.socket->Bind(InetSocketAddress(s.localAddress, BFD_PORT));
+        s.socket->BindToNetDevice(ipv4->GetNetDevice(s.interface));
+        s.socket->SetIpTtl(255);
+        s.socket->SetRecvCallback(MakeCallback(&BfdAgent::HandleRead, this));
+        // Spread the first packets of the sessions over one interval
+        s.txTimer.Schedule(m_timerWheel,
+                           Seconds(m_jitter->GetValue(0, m_minTx.GetSeconds())),
+                           &BfdAgent::Transmit,
+                           this,
+                           i);
+    }
+}
+
+inline void
+BfdAgent::StopApplication()
+{
+    m_running = false;
+    for (uint32_t i = 0; i < m_sessions.size(); ++i)
+    {
+        Session& s = m_sessions[i];
+        if (s.state == UP)
+        {
+            SetState(i, ADMIN_DOWN, DIAG_ADMIN_DOWN);
+        }
+        s.txTimer.Cancel();
+        s.detectionTimer.Cancel();
+        if (s.socket)
+        {
+            s.socket->Close();
+            s.socket = nullptr;
+        }
+    }
+}
+
+inline void
+BfdAgent::ScheduleTransmit(uint32_t session)
+{
+    // 75 - 100% of the interval, 75 - 90% with a multiplier of 1 (RFC 5880, section 6.8.7)
+    double high = m_multiplier == 1 ? 0.9 : 1.0;
+    Time interval = Seconds(GetTxInterval(session).GetSeconds() * m_jitter->GetValue(0.75, high));
+    m_sessions[session].txTimer.Schedule(m_timerWheel, interval, &BfdAgent::Transmit, this, session);
+}
+
+inline void
+BfdAgent::Transmit(uint32_t session)
+{
+    m_stats.timerEvents++;
+    SendControl(session);
+    ScheduleTransmit(session);
+}
+
+inline void
+BfdAgent::SendControl(uint32_t session)
+{
+    Session& s = m_sessions[session];
+    if (!s.socket)
+    {
+        return;
+    }
+    uint8_t buffer[BFD_CONTROL_SIZE] = {};
+    buffer[0] = (1 << 5) | (s.diagnostic & 0x1f); // version 1
+    buffer[1] = static_cast<uint8_t>(s.state) << 6;
+    buffer[2] = m_multiplier;
+    buffer[3] = BFD_CONTROL_SIZE;
+    uint32_t fields[4] = {s.localDiscriminator,
+                          s.remoteDiscriminator,
+                          static_cast<uint32_t>(m_minTx.GetMicroSeconds()),
+                          static_cast<uint32_t>(m_minRx.GetMicroSeconds())};
+    for (uint32_t f = 0; f < 4; ++f)
+    {
+        for (uint32_t b = 0; b < 4; ++b)
+        {
+            buffer[4 + 4 * f + b] = fields[f] >> (24 - 8 * b);
+        }
+    }
+    // Required Min Echo RX Interval (bytes 20 - 23) stays 0: no echo function
+    if (s.socket->SendTo(Create<Packet>(buffer, BFD_CONTROL_SIZE), 0, InetSocketAddress(s.peerAddress, BFD_PORT)) >= 0)
+    {
+        m_stats.controlSent++;
+    }
+}
+
+inline void
+BfdAgent::HandleRead(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    Address from;
+    while ((packet = socket->RecvFrom(from)))
+    {
+        Ipv4Address source = InetSocketAddress::ConvertFrom(from).GetIpv4();
+        uint32_t session = 0;
+        while (session < m_sessions.size() &&
+               (m_sessions[session].socket != socket || m_sessions[session].peerAddress != source))
+        {
+            ++session;
+        }
+        uint8_t buffer[BFD_CONTROL_SIZE];
+        if (session == m_sessions.size() || packet->GetSize() < BFD_CONTROL_SIZE)
+        {
+            m_stats.controlDropped++;
+            continue;
+        }
+        packet->CopyData(buffer, BFD_CONTROL_SIZE);
+        Receive(session, buffer, BFD_CONTROL_SIZE);
+    }
+}
+
+inline void
+BfdAgent::Receive(uint32_t session, const uint8_t* data, uint32_t size)
+{
+    Session& s = m_sessions[session];
+    auto field = [data](uint32_t offset) {
+        return uint32_t(data[offset]) << 24 | uint32_t(data[offset + 1]) << 16 |
+               uint32_t(data[offset + 2]) << 8 | uint32_t(data[offset + 3]);
+    };
+    State remoteState = static_cast<State>(data[1] >> 6);
+    uint32_t yourDiscriminator = field(8);
+    // Reception checks of RFC 5880, section 6.8.6
+    if ((data[0] >> 5) != 1 || data[3] < BFD_CONTROL_SIZE || data[2] == 0 || field(4) == 0 ||
+        (yourDiscriminator != 0 && yourDiscriminator != s.localDiscriminator) ||
+        (yourDiscriminator == 0 && remoteState != DOWN && remoteState != ADMIN_DOWN))
+    {
+        m_stats.controlDropped++;
+        return;
+    }
+    m_stats.controlReceived++;
+    s.remoteDiscriminator = field(4);
+    s.remoteState = remoteState;
+    s.remoteMultiplier = data[2];
+    s.remoteMinTx = MicroSeconds(field(12));
+    s.remoteMinRx = MicroSeconds(field(16));
+
+    if (remoteState == ADMIN_DOWN)
+    {
+        if (s.state != DOWN)
+        {
+            SetState(session, DOWN, DIAG_NEIGHBOR_DOWN);
+        }
+        return;
+    }
+
+    s.lastReceived = Simulator::Now();
+    if (s.state == DOWN)
+    {
+        if (remoteState == DOWN)
+        {
+            SetState(session, INIT, DIAG_NONE);
+        }
+        else if (remoteState == INIT)
+        {
+            SetState(session, UP, DIAG_NONE);
+        }
+    }
+    else if (s.state == INIT)
+    {
+        if (remoteState == INIT || remoteState == UP)
+        {
+            SetState(session, UP, DIAG_NONE);
+        }
+    }
+    else if (s.state == UP && remoteState == DOWN)
+    {
+        SetState(session, DOWN, DIAG_NEIGHBOR_DOWN);
+    }
+
+    if ((s.state == INIT || s.state == UP) && !s.detectionTimer.IsPending())
+    {
+        s.detectionTimer.Schedule(m_timerWheel,
+                                  GetDetectionTime(session),
+                                  &BfdAgent::DetectionTimerExpired,
+                                  this,
+                                  session);
+    }
+}
+
+inline void
+BfdAgent::DetectionTimerExpired(uint32_t session)
+{
+    m_stats.timerEvents++;
+    Session& s = m_sessions[session];
+    if (s.state != INIT && s.state != UP)
+    {
+        return;
+    }
+    Time deadline = s.lastReceived + GetDetectionTime(session);
+    if (Simulator::Now() < deadline)
+    {
+        // Packets arrived meanwhile: wait for the rest of the detection time
+        s.detectionTimer.Schedule(m_timerWheel,
+                                  deadline - Simulator::Now(),
+                                  &BfdAgent::DetectionTimerExpired,
+                                  this,
+                                  session);
+        return;
+    }
+    m_stats.detectionExpired++;
+    SetState(session, DOWN, DIAG_DETECTION_EXPIRED);
+}
+
+inline void
+BfdAgent::SetState(uint32_t session, State state, Diagnostic diagnostic)
+{
+    Session& s = m_sessions[session];
+    State previous = s.state;
+    s.state = state;
+    s.diagnostic = diagnostic;
+    if (state == DOWN || state == ADMIN_DOWN)
+    {
+        s.remoteDiscriminator = 0;
+        s.detectionTimer.Cancel();
+    }
+    if (state == UP)
+    {
+        m_stats.sessionsUp++;
+        m_sessionStateTrace(s.peerAddress, s.interface, true);
+    }
+    else if (previous == UP)
+    {
+        m_stats.sessionsDown++;
+        m_stats.lastDown = Simulator::Now();
+        m_sessionStateTrace(s.peerAddress, s.interface, false);
+    }
+    // Tell the peer right away instead of at the next periodic packet
+    if (m_running || state == ADMIN_DOWN)
+    {
+        SendControl(session);
+    }
+}
+
+/**
+ * Installs BfdAgents and sessions over point-to-point links.
+ */
+class BfdHelper
+{
+  public:
+    BfdHelper()
+        : m_timerWheel(nullptr)
+    {
+    }
+
+    /// Timer wheel of every agent created by Install() (see BfdAgent::SetTimerWheel())
+    void SetTimerWheel(TimerWheel* wheel)
+    {
+        m_timerWheel = wheel;
+    }
+
+    /// Set an attribute on every agent created by Install()
+    void SetAttribute(std::string name, const AttributeValue& value)
+    {
+        m_attributes.emplace_back(name, value.Copy());
+    }
+
+    /// The node's agent, created if the node has none yet
+    Ptr<BfdAgent> Install(Ptr<Node> node) const
+    {
+        for (uint32_t i = 0; i < node->GetNApplications(); ++i)
+        {
+            Ptr<BfdAgent> agent = DynamicCast<BfdAgent>(node->GetApplication(i));
+            if (agent)
+            {
+                return agent;
+            }
+        }
+        Ptr<BfdAgent> agent = CreateObject<BfdAgent>();
+        for (const auto& attribute : m_attributes)
+        {
+            agent->SetAttribute(attribute.first, *attribute.second);
+        }
+        agent->SetTimerWheel(m_timerWheel);
+        node->AddApplication(agent);
+        return agent;
+    }
+
+    /**
+     * Run a session between the two ends of a link (both must have an
+     * address). Ends on another MPI rank are skipped.
+     */
+    void InstallLink(const NetDeviceContainer& link) const
+    {
+        for (uint32_t end = 0; end < 2; ++end)
+        {
+            Ptr<NetDevice> local = link.Get(end);
+            Ptr<NetDevice> remote = link.Get(1 - end);
+            if (!WanMpi::IsLocal(local->GetNode()))
+            {
+                continue;
+            }
+            Ptr<Ipv4> localIpv4 = local->GetNode()->GetObject<Ipv4>();
+            Ptr<Ipv4> remoteIpv4 = remote->GetNode()->GetObject<Ipv4>();
+            uint32_t interface = localIpv4->GetInterfaceForDevice(local);
+            Ipv4Address peer = remoteIpv4->GetAddress(remoteIpv4->GetInterfaceForDevice(remote), 0).GetLocal();
+            Install(local->GetNode())->AddSession(interface, peer);
+        }
+    }
+
+  private:
+    std::vector<std::pair<std::string, Ptr<AttributeValue>>> m_attributes;
+    TimerWheel* m_timerWheel;
+};
+
+} // namespace ns3
+
+#endif /* WAN_BFD_H */
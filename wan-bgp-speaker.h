@@ -0,0 +1,3450 @@
+/*
+ * Event-driven BGP-4 speaker for the inter-AS scenarios
+ *
+ * BgpSpeaker is an Ipv4RoutingProtocol that runs real BGP sessions over
+ * TCP port 179 (RFC 4271). Every peer keeps an Adj-RIB-In and Adj-RIB-Out,
+ * the speaker keeps one Loc-RIB, and the decision process runs only for the
+ * prefixes touched by an UPDATE, a session going down or a local
+ * origination change - never as a full table recompute.
+ *
+ * The speaker sits in the node's Ipv4ListRouting next to the IGP
+ * (Ipv4StaticRouting for connected routes, Ipv4GlobalRouting or another IGP
+ * for the AS interior). BGP next hops that are not on-link are resolved
+ * recursively through the other protocols in the list, so iBGP sessions
+ * between routers that are not directly connected work like on a real router.
+ * Forwarding lookups go through an LpmTrie (wan-lpm-fib.h) that mirrors the
+ * Loc-RIB: a full table costs at most three memory reads per packet to find
+ * the prefix's next-hop group, then one read per next hop tried, whose
+ * interface and gateway are resolved beforehand (see below).
+ *
+ * Outbound changes are not sent one prefix at a time. Each peer collects the
+ * prefixes whose advertisement may have changed and flushes them in one go:
+ * repeated changes to a prefix collapse into its final state, and prefixes
+ * sharing attributes are packed into the same UPDATE. After a flush the
+ * peer's MinRouteAdvertisementInterval timer holds further announcements
+ * back; withdrawals are never delayed by it (RFC 4271, section 9.2.1.1).
+ *
+ * With UpdateGroups, peers with the same export policy (same kind of
+ * session and, unless the speaker is a route server, the same local
+ * address) share one Adj-RIB-Out, flush and MRAI timer: each UPDATE is
+ * built and encoded once per group and the same message is queued to every
+ * member. A peer that comes up while its group is running is first sent
+ * the group's Adj-RIB-Out. The per-peer export filters still hold: a member
+ * is never sent a route it advertised itself nor, over eBGP, a path through
+ * its own AS. Such a member gets its own encoding of the group's UPDATEs
+ * without those prefixes (withdrawing any it had been sent before), and
+ * remembers them so a later withdrawal of them is not sent to it either.
+ *
+ * With RouteServer the speaker is an IXP route server (RFC 7947): routes
+ * are passed between eBGP peers with AS_PATH, NEXT_HOP and MED untouched,
+ * so members forward to each other directly over the peering LAN, and
+ * nothing is installed in the FIB. All eBGP members of a route server fall
+ * into one update group. See wan-ixp-fabric.h for the LAN.
+ *
+ * Inside an AS the iBGP sessions can form a route reflector hierarchy
+ * (RFC 4456) instead of a full mesh, which needs O(n) sessions instead of
+ * O(n^2). Routes learned from a peer added as a reflector client are
+ * reflected to every iBGP peer, routes from other iBGP peers to the clients
+ * only. Reflected routes keep their NEXT_HOP and carry ORIGINATOR_ID and
+ * CLUSTER_LIST (ClusterId, by default the router id), so that they never
+ * return to their originator or into a cluster they have passed through.
+ * A reflector can itself be the client of a reflector one level up.
+ *
+ * With SetIgpCostCallback(), iBGP paths that are still tied after the
+ * eBGP-over-iBGP step are compared by the IGP distance to their NEXT_HOP
+ * (RFC 4271, section 9.1.2.2, step e): every router leaves the AS through
+ * its closest exit ("hot-potato" routing) instead of the one a fixed
+ * preference or the router id picks. The distances come from the IGP, e.g.
+ * IncrementalSpfRouting::GetCostCallback() (wan-incremental-spf.h), and
+ * NotifyIgpChange() re-runs the decision for the prefixes whose next hop
+ * moved closer or further away.
+ *
+ * With MaximumPaths > 1 the speaker forwards over every path that ties with
+ * the best one up to the router id comparison (same kind of session, local
+ * preference, AS_PATH, origin, MED and IGP distance), like "maximum-paths" on a router.
+ * Only the best path is advertised. Each packet's path is chosen by a
+ * CRC32C hash of its 5-tuple (wan-flow-hash.h), seeded with the router id,
+ * so a flow always takes the same path and is never reordered.
+ *
+ * The FIB is hierarchical: a prefix points to a shared next-hop group and
+ * the group to entries of a next-hop table, so the prefixes learned from
+ * one neighbour share a handful of groups. With PrefixIndependentConvergence
+ * every group also carries the best path with another next hop as a
+ * backup (BGP PIC). When a session goes down its next hop is marked dead
+ * in the table, a single write whatever the table size, and every group
+ * using it forwards over its backup at once. The per-prefix decision runs
+ * afterwards, in the next event, and moves the prefixes to their new
+ * groups. Without a tunnel to the backup egress, packets can bounce off a
+ * neighbour that has not converged yet, as on a router without MPLS.
+ *
+ * The table is keyed by BGP next hop, not by the IGP path to it. Each entry
+ * caches the interface and gateway the next hop resolves to, directly or
+ * through the IGP; they are resolved again after an interface or address
+ * change and when NotifyIgpChange() runs, so a core failure that only moves
+ * the IGP path needs no FIB change at all (an IGP other than
+ * IncrementalSpfRouting must call NotifyIgpChange() when its routes
+ * change). A core failure that cuts an iBGP next hop off (its IGP cost
+ * becomes 0xffffffff) is handled like a session loss when
+ * NotifyIgpChange() runs: the entry is marked unreachable
+ * in one write, before the decision process, even though the iBGP session
+ * to it is still up until its hold timer expires (BGP PIC core).
+ *
+ * Prefixes of the speaker's own AS (those with an empty AS_PATH,
+ * originated here or by an iBGP peer) are left to the IGP, and so is everything inside
+ * them: a more specific route into our own address space learned over eBGP,
+ * as a sub-prefix hijack announces it, stays in the Loc-RIB but never
+ * takes our traffic out of the AS.
+ *
+ * With RouteFlapDamping, routes from eBGP peers that keep flapping are
+ * suppressed (RFC 2439). Every withdrawal adds 1000 to the prefix's
+ * penalty at that peer and every attribute change 500; the penalty halves
+ * every DampingHalfLife. Above DampingSuppressThreshold the route is kept
+ * out of the decision process until the penalty has decayed below
+ * DampingReuseThreshold, which takes at most DampingMaxSuppressTime. There
+ * is no decay timer per prefix: a penalty is brought up to date when its
+ * prefix is touched, and suppressed routes wait in one queue ordered by
+ * reuse time that a single event serves, so damped prefixes cost no
+ * events while idle. The speaker aborts when it starts if the suppress
+ * threshold is not above the reuse threshold.
+ *
+ * Simplifications compared to a full implementation:
+ *  - 4-octet AS numbers are always used on the wire (AS4 capability is
+ *    announced in OPEN and assumed on both ends).
+ *  - To avoid connection collisions, the side with the numerically lower
+ *    address of a session actively connects and the other side only listens.
+ *  - iBGP exports use next-hop-self, except for reflected routes.
+ *  - A route server runs one decision process for all members instead of
+ *    one RIB per member.
+ *  - Flap damping uses the same half-life for reachable and unreachable
+ *    routes and does not penalize re-advertisements.
+ *
+ * Keepalive and hold timers go to the simulator's event queue, or to a
+ * shared TimerWheel (wan-timer-wheel.h) set with SetTimerWheel(), which
+ * keeps their constant rearming out of the scheduler heap.
+ *
+ * Usage: copy this header, wan-flow-hash.h, wan-lpm-fib.h, wan-mpi.h and
+ * wan-timer-wheel.h next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_BGP_SPEAKER_H
+#define WAN_BGP_SPEAKER_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "wan-flow-hash.h"
+#include "wan-lpm-fib.h"
+#include "wan-mpi.h"
+#include "wan-timer-wheel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/// BGP message types (RFC 4271, section 4.1)
+enum BgpMessageType : uint8_t
+{
+    BGP_OPEN = 1,
+    BGP_UPDATE = 2,
+    BGP_NOTIFICATION = 3,
+    BGP_KEEPALIVE = 4
+};
+
+/// Path attribute type codes used by the speaker
+enum BgpAttributeType : uint8_t
+{
+    BGP_ATTR_ORIGIN = 1,
+    BGP_ATTR_AS_PATH = 2,
+    BGP_ATTR_NEXT_HOP = 3,
+    BGP_ATTR_MED = 4,
+    BGP_ATTR_LOCAL_PREF = 5,
+    BGP_ATTR_ORIGINATOR_ID = 9,
+    BGP_ATTR_CLUSTER_LIST = 10
+};
+
+/**
+ * An IPv4 prefix as carried in NLRI and withdrawn-routes fields.
+ * The address is kept in host byte order with the host bits cleared.
+ */
+struct BgpPrefix
+{
+    uint32_t address{0};
+    uint8_t length{0};
+
+    BgpPrefix() = default;
+
+    BgpPrefix(uint32_t addr, uint8_t len)
+        : address(len == 0 ? 0 : addr & (0xffffffffu << (32 - len))),
+          length(len)
+    {
+    }
+
+    BgpPrefix(Ipv4Address network, Ipv4Mask mask)
+        : BgpPrefix(network.Get(), static_cast<uint8_t>(mask.GetPrefixLength()))
+    {
+    }
+
+    Ipv4Address GetAddress() const
+    {
+        return Ipv4Address(address);
+    }
+
+    Ipv4Mask GetMask() const
+    {
+        return Ipv4Mask(length == 0 ? 0 : 0xffffffffu << (32 - length));
+    }
+
+    bool operator<(const BgpPrefix& o) const
+    {
+        return address != o.address ? address < o.address : length < o.length;
+    }
+
+    bool operator==(const BgpPrefix& o) const
+    {
+        return address == o.address && length == o.length;
+    }
+
+    bool operator!=(const BgpPrefix& o) const
+    {
+        return !(*this == o);
+    }
+};
+
+inline std::ostream&
+operator<<(std::ostream& os, const BgpPrefix& prefix)
+{
+    return os << prefix.GetAddress() << "/" << static_cast<uint32_t>(prefix.length);
+}
+
+/// Path attributes of one route: ORIGIN, AS_PATH, NEXT_HOP, MED, LOCAL_PREF and route reflection
+struct BgpPathAttributes
+{
+    uint8_t origin{0}; ///< 0 = IGP, 1 = EGP, 2 = INCOMPLETE
+    std::vector<uint32_t> asPath;
+    Ipv4Address nextHop;
+    uint32_t med{0};
+    uint32_t localPref{100};
+    Ipv4Address originatorId;         ///< set by the first route reflector, 0.0.0.0: not reflected
+    std::vector<uint32_t> clusterList; ///< clusters passed through, most recent first
+
+    bool operator==(const BgpPathAttributes& o) const
+    {
+        return origin == o.origin && asPath == o.asPath && nextHop == o.nextHop && med == o.med &&
+               localPref == o.localPref && originatorId == o.originatorId && clusterList == o.clusterList;
+    }
+
+    bool operator!=(const BgpPathAttributes& o) const
+    {
+        return !(*this == o);
+    }
+};
+
+/**
+ * Interned, reference-counted path attributes.
+ *
+ * Most prefixes of a full table share a few thousand attribute sets, so each
+ * distinct set is stored once per simulation and shared by every speaker;
+ * RIB entries hold a 4-byte BgpAttributeHandle instead of a copy. An entry
+ * is freed when its last handle goes away and its slot is reused.
+ */
+class BgpAttributeStore
+{
+  public:
+    static constexpr uint32_t NONE = 0xffffffff;
+
+    /// The simulation-wide store
+    static BgpAttributeStore& Get();
+
+    /// Index of the entry equal to attributes, created if needed; takes a reference
+    uint32_t Intern(const BgpPathAttributes& attributes);
+    void Ref(uint32_t index);
+    void Unref(uint32_t index);
+    const BgpPathAttributes& At(uint32_t index) const;
+
+    /// Number of distinct attribute sets currently referenced
+    std::size_t GetNEntries() const;
+    /// Number of handles currently referencing the store
+    uint64_t GetNReferences() const;
+    /// Approximate heap bytes used by the store
+    std::size_t GetMemoryUsage() const;
+
+  private:
+    struct Entry
+    {
+        BgpPathAttributes attributes;
+        std::size_t hash{0};
+        uint32_t refs{0};
+    };
+
+    BgpAttributeStore();
+    static std::size_t Hash(const BgpPathAttributes& attributes);
+
+    std::deque<Entry> m_entries; ///< deque: references stay valid while it grows
+    std::vector<uint32_t> m_freeEntries;
+    std::unordered_multimap<std::size_t, uint32_t> m_index;
+    uint64_t m_references;
+};
+
+/// A counted reference to interned path attributes; compares by identity
+class BgpAttributeHandle
+{
+  public:
+    BgpAttributeHandle()
+        : m_index(BgpAttributeStore::NONE)
+    {
+    }
+
+    explicit BgpAttributeHandle(const BgpPathAttributes& attributes)
+        : m_index(BgpAttributeStore::Get().Intern(attributes))
+    {
+    }
+
+    BgpAttributeHandle(const BgpAttributeHandle& o)
+        : m_index(o.m_index)
+    {
+        if (m_index != BgpAttributeStore::NONE)
+        {
+            BgpAttributeStore::Get().Ref(m_index);
+        }
+    }
+
+    BgpAttributeHandle(BgpAttributeHandle&& o) noexcept
+        : m_index(o.m_index)
+    {
+        o.m_index = BgpAttributeStore::NONE;
+    }
+
+    BgpAttributeHandle& operator=(BgpAttributeHandle o) noexcept
+    {
+        std::swap(m_index, o.m_index);
+        return *this;
+    }
+
+    ~BgpAttributeHandle()
+    {
+        if (m_index != BgpAttributeStore::NONE)
+        {
+            BgpAttributeStore::Get().Unref(m_index);
+        }
+    }
+
+    bool IsNull() const
+    {
+        return m_index == BgpAttributeStore::NONE;
+    }
+
+    /// Store index; equal for equal attributes, stable while referenced
+    uint32_t GetIndex() const
+    {
+        return m_index;
+    }
+
+    const BgpPathAttributes& operator*() const
+    {
+        return BgpAttributeStore::Get().At(m_index);
+    }
+
+    const BgpPathAttributes* operator->() const
+    {
+        return &BgpAttributeStore::Get().At(m_index);
+    }
+
+    bool operator==(const BgpAttributeHandle& o) const
+    {
+        return m_index == o.m_index;
+    }
+
+    bool operator!=(const BgpAttributeHandle& o) const
+    {
+        return m_index != o.m_index;
+    }
+
+  private:
+    uint32_t m_index;
+};
+
+inline BgpAttributeStore::BgpAttributeStore()
+    : m_references(0)
+{
+}
+
+inline BgpAttributeStore&
+BgpAttributeStore::Get()
+{
+    // Never destroyed, so handles held by objects torn down at exit stay safe
+    static BgpAttributeStore* store = new BgpAttributeStore();
+    return *store;
+}
+
+inline std::size_t
+BgpAttributeStore::Hash(const BgpPathAttributes& attributes)
+{
+    uint64_t h = 1469598103934665603ULL; // FNV-1a over the fields
+    auto mix = [&h](uint64_t v) {
+        h ^= v;
+        h *= 1099511628211ULL;
+    };
+    mix(attributes.origin);
+    mix(attributes.nextHop.Get());
+    mix(attributes.med);
+    mix(attributes.localPref);
+    for (uint32_t as : attributes.asPath)
+    {
+        mix(as);
+    }
+    mix(attributes.originatorId.Get());
+    for (uint32_t cluster : attributes.clusterList)
+    {
+        mix(cluster);
+    }
+    return h;
+}
+
+inline uint32_t
+BgpAttributeStore::Intern(const BgpPathAttributes& attributes)
+{
+    std::size_t hash = Hash(attributes);
+    auto range = m_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (m_entries[it->second].attributes == attributes)
+        {
+            Ref(it->second);
+            return it->second;
+        }
+    }
+    uint32_t index;
+    if (!m_freeEntries.empty())
+    {
+        index = m_freeEntries.back();
+        m_freeEntries.pop_back();
+    }
+    else
+    {
+        index = m_entries.size();
+        m_entries.emplace_back();
+    }
+    Entry& entry = m_entries[index];
+    entry.attributes = attributes;
+    entry.hash = hash;
+    entry.refs = 0;
+    m_index.emplace(hash, index);
+    Ref(index);
+    return index;
+}
+
+inline void
+BgpAttributeStore::Ref(uint32_t index)
+{
+    m_entries[index].refs++;
+    m_references++;
+}
+
+inline void
+BgpAttributeStore::Unref(uint32_t index)
+{
+    Entry& entry = m_entries[index];
+    m_references--;
+    if (--entry.refs > 0)
+    {
+        return;
+    }
+    auto range = m_index.equal_range(entry.hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == index)
+        {
+            m_index.erase(it);
+            break;
+        }
+    }
+    std::vector<uint32_t>().swap(entry.attributes.asPath);
+    std::vector<uint32_t>().swap(entry.attributes.clusterList);
+    m_freeEntries.push_back(index);
+}
+
+inline const BgpPathAttributes&
+BgpAttributeStore::At(uint32_t index) const
+{
+    return m_entries[index].attributes;
+}
+
+inline std::size_t
+BgpAttributeStore::GetNEntries() const
+{
+    return m_entries.size() - m_freeEntries.size();
+}
+
+inline uint64_t
+BgpAttributeStore::GetNReferences() const
+{
+    return m_references;
+}
+
+inline std::size_t
+BgpAttributeStore::GetMemoryUsage() const
+{
+    std::size_t bytes = m_entries.size() * sizeof(Entry) + m_freeEntries.capacity() * sizeof(uint32_t) +
+                        m_index.bucket_count() * sizeof(void*) +
+                        m_index.size() * (sizeof(void*) + sizeof(std::pair<std::size_t, uint32_t>));
+    for (const auto& entry : m_entries)
+    {
+        const BgpPathAttributes& attributes = entry.attributes;
+        bytes += (attributes.asPath.capacity() + attributes.clusterList.capacity()) * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+/**
+ * BGP-4 speaker running as an Ipv4RoutingProtocol.
+ *
+ * Peers are configured with AddPeer() before the simulation starts; locally
+ * originated prefixes with AddNetwork(). Sessions are opened at StartTime.
+ */
+class BgpSpeaker : public Ipv4RoutingProtocol
+{
+  public:
+    static constexpr uint16_t BGP_PORT = 179;
+    static constexpr uint32_t BGP_HEADER_SIZE = 19;
+    static constexpr uint32_t BGP_MAX_MESSAGE_SIZE = 4096;
+    static constexpr int32_t LOCAL_ORIGIN = -1;
+    /// FIB value of prefixes from our own AS, which are left to the IGP
+    static constexpr uint32_t FIB_IGP = 0;
+
+    /**
+     * Import policy hook: called for every route received over eBGP with the
+     * peer's AS number; returning false drops the route as if it had been
+     * withdrawn. See BgpRouteValidator (wan-route-validation.h).
+     */
+    typedef Callback<bool, uint32_t, const BgpPrefix&, const BgpPathAttributes&> ImportFilterCallback;
+
+    /// IGP distance from this router to a BGP next hop (0xffffffff: unreachable)
+    typedef Callback<uint32_t, Ipv4Address> IgpCostCallback;
+
+    /// Per-speaker counters used for convergence and UPDATE volume reports
+    struct Statistics
+    {
+        uint64_t updatesSent{0};
+        uint64_t updatesEncoded{0}; ///< UPDATE messages built, once per update group
+        uint64_t updatesReceived{0};
+        uint64_t updateBytesSent{0};
+        uint64_t prefixesAdvertised{0};
+        uint64_t prefixesWithdrawn{0};
+        uint64_t prefixesReceived{0};
+        uint64_t withdrawalsReceived{0};
+        uint64_t loopRejections{0};
+        uint64_t importRejections{0}; ///< routes dropped by the import filter
+        uint64_t decisionRuns{0};
+        uint64_t bestPathChanges{0};
+        uint64_t sessionsEstablished{0};
+        uint64_t sessionsLost{0};
+        uint64_t prefixChangesQueued{0};    ///< Adj-RIB-Out re-evaluations requested
+        uint64_t prefixChangesCoalesced{0}; ///< ...merged into a pending one or found unchanged
+        uint64_t mraiFlushes{0};            ///< flushes run by an expiring MRAI timer
+        uint64_t fibUpdates{0};             ///< FIB prefixes written
+        uint64_t nextHopsDown{0};           ///< next-hop table entries marked dead or unreachable
+        uint64_t routesSuppressed{0};       ///< routes that crossed the damping suppress threshold
+        uint64_t routesReused{0};           ///< suppressed routes whose penalty decayed
+        uint64_t routesDamped{0};           ///< advertisements held back while suppressed
+        uint64_t igpCostChanges{0};         ///< iBGP next hops whose IGP distance changed
+        Time lastBestPathChange;
+    };
+
+    static TypeId GetTypeId();
+
+    BgpSpeaker();
+    ~BgpSpeaker() override;
+
+    /**
+     * Configure a BGP session.
+     * \param localAddress local end of the session (must be an address of this node)
+     * \param peerAddress remote end of the session
+     * \param peerAs AS number of the peer; equal to LocalAs for iBGP
+     * \param reflectorClient iBGP only: the peer is a route reflector client of this speaker
+     * \return the peer index
+     */
+    uint32_t AddPeer(Ipv4Address localAddress,
+                     Ipv4Address peerAddress,
+                     uint32_t peerAs,
+                     bool reflectorClient = false);
+
+    /// Originate a prefix (like "network x.x.x.x mask y.y.y.y")
+    void AddNetwork(Ipv4Address network, Ipv4Mask mask);
+
+    /// Stop originating a prefix (also removes routes added with AddRoute())
+    void RemoveNetwork(Ipv4Address network, Ipv4Mask mask);
+
+    /**
+     * Inject a route with its own path attributes, e.g. from a table dump
+     * of an upstream provider. It is advertised like a locally originated
+     * network, with the given AS_PATH behind our own AS on eBGP sessions.
+     * Injected routes are control plane only: this router does not forward
+     * traffic for them.
+     */
+    void AddRoute(const BgpPrefix& prefix, const BgpPathAttributes& attributes);
+
+    uint32_t GetLocalAs() const;
+    Ipv4Address GetRouterId() const;
+    uint32_t GetNPeers() const;
+    bool IsEstablished(uint32_t peer) const;
+    Ipv4Address GetPeerAddress(uint32_t peer) const;
+
+    /// Number of prefixes in the Loc-RIB
+    uint32_t GetNRoutes() const;
+
+    /// Best path currently selected for a prefix, or nullptr
+    const BgpPathAttributes* GetBestPath(Ipv4Address network, Ipv4Mask mask) const;
+
+    /// Number of paths traffic to a prefix is spread over (0: no route)
+    uint32_t GetNPaths(Ipv4Address network, Ipv4Mask mask) const;
+
+    /// Next hop of a prefix's PIC backup path (0.0.0.0: none)
+    Ipv4Address GetBackupNextHop(Ipv4Address network, Ipv4Mask mask) const;
+
+    /// Number of next-hop groups in the FIB
+    uint32_t GetNFibGroups() const;
+
+    /// Number of update groups (one per peer without UpdateGroups)
+    uint32_t GetNUpdateGroups() const;
+
+    /// Number of routes currently suppressed by flap damping
+    uint32_t GetNSuppressedRoutes() const;
+
+    /// Approximate bytes used by the RIBs and the FIB, without the shared BgpAttributeStore
+    std::size_t GetMemoryUsage() const;
+
+    const Statistics& GetStatistics() const;
+
+    /**
+     * Model a misconfigured export filter: every Loc-RIB route is sent to
+     * every eBGP peer, including back to the peer it was learned from.
+     */
+    void SetLeakRoutes(bool leak);
+
+    /// Install an import filter for eBGP routes (a null callback removes it)
+    void SetImportFilter(ImportFilterCallback filter);
+
+    /// Break ties between iBGP paths by IGP distance to their next hop; set before the speaker starts
+    void SetIgpCostCallback(IgpCostCallback cost);
+
+    /// IGP routes changed: re-resolve next hops, fail over from those it lost, re-run the decision for those that moved
+    void NotifyIgpChange();
+
+    /**
+     * Drop the session to a neighbour that a liveness check such as BFD
+     * (wan-bfd.h) declared unreachable, without waiting for the hold timer.
+     * The session is reopened after ConnectRetryTime.
+     */
+    void NotifyPeerDown(Ipv4Address peerAddress);
+
+    /// Run keepalive and hold timers on a wheel shared with other protocols (nullptr: simulator events)
+    void SetTimerWheel(TimerWheel* wheel);
+
+    // Inherited from Ipv4RoutingProtocol
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+    /// TracedCallback signature for best path changes
+    typedef void (*BestPathChangeTracedCallback)(Ipv4Address network,
+                                                  uint8_t prefixLength,
+                                                  bool reachable);
+    /// TracedCallback signature for session state changes
+    typedef void (*SessionStateTracedCallback)(Ipv4Address peer, bool established);
+    /// TracedCallback signature for routes dropped by the import filter
+    typedef void (*RouteRejectedTracedCallback)(Ipv4Address network,
+                                                 uint8_t prefixLength,
+                                                 uint32_t peerAs);
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    /// Finite state machine states (RFC 4271, section 8.2.2)
+    enum State
+    {
+        IDLE,
+        CONNECT,
+        ACTIVE,
+        OPEN_SENT,
+        OPEN_CONFIRM,
+        ESTABLISHED
+    };
+
+    /// Flap history of a prefix at one eBGP peer
+    struct DampingState
+    {
+        double penalty{0};
+        Time updated;             ///< time the penalty was last decayed to
+        bool suppressed{false};
+        BgpAttributeHandle route; ///< route held back while suppressed, null: withdrawn
+    };
+
+    struct Peer
+    {
+        Ipv4Address localAddress;
+        Ipv4Address peerAddress;
+        uint32_t peerAs{0};
+        bool internal{false};
+        bool reflectorClient{false};
+        bool active{false}; ///< this side opens the TCP connection
+        int32_t interface{-1};
+        State state{IDLE};
+        Ptr<Socket> socket;
+        std::vector<uint8_t> rxBuffer;
+        std::vector<Ptr<Packet>> txQueue;
+        Ipv4Address peerRouterId;
+        Time holdTime;
+        ProtocolTimer keepaliveTimer;
+        ProtocolTimer holdTimer;
+        EventId connectRetryTimer;
+        std::map<BgpPrefix, BgpAttributeHandle> adjRibIn;
+        std::map<BgpPrefix, DampingState> damping; ///< kept across sessions
+        uint32_t group{0};                         ///< index into m_groups
+        std::set<BgpPrefix> filteredOut; ///< in the group's Adj-RIB-Out, but not sent to this member
+    };
+
+    /// Peers sharing one export policy, Adj-RIB-Out and flush
+    struct UpdateGroup
+    {
+        bool internal{false};
+        bool reflectorClient{false};
+        Ipv4Address localAddress;      ///< NEXT_HOP written into exports
+        int32_t peer{-1};              ///< sole member without UpdateGroups, -1: shared
+        std::vector<uint32_t> members; ///< established sessions
+        std::map<BgpPrefix, BgpAttributeHandle> adjRibOut;
+        std::set<BgpPrefix> pendingOut; ///< prefixes to re-evaluate at the next flush
+        EventId mraiTimer;
+        EventId flushEvent;
+    };
+
+    struct LocRibEntry
+    {
+        BgpAttributeHandle attributes;
+        int32_t peer{LOCAL_ORIGIN};
+        std::vector<Ipv4Address> multipath; ///< next hops of all equal paths, sorted; empty: best only
+        Ipv4Address backup;                 ///< PIC backup next hop, 0.0.0.0: none
+    };
+
+    static constexpr uint32_t NO_NEXT_HOP = 0xffffffff;
+    static constexpr uint32_t IGP_UNREACHABLE = 0xffffffff;
+    static constexpr double DAMPING_WITHDRAWAL_PENALTY = 1000;
+    static constexpr double DAMPING_ATTRIBUTE_PENALTY = 500;
+
+    /// Entry of the next-hop table shared by all groups
+    struct FibNextHop
+    {
+        Ipv4Address address;
+        bool up{true};        ///< the session to this neighbour is up
+        bool reachable{true}; ///< the IGP reaches it
+        bool resolved{false}; ///< device, gateway and source are valid
+        Ptr<NetDevice> device;
+        Ipv4Address gateway;
+        Ipv4Address source;
+    };
+
+    /// What FIB prefixes point to: next hops to spread over, then a backup
+    struct FibGroup
+    {
+        std::vector<uint32_t> nextHops; ///< indices into m_fibNextHopTable
+        uint32_t backup{NO_NEXT_HOP};
+
+        bool operator<(const FibGroup& o) const
+        {
+            return nextHops != o.nextHops ? nextHops < o.nextHops : backup < o.backup;
+        }
+    };
+
+    void Start();
+    void Connect(uint32_t peer);
+    void ConnectionSucceeded(Ptr<Socket> socket);
+    void ConnectionFailed(Ptr<Socket> socket);
+    bool ConnectionRequest(Ptr<Socket> socket, const Address& from);
+    void HandleAccept(Ptr<Socket> socket, const Address& from);
+    void HandleRead(Ptr<Socket> socket);
+    void HandleSend(Ptr<Socket> socket, uint32_t available);
+    void HandlePeerClose(Ptr<Socket> socket);
+    void AttachSocket(uint32_t peer, Ptr<Socket> socket);
+    int32_t FindPeerBySocket(Ptr<Socket> socket) const;
+    int32_t FindPeerByAddress(Ipv4Address address) const;
+
+    void ProcessBuffer(uint32_t peer);
+    void ReceiveOpen(uint32_t peer, const uint8_t* data, uint32_t size);
+    void ReceiveKeepalive(uint32_t peer);
+    void ReceiveUpdate(uint32_t peer, const uint8_t* data, uint32_t size);
+    bool ParseAttributes(const uint8_t* data, uint32_t size, BgpPathAttributes& attrs) const;
+
+    void SendOpen(uint32_t peer);
+    void SendKeepalive(uint32_t peer);
+    void SendNotification(uint32_t peer, uint8_t code, uint8_t subcode);
+    /// Append the UPDATE messages carrying the given changes to messages
+    void EncodeUpdate(bool internal,
+                      const std::vector<BgpPrefix>& withdrawn,
+                      const BgpPathAttributes* attrs,
+                      const std::vector<BgpPrefix>& nlri,
+                      std::vector<Ptr<Packet>>& messages);
+    void SendUpdates(uint32_t peer,
+                     const std::vector<Ptr<Packet>>& messages,
+                     uint64_t announced,
+                     uint64_t withdrawn);
+    void SendAdjRibOut(uint32_t peer);
+    void SendMessage(uint32_t peer, BgpMessageType type, const std::vector<uint8_t>& body);
+    static Ptr<Packet> BuildMessage(BgpMessageType type, const std::vector<uint8_t>& body);
+    void FlushTxQueue(uint32_t peer);
+
+    void SessionEstablished(uint32_t peer);
+    void SessionDown(uint32_t peer, bool reconnect);
+    void KeepaliveTimerExpired(uint32_t peer);
+    void HoldTimerExpired(uint32_t peer);
+    void RestartHoldTimer(uint32_t peer);
+
+    void RunDecision(const BgpPrefix& prefix);
+    void RunDecisions(std::vector<BgpPrefix> prefixes);
+    bool IsBetter(const BgpPathAttributes& a,
+                  int32_t peerA,
+                  const BgpPathAttributes& b,
+                  int32_t peerB) const;
+    /// True if a path may share traffic with the best path
+    bool IsMultipath(const BgpPathAttributes& a,
+                     int32_t peerA,
+                     const BgpPathAttributes& best,
+                     int32_t bestPeer) const;
+    void UpdateAdjRibOut(uint32_t group, const BgpPrefix& prefix);
+    void FlushAdjRibOut(uint32_t group, bool withdrawalsOnly);
+    void MraiTimerExpired(uint32_t group);
+    void UpdateFib(const BgpPrefix& prefix);
+    /// True if the prefix lies inside one of our own AS's prefixes
+    bool IsOwnAddressSpace(const BgpPrefix& prefix) const;
+    uint32_t GetFibNextHop(Ipv4Address address);
+    void SetNextHopState(Ipv4Address address, bool up);
+    void SetNextHopReachable(Ipv4Address address, bool reachable);
+    bool BuildExport(const UpdateGroup& group, const LocRibEntry& entry, BgpPathAttributes& out) const;
+    /// The per-peer filters BuildExport() skips for a shared group: split horizon and AS loop
+    bool IsFilteredFor(uint32_t member, const UpdateGroup& group, const BgpPrefix& prefix, const BgpPathAttributes& out)
+        const;
+    /// CLUSTER_LIST value of this speaker's cluster
+    uint32_t GetClusterId() const;
+    /// Cached IGP distance to an iBGP next hop, 0 without an IGP cost callback
+    uint32_t GetIgpCost(Ipv4Address nextHop) const;
+    /// Charge a route change from an eBGP peer (null route: withdrawal); true: keep it out of the Adj-RIB-In
+    bool DampRoute(uint32_t peer, const BgpPrefix& prefix, const BgpAttributeHandle& route);
+    double DecayPenalty(DampingState& state) const;
+    Time GetReuseDelay(double penalty) const;
+    void ScheduleReuse(uint32_t peer, const BgpPrefix& prefix, Time at);
+    void ReuseTimerExpired();
+
+    Ptr<Ipv4Route> Lookup(const Ipv4Header& header, Ptr<const Packet> packet, Ptr<NetDevice> oif) const;
+    bool ResolveNextHop(Ipv4Address nextHop, uint32_t& interface, Ipv4Address& gateway) const;
+    /// Resolve one next-hop table entry again
+    void ResolveFibNextHop(FibNextHop& entry) const;
+    /// Resolve every next-hop table entry again
+    void ResolveFibNextHops();
+    /// Resolve every entry once the other protocols have handled an interface or address change
+    void ScheduleResolveFibNextHops();
+    void UpdatePeerInterfaces();
+
+    static void WriteU16(std::vector<uint8_t>& buf, uint16_t v);
+    static void WriteU32(std::vector<uint8_t>& buf, uint32_t v);
+    static uint16_t ReadU16(const uint8_t* p);
+    static uint32_t ReadU32(const uint8_t* p);
+    static void WritePrefix(std::vector<uint8_t>& buf, const BgpPrefix& prefix);
+    static bool ReadPrefixes(const uint8_t* data, uint32_t size, std::vector<BgpPrefix>& out);
+    static void WriteAttribute(std::vector<uint8_t>& buf,
+                               uint8_t flags,
+                               uint8_t type,
+                               const std::vector<uint8_t>& value);
+
+    Ptr<Ipv4> m_ipv4;
+    uint32_t m_localAs;
+    Ipv4Address m_routerId;
+    Ipv4Address m_clusterId;
+    Time m_holdTime;
+    Time m_connectRetryTime;
+    Time m_startTime;
+    Time m_mrai;
+    TimerWheel* m_timerWheel;
+    uint32_t m_maxPaths;
+    bool m_pic;
+    bool m_useUpdateGroups;
+    bool m_routeServer;
+    bool m_leakRoutes;
+    bool m_damping;
+    Time m_dampingHalfLife;
+    double m_dampingSuppress;
+    double m_dampingReuse;
+    Time m_dampingMaxSuppress;
+    bool m_started;
+    Ptr<Socket> m_listenSocket;
+    std::vector<Peer> m_peers;
+    std::vector<UpdateGroup> m_groups;
+    std::map<BgpPrefix, BgpAttributeHandle> m_localRoutes; ///< AddNetwork() and AddRoute()
+    std::map<BgpPrefix, LocRibEntry> m_locRib;
+    LpmTrie m_fib; ///< Loc-RIB prefix -> index into m_fibGroups
+    std::vector<FibGroup> m_fibGroups; ///< FIB_IGP is reserved
+    std::map<FibGroup, uint32_t> m_fibGroupIndex;
+    std::vector<FibNextHop> m_fibNextHopTable;
+    std::map<Ipv4Address, uint32_t> m_fibNextHopIndex;
+    std::set<BgpPrefix> m_ownPrefixes; ///< Loc-RIB prefixes of our own AS
+    std::multimap<Time, std::pair<uint32_t, BgpPrefix>> m_reuseQueue; ///< one entry per suppressed route
+    EventId m_reuseEvent;                                              ///< for the earliest entry
+    EventId m_resolveEvent;
+    Statistics m_stats;
+
+    TracedCallback<Ipv4Address, uint8_t, bool> m_bestPathChangeTrace;
+    TracedCallback<Ipv4Address, bool> m_sessionStateTrace;
+    TracedCallback<Ipv4Address, uint8_t, uint32_t> m_routeRejectedTrace;
+    ImportFilterCallback m_importFilter;
+    IgpCostCallback m_igpCost;
+    std::map<Ipv4Address, uint32_t> m_igpCosts; ///< every iBGP next hop seen
+};
+
+NS_OBJECT_ENSURE_REGISTERED(BgpSpeaker);
+
+inline TypeId
+BgpSpeaker::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::BgpSpeaker")
+            .SetParent<Ipv4RoutingProtocol>()
+            .SetGroupName("Internet")
+            .AddConstructor<BgpSpeaker>()
+            .AddAttribute("LocalAs",
+                          "Autonomous system number of this speaker",
+                          UintegerValue(65000),
+                          MakeUintegerAccessor(&BgpSpeaker::m_localAs),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("RouterId",
+                          "BGP identifier; 0.0.0.0 selects the first interface address",
+                          Ipv4AddressValue(Ipv4Address::GetZero()),
+                          MakeIpv4AddressAccessor(&BgpSpeaker::m_routerId),
+                          MakeIpv4AddressChecker())
+            .AddAttribute("ClusterId",
+                          "Route reflector cluster; 0.0.0.0 uses the router id",
+                          Ipv4AddressValue(Ipv4Address::GetZero()),
+                          MakeIpv4AddressAccessor(&BgpSpeaker::m_clusterId),
+                          MakeIpv4AddressChecker())
+            .AddAttribute("HoldTime",
+                          "Hold time proposed in OPEN; keepalives are sent every third of it",
+                          TimeValue(Seconds(90)),
+                          MakeTimeAccessor(&BgpSpeaker::m_holdTime),
+                          MakeTimeChecker())
+            .AddAttribute("ConnectRetryTime",
+                          "Delay before an active session retries its TCP connection",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&BgpSpeaker::m_connectRetryTime),
+                          MakeTimeChecker())
+            .AddAttribute("StartTime",
+                          "Time at which the speaker opens its sessions",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&BgpSpeaker::m_startTime),
+                          MakeTimeChecker())
+            .AddAttribute("MinRouteAdvertisementInterval",
+                          "Per-peer MRAI: minimum time between two flushes of announcements "
+                          "(0: flush once per simulation time step)",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&BgpSpeaker::m_mrai),
+                          MakeTimeChecker())
+            .AddAttribute("MaximumPaths",
+                          "Equal-cost paths per prefix to forward over (1: best path only)",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&BgpSpeaker::m_maxPaths),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("PrefixIndependentConvergence",
+                          "Keep a backup path per prefix and fail over to it by next hop (BGP PIC)",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&BgpSpeaker::m_pic),
+                          MakeBooleanChecker())
+            .AddAttribute("UpdateGroups",
+                          "Share one Adj-RIB-Out and encoded UPDATEs between peers with the same "
+                          "export policy (set before AddPeer)",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&BgpSpeaker::m_useUpdateGroups),
+                          MakeBooleanChecker())
+            .AddAttribute("RouteServer",
+                          "Act as an IXP route server: pass eBGP routes on unchanged, install no FIB",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&BgpSpeaker::m_routeServer),
+                          MakeBooleanChecker())
+            .AddAttribute("LeakRoutes",
+                          "Export every route to every eBGP peer (misconfigured export filter)",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&BgpSpeaker::m_leakRoutes),
+                          MakeBooleanChecker())
+            .AddAttribute("RouteFlapDamping",
+                          "Suppress flapping routes from eBGP peers (RFC 2439)",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&BgpSpeaker::m_damping),
+                          MakeBooleanChecker())
+            .AddAttribute("DampingHalfLife",
+                          "Time in which a flap penalty decays to half",
+                          TimeValue(Minutes(15)),
+                          MakeTimeAccessor(&BgpSpeaker::m_dampingHalfLife),
+                          MakeTimeChecker())
+            .AddAttribute("DampingSuppressThreshold",
+                          "Penalty above which a route is suppressed; must exceed DampingReuseThreshold",
+                          DoubleValue(2000),
+                          MakeDoubleAccessor(&BgpSpeaker::m_dampingSuppress),
+                          MakeDoubleChecker<double>(0))
+            .AddAttribute("DampingReuseThreshold",
+                          "Penalty below which a suppressed route is used again",
+                          DoubleValue(750),
+                          MakeDoubleAccessor(&BgpSpeaker::m_dampingReuse),
+                          MakeDoubleChecker<double>(1))
+            .AddAttribute("DampingMaxSuppressTime",
+                          "Longest time a route stays suppressed; caps the penalty",
+                          TimeValue(Minutes(60)),
+                          MakeTimeAccessor(&BgpSpeaker::m_dampingMaxSuppress),
+                          MakeTimeChecker())
+            .AddTraceSource("BestPathChange",
+                            "The Loc-RIB best path of a prefix changed",
+                            MakeTraceSourceAccessor(&BgpSpeaker::m_bestPathChangeTrace),
+                            "ns3::BgpSpeaker::BestPathChangeTracedCallback")
+            .AddTraceSource("SessionState",
+                            "A session reached or left the Established state",
+                            MakeTraceSourceAccessor(&BgpSpeaker::m_sessionStateTrace),
+                            "ns3::BgpSpeaker::SessionStateTracedCallback")
+            .AddTraceSource("RouteRejected",
+                            "A route received over eBGP was dropped by the import filter",
+                            MakeTraceSourceAccessor(&BgpSpeaker::m_routeRejectedTrace),
+                            "ns3::BgpSpeaker::RouteRejectedTracedCallback");
+    return tid;
+}
+
+inline BgpSpeaker::BgpSpeaker()
+    : m_localAs(65000),
+      m_holdTime(Seconds(90)),
+      m_connectRetryTime(Seconds(1)),
+      m_timerWheel(nullptr),
+      m_maxPaths(1),
+      m_pic(false),
+      m_useUpdateGroups(false),
+      m_routeServer(false),
+      m_leakRoutes(false),
+      m_damping(false),
+      m_dampingHalfLife(Minutes(15)),
+      m_dampingSuppress(2000),
+      m_dampingReuse(750),
+      m_dampingMaxSuppress(Minutes(60)),
+      m_started(false),
+      m_fibGroups(1) // slot FIB_IGP
+{
+}
+
+inline BgpSpeaker::~BgpSpeaker()
+{
+}
+
+inline void
+BgpSpeaker::DoDispose()
+{
+    for (auto& peer : m_peers)
+    {
+        peer.keepaliveTimer.Cancel();
+        peer.holdTimer.Cancel();
+        peer.connectRetryTimer.Cancel();
+        if (peer.socket)
+        {
+            peer.socket->Close();
+            peer.socket = nullptr;
+        }
+        peer.txQueue.clear();
+    }
+    if (m_listenSocket)
+    {
+        m_listenSocket->Close();
+        m_listenSocket = nullptr;
+    }
+    for (auto& group : m_groups)
+    {
+        group.mraiTimer.Cancel();
+        group.flushEvent.Cancel();
+    }
+    m_reuseEvent.Cancel();
+    m_resolveEvent.Cancel();
+    m_reuseQueue.clear();
+    m_peers.clear();
+    m_groups.clear();
+    m_locRib.clear();
+    m_ownPrefixes.clear();
+    m_localRoutes.clear();
+    m_fib.Clear();
+    m_ipv4 = nullptr;
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+inline uint32_t
+BgpSpeaker::AddPeer(Ipv4Address localAddress,
+                    Ipv4Address peerAddress,
+                    uint32_t peerAs,
+                    bool reflectorClient)
+{
+    Peer peer;
+    peer.localAddress = localAddress;
+    peer.peerAddress = peerAddress;
+    peer.peerAs = peerAs;
+    peer.internal = (peerAs == m_localAs);
+    NS_ABORT_MSG_UNLESS(peer.internal || !reflectorClient,
+                        "Route reflector client " << peerAddress << " is not in AS" << m_localAs);
+    peer.reflectorClient = reflectorClient;
+    peer.active = localAddress.Get() < peerAddress.Get();
+    peer.holdTime = m_holdTime;
+    peer.group = m_groups.size();
+    for (uint32_t g = 0; m_useUpdateGroups && g < m_groups.size(); ++g)
+    {
+        const UpdateGroup& group = m_groups[g];
+        if (group.internal == peer.internal && group.reflectorClient == reflectorClient &&
+            ((m_routeServer && !peer.internal) || group.localAddress == localAddress))
+        {
+            peer.group = g;
+            break;
+        }
+    }
+    if (peer.group == m_groups.size())
+    {
+        UpdateGroup group;
+        group.internal = peer.internal;
+        group.reflectorClient = reflectorClient;
+        group.localAddress = localAddress;
+        group.peer = m_useUpdateGroups ? -1 : static_cast<int32_t>(m_peers.size());
+        m_groups.push_back(group);
+    }
+    m_peers.push_back(peer);
+    UpdatePeerInterfaces();
+    return m_peers.size() - 1;
+}
+
+inline void
+BgpSpeaker::AddNetwork(Ipv4Address network, Ipv4Mask mask)
+{
+    AddRoute(BgpPrefix(network, mask), BgpPathAttributes());
+}
+
+inline void
+BgpSpeaker::AddRoute(const BgpPrefix& prefix, const BgpPathAttributes& attributes)
+{
+    BgpPathAttributes local = attributes;
+    local.nextHop = Ipv4Address::GetZero();
+    m_localRoutes[prefix] = BgpAttributeHandle(local);
+    if (m_started)
+    {
+        RunDecision(prefix);
+    }
+}
+
+inline void
+BgpSpeaker::RemoveNetwork(Ipv4Address network, Ipv4Mask mask)
+{
+    BgpPrefix prefix(network, mask);
+    if (m_localRoutes.erase(prefix) && m_started)
+    {
+        RunDecision(prefix);
+    }
+}
+
+inline uint32_t
+BgpSpeaker::GetLocalAs() const
+{
+    return m_localAs;
+}
+
+inline Ipv4Address
+BgpSpeaker::GetRouterId() const
+{
+    return m_routerId;
+}
+
+inline uint32_t
+BgpSpeaker::GetNPeers() const
+{
+    return m_peers.size();
+}
+
+inline bool
+BgpSpeaker::IsEstablished(uint32_t peer) const
+{
+    return peer < m_peers.size() && m_peers[peer].state == ESTABLISHED;
+}
+
+inline Ipv4Address
+BgpSpeaker::GetPeerAddress(uint32_t peer) const
+{
+    return m_peers.at(peer).peerAddress;
+}
+
+inline uint32_t
+BgpSpeaker::GetNRoutes() const
+{
+    return m_locRib.size();
+}
+
+inline const BgpPathAttributes*
+BgpSpeaker::GetBestPath(Ipv4Address network, Ipv4Mask mask) const
+{
+    auto it = m_locRib.find(BgpPrefix(network, mask));
+    return it == m_locRib.end() ? nullptr : &*it->second.attributes;
+}
+
+inline uint32_t
+BgpSpeaker::GetNPaths(Ipv4Address network, Ipv4Mask mask) const
+{
+    auto it = m_locRib.find(BgpPrefix(network, mask));
+    if (it == m_locRib.end())
+    {
+        return 0;
+    }
+    return std::max<uint32_t>(1, it->second.multipath.size());
+}
+
+inline Ipv4Address
+BgpSpeaker::GetBackupNextHop(Ipv4Address network, Ipv4Mask mask) const
+{
+    auto it = m_locRib.find(BgpPrefix(network, mask));
+    return it == m_locRib.end() ? Ipv4Address::GetZero() : it->second.backup;
+}
+
+inline uint32_t
+BgpSpeaker::GetNFibGroups() const
+{
+    return m_fibGroupIndex.size();
+}
+
+inline uint32_t
+BgpSpeaker::GetNUpdateGroups() const
+{
+    return m_groups.size();
+}
+
+inline uint32_t
+BgpSpeaker::GetNSuppressedRoutes() const
+{
+    return m_reuseQueue.size();
+}
+
+inline std::size_t
+BgpSpeaker::GetMemoryUsage() const
+{
+    // Red-black tree nodes: three pointers and a colour, then the value
+    const std::size_t node = 4 * sizeof(void*);
+    const std::size_t ribEntry = node + sizeof(std::pair<const BgpPrefix, BgpAttributeHandle>);
+    std::size_t bytes = m_peers.capacity() * sizeof(Peer) + m_groups.capacity() * sizeof(UpdateGroup) +
+                        m_localRoutes.size() * ribEntry +
+                        m_locRib.size() * (node + sizeof(std::pair<const BgpPrefix, LocRibEntry>)) +
+                        m_ownPrefixes.size() * (node + sizeof(BgpPrefix));
+    for (const auto& peer : m_peers)
+    {
+        bytes += peer.adjRibIn.size() * ribEntry + peer.rxBuffer.capacity() +
+                 peer.damping.size() * (node + sizeof(std::pair<const BgpPrefix, DampingState>)) +
+                 peer.filteredOut.size() * (node + sizeof(BgpPrefix));
+    }
+    bytes += m_reuseQueue.size() * (node + sizeof(std::pair<const Time, std::pair<uint32_t, BgpPrefix>>));
+    for (const auto& group : m_groups)
+    {
+        bytes += group.adjRibOut.size() * ribEntry + group.pendingOut.size() * (node + sizeof(BgpPrefix)) +
+                 group.members.capacity() * sizeof(uint32_t);
+    }
+    return bytes + m_fib.GetLookupMemory() + m_fib.GetIndexMemory();
+}
+
+inline const BgpSpeaker::Statistics&
+BgpSpeaker::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline void
+BgpSpeaker::SetLeakRoutes(bool leak)
+{
+    m_leakRoutes = leak;
+    if (!m_started)
+    {
+        return;
+    }
+    // Re-evaluate exports so that the change takes effect immediately
+    for (uint32_t g = 0; g < m_groups.size(); ++g)
+    {
+        if (!m_groups[g].members.empty() && !m_groups[g].internal)
+        {
+            for (const auto& entry : m_locRib)
+            {
+                UpdateAdjRibOut(g, entry.first);
+            }
+        }
+    }
+}
+
+inline void
+BgpSpeaker::SetImportFilter(ImportFilterCallback filter)
+{
+    m_importFilter = filter;
+}
+
+inline void
+BgpSpeaker::SetIgpCostCallback(IgpCostCallback cost)
+{
+    m_igpCost = cost;
+    m_igpCosts.clear();
+}
+
+inline void
+BgpSpeaker::NotifyIgpChange()
+{
+    ResolveFibNextHops();
+    if (m_igpCost.IsNull())
+    {
+        return;
+    }
+    std::set<Ipv4Address> moved;
+    for (auto& entry : m_igpCosts)
+    {
+        uint32_t cost = m_igpCost(entry.first);
+        if (cost != entry.second)
+        {
+            entry.second = cost;
+            moved.insert(entry.first);
+            m_stats.igpCostChanges++;
+            SetNextHopReachable(entry.first, cost != IGP_UNREACHABLE);
+        }
+    }
+    if (moved.empty())
+    {
+        return;
+    }
+    std::set<BgpPrefix> affected;
+    for (const auto& peer : m_peers)
+    {
+        if (!peer.internal || peer.state != ESTABLISHED)
+        {
+            continue;
+        }
+        for (const auto& entry : peer.adjRibIn)
+        {
+            if (moved.count(entry.second->nextHop))
+            {
+                affected.insert(entry.first);
+            }
+        }
+    }
+    if (m_pic)
+    {
+        // Unreachable next hops already fail over to their backups
+        Simulator::ScheduleNow(&BgpSpeaker::RunDecisions,
+                               this,
+                               std::vector<BgpPrefix>(affected.begin(), affected.end()));
+    }
+    else
+    {
+        RunDecisions(std::vector<BgpPrefix>(affected.begin(), affected.end()));
+    }
+}
+
+// ==============================================
+// Session management
+// ==============================================
+
+inline void
+BgpSpeaker::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    NS_ASSERT(ipv4);
+    m_ipv4 = ipv4;
+    UpdatePeerInterfaces();
+    if (!m_started)
+    {
+        Ptr<Node> node = m_ipv4->GetObject<Node>();
+        Simulator::ScheduleWithContext(node->GetId(), m_startTime, &BgpSpeaker::Start, this);
+    }
+}
+
+inline void
+BgpSpeaker::Start()
+{
+    if (m_started)
+    {
+        return;
+    }
+    m_started = true;
+
+    // Checked here, not per attribute: either threshold may be set first
+    NS_ABORT_MSG_IF(m_damping && m_dampingSuppress <= m_dampingReuse,
+                    "BgpSpeaker: DampingSuppressThreshold (" << m_dampingSuppress
+                                                             << ") must be above DampingReuseThreshold ("
+                                                             << m_dampingReuse << ")");
+    NS_ABORT_MSG_IF(m_damping && !m_dampingHalfLife.IsStrictlyPositive(),
+                    "BgpSpeaker: DampingHalfLife must be positive");
+
+    if (m_routerId == Ipv4Address::GetZero())
+    {
+        for (uint32_t i = 1; i < m_ipv4->GetNInterfaces(); ++i)
+        {
+            if (m_ipv4->GetNAddresses(i) > 0)
+            {
+                m_routerId = m_ipv4->GetAddress(i, 0).GetLocal();
+                break;
+            }
+        }
+    }
+
+    Ptr<Node> node = m_ipv4->GetObject<Node>();
+    m_listenSocket = Socket::CreateSocket(node, TcpSocketFactory::GetTypeId());
+    m_listenSocket->Bind(InetSocketAddress(Ipv4Address::GetAny(), BGP_PORT));
+    m_listenSocket->Listen();
+    m_listenSocket->SetAcceptCallback(MakeCallback(&BgpSpeaker::ConnectionRequest, this),
+                                      MakeCallback(&BgpSpeaker::HandleAccept, this));
+
+    for (const auto& local : m_localRoutes)
+    {
+        RunDecision(local.first);
+    }
+    for (uint32_t i = 0; i < m_peers.size(); ++i)
+    {
+        if (m_peers[i].active)
+        {
+            Connect(i);
+        }
+    }
+}
+
+inline void
+BgpSpeaker::Connect(uint32_t peer)
+{
+    Peer& p = m_peers[peer];
+    if (p.state != IDLE || (p.interface >= 0 && !m_ipv4->IsUp(p.interface)))
+    {
+        return;
+    }
+    Ptr<Socket> socket =
+        Socket::CreateSocket(m_ipv4->GetObject<Node>(), TcpSocketFactory::GetTypeId());
+    socket->Bind(InetSocketAddress(p.localAddress, 0));
+    socket->SetConnectCallback(MakeCallback(&BgpSpeaker::ConnectionSucceeded, this),
+                               MakeCallback(&BgpSpeaker::ConnectionFailed, this));
+    p.socket = socket;
+    p.state = CONNECT;
+    socket->Connect(InetSocketAddress(p.peerAddress, BGP_PORT));
+}
+
+inline void
+BgpSpeaker::ConnectionSucceeded(Ptr<Socket> socket)
+{
+    int32_t peer = FindPeerBySocket(socket);
+    if (peer < 0)
+    {
+        socket->Close();
+        return;
+    }
+    AttachSocket(peer, socket);
+    SendOpen(peer);
+    m_peers[peer].state = OPEN_SENT;
+    RestartHoldTimer(peer);
+}
+
+inline void
+BgpSpeaker::ConnectionFailed(Ptr<Socket> socket)
+{
+    int32_t peer = FindPeerBySocket(socket);
+    if (peer >= 0)
+    {
+        m_peers[peer].socket = nullptr;
+        SessionDown(peer, true);
+    }
+}
+
+inline bool
+BgpSpeaker::ConnectionRequest(Ptr<Socket> socket, const Address& from)
+{
+    int32_t peer = FindPeerByAddress(InetSocketAddress::ConvertFrom(from).GetIpv4());
+    return peer >= 0 && !m_peers[peer].active;
+}
+
+inline void
+BgpSpeaker::HandleAccept(Ptr<Socket> socket, const Address& from)
+{
+    int32_t peer = FindPeerByAddress(InetSocketAddress::ConvertFrom(from).GetIpv4());
+    if (peer < 0)
+    {
+        socket->Close();
+        return;
+    }
+    if (m_peers[peer].state != IDLE)
+    {
+        // The peer reconnected before we noticed the old session was gone
+        SessionDown(peer, false);
+    }
+    AttachSocket(peer, socket);
+    SendOpen(peer);
+    m_peers[peer].state = OPEN_SENT;
+    RestartHoldTimer(peer);
+}
+
+inline void
+BgpSpeaker::AttachSocket(uint32_t peer, Ptr<Socket> socket)
+{
+    Peer& p = m_peers[peer];
+    p.socket = socket;
+    p.rxBuffer.clear();
+    p.txQueue.clear();
+    socket->SetRecvCallback(MakeCallback(&BgpSpeaker::HandleRead, this));
+    socket->SetSendCallback(MakeCallback(&BgpSpeaker::HandleSend, this));
+    socket->SetCloseCallbacks(MakeCallback(&BgpSpeaker::HandlePeerClose, this),
+                              MakeCallback(&BgpSpeaker::HandlePeerClose, this));
+}
+
+inline int32_t
+BgpSpeaker::FindPeerBySocket(Ptr<Socket> socket) const
+{
+    for (uint32_t i = 0; i < m_peers.size(); ++i)
+    {
+        if (m_peers[i].socket == socket)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+inline int32_t
+BgpSpeaker::FindPeerByAddress(Ipv4Address address) const
+{
+    for (uint32_t i = 0; i < m_peers.size(); ++i)
+    {
+        if (m_peers[i].peerAddress == address)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+inline void
+BgpSpeaker::HandleRead(Ptr<Socket> socket)
+{
+    int32_t peer = FindPeerBySocket(socket);
+    if (peer < 0)
+    {
+        return;
+    }
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv()))
+    {
+        uint32_t size = packet->GetSize();
+        if (size == 0)
+        {
+            break;
+        }
+        std::vector<uint8_t>& buf = m_peers[peer].rxBuffer;
+        size_t offset = buf.size();
+        buf.resize(offset + size);
+        packet->CopyData(buf.data() + offset, size);
+    }
+    ProcessBuffer(peer);
+}
+
+inline void
+BgpSpeaker::HandleSend(Ptr<Socket> socket, uint32_t available)
+{
+    int32_t peer = FindPeerBySocket(socket);
+    if (peer >= 0)
+    {
+        FlushTxQueue(peer);
+    }
+}
+
+inline void
+BgpSpeaker::HandlePeerClose(Ptr<Socket> socket)
+{
+    int32_t peer = FindPeerBySocket(socket);
+    if (peer >= 0)
+    {
+        SessionDown(peer, true);
+    }
+}
+
+inline void
+BgpSpeaker::SessionEstablished(uint32_t peer)
+{
+    Peer& p = m_peers[peer];
+    p.state = ESTABLISHED;
+    m_stats.sessionsEstablished++;
+    SetNextHopState(p.peerAddress, true);
+    m_sessionStateTrace(p.peerAddress, true);
+    if (p.holdTime.IsStrictlyPositive())
+    {
+        p.keepaliveTimer.Schedule(m_timerWheel, p.holdTime / 3, &BgpSpeaker::KeepaliveTimerExpired, this, peer);
+    }
+    // Initial table exchange: a new group starts from the Loc-RIB, a peer
+    // joining a running group catches up with what the group advertised
+    UpdateGroup& group = m_groups[p.group];
+    group.members.push_back(peer);
+    p.filteredOut.clear();
+    if (group.members.size() > 1)
+    {
+        SendAdjRibOut(peer);
+        return;
+    }
+    group.adjRibOut.clear();
+    for (const auto& entry : m_locRib)
+    {
+        UpdateAdjRibOut(p.group, entry.first);
+    }
+}
+
+inline void
+BgpSpeaker::SessionDown(uint32_t peer, bool reconnect)
+{
+    Peer& p = m_peers[peer];
+    bool wasEstablished = (p.state == ESTABLISHED);
+    p.keepaliveTimer.Cancel();
+    p.holdTimer.Cancel();
+    p.connectRetryTimer.Cancel();
+    if (p.socket)
+    {
+        Ptr<Socket> socket = p.socket;
+        p.socket = nullptr;
+        socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        socket->SetSendCallback(MakeNullCallback<void, Ptr<Socket>, uint32_t>());
+        socket->SetCloseCallbacks(MakeNullCallback<void, Ptr<Socket>>(),
+                                  MakeNullCallback<void, Ptr<Socket>>());
+        socket->Close();
+    }
+    p.state = IDLE;
+    p.rxBuffer.clear();
+    p.txQueue.clear();
+    p.filteredOut.clear();
+    UpdateGroup& group = m_groups[p.group];
+    group.members.erase(std::remove(group.members.begin(), group.members.end(), peer), group.members.end());
+    if (group.members.empty())
+    {
+        group.adjRibOut.clear();
+        group.pendingOut.clear();
+        group.mraiTimer.Cancel();
+        group.flushEvent.Cancel();
+    }
+
+    if (m_damping && !p.internal)
+    {
+        // Every route of the session is withdrawn, the suppressed ones included
+        std::vector<BgpPrefix> held;
+        for (const auto& entry : p.damping)
+        {
+            if (entry.second.suppressed && !entry.second.route.IsNull())
+            {
+                held.push_back(entry.first);
+            }
+        }
+        for (const auto& prefix : held)
+        {
+            DampRoute(peer, prefix, BgpAttributeHandle());
+        }
+        for (const auto& entry : p.adjRibIn)
+        {
+            DampRoute(peer, entry.first, BgpAttributeHandle());
+        }
+    }
+
+    std::vector<BgpPrefix> affected;
+    affected.reserve(p.adjRibIn.size());
+    for (const auto& entry : p.adjRibIn)
+    {
+        affected.push_back(entry.first);
+    }
+    p.adjRibIn.clear();
+
+    if (wasEstablished)
+    {
+        m_stats.sessionsLost++;
+        m_sessionStateTrace(p.peerAddress, false);
+    }
+    SetNextHopState(p.peerAddress, false);
+    if (m_pic)
+    {
+        // Forwarding already moved to the backups; the Loc-RIB catches up next
+        Simulator::ScheduleNow(&BgpSpeaker::RunDecisions, this, std::move(affected));
+    }
+    else
+    {
+        RunDecisions(std::move(affected));
+    }
+    if (reconnect && p.active)
+    {
+        p.connectRetryTimer =
+            Simulator::Schedule(m_connectRetryTime, &BgpSpeaker::Connect, this, peer);
+    }
+}
+
+inline void
+BgpSpeaker::KeepaliveTimerExpired(uint32_t peer)
+{
+    Peer& p = m_peers[peer];
+    if (p.state != ESTABLISHED)
+    {
+        return;
+    }
+    SendKeepalive(peer);
+    p.keepaliveTimer.Schedule(m_timerWheel, p.holdTime / 3, &BgpSpeaker::KeepaliveTimerExpired, this, peer);
+}
+
+inline void
+BgpSpeaker::HoldTimerExpired(uint32_t peer)
+{
+    SendNotification(peer, 4, 0); // Hold Timer Expired
+    SessionDown(peer, true);
+}
+
+inline void
+BgpSpeaker::RestartHoldTimer(uint32_t peer)
+{
+    Peer& p = m_peers[peer];
+    p.holdTimer.Cancel();
+    if (p.holdTime.IsStrictlyPositive())
+    {
+        p.holdTimer.Schedule(m_timerWheel, p.holdTime, &BgpSpeaker::HoldTimerExpired, this, peer);
+    }
+}
+
+// ==============================================
+// Message reception
+// ==============================================
+
+inline void
+BgpSpeaker::ProcessBuffer(uint32_t peer)
+{
+    size_t offset = 0;
+    while (m_peers[peer].socket)
+    {
+        std::vector<uint8_t>& buf = m_peers[peer].rxBuffer;
+        if (buf.size() - offset < BGP_HEADER_SIZE)
+        {
+            break;
+        }
+        const uint8_t* msg = buf.data() + offset;
+        uint16_t length = ReadU16(msg + 16);
+        if (length < BGP_HEADER_SIZE || length > BGP_MAX_MESSAGE_SIZE)
+        {
+            SendNotification(peer, 1, 2); // Message Header Error, Bad Message Length
+            SessionDown(peer, true);
+            return;
+        }
+        if (buf.size() - offset < length)
+        {
+            break;
+        }
+        uint8_t type = msg[18];
+        const uint8_t* body = msg + BGP_HEADER_SIZE;
+        uint32_t bodySize = length - BGP_HEADER_SIZE;
+        offset += length;
+        switch (type)
+        {
+        case BGP_OPEN:
+            ReceiveOpen(peer, body, bodySize);
+            break;
+        case BGP_UPDATE:
+            ReceiveUpdate(peer, body, bodySize);
+            break;
+        case BGP_NOTIFICATION:
+            SessionDown(peer, true);
+            return;
+        case BGP_KEEPALIVE:
+            ReceiveKeepalive(peer);
+            break;
+        default:
+            SendNotification(peer, 1, 3); // Message Header Error, Bad Message Type
+            SessionDown(peer, true);
+            return;
+        }
+    }
+    if (m_peers[peer].socket)
+    {
+        std::vector<uint8_t>& buf = m_peers[peer].rxBuffer;
+        buf.erase(buf.begin(), buf.begin() + offset);
+    }
+}
+
+inline void
+BgpSpeaker::ReceiveOpen(uint32_t peer, const uint8_t* data, uint32_t size)
+{
+    Peer& p = m_peers[peer];
+    if (size < 10 || data[0] != 4)
+    {
+        SendNotification(peer, 2, 1); // OPEN Message Error, Unsupported Version Number
+        SessionDown(peer, true);
+        return;
+    }
+    uint32_t peerAs = ReadU16(data + 1);
+    uint16_t holdSeconds = ReadU16(data + 3);
+    p.peerRouterId = Ipv4Address(ReadU32(data + 5));
+
+    // Optional parameters: look for the 4-octet AS capability (code 65)
+    uint8_t optLength = data[9];
+    const uint8_t* opt = data + 10;
+    const uint8_t* optEnd = opt + std::min<uint32_t>(optLength, size - 10);
+    while (opt + 2 <= optEnd)
+    {
+        uint8_t paramType = opt[0];
+        uint8_t paramLength = opt[1];
+        const uint8_t* cap = opt + 2;
+        const uint8_t* capEnd = std::min(cap + paramLength, optEnd);
+        while (paramType == 2 && cap + 2 <= capEnd)
+        {
+            if (cap[0] == 65 && cap[1] == 4 && cap + 6 <= capEnd)
+            {
+                peerAs = ReadU32(cap + 2);
+            }
+            cap += 2 + cap[1];
+        }
+        opt += 2 + paramLength;
+    }
+
+    if (peerAs != p.peerAs)
+    {
+        SendNotification(peer, 2, 2); // OPEN Message Error, Bad Peer AS
+        SessionDown(peer, true);
+        return;
+    }
+    p.holdTime = std::min(m_holdTime, Seconds(holdSeconds));
+    SendKeepalive(peer);
+    p.state = OPEN_CONFIRM;
+    RestartHoldTimer(peer);
+}
+
+inline void
+BgpSpeaker::ReceiveKeepalive(uint32_t peer)
+{
+    if (m_peers[peer].state == OPEN_CONFIRM)
+    {
+        SessionEstablished(peer);
+    }
+    RestartHoldTimer(peer);
+}
+
+inline void
+BgpSpeaker::ReceiveUpdate(uint32_t peer, const uint8_t* data, uint32_t size)
+{
+    Peer& p = m_peers[peer];
+    if (p.state != ESTABLISHED)
+    {
+        SendNotification(peer, 5, 0); // Finite State Machine Error
+        SessionDown(peer, true);
+        return;
+    }
+    RestartHoldTimer(peer);
+    m_stats.updatesReceived++;
+
+    std::vector<BgpPrefix> withdrawn;
+    std::vector<BgpPrefix> nlri;
+    BgpPathAttributes attrs;
+    bool ok = size >= 4;
+    uint16_t withdrawnLength = ok ? ReadU16(data) : 0;
+    ok = ok && 2u + withdrawnLength + 2u <= size;
+    ok = ok && ReadPrefixes(data + 2, withdrawnLength, withdrawn);
+    uint16_t attrLength = ok ? ReadU16(data + 2 + withdrawnLength) : 0;
+    uint32_t attrOffset = 4 + withdrawnLength;
+    ok = ok && attrOffset + attrLength <= size;
+    ok = ok && ReadPrefixes(data + attrOffset + attrLength, size - attrOffset - attrLength, nlri);
+    ok = ok && (nlri.empty() || ParseAttributes(data + attrOffset, attrLength, attrs));
+    if (!ok)
+    {
+        SendNotification(peer, 3, 1); // UPDATE Message Error, Malformed Attribute List
+        SessionDown(peer, true);
+        return;
+    }
+
+    bool damping = m_damping && !p.internal;
+    std::vector<BgpPrefix> affected;
+    for (const auto& prefix : withdrawn)
+    {
+        m_stats.withdrawalsReceived++;
+        if (damping)
+        {
+            DampRoute(peer, prefix, BgpAttributeHandle());
+        }
+        if (p.adjRibIn.erase(prefix))
+        {
+            affected.push_back(prefix);
+        }
+    }
+
+    if (!nlri.empty())
+    {
+        bool loop = std::find(attrs.asPath.begin(), attrs.asPath.end(), m_localAs) !=
+                    attrs.asPath.end();
+        if (p.internal)
+        {
+            // Reflected back to its originator or into a cluster it passed through
+            loop = loop || attrs.originatorId == m_routerId ||
+                   std::find(attrs.clusterList.begin(), attrs.clusterList.end(), GetClusterId()) !=
+                       attrs.clusterList.end();
+            if (!m_igpCost.IsNull() && m_igpCosts.find(attrs.nextHop) == m_igpCosts.end())
+            {
+                m_igpCosts[attrs.nextHop] = m_igpCost(attrs.nextHop);
+            }
+        }
+        else
+        {
+            attrs.localPref = 100;
+            attrs.originatorId = Ipv4Address::GetZero();
+            attrs.clusterList.clear();
+        }
+        BgpAttributeHandle handle(attrs);
+        for (const auto& prefix : nlri)
+        {
+            m_stats.prefixesReceived++;
+            bool reject = loop;
+            if (loop)
+            {
+                m_stats.loopRejections++;
+            }
+            else if (!p.internal && !m_importFilter.IsNull() &&
+                     !m_importFilter(p.peerAs, prefix, *handle))
+            {
+                m_stats.importRejections++;
+                m_routeRejectedTrace(prefix.GetAddress(), prefix.length, p.peerAs);
+                reject = true;
+            }
+            if (reject)
+            {
+                // Treat as withdrawn (RFC 4271, section 9.1.2)
+                if (damping)
+                {
+                    DampRoute(peer, prefix, BgpAttributeHandle());
+                }
+                if (p.adjRibIn.erase(prefix))
+                {
+                    affected.push_back(prefix);
+                }
+                continue;
+            }
+            auto it = p.adjRibIn.find(prefix);
+            if (it != p.adjRibIn.end() && it->second == handle)
+            {
+                continue;
+            }
+            if (damping && DampRoute(peer, prefix, handle))
+            {
+                if (it != p.adjRibIn.end())
+                {
+                    p.adjRibIn.erase(it);
+                    affected.push_back(prefix);
+                }
+                continue;
+            }
+            p.adjRibIn[prefix] = handle;
+            affected.push_back(prefix);
+        }
+    }
+
+    for (const auto& prefix : affected)
+    {
+        RunDecision(prefix);
+    }
+}
+
+inline bool
+BgpSpeaker::ParseAttributes(const uint8_t* data, uint32_t size, BgpPathAttributes& attrs) const
+{
+    bool haveNextHop = false;
+    uint32_t pos = 0;
+    while (pos < size)
+    {
+        if (pos + 3 > size)
+        {
+            return false;
+        }
+        uint8_t flags = data[pos];
+        uint8_t type = data[pos + 1];
+        uint32_t length;
+        uint32_t header;
+        if (flags & 0x10)
+        {
+            if (pos + 4 > size)
+            {
+                return false;
+            }
+            length = ReadU16(data + pos + 2);
+            header = 4;
+        }
+        else
+        {
+            length = data[pos + 2];
+            header = 3;
+        }
+        if (pos + header + length > size)
+        {
+            return false;
+        }
+        const uint8_t* value = data + pos + header;
+        switch (type)
+        {
+        case BGP_ATTR_ORIGIN:
+            if (length != 1)
+            {
+                return false;
+            }
+            attrs.origin = value[0];
+            break;
+        case BGP_ATTR_AS_PATH: {
+            uint32_t seg = 0;
+            attrs.asPath.clear();
+            while (seg + 2 <= length)
+            {
+                uint8_t count = value[seg + 1];
+                if (seg + 2 + 4u * count > length)
+                {
+                    return false;
+                }
+                for (uint8_t i = 0; i < count; ++i)
+                {
+                    attrs.asPath.push_back(ReadU32(value + seg + 2 + 4 * i));
+                }
+                seg += 2 + 4 * count;
+            }
+            break;
+        }
+        case BGP_ATTR_NEXT_HOP:
+            if (length != 4)
+            {
+                return false;
+            }
+            attrs.nextHop = Ipv4Address(ReadU32(value));
+            haveNextHop = true;
+            break;
+        case BGP_ATTR_MED:
+            if (length != 4)
+            {
+                return false;
+            }
+            attrs.med = ReadU32(value);
+            break;
+        case BGP_ATTR_LOCAL_PREF:
+            if (length != 4)
+            {
+                return false;
+            }
+            attrs.localPref = ReadU32(value);
+            break;
+        case BGP_ATTR_ORIGINATOR_ID:
+            if (length != 4)
+            {
+                return false;
+            }
+            attrs.originatorId = Ipv4Address(ReadU32(value));
+            break;
+        case BGP_ATTR_CLUSTER_LIST:
+            if (length % 4 != 0)
+            {
+                return false;
+            }
+            attrs.clusterList.clear();
+            for (uint32_t i = 0; i < length; i += 4)
+            {
+                attrs.clusterList.push_back(ReadU32(value + i));
+            }
+            break;
+        default:
+            // Unknown optional attributes are ignored
+            break;
+        }
+        pos += header + length;
+    }
+    return haveNextHop;
+}
+
+// ==============================================
+// Message transmission
+// ==============================================
+
+inline void
+BgpSpeaker::SendOpen(uint32_t peer)
+{
+    std::vector<uint8_t> body;
+    body.push_back(4); // version
+    WriteU16(body, m_localAs > 0xffff ? 23456 : m_localAs); // AS_TRANS for 4-octet ASes
+    WriteU16(body, static_cast<uint16_t>(m_holdTime.GetSeconds()));
+    WriteU32(body, m_routerId.Get());
+    // One capabilities parameter carrying the 4-octet AS capability
+    body.push_back(8); // optional parameters length
+    body.push_back(2); // parameter type: capabilities
+    body.push_back(6);
+    body.push_back(65); // capability code: 4-octet AS
+    body.push_back(4);
+    WriteU32(body, m_localAs);
+    SendMessage(peer, BGP_OPEN, body);
+}
+
+inline void
+BgpSpeaker::SendKeepalive(uint32_t peer)
+{
+    SendMessage(peer, BGP_KEEPALIVE, std::vector<uint8_t>());
+}
+
+inline void
+BgpSpeaker::SendNotification(uint32_t peer, uint8_t code, uint8_t subcode)
+{
+    std::vector<uint8_t> body{code, subcode};
+    SendMessage(peer, BGP_NOTIFICATION, body);
+}
+
+inline void
+BgpSpeaker::EncodeUpdate(bool internal,
+                         const std::vector<BgpPrefix>& withdrawn,
+                         const BgpPathAttributes* attrs,
+                         const std::vector<BgpPrefix>& nlri,
+                         std::vector<Ptr<Packet>>& messages)
+{
+    std::vector<uint8_t> attrBytes;
+    if (attrs && !nlri.empty())
+    {
+        WriteAttribute(attrBytes, 0x40, BGP_ATTR_ORIGIN, std::vector<uint8_t>{attrs->origin});
+        std::vector<uint8_t> path;
+        for (size_t i = 0; i < attrs->asPath.size(); i += 255)
+        {
+            size_t count = std::min<size_t>(255, attrs->asPath.size() - i);
+            path.push_back(2); // AS_SEQUENCE
+            path.push_back(count);
+            for (size_t j = 0; j < count; ++j)
+            {
+                WriteU32(path, attrs->asPath[i + j]);
+            }
+        }
+        WriteAttribute(attrBytes, 0x40, BGP_ATTR_AS_PATH, path);
+        std::vector<uint8_t> value;
+        WriteU32(value, attrs->nextHop.Get());
+        WriteAttribute(attrBytes, 0x40, BGP_ATTR_NEXT_HOP, value);
+        if (attrs->med != 0)
+        {
+            value.clear();
+            WriteU32(value, attrs->med);
+            WriteAttribute(attrBytes, 0x80, BGP_ATTR_MED, value);
+        }
+        if (internal)
+        {
+            value.clear();
+            WriteU32(value, attrs->localPref);
+            WriteAttribute(attrBytes, 0x40, BGP_ATTR_LOCAL_PREF, value);
+            if (attrs->originatorId != Ipv4Address::GetZero())
+            {
+                value.clear();
+                WriteU32(value, attrs->originatorId.Get());
+                WriteAttribute(attrBytes, 0x80, BGP_ATTR_ORIGINATOR_ID, value);
+                value.clear();
+                for (uint32_t cluster : attrs->clusterList)
+                {
+                    WriteU32(value, cluster);
+                }
+                WriteAttribute(attrBytes, 0x80, BGP_ATTR_CLUSTER_LIST, value);
+            }
+        }
+    }
+
+    // Pack as many prefixes as fit into each message (at most 4096 bytes)
+    const uint32_t maxBody = BGP_MAX_MESSAGE_SIZE - BGP_HEADER_SIZE;
+    size_t w = 0;
+    size_t n = 0;
+    while (w < withdrawn.size() || n < nlri.size())
+    {
+        std::vector<uint8_t> withdrawnBytes;
+        while (w < withdrawn.size() && 4 + withdrawnBytes.size() + 5 <= maxBody)
+        {
+            WritePrefix(withdrawnBytes, withdrawn[w++]);
+        }
+        std::vector<uint8_t> body;
+        WriteU16(body, withdrawnBytes.size());
+        body.insert(body.end(), withdrawnBytes.begin(), withdrawnBytes.end());
+        if (w == withdrawn.size() && n < nlri.size() && body.size() + 2 + attrBytes.size() + 5 <= maxBody)
+        {
+            WriteU16(body, attrBytes.size());
+            body.insert(body.end(), attrBytes.begin(), attrBytes.end());
+            while (n < nlri.size() && body.size() + 5 <= maxBody)
+            {
+                WritePrefix(body, nlri[n++]);
+            }
+        }
+        else
+        {
+            WriteU16(body, 0);
+        }
+
+        m_stats.updatesEncoded++;
+        messages.push_back(BuildMessage(BGP_UPDATE, body));
+    }
+}
+
+inline void
+BgpSpeaker::SendUpdates(uint32_t peer,
+                        const std::vector<Ptr<Packet>>& messages,
+                        uint64_t announced,
+                        uint64_t withdrawn)
+{
+    Peer& p = m_peers[peer];
+    if (!p.socket)
+    {
+        return;
+    }
+    for (const auto& message : messages)
+    {
+        m_stats.updatesSent++;
+        m_stats.updateBytesSent += message->GetSize();
+        p.txQueue.push_back(message->Copy()); // shares the encoded bytes
+    }
+    m_stats.prefixesAdvertised += announced;
+    m_stats.prefixesWithdrawn += withdrawn;
+    FlushTxQueue(peer);
+}
+
+inline void
+BgpSpeaker::SendAdjRibOut(uint32_t peer)
+{
+    const UpdateGroup& group = m_groups[m_peers[peer].group];
+    std::map<uint32_t, std::vector<BgpPrefix>> announced;
+    uint64_t nAnnounced = 0;
+    for (const auto& entry : group.adjRibOut)
+    {
+        if (IsFilteredFor(peer, group, entry.first, *entry.second))
+        {
+            m_peers[peer].filteredOut.insert(entry.first);
+            continue;
+        }
+        announced[entry.second.GetIndex()].push_back(entry.first);
+        nAnnounced++;
+    }
+    std::vector<BgpPrefix> none;
+    std::vector<Ptr<Packet>> messages;
+    for (const auto& prefixes : announced)
+    {
+        EncodeUpdate(group.internal, none, &*group.adjRibOut.at(prefixes.second[0]), prefixes.second, messages);
+    }
+    SendUpdates(peer, messages, nAnnounced, 0);
+}
+
+inline void
+BgpSpeaker::SendMessage(uint32_t peer, BgpMessageType type, const std::vector<uint8_t>& body)
+{
+    Peer& p = m_peers[peer];
+    if (!p.socket)
+    {
+        return;
+    }
+    p.txQueue.push_back(BuildMessage(type, body));
+    FlushTxQueue(peer);
+}
+
+inline Ptr<Packet>
+BgpSpeaker::BuildMessage(BgpMessageType type, const std::vector<uint8_t>& body)
+{
+    std::vector<uint8_t> msg(16, 0xff); // marker
+    WriteU16(msg, BGP_HEADER_SIZE + body.size());
+    msg.push_back(type);
+    msg.insert(msg.end(), body.begin(), body.end());
+    return Create<Packet>(msg.data(), msg.size());
+}
+
+inline void
+BgpSpeaker::FlushTxQueue(uint32_t peer)
+{
+    Peer& p = m_peers[peer];
+    size_t sent = 0;
+    while (p.socket && sent < p.txQueue.size() &&
+           p.socket->GetTxAvailable() >= p.txQueue[sent]->GetSize())
+    {
+        if (p.socket->Send(p.txQueue[sent]) < 0)
+        {
+            break;
+        }
+        ++sent;
+    }
+    p.txQueue.erase(p.txQueue.begin(), p.txQueue.begin() + sent);
+}
+
+// ==============================================
+// Decision process and export
+// ==============================================
+
+inline bool
+BgpSpeaker::IsBetter(const BgpPathAttributes& a,
+                     int32_t peerA,
+                     const BgpPathAttributes& b,
+                     int32_t peerB) const
+{
+    // Locally originated routes always win
+    if ((peerA == LOCAL_ORIGIN) != (peerB == LOCAL_ORIGIN))
+    {
+        return peerA == LOCAL_ORIGIN;
+    }
+    if (a.localPref != b.localPref)
+    {
+        return a.localPref > b.localPref;
+    }
+    if (a.asPath.size() != b.asPath.size())
+    {
+        return a.asPath.size() < b.asPath.size();
+    }
+    if (a.origin != b.origin)
+    {
+        return a.origin < b.origin;
+    }
+    // MED is only comparable between paths from the same neighbouring AS
+    if (!a.asPath.empty() && !b.asPath.empty() && a.asPath.front() == b.asPath.front() &&
+        a.med != b.med)
+    {
+        return a.med < b.med;
+    }
+    if (peerA == LOCAL_ORIGIN)
+    {
+        return false;
+    }
+    const Peer& pa = m_peers[peerA];
+    const Peer& pb = m_peers[peerB];
+    if (pa.internal != pb.internal)
+    {
+        return !pa.internal; // eBGP over iBGP
+    }
+    if (pa.internal)
+    {
+        uint32_t costA = GetIgpCost(a.nextHop);
+        uint32_t costB = GetIgpCost(b.nextHop);
+        if (costA != costB)
+        {
+            return costA < costB; // closest exit
+        }
+    }
+    // A reflected route competes with its originator's router id, then by
+    // the shorter CLUSTER_LIST (RFC 4456, section 9)
+    Ipv4Address idA = a.originatorId == Ipv4Address::GetZero() ? pa.peerRouterId : a.originatorId;
+    Ipv4Address idB = b.originatorId == Ipv4Address::GetZero() ? pb.peerRouterId : b.originatorId;
+    if (idA != idB)
+    {
+        return idA.Get() < idB.Get();
+    }
+    if (a.clusterList.size() != b.clusterList.size())
+    {
+        return a.clusterList.size() < b.clusterList.size();
+    }
+    return pa.peerAddress.Get() < pb.peerAddress.Get();
+}
+
+inline bool
+BgpSpeaker::IsMultipath(const BgpPathAttributes& a,
+                        int32_t peerA,
+                        const BgpPathAttributes& best,
+                        int32_t bestPeer) const
+{
+    // Everything IsBetter() looks at before the router id must tie; an eBGP
+    // and an iBGP path never mix, which keeps hop-by-hop forwarding loop-free
+    return peerA != LOCAL_ORIGIN && bestPeer != LOCAL_ORIGIN &&
+           m_peers[peerA].internal == m_peers[bestPeer].internal && a.localPref == best.localPref &&
+           a.asPath == best.asPath && a.origin == best.origin && a.med == best.med &&
+           a.nextHop != best.nextHop &&
+           (!m_peers[peerA].internal || GetIgpCost(a.nextHop) == GetIgpCost(best.nextHop));
+}
+
+inline void
+BgpSpeaker::RunDecision(const BgpPrefix& prefix)
+{
+    m_stats.decisionRuns++;
+
+    const BgpAttributeHandle* best = nullptr;
+    int32_t bestPeer = LOCAL_ORIGIN;
+    auto local = m_localRoutes.find(prefix);
+    if (local != m_localRoutes.end())
+    {
+        best = &local->second;
+    }
+    for (uint32_t i = 0; i < m_peers.size(); ++i)
+    {
+        if (m_peers[i].state != ESTABLISHED)
+        {
+            continue;
+        }
+        auto it = m_peers[i].adjRibIn.find(prefix);
+        if (it == m_peers[i].adjRibIn.end())
+        {
+            continue;
+        }
+        if (!best || IsBetter(*it->second, i, **best, bestPeer))
+        {
+            best = &it->second;
+            bestPeer = i;
+        }
+    }
+
+    // Next hops of the paths that share traffic with the best one
+    std::vector<Ipv4Address> multipath;
+    if (best && m_maxPaths > 1 && bestPeer != LOCAL_ORIGIN)
+    {
+        multipath.push_back((*best)->nextHop);
+        for (uint32_t i = 0; i < m_peers.size() && multipath.size() < m_maxPaths; ++i)
+        {
+            auto it = m_peers[i].adjRibIn.find(prefix);
+            if (m_peers[i].state == ESTABLISHED && it != m_peers[i].adjRibIn.end() &&
+                static_cast<int32_t>(i) != bestPeer && IsMultipath(*it->second, i, **best, bestPeer) &&
+                std::find(multipath.begin(), multipath.end(), it->second->nextHop) == multipath.end())
+            {
+                multipath.push_back(it->second->nextHop);
+            }
+        }
+        if (multipath.size() == 1)
+        {
+            multipath.clear();
+        }
+        std::sort(multipath.begin(), multipath.end());
+    }
+
+    // PIC backup: the best remaining path through a next hop the FIB does not use yet
+    Ipv4Address backup;
+    if (best && m_pic && bestPeer != LOCAL_ORIGIN)
+    {
+        const BgpAttributeHandle* second = nullptr;
+        int32_t secondPeer = LOCAL_ORIGIN;
+        for (uint32_t i = 0; i < m_peers.size(); ++i)
+        {
+            auto it = m_peers[i].adjRibIn.find(prefix);
+            if (m_peers[i].state != ESTABLISHED || it == m_peers[i].adjRibIn.end() ||
+                static_cast<int32_t>(i) == bestPeer || it->second->nextHop == (*best)->nextHop ||
+                std::find(multipath.begin(), multipath.end(), it->second->nextHop) != multipath.end())
+            {
+                continue;
+            }
+            if (!second || IsBetter(*it->second, i, **second, secondPeer))
+            {
+                second = &it->second;
+                secondPeer = i;
+            }
+        }
+        if (second)
+        {
+            backup = (*second)->nextHop;
+        }
+    }
+
+    auto current = m_locRib.find(prefix);
+    if (!best)
+    {
+        if (current == m_locRib.end())
+        {
+            return;
+        }
+        m_locRib.erase(current);
+    }
+    else
+    {
+        if (current != m_locRib.end() && current->second.peer == bestPeer &&
+            current->second.attributes == *best)
+        {
+            if (current->second.multipath != multipath || current->second.backup != backup)
+            {
+                // Same best path, different set to spread over or fall back to: only forwarding changes
+                current->second.multipath = multipath;
+                current->second.backup = backup;
+                UpdateFib(prefix);
+            }
+            return;
+        }
+        LocRibEntry& entry = m_locRib[prefix];
+        entry.attributes = *best;
+        entry.peer = bestPeer;
+        entry.multipath = multipath;
+        entry.backup = backup;
+    }
+
+    UpdateFib(prefix);
+    m_stats.bestPathChanges++;
+    m_stats.lastBestPathChange = Simulator::Now();
+    m_bestPathChangeTrace(prefix.GetAddress(), prefix.length, best != nullptr);
+
+    for (uint32_t g = 0; g < m_groups.size(); ++g)
+    {
+        if (!m_groups[g].members.empty())
+        {
+            UpdateAdjRibOut(g, prefix);
+        }
+    }
+}
+
+inline void
+BgpSpeaker::RunDecisions(std::vector<BgpPrefix> prefixes)
+{
+    for (const auto& prefix : prefixes)
+    {
+        RunDecision(prefix);
+    }
+}
+
+inline bool
+BgpSpeaker::BuildExport(const UpdateGroup& group, const LocRibEntry& entry, BgpPathAttributes& out) const
+{
+    bool leak = m_leakRoutes && !group.internal;
+    if (group.peer >= 0 && entry.peer == group.peer && !leak)
+    {
+        return false; // never back to the peer it came from
+    }
+    bool reflect = false;
+    if (group.internal && entry.peer != LOCAL_ORIGIN && m_peers[entry.peer].internal)
+    {
+        // iBGP full-mesh rule, unless a client is on either end
+        if (!m_peers[entry.peer].reflectorClient && !group.reflectorClient)
+        {
+            return false;
+        }
+        reflect = true;
+    }
+    out = *entry.attributes;
+    bool transparent = m_routeServer && !group.internal && entry.peer != LOCAL_ORIGIN;
+    if (reflect)
+    {
+        if (out.originatorId == Ipv4Address::GetZero())
+        {
+            out.originatorId = m_peers[entry.peer].peerRouterId;
+        }
+        out.clusterList.insert(out.clusterList.begin(), GetClusterId());
+    }
+    else if (!transparent)
+    {
+        out.nextHop = group.localAddress;
+    }
+    if (!group.internal)
+    {
+        out.originatorId = Ipv4Address::GetZero();
+        out.clusterList.clear();
+        if (!leak && group.peer >= 0 &&
+            std::find(out.asPath.begin(), out.asPath.end(), m_peers[group.peer].peerAs) != out.asPath.end())
+        {
+            return false;
+        }
+        out.localPref = 100;
+        if (!transparent)
+        {
+            out.asPath.insert(out.asPath.begin(), m_localAs);
+            if (entry.peer != LOCAL_ORIGIN)
+            {
+                out.med = 0; // MED is not passed on to other ASes
+            }
+        }
+    }
+    return true;
+}
+
+inline bool
+BgpSpeaker::IsFilteredFor(uint32_t member,
+                          const UpdateGroup& group,
+                          const BgpPrefix& prefix,
+                          const BgpPathAttributes& out) const
+{
+    if (m_leakRoutes && !group.internal)
+    {
+        return false;
+    }
+    auto best = m_locRib.find(prefix);
+    if (best != m_locRib.end() && best->second.peer == static_cast<int32_t>(member))
+    {
+        return true; // never back to the peer it came from
+    }
+    return !group.internal &&
+           std::find(out.asPath.begin(), out.asPath.end(), m_peers[member].peerAs) != out.asPath.end();
+}
+
+inline uint32_t
+BgpSpeaker::GetClusterId() const
+{
+    return m_clusterId == Ipv4Address::GetZero() ? m_routerId.Get() : m_clusterId.Get();
+}
+
+inline uint32_t
+BgpSpeaker::GetIgpCost(Ipv4Address nextHop) const
+{
+    auto it = m_igpCosts.find(nextHop);
+    return it == m_igpCosts.end() ? 0 : it->second;
+}
+
+inline bool
+BgpSpeaker::DampRoute(uint32_t peer, const BgpPrefix& prefix, const BgpAttributeHandle& route)
+{
+    Peer& p = m_peers[peer];
+    auto it = p.damping.find(prefix);
+    BgpAttributeHandle previous;
+    auto rib = p.adjRibIn.find(prefix);
+    if (rib != p.adjRibIn.end())
+    {
+        previous = rib->second;
+    }
+    else if (it != p.damping.end())
+    {
+        previous = it->second.route;
+    }
+    double penalty = 0;
+    if (route.IsNull())
+    {
+        penalty = previous.IsNull() ? 0 : DAMPING_WITHDRAWAL_PENALTY;
+    }
+    else if (!previous.IsNull() && previous != route)
+    {
+        penalty = DAMPING_ATTRIBUTE_PENALTY;
+    }
+    if (it == p.damping.end())
+    {
+        if (penalty == 0)
+        {
+            return false; // no flap history
+        }
+        it = p.damping.emplace(prefix, DampingState()).first;
+    }
+
+    DampingState& state = it->second;
+    double ceiling =
+        m_dampingReuse * std::exp2(m_dampingMaxSuppress.GetSeconds() / m_dampingHalfLife.GetSeconds());
+    state.penalty = std::min(DecayPenalty(state) + penalty, ceiling);
+    if (!state.suppressed && state.penalty > m_dampingSuppress)
+    {
+        state.suppressed = true;
+        m_stats.routesSuppressed++;
+        ScheduleReuse(peer, prefix, Simulator::Now() + GetReuseDelay(state.penalty));
+    }
+    if (state.suppressed)
+    {
+        state.route = route;
+        if (!route.IsNull())
+        {
+            m_stats.routesDamped++;
+        }
+        return true;
+    }
+    if (state.penalty < m_dampingReuse / 2)
+    {
+        p.damping.erase(it); // forget the history (RFC 2439)
+    }
+    return false;
+}
+
+inline double
+BgpSpeaker::DecayPenalty(DampingState& state) const
+{
+    Time now = Simulator::Now();
+    state.penalty *= std::exp2(-(now - state.updated).GetSeconds() / m_dampingHalfLife.GetSeconds());
+    state.updated = now;
+    return state.penalty;
+}
+
+inline Time
+BgpSpeaker::GetReuseDelay(double penalty) const
+{
+    return Seconds(m_dampingHalfLife.GetSeconds() * std::log2(penalty / m_dampingReuse));
+}
+
+inline void
+BgpSpeaker::ScheduleReuse(uint32_t peer, const BgpPrefix& prefix, Time at)
+{
+    auto it = m_reuseQueue.emplace(at, std::make_pair(peer, prefix));
+    if (it == m_reuseQueue.begin())
+    {
+        m_reuseEvent.Cancel();
+        m_reuseEvent = Simulator::Schedule(at - Simulator::Now(), &BgpSpeaker::ReuseTimerExpired, this);
+    }
+}
+
+inline void
+BgpSpeaker::ReuseTimerExpired()
+{
+    Time now = Simulator::Now();
+    while (!m_reuseQueue.empty() && m_reuseQueue.begin()->first <= now)
+    {
+        uint32_t peer = m_reuseQueue.begin()->second.first;
+        BgpPrefix prefix = m_reuseQueue.begin()->second.second;
+        m_reuseQueue.erase(m_reuseQueue.begin());
+        Peer& p = m_peers[peer];
+        DampingState& state = p.damping[prefix];
+        Time delay = GetReuseDelay(DecayPenalty(state));
+        if (delay.IsStrictlyPositive())
+        {
+            // Flapped again while suppressed
+            m_reuseQueue.emplace(now + delay, std::make_pair(peer, prefix));
+            continue;
+        }
+        state.suppressed = false;
+        m_stats.routesReused++;
+        if (!state.route.IsNull() && p.state == ESTABLISHED)
+        {
+            p.adjRibIn[prefix] = state.route;
+            RunDecision(prefix);
+        }
+        state.route = BgpAttributeHandle();
+    }
+    if (!m_reuseQueue.empty())
+    {
+        m_reuseEvent =
+            Simulator::Schedule(m_reuseQueue.begin()->first - now, &BgpSpeaker::ReuseTimerExpired, this);
+    }
+}
+
+inline void
+BgpSpeaker::UpdateAdjRibOut(uint32_t group, const BgpPrefix& prefix)
+{
+    UpdateGroup& g = m_groups[group];
+    m_stats.prefixChangesQueued++;
+    if (!g.pendingOut.insert(prefix).second)
+    {
+        m_stats.prefixChangesCoalesced++;
+    }
+    if (g.flushEvent.IsPending())
+    {
+        return;
+    }
+    if (!g.mraiTimer.IsPending())
+    {
+        g.flushEvent = Simulator::ScheduleNow(&BgpSpeaker::FlushAdjRibOut, this, group, false);
+        return;
+    }
+    // MRAI is running: only a withdrawal may go out before it expires
+    BgpPathAttributes out;
+    auto best = m_locRib.find(prefix);
+    if (g.adjRibOut.count(prefix) && (best == m_locRib.end() || !BuildExport(g, best->second, out)))
+    {
+        g.flushEvent = Simulator::ScheduleNow(&BgpSpeaker::FlushAdjRibOut, this, group, true);
+    }
+}
+
+inline void
+BgpSpeaker::FlushAdjRibOut(uint32_t group, bool withdrawalsOnly)
+{
+    UpdateGroup& g = m_groups[group];
+    if (g.members.empty())
+    {
+        g.pendingOut.clear();
+        return;
+    }
+
+    // Bring the Adj-RIB-Out in line with the Loc-RIB; group announcements by attributes
+    std::vector<BgpPrefix> withdrawn;
+    std::map<uint32_t, std::pair<BgpPathAttributes, std::vector<BgpPrefix>>> announced;
+    std::set<BgpPrefix> replaced; ///< announced prefixes the members had an older path for
+    uint64_t nAnnounced = 0;
+    for (auto it = g.pendingOut.begin(); it != g.pendingOut.end();)
+    {
+        const BgpPrefix& prefix = *it;
+        auto best = m_locRib.find(prefix);
+        auto advertised = g.adjRibOut.find(prefix);
+        BgpPathAttributes out;
+        if (best != m_locRib.end() && BuildExport(g, best->second, out))
+        {
+            BgpAttributeHandle handle(out);
+            if (advertised != g.adjRibOut.end() && advertised->second == handle)
+            {
+                m_stats.prefixChangesCoalesced++;
+            }
+            else if (withdrawalsOnly)
+            {
+                ++it; // announcements wait for the MRAI timer
+                continue;
+            }
+            else
+            {
+                auto& attributes = announced[handle.GetIndex()];
+                if (attributes.second.empty())
+                {
+                    attributes.first = out;
+                }
+                attributes.second.push_back(prefix);
+                if (advertised != g.adjRibOut.end())
+                {
+                    replaced.insert(prefix);
+                }
+                g.adjRibOut[prefix] = handle;
+                nAnnounced++;
+            }
+        }
+        else if (advertised != g.adjRibOut.end())
+        {
+            g.adjRibOut.erase(advertised);
+            withdrawn.push_back(prefix);
+        }
+        else
+        {
+            m_stats.prefixChangesCoalesced++;
+        }
+        it = g.pendingOut.erase(it);
+    }
+
+    // Encode once, queue to every member
+    std::vector<BgpPrefix> none;
+    std::vector<Ptr<Packet>> messages;
+    if (!withdrawn.empty())
+    {
+        EncodeUpdate(g.internal, withdrawn, nullptr, none, messages);
+    }
+    for (const auto& attributes : announced)
+    {
+        EncodeUpdate(g.internal, none, &attributes.second.first, attributes.second.second, messages);
+    }
+    for (uint32_t member : g.members)
+    {
+        if (g.peer >= 0)
+        {
+            SendUpdates(member, messages, nAnnounced, withdrawn.size());
+            continue;
+        }
+        // A shared group: leave out what this member must not get
+        std::set<BgpPrefix>& filtered = m_peers[member].filteredOut;
+        bool differs = false;
+        std::vector<BgpPrefix> memberWithdrawn;
+        for (const auto& prefix : withdrawn)
+        {
+            if (filtered.erase(prefix))
+            {
+                differs = true; // never sent to it
+            }
+            else
+            {
+                memberWithdrawn.push_back(prefix);
+            }
+        }
+        std::map<uint32_t, std::vector<BgpPrefix>> memberAnnounced;
+        uint64_t nMemberAnnounced = 0;
+        for (const auto& attributes : announced)
+        {
+            for (const auto& prefix : attributes.second.second)
+            {
+                if (IsFilteredFor(member, g, prefix, attributes.second.first))
+                {
+                    differs = true;
+                    if (filtered.insert(prefix).second && replaced.count(prefix))
+                    {
+                        memberWithdrawn.push_back(prefix); // it holds the older path
+                    }
+                    continue;
+                }
+                filtered.erase(prefix);
+                memberAnnounced[attributes.first].push_back(prefix);
+                nMemberAnnounced++;
+            }
+        }
+        if (!differs)
+        {
+            SendUpdates(member, messages, nAnnounced, withdrawn.size());
+            continue;
+        }
+        std::vector<Ptr<Packet>> memberMessages;
+        if (!memberWithdrawn.empty())
+        {
+            EncodeUpdate(g.internal, memberWithdrawn, nullptr, none, memberMessages);
+        }
+        for (const auto& prefixes : memberAnnounced)
+        {
+            EncodeUpdate(g.internal, none, &announced[prefixes.first].first, prefixes.second, memberMessages);
+        }
+        SendUpdates(member, memberMessages, nMemberAnnounced, memberWithdrawn.size());
+    }
+    if (!announced.empty() && m_mrai.IsStrictlyPositive())
+    {
+        g.mraiTimer = Simulator::Schedule(m_mrai, &BgpSpeaker::MraiTimerExpired, this, group);
+    }
+}
+
+inline void
+BgpSpeaker::MraiTimerExpired(uint32_t group)
+{
+    UpdateGroup& g = m_groups[group];
+    if (!g.pendingOut.empty())
+    {
+        m_stats.mraiFlushes++;
+        g.flushEvent.Cancel();
+        FlushAdjRibOut(group, false);
+    }
+}
+
+// ==============================================
+// Forwarding
+// ==============================================
+
+inline bool
+BgpSpeaker::ResolveNextHop(Ipv4Address nextHop, uint32_t& interface, Ipv4Address& gateway) const
+{
+    // On-link next hop
+    for (uint32_t i = 1; i < m_ipv4->GetNInterfaces(); ++i)
+    {
+        if (!m_ipv4->IsUp(i))
+        {
+            continue;
+        }
+        for (uint32_t j = 0; j < m_ipv4->GetNAddresses(i); ++j)
+        {
+            Ipv4InterfaceAddress ifAddr = m_ipv4->GetAddress(i, j);
+            if (ifAddr.GetMask().IsMatch(ifAddr.GetLocal(), nextHop))
+            {
+                interface = i;
+                gateway = nextHop;
+                return true;
+            }
+        }
+    }
+
+    // Recursive resolution through the other protocols of the list (the IGP)
+    Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(m_ipv4->GetRoutingProtocol());
+    if (!list)
+    {
+        return false;
+    }
+    Ipv4Header header;
+    header.SetDestination(nextHop);
+    for (uint32_t i = 0; i < list->GetNRoutingProtocols(); ++i)
+    {
+        int16_t priority;
+        Ptr<Ipv4RoutingProtocol> proto = list->GetRoutingProtocol(i, priority);
+        if (PeekPointer(proto) == this)
+        {
+            continue;
+        }
+        Socket::SocketErrno err;
+        Ptr<Ipv4Route> route = proto->RouteOutput(nullptr, header, nullptr, err);
+        if (route)
+        {
+            interface = m_ipv4->GetInterfaceForDevice(route->GetOutputDevice());
+            gateway = route->GetGateway() == Ipv4Address::GetZero() ? nextHop : route->GetGateway();
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool
+BgpSpeaker::IsOwnAddressSpace(const BgpPrefix& prefix) const
+{
+    for (const BgpPrefix& own : m_ownPrefixes)
+    {
+        if (own.length < prefix.length && BgpPrefix(prefix.address, own.length).address == own.address)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint32_t
+BgpSpeaker::GetFibNextHop(Ipv4Address address)
+{
+    auto it = m_fibNextHopIndex.find(address);
+    if (it == m_fibNextHopIndex.end())
+    {
+        it = m_fibNextHopIndex.emplace(address, m_fibNextHopTable.size()).first;
+        FibNextHop entry;
+        entry.address = address;
+        entry.reachable = GetIgpCost(address) != IGP_UNREACHABLE;
+        ResolveFibNextHop(entry);
+        m_fibNextHopTable.push_back(entry);
+    }
+    return it->second;
+}
+
+inline void
+BgpSpeaker::ResolveFibNextHop(FibNextHop& entry) const
+{
+    uint32_t interface;
+    entry.resolved = ResolveNextHop(entry.address, interface, entry.gateway);
+    if (entry.resolved)
+    {
+        entry.device = m_ipv4->GetNetDevice(interface);
+        entry.source = m_ipv4->GetAddress(interface, 0).GetLocal();
+    }
+}
+
+inline void
+BgpSpeaker::ResolveFibNextHops()
+{
+    m_resolveEvent.Cancel();
+    for (auto& entry : m_fibNextHopTable)
+    {
+        ResolveFibNextHop(entry);
+    }
+}
+
+inline void
+BgpSpeaker::ScheduleResolveFibNextHops()
+{
+    // Ipv4ListRouting notifies the protocols one after the other: an IGP
+    // after this one in the list has not seen the change yet
+    if (!m_resolveEvent.IsPending() && !m_fibNextHopTable.empty())
+    {
+        m_resolveEvent = Simulator::ScheduleNow(&BgpSpeaker::ResolveFibNextHops, this);
+    }
+}
+
+inline void
+BgpSpeaker::SetNextHopState(Ipv4Address address, bool up)
+{
+    // One write for every prefix and group behind this next hop
+    auto it = m_fibNextHopIndex.find(address);
+    if (it == m_fibNextHopIndex.end() || m_fibNextHopTable[it->second].up == up)
+    {
+        return;
+    }
+    m_fibNextHopTable[it->second].up = up;
+    m_stats.nextHopsDown += up ? 0 : 1;
+}
+
+inline void
+BgpSpeaker::SetNextHopReachable(Ipv4Address address, bool reachable)
+{
+    auto it = m_fibNextHopIndex.find(address);
+    if (it == m_fibNextHopIndex.end() || m_fibNextHopTable[it->second].reachable == reachable)
+    {
+        return;
+    }
+    m_fibNextHopTable[it->second].reachable = reachable;
+    m_stats.nextHopsDown += reachable ? 0 : 1;
+}
+
+inline void
+BgpSpeaker::UpdateFib(const BgpPrefix& prefix)
+{
+    if (m_routeServer)
+    {
+        return; // not in the forwarding path of the routes it serves
+    }
+    m_stats.fibUpdates++;
+    auto it = m_locRib.find(prefix);
+    // Originated by our AS, here or by an iBGP peer; AddRoute() injects other ASes' paths too
+    bool own = it != m_locRib.end() && it->second.attributes->asPath.empty();
+    if (own != (m_ownPrefixes.count(prefix) > 0))
+    {
+        if (own)
+        {
+            m_ownPrefixes.insert(prefix);
+        }
+        else
+        {
+            m_ownPrefixes.erase(prefix);
+        }
+        // The more specific routes inside it move to the IGP or back
+        uint32_t last = prefix.length == 0 ? 0xffffffffu : prefix.address | ~(0xffffffffu << (32 - prefix.length));
+        for (auto covered = m_locRib.upper_bound(prefix);
+             covered != m_locRib.end() && covered->first.address <= last;
+             ++covered)
+        {
+            UpdateFib(covered->first);
+        }
+    }
+    if (it == m_locRib.end())
+    {
+        m_fib.Remove(prefix.address, prefix.length);
+        return;
+    }
+    if (own || it->second.peer == LOCAL_ORIGIN || IsOwnAddressSpace(prefix))
+    {
+        m_fib.Insert(prefix.address, prefix.length, FIB_IGP);
+        return;
+    }
+    // Few distinct groups exist, so they are interned and never released
+    FibGroup group;
+    if (it->second.multipath.empty())
+    {
+        group.nextHops.push_back(GetFibNextHop(it->second.attributes->nextHop));
+    }
+    for (Ipv4Address nextHop : it->second.multipath)
+    {
+        group.nextHops.push_back(GetFibNextHop(nextHop));
+    }
+    if (it->second.backup != Ipv4Address::GetZero())
+    {
+        group.backup = GetFibNextHop(it->second.backup);
+    }
+    auto index = m_fibGroupIndex.find(group);
+    if (index == m_fibGroupIndex.end())
+    {
+        index = m_fibGroupIndex.emplace(group, m_fibGroups.size()).first;
+        m_fibGroups.push_back(group);
+    }
+    m_fib.Insert(prefix.address, prefix.length, index->second);
+}
+
+inline Ptr<Ipv4Route>
+BgpSpeaker::Lookup(const Ipv4Header& header, Ptr<const Packet> packet, Ptr<NetDevice> oif) const
+{
+    Ipv4Address destination = header.GetDestination();
+    uint32_t index = m_fib.Lookup(destination.Get());
+    if (index == LpmTrie::NO_ROUTE || index == FIB_IGP)
+    {
+        return nullptr; // unknown, or our own AS's address space: leave it to the IGP
+    }
+    // One next hop per flow; if it is dead or its IGP route is gone, fall
+    // back to the next one, and to the group's backup after the last
+    const FibGroup& group = m_fibGroups[index];
+    uint32_t n = group.nextHops.size();
+    uint32_t first = n == 1 ? 0 : FlowHash::Select(FlowHash::Hash(header, packet, m_routerId.Get()), n);
+    const FibNextHop* nextHop = nullptr;
+    for (uint32_t i = 0; i <= n && !nextHop; ++i)
+    {
+        uint32_t id = i < n ? group.nextHops[(first + i) % n] : group.backup;
+        if (id != NO_NEXT_HOP && m_fibNextHopTable[id].up && m_fibNextHopTable[id].reachable &&
+            m_fibNextHopTable[id].resolved)
+        {
+            nextHop = &m_fibNextHopTable[id];
+        }
+    }
+    if (!nextHop || (oif && oif != nextHop->device))
+    {
+        return nullptr;
+    }
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetGateway(nextHop->gateway);
+    route->SetOutputDevice(nextHop->device);
+    route->SetSource(nextHop->source);
+    return route;
+}
+
+inline Ptr<Ipv4Route>
+BgpSpeaker::RouteOutput(Ptr<Packet> p,
+                        const Ipv4Header& header,
+                        Ptr<NetDevice> oif,
+                        Socket::SocketErrno& sockerr)
+{
+    Ptr<Ipv4Route> route = Lookup(header, nullptr, oif); // ports are not in p yet
+    sockerr = route ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+    return route;
+}
+
+inline bool
+BgpSpeaker::RouteInput(Ptr<const Packet> p,
+                       const Ipv4Header& header,
+                       Ptr<const NetDevice> idev,
+                       const UnicastForwardCallback& ucb,
+                       const MulticastForwardCallback& mcb,
+                       const LocalDeliverCallback& lcb,
+                       const ErrorCallback& ecb)
+{
+    NS_ASSERT(m_ipv4->GetInterfaceForDevice(idev) >= 0);
+    uint32_t iif = m_ipv4->GetInterfaceForDevice(idev);
+
+    if (header.GetDestination().IsMulticast())
+    {
+        return false;
+    }
+    if (m_ipv4->IsDestinationAddress(header.GetDestination(), iif))
+    {
+        if (!lcb.IsNull())
+        {
+            lcb(p, header, iif);
+            return true;
+        }
+        return false;
+    }
+    if (!m_ipv4->IsForwarding(iif))
+    {
+        ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+        return true;
+    }
+    Ptr<Ipv4Route> route = Lookup(header, p, nullptr);
+    if (route)
+    {
+        ucb(route, p, header);
+        return true;
+    }
+    return false;
+}
+
+inline void
+BgpSpeaker::UpdatePeerInterfaces()
+{
+    if (!m_ipv4)
+    {
+        return;
+    }
+    for (auto& peer : m_peers)
+    {
+        peer.interface = m_ipv4->GetInterfaceForAddress(peer.localAddress);
+    }
+}
+
+inline void
+BgpSpeaker::NotifyInterfaceUp(uint32_t interface)
+{
+    UpdatePeerInterfaces();
+    ScheduleResolveFibNextHops();
+    if (!m_started)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < m_peers.size(); ++i)
+    {
+        if (m_peers[i].interface == static_cast<int32_t>(interface) && m_peers[i].active &&
+            m_peers[i].state == IDLE)
+        {
+            m_peers[i].connectRetryTimer.Cancel();
+            Connect(i);
+        }
+    }
+}
+
+inline void
+BgpSpeaker::NotifyInterfaceDown(uint32_t interface)
+{
+    ScheduleResolveFibNextHops();
+    if (!m_started)
+    {
+        return;
+    }
+    // Fast external fallover: drop sessions sourced from the failed interface
+    for (uint32_t i = 0; i < m_peers.size(); ++i)
+    {
+        if (m_peers[i].interface == static_cast<int32_t>(interface) && m_peers[i].state != IDLE)
+        {
+            SessionDown(i, false);
+        }
+    }
+}
+
+inline void
+BgpSpeaker::NotifyPeerDown(Ipv4Address peerAddress)
+{
+    for (uint32_t i = 0; i < m_peers.size(); ++i)
+    {
+        if (m_peers[i].peerAddress == peerAddress && m_peers[i].state != IDLE)
+        {
+            SessionDown(i, true);
+        }
+    }
+}
+
+inline void
+BgpSpeaker::SetTimerWheel(TimerWheel* wheel)
+{
+    m_timerWheel = wheel;
+}
+
+inline void
+BgpSpeaker::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    UpdatePeerInterfaces();
+    ScheduleResolveFibNextHops();
+}
+
+inline void
+BgpSpeaker::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    UpdatePeerInterfaces();
+    ScheduleResolveFibNextHops();
+}
+
+inline void
+BgpSpeaker::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Simulator::Now().As(unit)
+        << ", BGP table (AS" << m_localAs << ", router-id " << m_routerId << ")\n";
+    *os << "   Network            Next Hop         Metric LocPrf Path\n";
+    for (const auto& entry : m_locRib)
+    {
+        std::ostringstream network;
+        network << entry.first;
+        const BgpPathAttributes& a = *entry.second.attributes;
+        *os << " * " << std::left << std::setw(18) << network.str() << " " << std::setw(16)
+            << (entry.second.peer == LOCAL_ORIGIN ? Ipv4Address::GetZero() : a.nextHop) << " "
+            << std::setw(6) << a.med << " " << std::setw(6) << a.localPref << " ";
+        for (uint32_t as : a.asPath)
+        {
+            *os << as << " ";
+        }
+        *os << (a.origin == 0 ? "i" : (a.origin == 1 ? "e" : "?")) << "\n";
+        for (Ipv4Address nextHop : entry.second.multipath)
+        {
+            if (nextHop != a.nextHop)
+            {
+                *os << " = " << std::setw(18) << "" << " " << nextHop << "\n";
+            }
+        }
+        if (entry.second.backup != Ipv4Address::GetZero())
+        {
+            *os << " b " << std::setw(18) << "" << " " << entry.second.backup << "\n";
+        }
+    }
+    *os << std::right << "\n";
+}
+
+// ==============================================
+// Wire format helpers
+// ==============================================
+
+inline void
+BgpSpeaker::WriteU16(std::vector<uint8_t>& buf, uint16_t v)
+{
+    buf.push_back(v >> 8);
+    buf.push_back(v & 0xff);
+}
+
+inline void
+BgpSpeaker::WriteU32(std::vector<uint8_t>& buf, uint32_t v)
+{
+    buf.push_back(v >> 24);
+    buf.push_back((v >> 16) & 0xff);
+    buf.push_back((v >> 8) & 0xff);
+    buf.push_back(v & 0xff);
+}
+
+inline uint16_t
+BgpSpeaker::ReadU16(const uint8_t* p)
+{
+    return (static_cast<uint16_t>(p[0]) << 8) | p[1];
+}
+
+inline uint32_t
+BgpSpeaker::ReadU32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void
+BgpSpeaker::WritePrefix(std::vector<uint8_t>& buf, const BgpPrefix& prefix)
+{
+    buf.push_back(prefix.length);
+    for (uint32_t i = 0; i < (prefix.length + 7u) / 8; ++i)
+    {
+        buf.push_back((prefix.address >> (24 - 8 * i)) & 0xff);
+    }
+}
+
+inline bool
+BgpSpeaker::ReadPrefixes(const uint8_t* data, uint32_t size, std::vector<BgpPrefix>& out)
+{
+    uint32_t pos = 0;
+    while (pos < size)
+    {
+        uint8_t length = data[pos];
+        uint32_t bytes = (length + 7u) / 8;
+        if (length > 32 || pos + 1 + bytes > size)
+        {
+            return false;
+        }
+        uint32_t addr = 0;
+        for (uint32_t i = 0; i < bytes; ++i)
+        {
+            addr |= static_cast<uint32_t>(data[pos + 1 + i]) << (24 - 8 * i);
+        }
+        out.emplace_back(addr, length);
+        pos += 1 + bytes;
+    }
+    return true;
+}
+
+inline void
+BgpSpeaker::WriteAttribute(std::vector<uint8_t>& buf,
+                           uint8_t flags,
+                           uint8_t type,
+                           const std::vector<uint8_t>& value)
+{
+    if (value.size() > 255)
+    {
+        buf.push_back(flags | 0x10); // extended length
+        buf.push_back(type);
+        WriteU16(buf, value.size());
+    }
+    else
+    {
+        buf.push_back(flags);
+        buf.push_back(type);
+        buf.push_back(value.size());
+    }
+    buf.insert(buf.end(), value.begin(), value.end());
+}
+
+/**
+ * Installs BgpSpeakers into the Ipv4ListRouting of existing nodes and wires
+ * up sessions between them.
+ *
+ * Under MPI (wan-mpi.h) only the nodes of the local rank get a running
+ * speaker. The others get an inert one that is configured like the real
+ * one but never attached to the node, so scripts can configure every
+ * speaker on every rank; its statistics stay zero and add up correctly
+ * with WanMpi::Sum().
+ */
+class BgpHelper
+{
+  public:
+    BgpHelper()
+        : m_priority(-5),
+          m_timerWheel(nullptr)
+    {
+    }
+
+    /// List routing priority of the speaker (static routing is 0, global routing -10)
+    void SetPriority(int16_t priority)
+    {
+        m_priority = priority;
+    }
+
+    /// Set an attribute on every speaker created by Install()
+    void SetAttribute(std::string name, const AttributeValue& value)
+    {
+        m_attributes.emplace_back(name, value.Copy());
+    }
+
+    /// Timer wheel of every speaker created by Install() (see BgpSpeaker::SetTimerWheel())
+    void SetTimerWheel(TimerWheel* wheel)
+    {
+        m_timerWheel = wheel;
+    }
+
+    Ptr<BgpSpeaker> Install(Ptr<Node> node, uint32_t localAs) const
+    {
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+        NS_ABORT_MSG_UNLESS(list, "BgpHelper needs the default Ipv4ListRouting on the node");
+        Ptr<BgpSpeaker> speaker = CreateObject<BgpSpeaker>();
+        speaker->SetAttribute("LocalAs", UintegerValue(localAs));
+        for (const auto& attribute : m_attributes)
+        {
+            speaker->SetAttribute(attribute.first, *attribute.second);
+        }
+        speaker->SetTimerWheel(m_timerWheel);
+        if (WanMpi::IsLocal(node))
+        {
+            list->AddRoutingProtocol(speaker, m_priority);
+        }
+        return speaker;
+    }
+
+    /// Configure a session between two speakers using the given local addresses
+    static void Peer(Ptr<BgpSpeaker> a, Ipv4Address aAddress, Ptr<BgpSpeaker> b, Ipv4Address bAddress)
+    {
+        a->AddPeer(aAddress, bAddress, b->GetLocalAs());
+        b->AddPeer(bAddress, aAddress, a->GetLocalAs());
+    }
+
+    /// Configure an iBGP session on which client is a route reflector client of reflector
+    static void ReflectorClient(Ptr<BgpSpeaker> reflector,
+                                Ipv4Address reflectorAddress,
+                                Ptr<BgpSpeaker> client,
+                                Ipv4Address clientAddress)
+    {
+        reflector->AddPeer(reflectorAddress, clientAddress, client->GetLocalAs(), true);
+        client->AddPeer(clientAddress, reflectorAddress, reflector->GetLocalAs());
+    }
+
+  private:
+    int16_t m_priority;
+    std::vector<std::pair<std::string, Ptr<AttributeValue>>> m_attributes;
+    TimerWheel* m_timerWheel;
+};
+
+} // namespace ns3
+
+#endif /* WAN_BGP_SPEAKER_H */
@@ -0,0 +1,723 @@
+/*
+ * Loop-free alternate fast reroute for the WAN exercises
+ *
+ * When an interface goes down, Ipv4StaticRouting drops every route through
+ * it and traffic only survives where a backup route was written by hand
+ * (the metric-10 routes of exercise02); dynamic routing has to recompute
+ * before it forwards again. Fast reroute computes a repair path for every
+ * prefix ahead of time, while the network is healthy, and switches to it
+ * the moment the primary interface goes down.
+ *
+ * FastRerouteHelper::Install() is called once the routes are installed. It
+ * builds the graph of the nodes from their interfaces and metrics (like
+ * IncrementalSpfRouting, wan-incremental-spf.h), computes the distances
+ * between all nodes, and for every prefix of every node picks a loop-free
+ * alternate (RFC 5286): a neighbour N, reached over another interface,
+ * with
+ *
+ *     dist(N, P) < dist(N, S) + dist(S, P)
+ *
+ * for the protecting node S and prefix P, so N's own shortest path to P
+ * does not come back through S. The inequality is strict, so a neighbour
+ * that could break a tie towards S is never used. Alternates that also
+ * avoid the primary next hop E (dist(N, P) < dist(N, E) + dist(E, P)) are
+ * preferred, then the shortest alternate path.
+ *
+ * Each node gets an Ipv4FastReroute in its Ipv4ListRouting, in front of
+ * static routing. It holds every prefix of the node in an LpmTrie (wan-lpm-fib.h)
+ * with its primary interface and alternate, and one "repairing" flag
+ * per interface. NotifyInterfaceDown() only sets that flag: every prefix
+ * on the interface switches to its alternate at once, with no route
+ * recomputed, removed or added. While the primary interface is up the
+ * protocol returns no route, so forwarding stays with static routing.
+ *
+ * Static routing deletes the routes of an interface that goes down and does
+ * not bring them back with it. NotifyInterfaceUp() therefore writes the
+ * recorded primary routes of the interface back into the node's static
+ * routing (those not already there) before it stops repairing, so a
+ * down/up history leaves every prefix with its route.
+ *
+ * Primaries are read from the node's Ipv4StaticRouting or
+ * Ipv4IndexedStaticRouting (lowest metric per prefix, the route added
+ * last on a tie, as both select). Only prefixes of networks attached to
+ * the nodes can be protected: for any other prefix (a default route, an
+ * aggregate) the distance from a neighbour is unknown.
+ *
+ * Usage: copy this header, wan-incremental-spf.h, wan-indexed-static-routing.h
+ * and wan-lpm-fib.h next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_FAST_REROUTE_H
+#define WAN_FAST_REROUTE_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "wan-incremental-spf.h"
+#include "wan-indexed-static-routing.h"
+#include "wan-lpm-fib.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Per-node repair FIB: forwards the prefixes of a failed interface over
+ * their precomputed alternates and defers everything else.
+ */
+class Ipv4FastReroute : public Ipv4RoutingProtocol
+{
+  public:
+    /// Alternate interface of a prefix without alternate
+    static constexpr uint32_t NO_ALTERNATE = 0xffffffff;
+
+    struct Statistics
+    {
+        uint32_t prefixes{0};       ///< prefixes of the node
+        uint32_t protectedPrefixes{0};
+        uint32_t nodeProtecting{0}; ///< ...of which the alternate also avoids the next hop
+        uint64_t repairs{0};        ///< interface-down events that switched prefixes
+        uint64_t restored{0};       ///< primary routes written back on interface up
+        uint64_t rerouted{0};       ///< packets forwarded over an alternate
+    };
+
+    static TypeId GetTypeId();
+
+    Ipv4FastReroute();
+    ~Ipv4FastReroute() override;
+
+    /**
+     * Add a prefix of the node and its alternate.
+     * \param primaryGateway next hop of the route in use (0.0.0.0 for a connected route)
+     * \param primaryInterface interface of the route in use
+     * \param primaryMetric metric of the route in use
+     * \param alternateGateway the alternate neighbour's address
+     * \param alternateInterface interface to the neighbour, NO_ALTERNATE if unprotected
+     * \param nodeProtecting the alternate avoids the primary next hop
+     */
+    void AddPrefix(Ipv4Address network,
+                   Ipv4Mask networkMask,
+                   Ipv4Address primaryGateway,
+                   uint32_t primaryInterface,
+                   uint32_t primaryMetric,
+                   Ipv4Address alternateGateway,
+                   uint32_t alternateInterface,
+                   bool nodeProtecting);
+
+    /// Forget every prefix (before they are computed again)
+    void Clear();
+
+    /// True while the prefixes of the interface are on their alternates
+    bool IsRepairing(uint32_t interface) const;
+
+    /// Number of protected prefixes whose primary is the interface
+    uint32_t GetNProtected(uint32_t interface) const;
+
+    const Statistics& GetStatistics() const;
+
+    /**
+     * TracedCallback signature for repairs.
+     * \param interface the interface that went down or came back up
+     * \param prefixes protected prefixes switched to or back from their alternates
+     * \param down true when the interface went down
+     */
+    typedef void (*RerouteTracedCallback)(uint32_t interface, uint32_t prefixes, bool down);
+
+    // Inherited from Ipv4RoutingProtocol
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    struct Entry
+    {
+        Ipv4Address network;
+        Ipv4Mask mask;
+        Ipv4Address primaryGateway;
+        uint32_t primaryInterface;
+        uint32_t primaryMetric;
+        Ipv4Address alternateGateway;
+        uint32_t alternateInterface;
+    };
+
+    /// Grow the per-interface state to cover the interface
+    void Track(uint32_t interface);
+
+    /// Add the interface's primaries that are missing from routing; returns the count
+    template <class Routing>
+    uint32_t RestorePrimaries(Ptr<Routing> routing, uint32_t interface);
+    Ptr<Ipv4Route> Lookup(Ipv4Address destination, Ptr<NetDevice> oif) const;
+
+    Ptr<Ipv4> m_ipv4;
+    LpmTrie m_trie;                   ///< prefix -> index into m_entries
+    std::vector<Entry> m_entries;
+    std::vector<uint8_t> m_repairing; ///< per interface
+    std::vector<uint32_t> m_protected; ///< per interface: protected prefixes using it as primary
+    Statistics m_stats;
+    TracedCallback<uint32_t, uint32_t, bool> m_rerouteTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(Ipv4FastReroute);
+
+inline TypeId
+Ipv4FastReroute::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::Ipv4FastReroute")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<Ipv4FastReroute>()
+                            .AddTraceSource("Reroute",
+                                            "An interface went down or came back up and its prefixes switched",
+                                            MakeTraceSourceAccessor(&Ipv4FastReroute::m_rerouteTrace),
+                                            "ns3::Ipv4FastReroute::RerouteTracedCallback");
+    return tid;
+}
+
+inline Ipv4FastReroute::Ipv4FastReroute()
+{
+}
+
+inline Ipv4FastReroute::~Ipv4FastReroute()
+{
+}
+
+inline void
+Ipv4FastReroute::DoDispose()
+{
+    Clear();
+    m_ipv4 = nullptr;
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+inline void
+Ipv4FastReroute::Track(uint32_t interface)
+{
+    while (m_repairing.size() <= interface)
+    {
+        uint32_t next = m_repairing.size();
+        m_repairing.push_back(m_ipv4 && next < m_ipv4->GetNInterfaces() && !m_ipv4->IsUp(next));
+        m_protected.push_back(0);
+    }
+}
+
+inline void
+Ipv4FastReroute::AddPrefix(Ipv4Address network,
+                           Ipv4Mask networkMask,
+                           Ipv4Address primaryGateway,
+                           uint32_t primaryInterface,
+                           uint32_t primaryMetric,
+                           Ipv4Address alternateGateway,
+                           uint32_t alternateInterface,
+                           bool nodeProtecting)
+{
+    uint32_t index;
+    uint8_t length = networkMask.GetPrefixLength();
+    NS_ASSERT_MSG(!m_trie.Find(network.Get(), length, index), "Ipv4FastReroute: prefix added twice");
+    m_trie.Insert(network.Get(), length, m_entries.size());
+    m_entries.push_back(
+        {network, networkMask, primaryGateway, primaryInterface, primaryMetric, alternateGateway, alternateInterface});
+    Track(primaryInterface);
+    m_stats.prefixes++;
+    if (alternateInterface != NO_ALTERNATE)
+    {
+        m_protected[primaryInterface]++;
+        m_stats.protectedPrefixes++;
+        m_stats.nodeProtecting += nodeProtecting;
+    }
+}
+
+inline void
+Ipv4FastReroute::Clear()
+{
+    m_trie.Clear();
+    m_entries.clear();
+    std::fill(m_protected.begin(), m_protected.end(), 0);
+    m_stats.prefixes = 0;
+    m_stats.protectedPrefixes = 0;
+    m_stats.nodeProtecting = 0;
+}
+
+inline bool
+Ipv4FastReroute::IsRepairing(uint32_t interface) const
+{
+    return interface < m_repairing.size() && m_repairing[interface];
+}
+
+inline uint32_t
+Ipv4FastReroute::GetNProtected(uint32_t interface) const
+{
+    return interface < m_protected.size() ? m_protected[interface] : 0;
+}
+
+inline const Ipv4FastReroute::Statistics&
+Ipv4FastReroute::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline Ptr<Ipv4Route>
+Ipv4FastReroute::Lookup(Ipv4Address destination, Ptr<NetDevice> oif) const
+{
+    uint32_t index = m_trie.Lookup(destination.Get());
+    if (index == LpmTrie::NO_ROUTE)
+    {
+        return nullptr;
+    }
+    const Entry& entry = m_entries[index];
+    if (entry.alternateInterface == NO_ALTERNATE || !IsRepairing(entry.primaryInterface) ||
+        !m_ipv4->IsUp(entry.alternateInterface))
+    {
+        return nullptr;
+    }
+    Ptr<NetDevice> device = m_ipv4->GetNetDevice(entry.alternateInterface);
+    if (oif && oif != device)
+    {
+        return nullptr;
+    }
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetGateway(entry.alternateGateway);
+    route->SetOutputDevice(device);
+    route->SetSource(m_ipv4->SourceAddressSelection(entry.alternateInterface, destination));
+    return route;
+}
+
+inline Ptr<Ipv4Route>
+Ipv4FastReroute::RouteOutput(Ptr<Packet> p,
+                             const Ipv4Header& header,
+                             Ptr<NetDevice> oif,
+                             Socket::SocketErrno& sockerr)
+{
+    Ptr<Ipv4Route> route;
+    if (!header.GetDestination().IsMulticast())
+    {
+        route = Lookup(header.GetDestination(), oif);
+    }
+    sockerr = route ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+    m_stats.rerouted += bool(route);
+    return route;
+}
+
+inline bool
+Ipv4FastReroute::RouteInput(Ptr<const Packet> p,
+                            const Ipv4Header& header,
+                            Ptr<const NetDevice> idev,
+                            const UnicastForwardCallback& ucb,
+                            const MulticastForwardCallback& mcb,
+                            const LocalDeliverCallback& lcb,
+                            const ErrorCallback& ecb)
+{
+    NS_ASSERT(m_ipv4->GetInterfaceForDevice(idev) >= 0);
+    uint32_t iif = m_ipv4->GetInterfaceForDevice(idev);
+
+    // Local delivery and errors are left to the protocols behind
+    if (header.GetDestination().IsMulticast() || m_ipv4->IsDestinationAddress(header.GetDestination(), iif) ||
+        !m_ipv4->IsForwarding(iif))
+    {
+        return false;
+    }
+    Ptr<Ipv4Route> route = Lookup(header.GetDestination(), nullptr);
+    if (route)
+    {
+        m_stats.rerouted++;
+        ucb(route, p, header);
+        return true;
+    }
+    return false;
+}
+
+template <class Routing>
+uint32_t
+Ipv4FastReroute::RestorePrimaries(Ptr<Routing> routing, uint32_t interface)
+{
+    std::set<std::pair<uint32_t, uint32_t>> present; ///< (network, mask) routed via the interface
+    for (uint32_t i = 0; i < routing->GetNRoutes(); ++i)
+    {
+        Ipv4RoutingTableEntry route = routing->GetRoute(i);
+        if (route.GetInterface() == interface)
+        {
+            present.emplace(route.GetDestNetwork().Get(), route.GetDestNetworkMask().Get());
+        }
+    }
+    uint32_t restored = 0;
+    for (const Entry& entry : m_entries)
+    {
+        // Connected routes come back with the interface address
+        if (entry.primaryInterface != interface || entry.primaryGateway == Ipv4Address::GetZero() ||
+            present.count(std::make_pair(entry.network.Get(), entry.mask.Get())))
+        {
+            continue;
+        }
+        routing->AddNetworkRouteTo(entry.network, entry.mask, entry.primaryGateway, interface, entry.primaryMetric);
+        restored++;
+    }
+    return restored;
+}
+
+inline void
+Ipv4FastReroute::NotifyInterfaceUp(uint32_t interface)
+{
+    Track(interface);
+    if (m_repairing[interface])
+    {
+        if (Ptr<Ipv4IndexedStaticRouting> indexed = Ipv4IndexedStaticRoutingHelper::GetIndexedStaticRouting(m_ipv4))
+        {
+            m_stats.restored += RestorePrimaries(indexed, interface);
+        }
+        else if (Ptr<Ipv4StaticRouting> staticRouting = Ipv4StaticRoutingHelper().GetStaticRouting(m_ipv4))
+        {
+            m_stats.restored += RestorePrimaries(staticRouting, interface);
+        }
+        m_repairing[interface] = false;
+        m_rerouteTrace(interface, m_protected[interface], false);
+    }
+}
+
+inline void
+Ipv4FastReroute::NotifyInterfaceDown(uint32_t interface)
+{
+    // Nothing is recomputed: the lookups of the interface's prefixes see the flag
+    Track(interface);
+    if (!m_repairing[interface])
+    {
+        m_repairing[interface] = true;
+        m_stats.repairs += m_protected[interface] > 0;
+        m_rerouteTrace(interface, m_protected[interface], true);
+    }
+}
+
+inline void
+Ipv4FastReroute::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+}
+
+inline void
+Ipv4FastReroute::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+}
+
+inline void
+Ipv4FastReroute::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    NS_ASSERT(!m_ipv4 && ipv4);
+    m_ipv4 = ipv4;
+}
+
+inline void
+Ipv4FastReroute::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Simulator::Now().As(unit)
+        << ", Ipv4FastReroute table (" << m_stats.protectedPrefixes << " of " << m_stats.prefixes
+        << " prefixes protected)\n";
+
+    std::map<std::pair<uint32_t, uint8_t>, uint32_t> sorted;
+    m_trie.ForEach([&sorted](uint32_t address, uint8_t length, uint32_t index) {
+        sorted[std::make_pair(address, length)] = index;
+    });
+    *os << "Destination        Iface  Alternate        Iface  State\n";
+    for (const auto& prefix : sorted)
+    {
+        std::ostringstream destination;
+        destination << Ipv4Address(prefix.first.first) << "/" << static_cast<uint32_t>(prefix.first.second);
+        const Entry& entry = m_entries[prefix.second];
+        *os << std::left << std::setw(19) << destination.str() << std::setw(7) << entry.primaryInterface;
+        if (entry.alternateInterface == NO_ALTERNATE)
+        {
+            *os << std::setw(17) << "-" << std::setw(7) << "-" << "unprotected\n";
+            continue;
+        }
+        *os << std::setw(17) << entry.alternateGateway << std::setw(7) << entry.alternateInterface
+            << (IsRepairing(entry.primaryInterface) ? "repairing" : "standby") << "\n";
+    }
+    *os << std::right << "\n";
+}
+
+/**
+ * Computes the loop-free alternates of a set of nodes and installs them in
+ * an Ipv4FastReroute on every node.
+ */
+class FastRerouteHelper
+{
+  public:
+    struct Statistics
+    {
+        uint32_t nodes{0};
+        uint32_t links{0};
+        uint32_t prefixes{0};       ///< prefixes over all nodes
+        uint32_t protectedPrefixes{0};
+        uint32_t nodeProtecting{0};
+    };
+
+    FastRerouteHelper()
+        : m_priority(10)
+    {
+    }
+
+    /// List routing priority of the Ipv4FastReroute instances (static routing is 0)
+    void SetPriority(int16_t priority)
+    {
+        m_priority = priority;
+    }
+
+    /**
+     * Compute the alternates of every node from its current routes, and
+     * add or refill the nodes' Ipv4FastReroute. Call it after the routes are
+     * installed, and again whenever they or the topology change.
+     */
+    void Install(NodeContainer nodes);
+
+    const Statistics& GetStatistics() const
+    {
+        return m_stats;
+    }
+
+    /// Find the Ipv4FastReroute of a node, or nullptr
+    static Ptr<Ipv4FastReroute> GetFastReroute(Ptr<Ipv4> ipv4)
+    {
+        Ptr<Ipv4RoutingProtocol> protocol = ipv4->GetRoutingProtocol();
+        Ptr<Ipv4FastReroute> frr = DynamicCast<Ipv4FastReroute>(protocol);
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(protocol);
+        for (uint32_t i = 0; !frr && list && i < list->GetNRoutingProtocols(); ++i)
+        {
+            int16_t priority;
+            frr = DynamicCast<Ipv4FastReroute>(list->GetRoutingProtocol(i, priority));
+        }
+        return frr;
+    }
+
+  private:
+    struct Primary
+    {
+        uint32_t network;
+        uint8_t length;
+        Ipv4Address gateway;
+        uint32_t interface;
+        uint32_t metric;
+    };
+
+    struct Neighbour
+    {
+        uint32_t node;
+        uint32_t interface;
+        Ipv4Address gateway;
+        uint32_t metric;
+    };
+
+    /// The route each prefix uses: lowest metric, the last added on a tie
+    template <class Routing>
+    static void CollectPrimaries(Ptr<Routing> routing, std::map<uint64_t, Primary>& primaries)
+    {
+        for (uint32_t i = 0; i < routing->GetNRoutes(); ++i)
+        {
+            Ipv4RoutingTableEntry route = routing->GetRoute(i);
+            uint32_t metric = routing->GetMetric(i);
+            uint8_t length = route.GetDestNetworkMask().GetPrefixLength();
+            uint64_t key = (uint64_t(route.GetDestNetwork().Get()) << 8) | length;
+            auto it = primaries.find(key);
+            if (it == primaries.end() || metric <= it->second.metric)
+            {
+                primaries[key] = {route.GetDestNetwork().Get(), length, route.GetGateway(), route.GetInterface(), metric};
+            }
+        }
+    }
+
+    int16_t m_priority;
+    Statistics m_stats;
+};
+
+inline void
+FastRerouteHelper::Install(NodeContainer nodes)
+{
+    m_stats = Statistics();
+    IncrementalSpf spf;
+    std::vector<Ptr<Ipv4>> ipv4s;
+    std::map<uint32_t, uint32_t> nodeIndex; ///< ns-3 node id -> graph node
+    for (uint32_t i = 0; i < nodes.GetN(); ++i)
+    {
+        if (nodes.Get(i)->GetObject<Ipv4>())
+        {
+            nodeIndex[nodes.Get(i)->GetId()] = spf.AddNode();
+            ipv4s.push_back(nodes.Get(i)->GetObject<Ipv4>());
+        }
+    }
+
+    // Graph of the interfaces that are up, and the nodes attached to every network
+    std::unordered_map<uint64_t, std::vector<uint32_t>> attached; ///< (network << 8 | length) -> nodes
+    std::unordered_map<uint32_t, uint32_t> addressNode;           ///< interface address -> graph node
+    std::vector<std::vector<Neighbour>> neighbours(ipv4s.size());
+    for (uint32_t node = 0; node < ipv4s.size(); ++node)
+    {
+        Ptr<Ipv4> ipv4 = ipv4s[node];
+        for (uint32_t interface = 0; interface < ipv4->GetNInterfaces(); ++interface)
+        {
+            if (ipv4->GetNAddresses(interface) == 0 || !ipv4->IsUp(interface))
+            {
+                continue;
+            }
+            Ipv4InterfaceAddress address = ipv4->GetAddress(interface, 0);
+            if (address.GetLocal().IsLocalhost())
+            {
+                continue;
+            }
+            Ipv4Mask mask = address.GetMask();
+            uint64_t key = (uint64_t(address.GetLocal().CombineMask(mask).Get()) << 8) | mask.GetPrefixLength();
+            attached[key].push_back(node);
+            addressNode[address.GetLocal().Get()] = node;
+
+            Ptr<Channel> channel = ipv4->GetNetDevice(interface)->GetChannel();
+            for (std::size_t d = 0; channel && d < channel->GetNDevices(); ++d)
+            {
+                Ptr<NetDevice> device = channel->GetDevice(d);
+                Ptr<Ipv4> peerIpv4 = device->GetNode()->GetObject<Ipv4>();
+                auto peer = nodeIndex.find(device->GetNode()->GetId());
+                if (device == ipv4->GetNetDevice(interface) || !peerIpv4 || peer == nodeIndex.end())
+                {
+                    continue;
+                }
+                int32_t peerInterface = peerIpv4->GetInterfaceForDevice(device);
+                if (peerInterface < 0 || peerIpv4->GetNAddresses(peerInterface) == 0 || !peerIpv4->IsUp(peerInterface))
+                {
+                    continue;
+                }
+                uint32_t metric = ipv4->GetMetric(interface);
+                spf.AddLink(node, peer->second, metric);
+                neighbours[node].push_back(
+                    {peer->second, interface, peerIpv4->GetAddress(peerInterface, 0).GetLocal(), metric});
+            }
+        }
+    }
+    for (uint32_t node = 0; node < ipv4s.size(); ++node)
+    {
+        spf.AddRoot(node); // root index == node index
+    }
+    spf.ComputeAll();
+    m_stats.nodes = spf.GetNNodes();
+    m_stats.links = spf.GetNLinks();
+
+    // Distances are summed in 64 bits, so INFINITE stays larger than any real one
+    auto distance = [&spf](uint32_t from, const std::vector<uint32_t>& to) {
+        uint64_t best = IncrementalSpf::INFINITE;
+        for (uint32_t node : to)
+        {
+            best = std::min<uint64_t>(best, spf.GetDistance(from, node));
+        }
+        return best;
+    };
+
+    Ipv4StaticRoutingHelper staticHelper;
+    for (uint32_t node = 0; node < ipv4s.size(); ++node)
+    {
+        Ptr<Ipv4> ipv4 = ipv4s[node];
+        std::map<uint64_t, Primary> primaries;
+        Ptr<Ipv4IndexedStaticRouting> indexed = Ipv4IndexedStaticRoutingHelper::GetIndexedStaticRouting(ipv4);
+        if (indexed)
+        {
+            CollectPrimaries(indexed, primaries);
+        }
+        else if (Ptr<Ipv4StaticRouting> staticRouting = staticHelper.GetStaticRouting(ipv4))
+        {
+            CollectPrimaries(staticRouting, primaries);
+        }
+
+        Ptr<Ipv4FastReroute> frr = GetFastReroute(ipv4);
+        if (frr)
+        {
+            frr->Clear();
+        }
+        else
+        {
+            Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+            NS_ABORT_MSG_UNLESS(list,
+                                "FastRerouteHelper needs an Ipv4ListRouting on the node; install a lone "
+                                "routing protocol through Ipv4ListRoutingHelper");
+            frr = CreateObject<Ipv4FastReroute>();
+            list->AddRoutingProtocol(frr, m_priority);
+        }
+
+        for (const auto& prefix : primaries)
+        {
+            const Primary& primary = prefix.second;
+            if (primary.interface == 0 || !ipv4->IsUp(primary.interface))
+            {
+                continue; // loopback, or already failed
+            }
+            uint32_t alternate = Ipv4FastReroute::NO_ALTERNATE;
+            Ipv4Address alternateGateway;
+            bool nodeProtecting = false;
+            auto to = attached.find(prefix.first);
+            if (to != attached.end())
+            {
+                uint64_t fromS = distance(node, to->second);
+                auto nextHop = addressNode.find(primary.gateway.Get());
+                uint64_t best = 0;
+                for (const Neighbour& n : neighbours[node])
+                {
+                    if (n.interface == primary.interface)
+                    {
+                        continue;
+                    }
+                    uint64_t fromN = distance(n.node, to->second);
+                    if (fromN == IncrementalSpf::INFINITE || fromN >= spf.GetDistance(n.node, node) + fromS)
+                    {
+                        continue; // not loop-free: N may send it back through S
+                    }
+                    bool protecting = primary.gateway != Ipv4Address::GetZero() && nextHop != addressNode.end() &&
+                                      fromN < spf.GetDistance(n.node, nextHop->second) +
+                                                  distance(nextHop->second, to->second);
+                    uint64_t cost = n.metric + fromN;
+                    if (alternate == Ipv4FastReroute::NO_ALTERNATE || protecting > nodeProtecting ||
+                        (protecting == nodeProtecting && cost < best))
+                    {
+                        alternate = n.interface;
+                        alternateGateway = n.gateway;
+                        nodeProtecting = protecting;
+                        best = cost;
+                    }
+                }
+            }
+            Ipv4Mask mask(primary.length == 0 ? 0 : ~uint32_t(0) << (32 - primary.length));
+            frr->AddPrefix(Ipv4Address(primary.network),
+                           mask,
+                           primary.gateway,
+                           primary.interface,
+                           primary.metric,
+                           alternateGateway,
+                           alternate,
+                           nodeProtecting);
+        }
+
+        m_stats.prefixes += frr->GetStatistics().prefixes;
+        m_stats.protectedPrefixes += frr->GetStatistics().protectedPrefixes;
+        m_stats.nodeProtecting += frr->GetStatistics().nodeProtecting;
+    }
+}
+
+} // namespace ns3
+
+#endif /* WAN_FAST_REROUTE_H */
@@ -0,0 +1,549 @@
+/*
+ * Trace-driven link and interface fault injection for the WAN exercises
+ *
+ * The exercises fail one link at one hardcoded time with their own
+ * Simulator::Schedule() calls. FaultInjector replays a failure and repair
+ * history instead: a text trace of timestamped events against named links
+ * or interfaces.
+ *
+ *   # time   target     event   [value]
+ *   6s       hq-dc      down
+ *   3h       hq-dc      up
+ *   1.5d     branch-dc  rate    256kbps
+ *   2d       branch-dc  rate    default
+ *   2d       hq-branch  delay   80ms
+ *
+ *  - down / up: the Ipv4 interfaces of the target go down or up (SetDown()
+ *    and SetUp(), which routing protocols see);
+ *  - rate: the DataRate attribute of the target's devices, e.g. 1bps for a
+ *    circuit that stops carrying traffic while its interfaces stay up;
+ *  - delay: the Delay attribute of the target's channel.
+ *
+ * "default" restores the value the target had when it was registered.
+ * Times are seconds, or a number with one of the units s, ms, us, ns, min,
+ * h, d; rates are bps, kbps, Mbps or Gbps. Events need not be sorted.
+ *
+ * Targets are registered by the script: AddLink() names the two ends of a
+ * link, AddInterface() one interface, and AddLinks() every point-to-point
+ * link between a set of nodes as "<node id>-<node id>".
+ *
+ * Schedule() sorts the events and keeps a single simulator event pending
+ * however long the trace is: it fires at the next timestamp, applies every
+ * event of that timestamp as one batch and schedules the following one. A
+ * week of outage history with thousands of events costs one event per
+ * distinct timestamp and no queue growth.
+ *
+ * Usage: copy this header next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_FAULT_INJECTOR_H
+#define WAN_FAULT_INJECTOR_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Failure and repair events of named links and interfaces, replayed in
+ * batches of equal timestamps.
+ */
+class FaultInjector
+{
+  public:
+    enum Action : uint8_t
+    {
+        DOWN,
+        UP,
+        RATE,
+        DELAY
+    };
+
+    /// Value of a RATE or DELAY event that restores the registered value
+    static constexpr uint64_t DEFAULT = ~uint64_t(0);
+
+    struct Fault
+    {
+        Time time;
+        uint32_t target;
+        Action action;
+        uint64_t value; ///< RATE: bit/s, DELAY: ns, or DEFAULT
+    };
+
+    struct Statistics
+    {
+        uint64_t lines{0};    ///< text lines read
+        uint64_t faults{0};   ///< events loaded or added
+        uint64_t batches{0};  ///< distinct timestamps fired
+        uint64_t applied{0};  ///< events applied
+        uint64_t largestBatch{0};
+    };
+
+    typedef std::function<void(const Fault&)> FaultCallback;
+
+    FaultInjector();
+
+    /// Name both ends of a link; returns the target index
+    uint32_t AddLink(const std::string& name, const NetDeviceContainer& link);
+
+    /// Name one interface of a node; returns the target index
+    uint32_t AddInterface(const std::string& name, Ptr<Node> node, uint32_t interface);
+
+    /// Name every point-to-point link between the nodes "<id>-<id>" (lower id first); returns the count
+    uint32_t AddLinks(NodeContainer nodes);
+
+    /// Add one event; false (see GetError()) for an unknown target
+    bool AddFault(Time time, const std::string& target, Action action, uint64_t value = 0);
+
+    /// Add the events of a trace file; false on error (see GetError())
+    bool Load(const std::string& path);
+
+    /// Add the events of a text trace
+    bool LoadText(std::istream& input);
+
+    /**
+     * Schedule the events, shifted by offset. Call once, after every event
+     * is added and before Simulator::Run().
+     */
+    void Schedule(Time offset = Seconds(0));
+
+    /// Called for every event as it is applied
+    void AddFaultCallback(FaultCallback callback);
+
+    /// "hq-dc down", "branch-dc rate 256kbps", ...
+    std::string Describe(const Fault& fault) const;
+
+    const std::string& GetTargetName(uint32_t target) const;
+    uint32_t GetNTargets() const;
+    uint64_t GetNFaults() const;
+
+    /// Time of the first event, or -1 s if there is none
+    Time GetFirstFaultTime() const;
+
+    const Statistics& GetStatistics() const;
+    const std::string& GetError() const;
+
+  private:
+    struct Target
+    {
+        std::string name;
+        std::vector<Ptr<NetDevice>> devices;
+        DataRate rate;  ///< registered DataRate of the first device
+        Time delay;     ///< registered Delay of the channel
+    };
+
+    uint32_t AddTarget(const std::string& name, std::vector<Ptr<NetDevice>> devices);
+    void RunBatch();
+    void Apply(const Fault& fault);
+
+    static bool ParseTime(const std::string& text, Time& time);
+    static bool ParseRate(const std::string& text, uint64_t& bps);
+
+    std::vector<Target> m_targets;
+    std::map<std::string, uint32_t> m_targetIndex;
+    std::vector<Fault> m_faults;
+    std::size_t m_next;
+    Time m_offset;
+    bool m_scheduled;
+    std::vector<FaultCallback> m_callbacks;
+    Statistics m_stats;
+    std::string m_error;
+};
+
+inline FaultInjector::FaultInjector()
+    : m_next(0),
+      m_scheduled(false)
+{
+}
+
+inline uint32_t
+FaultInjector::AddTarget(const std::string& name, std::vector<Ptr<NetDevice>> devices)
+{
+    NS_ABORT_MSG_IF(m_targetIndex.count(name), "FaultInjector: target " << name << " registered twice");
+    Target target{name, std::move(devices), DataRate(), Seconds(0)};
+    DataRateValue rate;
+    if (target.devices[0]->GetAttributeFailSafe("DataRate", rate))
+    {
+        target.rate = rate.Get();
+    }
+    TimeValue delay;
+    Ptr<Channel> channel = target.devices[0]->GetChannel();
+    if (channel && channel->GetAttributeFailSafe("Delay", delay))
+    {
+        target.delay = delay.Get();
+    }
+    m_targetIndex[name] = m_targets.size();
+    m_targets.push_back(target);
+    return m_targets.size() - 1;
+}
+
+inline uint32_t
+FaultInjector::AddLink(const std::string& name, const NetDeviceContainer& link)
+{
+    NS_ABORT_MSG_IF(link.GetN() == 0, "FaultInjector: link " << name << " has no devices");
+    return AddTarget(name, std::vector<Ptr<NetDevice>>(link.Begin(), link.End()));
+}
+
+inline uint32_t
+FaultInjector::AddInterface(const std::string& name, Ptr<Node> node, uint32_t interface)
+{
+    return AddTarget(name, {node->GetObject<Ipv4>()->GetNetDevice(interface)});
+}
+
+inline uint32_t
+FaultInjector::AddLinks(NodeContainer nodes)
+{
+    std::map<uint32_t, bool> member;
+    for (uint32_t i = 0; i < nodes.GetN(); ++i)
+    {
+        member[nodes.Get(i)->GetId()] = true;
+    }
+    uint32_t links = 0;
+    for (uint32_t i = 0; i < nodes.GetN(); ++i)
+    {
+        Ptr<Node> node = nodes.Get(i);
+        for (uint32_t d = 0; d < node->GetNDevices(); ++d)
+        {
+            Ptr<Channel> channel = node->GetDevice(d)->GetChannel();
+            if (!channel || channel->GetNDevices() != 2)
+            {
+                continue;
+            }
+            Ptr<NetDevice> peer = channel->GetDevice(0) == node->GetDevice(d) ? channel->GetDevice(1)
+                                                                              : channel->GetDevice(0);
+            uint32_t peerId = peer->GetNode()->GetId();
+            if (peerId < node->GetId() || !member.count(peerId))
+            {
+                continue; // named from the lower id, once
+            }
+            std::string name = std::to_string(node->GetId()) + "-" + std::to_string(peerId);
+            for (uint32_t parallel = 2; m_targetIndex.count(name); ++parallel)
+            {
+                name = std::to_string(node->GetId()) + "-" + std::to_string(peerId) + "#" + std::to_string(parallel);
+            }
+            AddTarget(name, {node->GetDevice(d), peer});
+            links++;
+        }
+    }
+    return links;
+}
+
+inline bool
+FaultInjector::AddFault(Time time, const std::string& target, Action action, uint64_t value)
+{
+    auto it = m_targetIndex.find(target);
+    if (it == m_targetIndex.end())
+    {
+        m_error = "unknown target " + target;
+        return false;
+    }
+    NS_ABORT_MSG_IF(m_scheduled, "FaultInjector: add faults before Schedule()");
+    m_faults.push_back({time, it->second, action, value});
+    m_stats.faults++;
+    return true;
+}
+
+inline bool
+FaultInjector::Load(const std::string& path)
+{
+    std::ifstream input(path);
+    if (!input)
+    {
+        m_error = "cannot open " + path;
+        return false;
+    }
+    if (!LoadText(input))
+    {
+        m_error = path + ": " + m_error;
+        return false;
+    }
+    return true;
+}
+
+inline bool
+FaultInjector::LoadText(std::istream& input)
+{
+    std::string line;
+    uint64_t number = 0;
+    while (std::getline(input, line))
+    {
+        number++;
+        m_stats.lines++;
+        std::string::size_type comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+        std::istringstream fields(line);
+        std::string time;
+        std::string target;
+        std::string event;
+        std::string value;
+        std::string extra;
+        if (!(fields >> time))
+        {
+            continue; // blank or comment
+        }
+        fields >> target >> event >> value >> extra;
+
+        Fault fault{Seconds(0), 0, DOWN, 0};
+        bool valid = ParseTime(time, fault.time) && !target.empty() && extra.empty();
+        if (event == "down" || event == "up")
+        {
+            fault.action = event == "down" ? DOWN : UP;
+            valid = valid && value.empty();
+        }
+        else if (event == "rate")
+        {
+            fault.action = RATE;
+            fault.value = DEFAULT;
+            valid = valid && (value == "default" || ParseRate(value, fault.value));
+        }
+        else if (event == "delay")
+        {
+            Time delay;
+            fault.action = DELAY;
+            fault.value = DEFAULT;
+            if (value != "default")
+            {
+                valid = valid && ParseTime(value, delay);
+                fault.value = delay.GetNanoSeconds();
+            }
+        }
+        else
+        {
+            valid = false;
+        }
+        if (!valid)
+        {
+            m_error = "line " + std::to_string(number) + ": cannot parse \"" + line + "\"";
+            return false;
+        }
+        if (!AddFault(fault.time, target, fault.action, fault.value))
+        {
+            m_error = "line " + std::to_string(number) + ": " + m_error;
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool
+FaultInjector::ParseTime(const std::string& text, Time& time)
+{
+    static const std::pair<const char*, double> units[] = {
+        {"", 1}, {"s", 1}, {"ms", 1e-3}, {"us", 1e-6}, {"ns", 1e-9}, {"min", 60}, {"h", 3600}, {"d", 86400}};
+    char* end;
+    double value = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0 || !std::isfinite(value))
+    {
+        return false;
+    }
+    for (const auto& unit : units)
+    {
+        if (unit.first == std::string(end))
+        {
+            time = NanoSeconds(static_cast<int64_t>(std::llround(value * unit.second * 1e9)));
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool
+FaultInjector::ParseRate(const std::string& text, uint64_t& bps)
+{
+    static const std::pair<const char*, double> units[] = {
+        {"bps", 1}, {"kbps", 1e3}, {"Kbps", 1e3}, {"Mbps", 1e6}, {"Gbps", 1e9}};
+    char* end;
+    double value = std::strtod(text.c_str(), &end);
+    if (end == text.c_str() || value < 0 || !std::isfinite(value))
+    {
+        return false;
+    }
+    for (const auto& unit : units)
+    {
+        if (unit.first == std::string(end))
+        {
+            bps = static_cast<uint64_t>(std::llround(value * unit.second));
+            return bps > 0;
+        }
+    }
+    return false;
+}
+
+inline void
+FaultInjector::Schedule(Time offset)
+{
+    NS_ABORT_MSG_IF(m_scheduled, "FaultInjector: Schedule() called twice");
+    m_scheduled = true;
+    m_offset = offset;
+    // Stable, so events of one timestamp are applied in trace order
+    std::stable_sort(m_faults.begin(), m_faults.end(), [](const Fault& a, const Fault& b) {
+        return a.time < b.time;
+    });
+    if (!m_faults.empty())
+    {
+        Time delay = m_offset + m_faults[0].time - Simulator::Now();
+        Simulator::Schedule(delay.IsNegative() ? Seconds(0) : delay, &FaultInjector::RunBatch, this);
+    }
+}
+
+inline void
+FaultInjector::RunBatch()
+{
+    std::size_t first = m_next;
+    Time time = m_faults[first].time;
+    while (m_next < m_faults.size() && m_faults[m_next].time == time)
+    {
+        Apply(m_faults[m_next++]);
+    }
+    m_stats.batches++;
+    m_stats.largestBatch = std::max<uint64_t>(m_stats.largestBatch, m_next - first);
+    if (m_next < m_faults.size())
+    {
+        Simulator::Schedule(m_faults[m_next].time - time, &FaultInjector::RunBatch, this);
+    }
+}
+
+inline void
+FaultInjector::Apply(const Fault& fault)
+{
+    const Target& target = m_targets[fault.target];
+    switch (fault.action)
+    {
+    case DOWN:
+    case UP:
+        for (Ptr<NetDevice> device : target.devices)
+        {
+            Ptr<Ipv4> ipv4 = device->GetNode()->GetObject<Ipv4>();
+            int32_t interface = ipv4 ? ipv4->GetInterfaceForDevice(device) : -1;
+            if (interface < 0 || ipv4->IsUp(interface) == (fault.action == UP))
+            {
+                continue;
+            }
+            if (fault.action == DOWN)
+            {
+                ipv4->SetDown(interface);
+            }
+            else
+            {
+                ipv4->SetUp(interface);
+            }
+        }
+        break;
+    case RATE: {
+        DataRate rate = fault.value == DEFAULT ? target.rate : DataRate(fault.value);
+        for (Ptr<NetDevice> device : target.devices)
+        {
+            device->SetAttributeFailSafe("DataRate", DataRateValue(rate));
+        }
+        break;
+    }
+    case DELAY: {
+        Time delay = fault.value == DEFAULT ? target.delay : NanoSeconds(fault.value);
+        Ptr<Channel> channel = target.devices[0]->GetChannel();
+        if (channel)
+        {
+            channel->SetAttributeFailSafe("Delay", TimeValue(delay));
+        }
+        break;
+    }
+    }
+    m_stats.applied++;
+    for (const FaultCallback& callback : m_callbacks)
+    {
+        callback(fault);
+    }
+}
+
+inline void
+FaultInjector::AddFaultCallback(FaultCallback callback)
+{
+    m_callbacks.push_back(callback);
+}
+
+inline std::string
+FaultInjector::Describe(const Fault& fault) const
+{
+    static const char* names[] = {"down", "up", "rate", "delay"};
+    std::ostringstream text;
+    text << m_targets[fault.target].name << " " << names[fault.action];
+    if (fault.action == RATE || fault.action == DELAY)
+    {
+        text << " ";
+        if (fault.value == DEFAULT)
+        {
+            text << "default";
+        }
+        else if (fault.action == RATE)
+        {
+            text << fault.value << "bps";
+        }
+        else
+        {
+            text << NanoSeconds(fault.value).As(Time::MS);
+        }
+    }
+    return text.str();
+}
+
+inline const std::string&
+FaultInjector::GetTargetName(uint32_t target) const
+{
+    return m_targets[target].name;
+}
+
+inline uint32_t
+FaultInjector::GetNTargets() const
+{
+    return m_targets.size();
+}
+
+inline uint64_t
+FaultInjector::GetNFaults() const
+{
+    return m_faults.size();
+}
+
+inline Time
+FaultInjector::GetFirstFaultTime() const
+{
+    Time first = Seconds(-1);
+    for (const Fault& fault : m_faults)
+    {
+        if (first.IsNegative() || fault.time < first)
+        {
+            first = fault.time;
+        }
+    }
+    return first;
+}
+
+inline const FaultInjector::Statistics&
+FaultInjector::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline const std::string&
+FaultInjector::GetError() const
+{
+    return m_error;
+}
+
+} // namespace ns3
+
+#endif /* WAN_FAULT_INJECTOR_H */
@@ -0,0 +1,138 @@
+/*
+ * Flow hashing for equal-cost multipath forwarding
+ *
+ * ECMP must keep every packet of a flow on the same path, or TCP sees
+ * reordering. FlowHash hashes the 5-tuple (addresses, protocol and, for
+ * unfragmented TCP and UDP packets, the ports) with CRC32C, which is stable
+ * across runs and cheap: one SSE4.2 crc32 instruction per 4 bytes when the
+ * compiler targets it (-msse4.2 or -march=native), a table lookup per byte
+ * otherwise. Both give the same value.
+ *
+ * Routers usually seed the hash with something of their own (the router
+ * id), so that two ECMP stages in a row do not make the same choice for
+ * every flow (hash polarisation). Select() maps a hash onto n paths with a
+ * multiply-shift instead of a division.
+ *
+ * Usage: copy this header next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_FLOW_HASH_H
+#define WAN_FLOW_HASH_H
+
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <cstdint>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+namespace ns3
+{
+
+/**
+ * CRC32C 5-tuple hash of IPv4 packets.
+ */
+class FlowHash
+{
+  public:
+    /// CRC32C (Castagnoli) of a buffer, continuing from crc
+    static uint32_t Crc32c(const uint8_t* data, std::size_t size, uint32_t crc = 0);
+
+    /**
+     * Hash of a packet's flow.
+     * \param header IP header of the packet
+     * \param packet the packet after its IP header (as passed to RouteInput),
+     *        or nullptr when the ports are not known yet (RouteOutput)
+     * \param seed per-router perturbation
+     */
+    static uint32_t Hash(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t seed);
+
+    /// Map a hash onto one of n paths
+    static uint32_t Select(uint32_t hash, uint32_t n);
+
+  private:
+    static const uint32_t* Table();
+};
+
+inline const uint32_t*
+FlowHash::Table()
+{
+    static uint32_t table[256];
+    static bool built = false;
+    if (!built)
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit)
+            {
+                crc = (crc >> 1) ^ (0x82f63b78 & (0u - (crc & 1))); // reflected Castagnoli polynomial
+            }
+            table[i] = crc;
+        }
+        built = true;
+    }
+    return table;
+}
+
+inline uint32_t
+FlowHash::Crc32c(const uint8_t* data, std::size_t size, uint32_t crc)
+{
+    crc = ~crc;
+#ifdef __SSE4_2__
+    for (; size >= 4; size -= 4, data += 4)
+    {
+        uint32_t word = uint32_t(data[0]) | uint32_t(data[1]) << 8 | uint32_t(data[2]) << 16 |
+                        uint32_t(data[3]) << 24;
+        crc = _mm_crc32_u32(crc, word);
+    }
+    for (; size > 0; --size)
+    {
+        crc = _mm_crc32_u8(crc, *data++);
+    }
+#else
+    const uint32_t* table = Table();
+    for (; size > 0; --size)
+    {
+        crc = table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+#endif
+    return ~crc;
+}
+
+inline uint32_t
+FlowHash::Hash(const Ipv4Header& header, Ptr<const Packet> packet, uint32_t seed)
+{
+    uint8_t tuple[13];
+    uint32_t source = header.GetSource().Get();
+    uint32_t destination = header.GetDestination().Get();
+    for (int i = 0; i < 4; ++i)
+    {
+        tuple[i] = source >> (24 - 8 * i);
+        tuple[4 + i] = destination >> (24 - 8 * i);
+    }
+    tuple[8] = header.GetProtocol();
+    std::size_t size = 9;
+    // Source and destination port are the first 4 bytes of both TCP and UDP.
+    // Only unfragmented packets use them: later fragments carry no ports, and
+    // all fragments of a packet must hash alike to take the same path
+    if (packet && (tuple[8] == 6 || tuple[8] == 17) && header.IsLastFragment() &&
+        header.GetFragmentOffset() == 0 && packet->GetSize() >= 4)
+    {
+        packet->CopyData(tuple + 9, 4);
+        size = 13;
+    }
+    return Crc32c(tuple, size, seed);
+}
+
+inline uint32_t
+FlowHash::Select(uint32_t hash, uint32_t n)
+{
+    return static_cast<uint32_t>((uint64_t(hash) * n) >> 32);
+}
+
+} // namespace ns3
+
+#endif /* WAN_FLOW_HASH_H */
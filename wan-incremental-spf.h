@@ -0,0 +1,896 @@
+/*
+ * Incremental shortest-path-first routing for the WAN exercises
+ *
+ * Ipv4GlobalRoutingHelper::PopulateRoutingTables() runs a full Dijkstra for
+ * every node, and RecomputeRoutingTables() throws all of it away and runs
+ * them all again, even when a single link changed. For a link-state change
+ * only part of each shortest-path tree can move:
+ *
+ *   - a link gets worse (metric up, or down): only the nodes below it in a
+ *     tree that uses it are affected. They are detached and re-attached by a
+ *     Dijkstra restricted to that subtree, seeded from its unaffected
+ *     neighbours. Trees that do not use the link are not touched at all.
+ *   - a link gets better (metric down, or up): Dijkstra is seeded with the
+ *     link's far end and only expands through nodes whose distance strictly
+ *     improves.
+ *
+ * Each changed destination is reported, so only the FIB entries whose next
+ * hop actually moved are rewritten.
+ *
+ * IncrementalSpf is the plain graph engine (no simulator dependencies, as in
+ * LpmTrie). IncrementalSpfRouting maps the ns-3 nodes' interfaces onto it and
+ * keeps an Ipv4LpmRouting (wan-lpm-fib.h) per node up to date: Populate()
+ * replaces PopulateRoutingTables() and Update() replaces
+ * RecomputeRoutingTables(), re-reading interface states and metrics and
+ * applying only the links that changed. One shortest path per destination
+ * (no ECMP); metrics are the interfaces' Ipv4 metrics.
+ *
+ * The distances are also what BGP needs for hot-potato routing:
+ * GetCostCallback() hands a BgpSpeaker (wan-bgp-speaker.h) its router's
+ * distance to any BGP next hop, and AddCostChangeCallback() tells it when
+ * an Update() may have moved them.
+ *
+ * Usage: copy this header and wan-lpm-fib.h next to the exercise script in
+ * scratch/.
+ */
+
+#ifndef WAN_INCREMENTAL_SPF_H
+#define WAN_INCREMENTAL_SPF_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "wan-lpm-fib.h"
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Shortest-path trees of a directed graph, kept up to date link by link.
+ *
+ * Trees are only kept for the roots added with AddRoot(). Distances are
+ * 32-bit sums of 16-bit metrics.
+ */
+class IncrementalSpf
+{
+  public:
+    /// Metric of a link that is down, distance of an unreachable node
+    static constexpr uint32_t INFINITE = 0xffffffff;
+    /// No link / no node
+    static constexpr uint32_t NONE = 0xffffffff;
+
+    /**
+     * Called for every destination whose distance or first hop changed in a
+     * tree: (root index, destination node)
+     */
+    typedef std::function<void(uint32_t, uint32_t)> ChangeCallback;
+
+    struct Statistics
+    {
+        uint64_t fullRuns{0};         ///< trees computed from scratch
+        uint64_t linkChanges{0};      ///< SetMetric() calls that changed a metric
+        uint64_t treesUpdated{0};     ///< trees an incremental update had to touch
+        uint64_t nodesSettled{0};     ///< nodes settled by full and incremental runs
+        uint64_t changes{0};          ///< destinations reported to the change callback
+    };
+
+    IncrementalSpf();
+
+    /// Add a node; returns its index
+    uint32_t AddNode();
+
+    /// Add a directed link; returns its index
+    uint32_t AddLink(uint32_t from, uint32_t to, uint32_t metric);
+
+    /// Keep the shortest-path tree of a node; returns the root index
+    uint32_t AddRoot(uint32_t node);
+
+    /// Recompute every tree from scratch (no change is reported)
+    void ComputeAll();
+
+    /**
+     * Change the metric of a link (INFINITE takes it down) and update every
+     * tree incrementally. Trees must have been computed with ComputeAll().
+     */
+    void SetMetric(uint32_t link, uint32_t metric);
+
+    void SetChangeCallback(ChangeCallback callback);
+
+    uint32_t GetNNodes() const;
+    uint32_t GetNLinks() const;
+    uint32_t GetNRoots() const;
+    uint32_t GetRoot(uint32_t root) const;
+    uint32_t GetFrom(uint32_t link) const;
+    uint32_t GetTo(uint32_t link) const;
+    uint32_t GetMetric(uint32_t link) const;
+
+    /// Distance from a root to a node, INFINITE if unreachable
+    uint32_t GetDistance(uint32_t root, uint32_t node) const;
+
+    /// The root's outgoing link towards a node, NONE if unreachable or the root itself
+    uint32_t GetFirstHop(uint32_t root, uint32_t node) const;
+
+    /// Bytes used by the trees
+    std::size_t GetMemoryUsage() const;
+
+    const Statistics& GetStatistics() const;
+
+  private:
+    struct Link
+    {
+        uint32_t from;
+        uint32_t to;
+        uint32_t metric;
+    };
+
+    struct Tree
+    {
+        uint32_t root;
+        std::vector<uint32_t> distance;
+        std::vector<uint32_t> parent;   ///< link from the parent, NONE for the root and unreachable nodes
+        std::vector<uint32_t> firstHop; ///< root's outgoing link on the path
+    };
+
+    typedef std::pair<uint32_t, uint32_t> HeapEntry; ///< (distance, node)
+    typedef std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<HeapEntry>> Heap;
+
+    void Compute(Tree& tree);
+    /// Set parent and first hop of a node whose distance is final
+    void Settle(Tree& tree, uint32_t node, uint32_t parentLink);
+    void Worsened(Tree& tree, uint32_t root, uint32_t link);
+    void Improved(Tree& tree, uint32_t root, uint32_t link);
+    void Report(uint32_t root, uint32_t node);
+
+    std::vector<Link> m_links;
+    std::vector<std::vector<uint32_t>> m_out; ///< outgoing links per node
+    std::vector<std::vector<uint32_t>> m_in;  ///< incoming links per node
+    std::vector<Tree> m_trees;
+    ChangeCallback m_changed;
+    Statistics m_stats;
+
+    // Scratch space of the incremental updates
+    std::vector<uint32_t> m_mark; ///< == m_epoch: node is in the affected subtree
+    uint32_t m_epoch;
+    std::vector<uint32_t> m_affected;
+    std::vector<uint32_t> m_oldDistance;
+    std::vector<uint32_t> m_oldFirstHop;
+    Heap m_heap;
+};
+
+inline IncrementalSpf::IncrementalSpf()
+    : m_epoch(0)
+{
+}
+
+inline uint32_t
+IncrementalSpf::AddNode()
+{
+    NS_ASSERT_MSG(m_trees.empty(), "IncrementalSpf: add nodes before roots");
+    m_out.emplace_back();
+    m_in.emplace_back();
+    m_mark.push_back(0);
+    return m_out.size() - 1;
+}
+
+inline uint32_t
+IncrementalSpf::AddLink(uint32_t from, uint32_t to, uint32_t metric)
+{
+    NS_ASSERT_MSG(from < m_out.size() && to < m_out.size(), "IncrementalSpf: unknown node");
+    NS_ASSERT_MSG(metric <= 0xffff || metric == INFINITE, "IncrementalSpf: metric above 65535");
+    uint32_t link = m_links.size();
+    m_links.push_back({from, to, metric});
+    m_out[from].push_back(link);
+    m_in[to].push_back(link);
+    return link;
+}
+
+inline uint32_t
+IncrementalSpf::AddRoot(uint32_t node)
+{
+    NS_ASSERT_MSG(node < m_out.size(), "IncrementalSpf: unknown node");
+    m_trees.push_back({node, {}, {}, {}});
+    return m_trees.size() - 1;
+}
+
+inline void
+IncrementalSpf::Settle(Tree& tree, uint32_t node, uint32_t parentLink)
+{
+    tree.parent[node] = parentLink;
+    uint32_t from = m_links[parentLink].from;
+    tree.firstHop[node] = from == tree.root ? parentLink : tree.firstHop[from];
+    m_stats.nodesSettled++;
+}
+
+inline void
+IncrementalSpf::Compute(Tree& tree)
+{
+    uint32_t n = m_out.size();
+    tree.distance.assign(n, INFINITE);
+    tree.parent.assign(n, NONE);
+    tree.firstHop.assign(n, NONE);
+    tree.distance[tree.root] = 0;
+    Heap& heap = m_heap;
+    heap.push({0, tree.root});
+    while (!heap.empty())
+    {
+        HeapEntry top = heap.top();
+        heap.pop();
+        uint32_t node = top.second;
+        if (top.first != tree.distance[node])
+        {
+            continue; // stale entry
+        }
+        if (node != tree.root)
+        {
+            Settle(tree, node, tree.parent[node]);
+        }
+        for (uint32_t link : m_out[node])
+        {
+            const Link& l = m_links[link];
+            if (l.metric == INFINITE)
+            {
+                continue;
+            }
+            uint32_t distance = top.first + l.metric;
+            if (distance < tree.distance[l.to])
+            {
+                tree.distance[l.to] = distance;
+                tree.parent[l.to] = link;
+                heap.push({distance, l.to});
+            }
+        }
+    }
+    m_stats.fullRuns++;
+}
+
+inline void
+IncrementalSpf::ComputeAll()
+{
+    for (Tree& tree : m_trees)
+    {
+        Compute(tree);
+    }
+}
+
+inline void
+IncrementalSpf::SetMetric(uint32_t link, uint32_t metric)
+{
+    NS_ASSERT_MSG(metric <= 0xffff || metric == INFINITE, "IncrementalSpf: metric above 65535");
+    uint32_t previous = m_links[link].metric;
+    if (metric == previous)
+    {
+        return;
+    }
+    m_links[link].metric = metric;
+    m_stats.linkChanges++;
+    for (uint32_t root = 0; root < m_trees.size(); ++root)
+    {
+        if (metric > previous)
+        {
+            Worsened(m_trees[root], root, link);
+        }
+        else
+        {
+            Improved(m_trees[root], root, link);
+        }
+    }
+}
+
+inline void
+IncrementalSpf::Worsened(Tree& tree, uint32_t root, uint32_t link)
+{
+    uint32_t top = m_links[link].to;
+    if (tree.parent[top] != link)
+    {
+        return; // the tree does not use the link
+    }
+    m_stats.treesUpdated++;
+
+    // The subtree below the link: children are found through their parent link
+    ++m_epoch;
+    m_affected.clear();
+    m_affected.push_back(top);
+    m_mark[top] = m_epoch;
+    for (std::size_t i = 0; i < m_affected.size(); ++i)
+    {
+        for (uint32_t out : m_out[m_affected[i]])
+        {
+            uint32_t child = m_links[out].to;
+            if (tree.parent[child] == out)
+            {
+                m_mark[child] = m_epoch;
+                m_affected.push_back(child);
+            }
+        }
+    }
+
+    // Detach it, then seed each node with its best way in from outside the subtree
+    m_oldDistance.resize(m_affected.size());
+    m_oldFirstHop.resize(m_affected.size());
+    for (std::size_t i = 0; i < m_affected.size(); ++i)
+    {
+        uint32_t node = m_affected[i];
+        m_oldDistance[i] = tree.distance[node];
+        m_oldFirstHop[i] = tree.firstHop[node];
+        tree.distance[node] = INFINITE;
+        tree.parent[node] = NONE;
+        tree.firstHop[node] = NONE;
+    }
+    Heap& heap = m_heap;
+    for (uint32_t node : m_affected)
+    {
+        for (uint32_t in : m_in[node])
+        {
+            const Link& l = m_links[in];
+            if (m_mark[l.from] == m_epoch || l.metric == INFINITE || tree.distance[l.from] == INFINITE)
+            {
+                continue;
+            }
+            uint32_t distance = tree.distance[l.from] + l.metric;
+            if (distance < tree.distance[node])
+            {
+                tree.distance[node] = distance;
+                tree.parent[node] = in;
+            }
+        }
+        if (tree.distance[node] != INFINITE)
+        {
+            heap.push({tree.distance[node], node});
+        }
+    }
+
+    // Dijkstra inside the subtree
+    while (!heap.empty())
+    {
+        HeapEntry entry = heap.top();
+        heap.pop();
+        uint32_t node = entry.second;
+        if (entry.first != tree.distance[node])
+        {
+            continue;
+        }
+        Settle(tree, node, tree.parent[node]);
+        for (uint32_t out : m_out[node])
+        {
+            const Link& l = m_links[out];
+            if (m_mark[l.to] != m_epoch || l.metric == INFINITE)
+            {
+                continue;
+            }
+            uint32_t distance = entry.first + l.metric;
+            if (distance < tree.distance[l.to])
+            {
+                tree.distance[l.to] = distance;
+                tree.parent[l.to] = out;
+                heap.push({distance, l.to});
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < m_affected.size(); ++i)
+    {
+        uint32_t node = m_affected[i];
+        if (tree.distance[node] != m_oldDistance[i] || tree.firstHop[node] != m_oldFirstHop[i])
+        {
+            Report(root, node);
+        }
+    }
+}
+
+inline void
+IncrementalSpf::Improved(Tree& tree, uint32_t root, uint32_t link)
+{
+    const Link& changed = m_links[link];
+    if (tree.distance[changed.from] == INFINITE ||
+        tree.distance[changed.from] + changed.metric >= tree.distance[changed.to])
+    {
+        return; // not shorter than what the tree already has
+    }
+    m_stats.treesUpdated++;
+    Heap& heap = m_heap;
+    tree.distance[changed.to] = tree.distance[changed.from] + changed.metric;
+    tree.parent[changed.to] = link;
+    heap.push({tree.distance[changed.to], changed.to});
+    while (!heap.empty())
+    {
+        HeapEntry entry = heap.top();
+        heap.pop();
+        uint32_t node = entry.second;
+        if (entry.first != tree.distance[node])
+        {
+            continue;
+        }
+        Settle(tree, node, tree.parent[node]);
+        Report(root, node); // every node reached here got strictly closer
+        for (uint32_t out : m_out[node])
+        {
+            const Link& l = m_links[out];
+            if (l.metric == INFINITE)
+            {
+                continue;
+            }
+            uint32_t distance = entry.first + l.metric;
+            if (distance < tree.distance[l.to])
+            {
+                tree.distance[l.to] = distance;
+                tree.parent[l.to] = out;
+                heap.push({distance, l.to});
+            }
+        }
+    }
+}
+
+inline void
+IncrementalSpf::Report(uint32_t root, uint32_t node)
+{
+    m_stats.changes++;
+    if (m_changed)
+    {
+        m_changed(root, node);
+    }
+}
+
+inline void
+IncrementalSpf::SetChangeCallback(ChangeCallback callback)
+{
+    m_changed = callback;
+}
+
+inline uint32_t
+IncrementalSpf::GetNNodes() const
+{
+    return m_out.size();
+}
+
+inline uint32_t
+IncrementalSpf::GetNLinks() const
+{
+    return m_links.size();
+}
+
+inline uint32_t
+IncrementalSpf::GetNRoots() const
+{
+    return m_trees.size();
+}
+
+inline uint32_t
+IncrementalSpf::GetRoot(uint32_t root) const
+{
+    return m_trees[root].root;
+}
+
+inline uint32_t
+IncrementalSpf::GetFrom(uint32_t link) const
+{
+    return m_links[link].from;
+}
+
+inline uint32_t
+IncrementalSpf::GetTo(uint32_t link) const
+{
+    return m_links[link].to;
+}
+
+inline uint32_t
+IncrementalSpf::GetMetric(uint32_t link) const
+{
+    return m_links[link].metric;
+}
+
+inline uint32_t
+IncrementalSpf::GetDistance(uint32_t root, uint32_t node) const
+{
+    return m_trees[root].distance[node];
+}
+
+inline uint32_t
+IncrementalSpf::GetFirstHop(uint32_t root, uint32_t node) const
+{
+    return m_trees[root].firstHop[node];
+}
+
+inline std::size_t
+IncrementalSpf::GetMemoryUsage() const
+{
+    return m_trees.size() * (sizeof(Tree) + 3 * m_out.size() * sizeof(uint32_t));
+}
+
+inline const IncrementalSpf::Statistics&
+IncrementalSpf::GetStatistics() const
+{
+    return m_stats;
+}
+
+/**
+ * Link-state routing of a set of ns-3 nodes on IncrementalSpf.
+ *
+ * Every interface with an address becomes one directed link per neighbour
+ * on its channel, with the interface's metric, and every interface network
+ * a destination. Each node gets an Ipv4LpmRouting (added if missing) with a
+ * route to every network that is not directly connected, through the first
+ * hop towards the closest node attached to it by an interface that is up.
+ * When every attachment of a network is down the network is withdrawn
+ * everywhere, as global routing stops advertising a down interface;
+ * otherwise the two ends of a failed link would route its subnet to each
+ * other.
+ */
+class IncrementalSpfRouting
+{
+  public:
+    struct Statistics
+    {
+        uint64_t updates{0};          ///< Update() calls
+        uint64_t linkChanges{0};      ///< links whose state or metric changed
+        uint64_t interfaceChanges{0}; ///< attached interfaces that went down or came up
+        uint64_t fibUpdates{0};       ///< routes added, replaced or removed by Update()
+        uint64_t fibRoutes{0};        ///< routes installed by Populate()
+    };
+
+    /// Build the graph of the nodes, compute every tree and fill the FIBs
+    void Populate(NodeContainer nodes);
+
+    /// Re-read interface states and metrics, apply the changed links only
+    void Update();
+
+    /**
+     * IGP distance from a node to the node owning an address, or to the
+     * closest node on the address's network; IncrementalSpf::INFINITE if
+     * unreachable or not part of the graph.
+     */
+    uint32_t GetCost(Ptr<Node> node, Ipv4Address address) const;
+
+    /// GetCost() from one node, as BgpSpeaker::SetIgpCostCallback() takes it
+    Callback<uint32_t, Ipv4Address> GetCostCallback(Ptr<Node> node) const;
+
+    /// Called after every Update() that changed a link
+    void AddCostChangeCallback(Callback<void> callback);
+
+    const IncrementalSpf& GetSpf() const;
+    const Statistics& GetStatistics() const;
+
+  private:
+    struct LinkInfo
+    {
+        Ptr<Ipv4> ipv4;         ///< sending side
+        uint32_t interface;
+        Ptr<Ipv4> peerIpv4;
+        uint32_t peerInterface;
+        Ipv4Address gateway;    ///< the neighbour's address on the channel
+    };
+
+    struct Network
+    {
+        Ipv4Address address;
+        Ipv4Mask mask;
+        std::vector<std::pair<uint32_t, uint32_t>> attached; ///< (node, interface)
+        std::vector<bool> up; ///< per attachment: interface state as of the last Update()
+    };
+
+    uint32_t CurrentMetric(const LinkInfo& link) const;
+    /// True if the node has an interface up on the network
+    bool IsConnected(uint32_t node, uint32_t network) const;
+    /// First-hop link of a node towards a network, NONE for no route
+    uint32_t BestRoute(uint32_t root, uint32_t network) const;
+    void Refresh(uint32_t root, uint32_t network);
+    void Changed(uint32_t root, uint32_t node);
+    static uint32_t CostFrom(const IncrementalSpfRouting* routing, Ptr<Node> node, Ipv4Address address);
+
+    IncrementalSpf m_spf;
+    std::map<uint32_t, uint32_t> m_nodeIndex;             ///< ns-3 node id -> graph node
+    std::unordered_map<uint32_t, uint32_t> m_addressNode; ///< interface address -> graph node
+    std::vector<LinkInfo> m_links;
+    std::vector<Network> m_networks;
+    std::vector<std::vector<uint32_t>> m_nodeNetworks; ///< networks each node is attached to
+    std::vector<Ptr<Ipv4>> m_ipv4s;
+    std::vector<Ptr<Ipv4LpmRouting>> m_fibs;
+    std::vector<std::vector<uint32_t>> m_installed;    ///< per node and network: link of the route, NONE
+    std::vector<std::pair<uint32_t, uint32_t>> m_dirty; ///< (node, network) to refresh
+    std::vector<Callback<void>> m_costChanged;
+    Statistics m_stats;
+};
+
+inline void
+IncrementalSpfRouting::Populate(NodeContainer nodes)
+{
+    for (uint32_t i = 0; i < nodes.GetN(); ++i)
+    {
+        if (nodes.Get(i)->GetObject<Ipv4>())
+        {
+            m_nodeIndex[nodes.Get(i)->GetId()] = m_spf.AddNode();
+            m_ipv4s.push_back(nodes.Get(i)->GetObject<Ipv4>());
+            m_fibs.push_back(nullptr);
+        }
+    }
+
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> networkIndex; // (network, mask) -> index
+    m_nodeNetworks.resize(m_spf.GetNNodes());
+    Ipv4LpmRoutingHelper lpmHelper;
+    for (uint32_t i = 0; i < nodes.GetN(); ++i)
+    {
+        Ptr<Ipv4> ipv4 = nodes.Get(i)->GetObject<Ipv4>();
+        if (!ipv4)
+        {
+            continue;
+        }
+        uint32_t node = m_nodeIndex[nodes.Get(i)->GetId()];
+        m_fibs[node] = Ipv4LpmRoutingHelper::GetLpmRouting(ipv4);
+        if (!m_fibs[node])
+        {
+            m_fibs[node] = lpmHelper.Install(nodes.Get(i));
+        }
+        for (uint32_t interface = 0; interface < ipv4->GetNInterfaces(); ++interface)
+        {
+            if (ipv4->GetNAddresses(interface) == 0)
+            {
+                continue;
+            }
+            Ipv4InterfaceAddress address = ipv4->GetAddress(interface, 0);
+            if (address.GetLocal().IsLocalhost())
+            {
+                continue;
+            }
+            Ipv4Mask mask = address.GetMask();
+            Ipv4Address network = address.GetLocal().CombineMask(mask);
+            auto found = networkIndex.emplace(std::make_pair(network.Get(), mask.Get()), m_networks.size());
+            if (found.second)
+            {
+                m_networks.push_back({network, mask, {}, {}});
+            }
+            m_networks[found.first->second].attached.emplace_back(node, interface);
+            m_networks[found.first->second].up.push_back(ipv4->IsUp(interface));
+            m_nodeNetworks[node].push_back(found.first->second);
+            m_addressNode[address.GetLocal().Get()] = node;
+
+            Ptr<Channel> channel = ipv4->GetNetDevice(interface)->GetChannel();
+            for (std::size_t d = 0; channel && d < channel->GetNDevices(); ++d)
+            {
+                Ptr<NetDevice> device = channel->GetDevice(d);
+                Ptr<Ipv4> peerIpv4 = device->GetNode()->GetObject<Ipv4>();
+                auto peer = m_nodeIndex.find(device->GetNode()->GetId());
+                if (device == ipv4->GetNetDevice(interface) || !peerIpv4 || peer == m_nodeIndex.end())
+                {
+                    continue;
+                }
+                int32_t peerInterface = peerIpv4->GetInterfaceForDevice(device);
+                if (peerInterface < 0 || peerIpv4->GetNAddresses(peerInterface) == 0)
+                {
+                    continue;
+                }
+                LinkInfo link{ipv4, interface, peerIpv4, static_cast<uint32_t>(peerInterface),
+                              peerIpv4->GetAddress(peerInterface, 0).GetLocal()};
+                m_spf.AddLink(node, peer->second, CurrentMetric(link));
+                m_links.push_back(link);
+            }
+        }
+    }
+
+    for (uint32_t node = 0; node < m_spf.GetNNodes(); ++node)
+    {
+        m_spf.AddRoot(node); // root index == node index
+    }
+    m_spf.ComputeAll();
+    m_spf.SetChangeCallback([this](uint32_t root, uint32_t node) { Changed(root, node); });
+
+    m_installed.assign(m_spf.GetNNodes(), std::vector<uint32_t>(m_networks.size(), IncrementalSpf::NONE));
+    uint64_t before = m_stats.fibUpdates;
+    for (uint32_t node = 0; node < m_spf.GetNNodes(); ++node)
+    {
+        for (uint32_t network = 0; network < m_networks.size(); ++network)
+        {
+            Refresh(node, network);
+        }
+    }
+    m_stats.fibRoutes = m_stats.fibUpdates - before;
+    m_stats.fibUpdates = before;
+}
+
+inline uint32_t
+IncrementalSpfRouting::CurrentMetric(const LinkInfo& link) const
+{
+    if (!link.ipv4->IsUp(link.interface) || !link.peerIpv4->IsUp(link.peerInterface))
+    {
+        return IncrementalSpf::INFINITE;
+    }
+    return link.ipv4->GetMetric(link.interface);
+}
+
+inline bool
+IncrementalSpfRouting::IsConnected(uint32_t node, uint32_t network) const
+{
+    for (const auto& attached : m_networks[network].attached)
+    {
+        if (attached.first == node && m_ipv4s[node]->IsUp(attached.second))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint32_t
+IncrementalSpfRouting::BestRoute(uint32_t root, uint32_t network) const
+{
+    if (IsConnected(root, network))
+    {
+        return IncrementalSpf::NONE; // Ipv4LpmRouting has the connected route
+    }
+    uint32_t best = IncrementalSpf::INFINITE;
+    uint32_t route = IncrementalSpf::NONE;
+    for (const auto& attached : m_networks[network].attached)
+    {
+        // A down interface no longer connects its node to the network
+        if (attached.first == root || !m_ipv4s[attached.first]->IsUp(attached.second))
+        {
+            continue;
+        }
+        uint32_t distance = m_spf.GetDistance(root, attached.first);
+        if (distance < best)
+        {
+            best = distance;
+            route = m_spf.GetFirstHop(root, attached.first);
+        }
+    }
+    return route;
+}
+
+inline void
+IncrementalSpfRouting::Refresh(uint32_t root, uint32_t network)
+{
+    uint32_t route = BestRoute(root, network);
+    uint32_t& installed = m_installed[root][network];
+    if (route == installed)
+    {
+        return;
+    }
+    const Network& n = m_networks[network];
+    if (route == IncrementalSpf::NONE)
+    {
+        // An interface coming back up has already replaced the route with the connected one
+        if (!IsConnected(root, network))
+        {
+            m_fibs[root]->RemoveNetworkRouteTo(n.address, n.mask);
+        }
+    }
+    else
+    {
+        m_fibs[root]->AddNetworkRouteTo(n.address, n.mask, m_links[route].gateway, m_links[route].interface);
+    }
+    installed = route;
+    m_stats.fibUpdates++;
+}
+
+inline void
+IncrementalSpfRouting::Changed(uint32_t root, uint32_t node)
+{
+    for (uint32_t network : m_nodeNetworks[node])
+    {
+        m_dirty.emplace_back(root, network);
+    }
+}
+
+inline void
+IncrementalSpfRouting::Update()
+{
+    m_stats.updates++;
+    m_dirty.clear();
+    for (uint32_t link = 0; link < m_links.size(); ++link)
+    {
+        uint32_t metric = CurrentMetric(m_links[link]);
+        if (metric != m_spf.GetMetric(link))
+        {
+            m_stats.linkChanges++;
+            m_spf.SetMetric(link, metric);
+            // The sending node's own interface state decides its connected networks
+            uint32_t from = m_spf.GetFrom(link);
+            for (uint32_t network : m_nodeNetworks[from])
+            {
+                m_dirty.emplace_back(from, network);
+            }
+        }
+    }
+    // An attachment going down or up moves every node's route to its network,
+    // also for interfaces without a neighbour in the graph (stub networks)
+    for (uint32_t network = 0; network < m_networks.size(); ++network)
+    {
+        Network& n = m_networks[network];
+        for (std::size_t a = 0; a < n.attached.size(); ++a)
+        {
+            bool up = m_ipv4s[n.attached[a].first]->IsUp(n.attached[a].second);
+            if (up == n.up[a])
+            {
+                continue;
+            }
+            n.up[a] = up;
+            m_stats.interfaceChanges++;
+            for (uint32_t node = 0; node < m_spf.GetNNodes(); ++node)
+            {
+                m_dirty.emplace_back(node, network);
+            }
+        }
+    }
+    std::sort(m_dirty.begin(), m_dirty.end());
+    m_dirty.erase(std::unique(m_dirty.begin(), m_dirty.end()), m_dirty.end());
+    for (const auto& dirty : m_dirty)
+    {
+        Refresh(dirty.first, dirty.second);
+    }
+    if (!m_dirty.empty())
+    {
+        for (const auto& callback : m_costChanged)
+        {
+            callback();
+        }
+    }
+}
+
+inline uint32_t
+IncrementalSpfRouting::GetCost(Ptr<Node> node, Ipv4Address address) const
+{
+    auto from = m_nodeIndex.find(node->GetId());
+    if (from == m_nodeIndex.end())
+    {
+        return IncrementalSpf::INFINITE;
+    }
+    auto owner = m_addressNode.find(address.Get());
+    if (owner != m_addressNode.end())
+    {
+        return m_spf.GetDistance(from->second, owner->second);
+    }
+    uint32_t best = IncrementalSpf::INFINITE;
+    for (const auto& network : m_networks)
+    {
+        if (network.mask.IsMatch(network.address, address))
+        {
+            for (const auto& attached : network.attached)
+            {
+                if (m_ipv4s[attached.first]->IsUp(attached.second))
+                {
+                    best = std::min(best, m_spf.GetDistance(from->second, attached.first));
+                }
+            }
+        }
+    }
+    return best;
+}
+
+inline uint32_t
+IncrementalSpfRouting::CostFrom(const IncrementalSpfRouting* routing, Ptr<Node> node, Ipv4Address address)
+{
+    return routing->GetCost(node, address);
+}
+
+inline Callback<uint32_t, Ipv4Address>
+IncrementalSpfRouting::GetCostCallback(Ptr<Node> node) const
+{
+    return MakeBoundCallback(&IncrementalSpfRouting::CostFrom, this, node);
+}
+
+inline void
+IncrementalSpfRouting::AddCostChangeCallback(Callback<void> callback)
+{
+    m_costChanged.push_back(callback);
+}
+
+inline const IncrementalSpf&
+IncrementalSpfRouting::GetSpf() const
+{
+    return m_spf;
+}
+
+inline const IncrementalSpfRouting::Statistics&
+IncrementalSpfRouting::GetStatistics() const
+{
+    return m_stats;
+}
+
+} // namespace ns3
+
+#endif /* WAN_INCREMENTAL_SPF_H */
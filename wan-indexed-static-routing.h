@@ -0,0 +1,601 @@
+/*
+ * Indexed static routing: Ipv4StaticRouting's routes, found through a trie
+ *
+ * Ipv4StaticRouting::LookupStatic walks every route for every packet to
+ * find the longest match with the lowest metric, so forwarding slows down
+ * linearly with the table. Ipv4IndexedStaticRouting keeps the same routes
+ * and answers the same way, but groups them by prefix: every prefix has a
+ * list of its routes sorted by metric (the primary first, then its
+ * backups), and an LpmTrie (wan-lpm-fib.h) maps addresses to the prefix.
+ * A lookup is a trie lookup plus the head of one list; adding or removing
+ * a route touches one list.
+ *
+ * It is a drop-in replacement: the route API (AddNetworkRouteTo,
+ * AddHostRouteTo, SetDefaultRoute with metrics, GetNRoutes, GetRoute,
+ * GetMetric, RemoveRoute by index) and the behaviour match
+ * Ipv4StaticRouting:
+ *  - among routes to the same prefix the lowest metric wins, and between
+ *    equal metrics the route added last;
+ *  - routes whose output device is not the requested one are skipped, and
+ *    the lookup falls back to shorter prefixes;
+ *  - connected routes are added when an address comes up, and every route
+ *    through an interface is removed when the interface goes down.
+ *
+ * Unicast only: multicast routes are not supported.
+ *
+ * Usage: copy this header and wan-lpm-fib.h next to the exercise script in
+ * scratch/.
+ */
+
+#ifndef WAN_INDEXED_STATIC_ROUTING_H
+#define WAN_INDEXED_STATIC_ROUTING_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "wan-lpm-fib.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Ipv4StaticRouting with a per-prefix index of metric-sorted routes.
+ */
+class Ipv4IndexedStaticRouting : public Ipv4RoutingProtocol
+{
+  public:
+    static TypeId GetTypeId();
+
+    Ipv4IndexedStaticRouting();
+    ~Ipv4IndexedStaticRouting() override;
+
+    void AddNetworkRouteTo(Ipv4Address network,
+                           Ipv4Mask networkMask,
+                           Ipv4Address nextHop,
+                           uint32_t interface,
+                           uint32_t metric = 0);
+    void AddNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask, uint32_t interface, uint32_t metric = 0);
+    void AddHostRouteTo(Ipv4Address dest, Ipv4Address nextHop, uint32_t interface, uint32_t metric = 0);
+    void AddHostRouteTo(Ipv4Address dest, uint32_t interface, uint32_t metric = 0);
+    void SetDefaultRoute(Ipv4Address nextHop, uint32_t interface, uint32_t metric = 0);
+
+    /// Number of routes, connected routes included
+    uint32_t GetNRoutes() const;
+
+    /// Route i, in the order the routes were added
+    Ipv4RoutingTableEntry GetRoute(uint32_t i) const;
+    uint32_t GetMetric(uint32_t i) const;
+
+    /// Remove route i; the routes after it move down by one
+    void RemoveRoute(uint32_t i);
+
+    /// Number of distinct prefixes
+    uint32_t GetNPrefixes() const;
+
+    // Inherited from Ipv4RoutingProtocol
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    struct Route
+    {
+        uint32_t network;
+        uint8_t length;
+        bool live{false};
+        Ipv4Address gateway; ///< 0.0.0.0 for on-link routes
+        uint32_t interface;
+        uint32_t metric;
+        uint32_t prefix; ///< index into m_prefixes
+    };
+
+    /// The routes to one prefix, lowest metric first
+    struct Prefix
+    {
+        uint32_t network;
+        uint8_t length;
+        std::vector<uint32_t> routes;
+    };
+
+    void AddRoute(uint32_t network, uint8_t length, Ipv4Address gateway, uint32_t interface, uint32_t metric);
+    /// Unlink route id from its prefix and free it; m_order is left to the caller
+    void Unlink(uint32_t id);
+    /// Drop freed routes from m_order
+    void CompactOrder();
+    /// First route of the prefix usable through oif, or nullptr
+    const Route* Select(uint32_t prefix, Ptr<NetDevice> oif) const;
+    Ptr<Ipv4Route> Lookup(Ipv4Address destination, Ptr<NetDevice> oif) const;
+
+    Ptr<Ipv4> m_ipv4;
+    LpmTrie m_trie; ///< prefix -> index into m_prefixes
+    std::vector<Route> m_routes;
+    std::vector<uint32_t> m_freeRoutes;
+    std::vector<Prefix> m_prefixes;
+    std::vector<uint32_t> m_freePrefixes;
+    std::vector<uint32_t> m_order; ///< live route ids in GetRoute() order
+};
+
+NS_OBJECT_ENSURE_REGISTERED(Ipv4IndexedStaticRouting);
+
+inline TypeId
+Ipv4IndexedStaticRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::Ipv4IndexedStaticRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<Ipv4IndexedStaticRouting>();
+    return tid;
+}
+
+inline Ipv4IndexedStaticRouting::Ipv4IndexedStaticRouting()
+{
+}
+
+inline Ipv4IndexedStaticRouting::~Ipv4IndexedStaticRouting()
+{
+}
+
+inline void
+Ipv4IndexedStaticRouting::DoDispose()
+{
+    m_trie.Clear();
+    m_routes.clear();
+    m_freeRoutes.clear();
+    m_prefixes.clear();
+    m_freePrefixes.clear();
+    m_order.clear();
+    m_ipv4 = nullptr;
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+inline void
+Ipv4IndexedStaticRouting::AddRoute(uint32_t network,
+                                   uint8_t length,
+                                   Ipv4Address gateway,
+                                   uint32_t interface,
+                                   uint32_t metric)
+{
+    network &= length == 0 ? 0 : ~uint32_t(0) << (32 - length);
+    uint32_t prefix;
+    if (!m_trie.Find(network, length, prefix))
+    {
+        if (!m_freePrefixes.empty())
+        {
+            prefix = m_freePrefixes.back();
+            m_freePrefixes.pop_back();
+        }
+        else
+        {
+            prefix = m_prefixes.size();
+            m_prefixes.emplace_back();
+        }
+        m_prefixes[prefix].network = network;
+        m_prefixes[prefix].length = length;
+        m_prefixes[prefix].routes.clear();
+        m_trie.Insert(network, length, prefix);
+    }
+
+    uint32_t id;
+    if (!m_freeRoutes.empty())
+    {
+        id = m_freeRoutes.back();
+        m_freeRoutes.pop_back();
+    }
+    else
+    {
+        id = m_routes.size();
+        m_routes.emplace_back();
+    }
+    m_routes[id] = {network, length, true, gateway, interface, metric, prefix};
+    m_order.push_back(id);
+
+    // Ahead of the routes with the same metric: Ipv4StaticRouting prefers the one added last
+    std::vector<uint32_t>& routes = m_prefixes[prefix].routes;
+    auto position = std::lower_bound(routes.begin(), routes.end(), metric, [this](uint32_t route, uint32_t m) {
+        return m_routes[route].metric < m;
+    });
+    routes.insert(position, id);
+}
+
+inline void
+Ipv4IndexedStaticRouting::Unlink(uint32_t id)
+{
+    Route& route = m_routes[id];
+    Prefix& prefix = m_prefixes[route.prefix];
+    prefix.routes.erase(std::find(prefix.routes.begin(), prefix.routes.end(), id));
+    if (prefix.routes.empty())
+    {
+        m_trie.Remove(prefix.network, prefix.length);
+        m_freePrefixes.push_back(route.prefix);
+    }
+    route.live = false;
+    m_freeRoutes.push_back(id);
+}
+
+inline void
+Ipv4IndexedStaticRouting::CompactOrder()
+{
+    m_order.erase(std::remove_if(m_order.begin(),
+                                 m_order.end(),
+                                 [this](uint32_t id) { return !m_routes[id].live; }),
+                  m_order.end());
+}
+
+inline void
+Ipv4IndexedStaticRouting::AddNetworkRouteTo(Ipv4Address network,
+                                            Ipv4Mask networkMask,
+                                            Ipv4Address nextHop,
+                                            uint32_t interface,
+                                            uint32_t metric)
+{
+    AddRoute(network.Get(), networkMask.GetPrefixLength(), nextHop, interface, metric);
+}
+
+inline void
+Ipv4IndexedStaticRouting::AddNetworkRouteTo(Ipv4Address network,
+                                            Ipv4Mask networkMask,
+                                            uint32_t interface,
+                                            uint32_t metric)
+{
+    AddRoute(network.Get(), networkMask.GetPrefixLength(), Ipv4Address::GetZero(), interface, metric);
+}
+
+inline void
+Ipv4IndexedStaticRouting::AddHostRouteTo(Ipv4Address dest,
+                                         Ipv4Address nextHop,
+                                         uint32_t interface,
+                                         uint32_t metric)
+{
+    AddRoute(dest.Get(), 32, nextHop, interface, metric);
+}
+
+inline void
+Ipv4IndexedStaticRouting::AddHostRouteTo(Ipv4Address dest, uint32_t interface, uint32_t metric)
+{
+    AddRoute(dest.Get(), 32, Ipv4Address::GetZero(), interface, metric);
+}
+
+inline void
+Ipv4IndexedStaticRouting::SetDefaultRoute(Ipv4Address nextHop, uint32_t interface, uint32_t metric)
+{
+    AddRoute(0, 0, nextHop, interface, metric);
+}
+
+inline uint32_t
+Ipv4IndexedStaticRouting::GetNRoutes() const
+{
+    return m_order.size();
+}
+
+inline Ipv4RoutingTableEntry
+Ipv4IndexedStaticRouting::GetRoute(uint32_t i) const
+{
+    NS_ASSERT_MSG(i < m_order.size(), "Ipv4IndexedStaticRouting: route " << i << " out of range");
+    const Route& route = m_routes[m_order[i]];
+    Ipv4Mask mask(route.length == 0 ? 0 : ~uint32_t(0) << (32 - route.length));
+    if (route.gateway == Ipv4Address::GetZero())
+    {
+        return Ipv4RoutingTableEntry::CreateNetworkRouteTo(Ipv4Address(route.network), mask, route.interface);
+    }
+    return Ipv4RoutingTableEntry::CreateNetworkRouteTo(Ipv4Address(route.network),
+                                                       mask,
+                                                       route.gateway,
+                                                       route.interface);
+}
+
+inline uint32_t
+Ipv4IndexedStaticRouting::GetMetric(uint32_t i) const
+{
+    NS_ASSERT_MSG(i < m_order.size(), "Ipv4IndexedStaticRouting: route " << i << " out of range");
+    return m_routes[m_order[i]].metric;
+}
+
+inline void
+Ipv4IndexedStaticRouting::RemoveRoute(uint32_t i)
+{
+    NS_ASSERT_MSG(i < m_order.size(), "Ipv4IndexedStaticRouting: route " << i << " out of range");
+    Unlink(m_order[i]);
+    m_order.erase(m_order.begin() + i);
+}
+
+inline uint32_t
+Ipv4IndexedStaticRouting::GetNPrefixes() const
+{
+    return m_trie.GetNPrefixes();
+}
+
+inline const Ipv4IndexedStaticRouting::Route*
+Ipv4IndexedStaticRouting::Select(uint32_t prefix, Ptr<NetDevice> oif) const
+{
+    for (uint32_t id : m_prefixes[prefix].routes)
+    {
+        const Route& route = m_routes[id];
+        if (!oif || oif == m_ipv4->GetNetDevice(route.interface))
+        {
+            return &route;
+        }
+    }
+    return nullptr;
+}
+
+inline Ptr<Ipv4Route>
+Ipv4IndexedStaticRouting::Lookup(Ipv4Address destination, Ptr<NetDevice> oif) const
+{
+    uint32_t address = destination.Get();
+    uint32_t prefix = m_trie.Lookup(address);
+    if (prefix == LpmTrie::NO_ROUTE)
+    {
+        return nullptr;
+    }
+    const Route* route = Select(prefix, oif);
+    // Only with an output device can the longest prefix have no usable route
+    for (int length = m_prefixes[prefix].length - 1; !route && length >= 0; --length)
+    {
+        uint32_t shorter;
+        if (m_trie.Find(address & (length == 0 ? 0 : ~uint32_t(0) << (32 - length)), length, shorter))
+        {
+            route = Select(shorter, oif);
+        }
+    }
+    if (!route)
+    {
+        return nullptr;
+    }
+    Ptr<Ipv4Route> rtentry = Create<Ipv4Route>();
+    rtentry->SetDestination(destination);
+    rtentry->SetGateway(route->gateway);
+    rtentry->SetOutputDevice(m_ipv4->GetNetDevice(route->interface));
+    rtentry->SetSource(m_ipv4->SourceAddressSelection(route->interface, destination));
+    return rtentry;
+}
+
+inline Ptr<Ipv4Route>
+Ipv4IndexedStaticRouting::RouteOutput(Ptr<Packet> p,
+                                      const Ipv4Header& header,
+                                      Ptr<NetDevice> oif,
+                                      Socket::SocketErrno& sockerr)
+{
+    Ptr<Ipv4Route> route;
+    if (!header.GetDestination().IsMulticast())
+    {
+        route = Lookup(header.GetDestination(), oif);
+    }
+    sockerr = route ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+    return route;
+}
+
+inline bool
+Ipv4IndexedStaticRouting::RouteInput(Ptr<const Packet> p,
+                                     const Ipv4Header& header,
+                                     Ptr<const NetDevice> idev,
+                                     const UnicastForwardCallback& ucb,
+                                     const MulticastForwardCallback& mcb,
+                                     const LocalDeliverCallback& lcb,
+                                     const ErrorCallback& ecb)
+{
+    NS_ASSERT(m_ipv4->GetInterfaceForDevice(idev) >= 0);
+    uint32_t iif = m_ipv4->GetInterfaceForDevice(idev);
+
+    if (header.GetDestination().IsMulticast())
+    {
+        return false;
+    }
+    if (m_ipv4->IsDestinationAddress(header.GetDestination(), iif))
+    {
+        if (!lcb.IsNull())
+        {
+            lcb(p, header, iif);
+            return true;
+        }
+        return false;
+    }
+    if (!m_ipv4->IsForwarding(iif))
+    {
+        ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+        return true;
+    }
+    Ptr<Ipv4Route> route = Lookup(header.GetDestination(), nullptr);
+    if (route)
+    {
+        ucb(route, p, header);
+        return true;
+    }
+    return false;
+}
+
+inline void
+Ipv4IndexedStaticRouting::NotifyInterfaceUp(uint32_t interface)
+{
+    for (uint32_t j = 0; j < m_ipv4->GetNAddresses(interface); ++j)
+    {
+        NotifyAddAddress(interface, m_ipv4->GetAddress(interface, j));
+    }
+}
+
+inline void
+Ipv4IndexedStaticRouting::NotifyInterfaceDown(uint32_t interface)
+{
+    // Like Ipv4StaticRouting: every route out of the interface goes away
+    for (uint32_t id : m_order)
+    {
+        if (m_routes[id].interface == interface)
+        {
+            Unlink(id);
+        }
+    }
+    CompactOrder();
+}
+
+inline void
+Ipv4IndexedStaticRouting::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    Ipv4Mask mask = address.GetMask();
+    if (!m_ipv4->IsUp(interface) || address.GetLocal() == Ipv4Address() || mask == Ipv4Mask())
+    {
+        return;
+    }
+    AddNetworkRouteTo(address.GetLocal().CombineMask(mask), mask, interface);
+}
+
+inline void
+Ipv4IndexedStaticRouting::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    Ipv4Mask mask = address.GetMask();
+    uint32_t network = address.GetLocal().CombineMask(mask).Get();
+    uint32_t prefix;
+    if (!m_trie.Find(network, mask.GetPrefixLength(), prefix))
+    {
+        return;
+    }
+    std::vector<uint32_t> connected;
+    for (uint32_t id : m_prefixes[prefix].routes)
+    {
+        if (m_routes[id].interface == interface && m_routes[id].gateway == Ipv4Address::GetZero())
+        {
+            connected.push_back(id);
+        }
+    }
+    for (uint32_t id : connected)
+    {
+        Unlink(id);
+    }
+    CompactOrder();
+}
+
+inline void
+Ipv4IndexedStaticRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    NS_ASSERT(!m_ipv4 && ipv4);
+    m_ipv4 = ipv4;
+    for (uint32_t i = 0; i < m_ipv4->GetNInterfaces(); ++i)
+    {
+        if (m_ipv4->IsUp(i))
+        {
+            NotifyInterfaceUp(i);
+        }
+    }
+}
+
+inline void
+Ipv4IndexedStaticRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    // Same layout as Ipv4StaticRouting, so that RouteTable (wan-route-table.h) reads it back
+    std::ostream* os = stream->GetStream();
+    Ptr<Node> node = m_ipv4->GetObject<Node>();
+    *os << "Node: " << node->GetId() << ", Time: " << Simulator::Now().As(unit)
+        << ", Local time: " << node->GetLocalTime().As(unit) << ", Ipv4IndexedStaticRouting table"
+        << "\n";
+    if (m_order.empty())
+    {
+        *os << "\n";
+        return;
+    }
+    *os << "Destination     Gateway         Genmask         Flags Metric Ref    Use Iface\n";
+    for (uint32_t id : m_order)
+    {
+        const Route& route = m_routes[id];
+        std::ostringstream destination, gateway, mask;
+        destination << Ipv4Address(route.network);
+        gateway << route.gateway;
+        mask << Ipv4Mask(route.length == 0 ? 0 : ~uint32_t(0) << (32 - route.length));
+        std::string flags = "U";
+        if (route.length == 32)
+        {
+            flags += "H";
+        }
+        else if (route.gateway != Ipv4Address::GetZero())
+        {
+            flags += "GS";
+        }
+        *os << std::left << std::setw(16) << destination.str() << std::setw(16) << gateway.str()
+            << std::setw(16) << mask.str() << std::setw(6) << flags << std::setw(7) << route.metric
+            << "-      -   " << route.interface << "\n";
+    }
+    *os << std::right << "\n";
+}
+
+/**
+ * Creates Ipv4IndexedStaticRouting instances, either through
+ * Ipv4ListRoutingHelper / InternetStackHelper::SetRoutingHelper (in place
+ * of Ipv4StaticRoutingHelper) or directly on a node that already has an
+ * Internet stack.
+ */
+class Ipv4IndexedStaticRoutingHelper : public Ipv4RoutingHelper
+{
+  public:
+    Ipv4IndexedStaticRoutingHelper()
+        : m_priority(0)
+    {
+    }
+
+    Ipv4IndexedStaticRoutingHelper* Copy() const override
+    {
+        return new Ipv4IndexedStaticRoutingHelper(*this);
+    }
+
+    Ptr<Ipv4RoutingProtocol> Create(Ptr<Node> node) const override
+    {
+        return CreateObject<Ipv4IndexedStaticRouting>();
+    }
+
+    /// List routing priority used by Install() (static routing is 0)
+    void SetPriority(int16_t priority)
+    {
+        m_priority = priority;
+    }
+
+    /// Add an Ipv4IndexedStaticRouting to the node's Ipv4ListRouting
+    Ptr<Ipv4IndexedStaticRouting> Install(Ptr<Node> node) const
+    {
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+        NS_ABORT_MSG_UNLESS(list, "Ipv4IndexedStaticRoutingHelper needs the default Ipv4ListRouting on the node");
+        Ptr<Ipv4IndexedStaticRouting> routing = CreateObject<Ipv4IndexedStaticRouting>();
+        list->AddRoutingProtocol(routing, m_priority);
+        return routing;
+    }
+
+    /// Find the Ipv4IndexedStaticRouting of a node, or nullptr
+    static Ptr<Ipv4IndexedStaticRouting> GetIndexedStaticRouting(Ptr<Ipv4> ipv4)
+    {
+        Ptr<Ipv4RoutingProtocol> protocol = ipv4->GetRoutingProtocol();
+        Ptr<Ipv4IndexedStaticRouting> routing = DynamicCast<Ipv4IndexedStaticRouting>(protocol);
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(protocol);
+        for (uint32_t i = 0; !routing && list && i < list->GetNRoutingProtocols(); ++i)
+        {
+            int16_t priority;
+            routing = DynamicCast<Ipv4IndexedStaticRouting>(list->GetRoutingProtocol(i, priority));
+        }
+        return routing;
+    }
+
+  private:
+    int16_t m_priority;
+};
+
+} // namespace ns3
+
+#endif /* WAN_INDEXED_STATIC_ROUTING_H */
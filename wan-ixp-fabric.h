@@ -0,0 +1,106 @@
+/*
+ * Switched peering LAN of an Internet exchange point
+ *
+ * The IXP links of exercise01 are point-to-point links between two routers.
+ * A real exchange is one Ethernet segment that hundreds of member routers
+ * attach to, each with an address out of the exchange's peering prefix,
+ * usually with a route server (BgpSpeaker with RouteServer, see
+ * wan-bgp-speaker.h) as one more port so that a member needs a single BGP
+ * session to reach everybody else.
+ *
+ * IxpFabricHelper builds that segment: every port node gets a CSMA link to
+ * a switch node that bridges all of them (BridgeNetDevice), so frames
+ * between two members are only delivered to those two once the switch has
+ * learned their MAC addresses. A single shared CsmaChannel would hand
+ * every frame to every port and serialize all members on one medium, which
+ * does not scale to a large exchange.
+ *
+ * Simplifications compared to a real exchange:
+ *  - one switch, no VLANs, no port security or MAC filtering;
+ *  - all ports run at the same rate.
+ *
+ * Usage: copy this header next to the exercise script in scratch/; the
+ * bridge and csma modules must be enabled.
+ */
+
+#ifndef WAN_IXP_FABRIC_H
+#define WAN_IXP_FABRIC_H
+
+#include "ns3/bridge-module.h"
+#include "ns3/core-module.h"
+#include "ns3/csma-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+namespace ns3
+{
+
+/// A peering LAN built by IxpFabricHelper
+struct IxpFabric
+{
+    Ptr<Node> switchNode;
+    NetDeviceContainer ports;        ///< one device per port node, in Install() order
+    Ipv4InterfaceContainer addresses; ///< peering LAN address of every port
+};
+
+/**
+ * Builds a bridged CSMA peering LAN between nodes that already have an
+ * Internet stack.
+ */
+class IxpFabricHelper
+{
+  public:
+    IxpFabricHelper()
+    {
+        m_csma.SetChannelAttribute("DataRate", StringValue("10Gbps"));
+        m_csma.SetChannelAttribute("Delay", TimeValue(MicroSeconds(5)));
+    }
+
+    /// Attribute of every port link's CsmaChannel (DataRate, Delay)
+    void SetChannelAttribute(std::string name, const AttributeValue& value)
+    {
+        m_csma.SetChannelAttribute(name, value);
+    }
+
+    /// Attribute of every CsmaNetDevice, on both ends of the port links
+    void SetDeviceAttribute(std::string name, const AttributeValue& value)
+    {
+        m_csma.SetDeviceAttribute(name, value);
+    }
+
+    /**
+     * Attach the nodes to a new switch and number them from the peering prefix.
+     * \param nodes routers (and route server) that get a port, each needing an Ipv4
+     * \param network peering LAN prefix, e.g. 80.81.192.0
+     * \param mask peering LAN mask, large enough for all nodes
+     */
+    IxpFabric Install(const NodeContainer& nodes, Ipv4Address network, Ipv4Mask mask) const
+    {
+        NS_ABORT_MSG_UNLESS(uint64_t(nodes.GetN()) + 2 <= uint64_t(~mask.Get()) + 1,
+                            "IXP peering LAN " << network << mask << " too small for " << nodes.GetN()
+                                               << " ports");
+        IxpFabric fabric;
+        fabric.switchNode = CreateObject<Node>();
+        NetDeviceContainer switchPorts;
+        for (uint32_t i = 0; i < nodes.GetN(); ++i)
+        {
+            NetDeviceContainer link = m_csma.Install(NodeContainer(nodes.Get(i), fabric.switchNode));
+            fabric.ports.Add(link.Get(0));
+            switchPorts.Add(link.Get(1));
+        }
+        BridgeHelper bridge;
+        bridge.Install(fabric.switchNode, switchPorts);
+
+        Ipv4AddressHelper address;
+        address.SetBase(network, mask);
+        fabric.addresses = address.Assign(fabric.ports);
+        return fabric;
+    }
+
+  private:
+    CsmaHelper m_csma;
+};
+
+} // namespace ns3
+
+#endif /* WAN_IXP_FABRIC_H */
@@ -0,0 +1,847 @@
+/*
+ * Longest-prefix-match FIB for large IPv4 forwarding tables
+ *
+ * Ipv4StaticRouting and Ipv4GlobalRouting walk a list of routes for every
+ * packet, which is fine for the handful of routes in the exercises but not
+ * for a full Internet table on an AS border router. LpmTrie is a
+ * level-compressed multibit trie with fixed 16-8-8 strides and controlled
+ * prefix expansion: a lookup reads at most three 4-byte slots (one per
+ * level), so it touches at most three cache lines whatever the table size.
+ *
+ *   level 1: 65536 slots indexed by address bits 31..16
+ *   level 2: 256-slot chunks indexed by bits 15..8, for /17 - /24 prefixes
+ *   level 3: 256-slot chunks indexed by bits 7..0,  for /25 - /32 prefixes
+ *
+ * A slot holds either a value (the leaf) or the index of a child chunk.
+ * Every slot also remembers the length of the prefix that painted it, so
+ * inserts and removals are incremental: a more specific prefix is never
+ * overwritten by a shorter one, and removing a prefix repaints its slots
+ * with the next shorter covering prefix. Chunks that no longer hold any
+ * prefix longer than their parent slot are folded back into it.
+ *
+ * Ipv4LpmRouting wraps the trie as an Ipv4RoutingProtocol with the same
+ * route API as Ipv4StaticRouting. Leaves hold an index into a shared
+ * next-hop table, so a million prefixes through a few neighbours cost a few
+ * bytes of next-hop state in total. One route per prefix: adding a route for
+ * an existing prefix replaces it (there is no per-route metric).
+ *
+ * Usage: copy this header next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_LPM_FIB_H
+#define WAN_LPM_FIB_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * 16-8-8 multibit trie mapping IPv4 prefixes to 31-bit values.
+ *
+ * Plain C++ with no simulator dependencies, so it can be reused by other
+ * routing protocols (BgpSpeaker keeps its forwarding view in one).
+ */
+class LpmTrie
+{
+  public:
+    /// Returned by Lookup() when no prefix covers the address
+    static constexpr uint32_t NO_ROUTE = 0x7fffffff;
+    /// Largest value that can be stored
+    static constexpr uint32_t MAX_VALUE = NO_ROUTE - 1;
+
+    LpmTrie();
+
+    /**
+     * Insert or replace a prefix.
+     * \param address prefix address in host byte order (host bits are ignored)
+     * \param length prefix length, 0 - 32
+     * \param value value returned by Lookup(), at most MAX_VALUE
+     * \return true if the prefix was not in the table before
+     */
+    bool Insert(uint32_t address, uint8_t length, uint32_t value);
+
+    /// Remove a prefix; returns false if it was not in the table
+    bool Remove(uint32_t address, uint8_t length);
+
+    /// Value of the longest prefix covering the address, or NO_ROUTE
+    uint32_t Lookup(uint32_t address) const;
+
+    /// Exact-match lookup of a prefix
+    bool Find(uint32_t address, uint8_t length, uint32_t& value) const;
+
+    void Clear();
+
+    /// Number of prefixes in the table
+    std::size_t GetNPrefixes() const;
+
+    /// Number of level 2 and level 3 chunks currently allocated
+    std::size_t GetNChunks() const;
+
+    /// Bytes used by the lookup structure (slot arrays and chunk bookkeeping)
+    std::size_t GetLookupMemory() const;
+
+    /// Bytes used by the exact-match prefix index that drives updates
+    std::size_t GetIndexMemory() const;
+
+    /// Call f(address, length, value) for every prefix, in no particular order
+    template <class F>
+    void ForEach(F f) const
+    {
+        for (const auto& entry : m_prefixes)
+        {
+            f(static_cast<uint32_t>(entry.first >> 8), static_cast<uint8_t>(entry.first & 0xff), entry.second);
+        }
+    }
+
+  private:
+    static constexpr uint32_t CHILD = 0x80000000;
+    static constexpr uint32_t CHUNK_SLOTS = 256;
+
+    static uint32_t Mask(uint32_t address, uint8_t length);
+    static uint64_t Key(uint32_t address, uint8_t length);
+
+    /**
+     * Paint count slots starting at first in the level-1 array (chunk < 0) or
+     * in a chunk. A slot is overwritten when its depth is <= depth (insert)
+     * or exactly matchDepth (remove); child chunks are painted recursively.
+     */
+    void Paint(int64_t chunk, uint32_t first, uint32_t count, uint32_t value, uint8_t depth, uint8_t matchDepth);
+    uint32_t SplitSlot(int64_t chunk, uint32_t slot);
+    void FoldChunk(int64_t parent, uint32_t slot);
+    uint32_t& SlotAt(int64_t chunk, uint32_t slot);
+    uint8_t& DepthAt(int64_t chunk, uint32_t slot);
+
+    std::vector<uint32_t> m_root;        ///< level-1 slots
+    std::vector<uint8_t> m_rootDepth;    ///< prefix length + 1 that painted each slot, 0 = none
+    std::vector<uint32_t> m_chunks;      ///< level-2/3 slots, CHUNK_SLOTS per chunk
+    std::vector<uint8_t> m_chunkDepth;   ///< depth of every chunk slot
+    std::vector<uint32_t> m_chunkRefs;   ///< prefixes stored below each chunk's parent slot
+    std::vector<uint32_t> m_freeChunks;  ///< chunk indices available for reuse
+    std::unordered_map<uint64_t, uint32_t> m_prefixes; ///< (address << 8 | length) -> value
+};
+
+inline LpmTrie::LpmTrie()
+    : m_root(65536, NO_ROUTE),
+      m_rootDepth(65536, 0)
+{
+}
+
+inline uint32_t
+LpmTrie::Mask(uint32_t address, uint8_t length)
+{
+    return length == 0 ? 0 : address & (0xffffffffu << (32 - length));
+}
+
+inline uint64_t
+LpmTrie::Key(uint32_t address, uint8_t length)
+{
+    return (static_cast<uint64_t>(address) << 8) | length;
+}
+
+inline uint32_t&
+LpmTrie::SlotAt(int64_t chunk, uint32_t slot)
+{
+    return chunk < 0 ? m_root[slot] : m_chunks[chunk * CHUNK_SLOTS + slot];
+}
+
+inline uint8_t&
+LpmTrie::DepthAt(int64_t chunk, uint32_t slot)
+{
+    return chunk < 0 ? m_rootDepth[slot] : m_chunkDepth[chunk * CHUNK_SLOTS + slot];
+}
+
+inline uint32_t
+LpmTrie::SplitSlot(int64_t chunk, uint32_t slot)
+{
+    if (SlotAt(chunk, slot) & CHILD)
+    {
+        return SlotAt(chunk, slot) & ~CHILD;
+    }
+    uint32_t child;
+    if (!m_freeChunks.empty())
+    {
+        child = m_freeChunks.back();
+        m_freeChunks.pop_back();
+    }
+    else
+    {
+        child = m_chunkRefs.size();
+        m_chunks.resize(m_chunks.size() + CHUNK_SLOTS);
+        m_chunkDepth.resize(m_chunkDepth.size() + CHUNK_SLOTS);
+        m_chunkRefs.push_back(0);
+    }
+    // The new chunk inherits whatever covered the whole slot before
+    uint32_t value = SlotAt(chunk, slot);
+    uint8_t depth = DepthAt(chunk, slot);
+    std::fill_n(m_chunks.begin() + child * CHUNK_SLOTS, CHUNK_SLOTS, value);
+    std::fill_n(m_chunkDepth.begin() + child * CHUNK_SLOTS, CHUNK_SLOTS, depth);
+    m_chunkRefs[child] = 0;
+    SlotAt(chunk, slot) = CHILD | child;
+    return child;
+}
+
+inline void
+LpmTrie::FoldChunk(int64_t parent, uint32_t slot)
+{
+    uint32_t child = SlotAt(parent, slot) & ~CHILD;
+    // No prefix longer than the parent slot is left, so the chunk is uniform
+    SlotAt(parent, slot) = m_chunks[child * CHUNK_SLOTS];
+    DepthAt(parent, slot) = m_chunkDepth[child * CHUNK_SLOTS];
+    m_freeChunks.push_back(child);
+}
+
+inline void
+LpmTrie::Paint(int64_t chunk, uint32_t first, uint32_t count, uint32_t value, uint8_t depth, uint8_t matchDepth)
+{
+    for (uint32_t i = first; i < first + count; ++i)
+    {
+        uint32_t slot = SlotAt(chunk, i);
+        if (slot & CHILD)
+        {
+            Paint(slot & ~CHILD, 0, CHUNK_SLOTS, value, depth, matchDepth);
+            continue;
+        }
+        uint8_t& current = DepthAt(chunk, i);
+        if (matchDepth ? current == matchDepth : current <= depth)
+        {
+            SlotAt(chunk, i) = value;
+            current = depth;
+        }
+    }
+}
+
+inline bool
+LpmTrie::Insert(uint32_t address, uint8_t length, uint32_t value)
+{
+    NS_ASSERT_MSG(length <= 32 && value <= MAX_VALUE, "LpmTrie: bad prefix length or value");
+    address = Mask(address, length);
+    auto result = m_prefixes.emplace(Key(address, length), value);
+    bool added = result.second;
+    result.first->second = value;
+
+    uint8_t depth = length + 1;
+    if (length <= 16)
+    {
+        Paint(-1, address >> 16, 1u << (16 - length), value, depth, 0);
+        return added;
+    }
+    uint32_t level2 = SplitSlot(-1, address >> 16);
+    if (added)
+    {
+        m_chunkRefs[level2]++;
+    }
+    if (length <= 24)
+    {
+        Paint(level2, (address >> 8) & 0xff, 1u << (24 - length), value, depth, 0);
+        return added;
+    }
+    uint32_t level3 = SplitSlot(level2, (address >> 8) & 0xff);
+    if (added)
+    {
+        m_chunkRefs[level3]++;
+    }
+    Paint(level3, address & 0xff, 1u << (32 - length), value, depth, 0);
+    return added;
+}
+
+inline bool
+LpmTrie::Remove(uint32_t address, uint8_t length)
+{
+    if (length > 32)
+    {
+        return false;
+    }
+    address = Mask(address, length);
+    if (m_prefixes.erase(Key(address, length)) == 0)
+    {
+        return false;
+    }
+
+    // The slots fall back to the longest remaining prefix that covers this one
+    uint32_t value = NO_ROUTE;
+    uint8_t depth = 0;
+    for (int shorter = length - 1; shorter >= 0; --shorter)
+    {
+        auto it = m_prefixes.find(Key(Mask(address, shorter), shorter));
+        if (it != m_prefixes.end())
+        {
+            value = it->second;
+            depth = shorter + 1;
+            break;
+        }
+    }
+
+    uint8_t matchDepth = length + 1;
+    if (length <= 16)
+    {
+        Paint(-1, address >> 16, 1u << (16 - length), value, depth, matchDepth);
+        return true;
+    }
+    uint32_t rootSlot = address >> 16;
+    uint32_t level2 = m_root[rootSlot] & ~CHILD;
+    if (length <= 24)
+    {
+        Paint(level2, (address >> 8) & 0xff, 1u << (24 - length), value, depth, matchDepth);
+    }
+    else
+    {
+        uint32_t level2Slot = (address >> 8) & 0xff;
+        uint32_t level3 = m_chunks[level2 * CHUNK_SLOTS + level2Slot] & ~CHILD;
+        Paint(level3, address & 0xff, 1u << (32 - length), value, depth, matchDepth);
+        if (--m_chunkRefs[level3] == 0)
+        {
+            FoldChunk(level2, level2Slot);
+        }
+    }
+    if (--m_chunkRefs[level2] == 0)
+    {
+        FoldChunk(-1, rootSlot);
+    }
+    return true;
+}
+
+inline uint32_t
+LpmTrie::Lookup(uint32_t address) const
+{
+    uint32_t slot = m_root[address >> 16];
+    if (slot & CHILD)
+    {
+        slot = m_chunks[(slot & ~CHILD) * CHUNK_SLOTS + ((address >> 8) & 0xff)];
+        if (slot & CHILD)
+        {
+            slot = m_chunks[(slot & ~CHILD) * CHUNK_SLOTS + (address & 0xff)];
+        }
+    }
+    return slot;
+}
+
+inline bool
+LpmTrie::Find(uint32_t address, uint8_t length, uint32_t& value) const
+{
+    auto it = m_prefixes.find(Key(Mask(address, length), length));
+    if (it == m_prefixes.end())
+    {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+inline void
+LpmTrie::Clear()
+{
+    std::fill(m_root.begin(), m_root.end(), NO_ROUTE);
+    std::fill(m_rootDepth.begin(), m_rootDepth.end(), 0);
+    m_chunks.clear();
+    m_chunkDepth.clear();
+    m_chunkRefs.clear();
+    m_freeChunks.clear();
+    m_prefixes.clear();
+}
+
+inline std::size_t
+LpmTrie::GetNPrefixes() const
+{
+    return m_prefixes.size();
+}
+
+inline std::size_t
+LpmTrie::GetNChunks() const
+{
+    return m_chunkRefs.size() - m_freeChunks.size();
+}
+
+inline std::size_t
+LpmTrie::GetLookupMemory() const
+{
+    return m_root.capacity() * sizeof(uint32_t) + m_rootDepth.capacity() +
+           m_chunks.capacity() * sizeof(uint32_t) + m_chunkDepth.capacity() +
+           (m_chunkRefs.capacity() + m_freeChunks.capacity()) * sizeof(uint32_t);
+}
+
+inline std::size_t
+LpmTrie::GetIndexMemory() const
+{
+    // One heap node per entry (key, value, next pointer, cached hash) plus the bucket array
+    std::size_t node = sizeof(void*) + sizeof(std::size_t) + sizeof(std::pair<const uint64_t, uint32_t>);
+    return m_prefixes.size() * node + m_prefixes.bucket_count() * sizeof(void*);
+}
+
+/**
+ * Ipv4RoutingProtocol forwarding from an LpmTrie.
+ *
+ * Connected networks are added and removed automatically as interfaces come
+ * up and go down, like Ipv4StaticRouting does, so the protocol can sit
+ * in front of static routing or replace it.
+ */
+class Ipv4LpmRouting : public Ipv4RoutingProtocol
+{
+  public:
+    static TypeId GetTypeId();
+
+    Ipv4LpmRouting();
+    ~Ipv4LpmRouting() override;
+
+    /// Add (or replace) a route to a network through a gateway
+    void AddNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask, Ipv4Address nextHop, uint32_t interface);
+
+    /// Add (or replace) a route to an on-link network
+    void AddNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask, uint32_t interface);
+
+    /// Add (or replace) a /32 route through a gateway
+    void AddHostRouteTo(Ipv4Address dest, Ipv4Address nextHop, uint32_t interface);
+
+    /// Add (or replace) the 0.0.0.0/0 route
+    void SetDefaultRoute(Ipv4Address nextHop, uint32_t interface);
+
+    /// Remove the route to a network; returns false if there was none
+    bool RemoveNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask);
+
+    /// Number of prefixes in the FIB
+    uint32_t GetNRoutes() const;
+
+    /// Number of distinct (gateway, interface) pairs referenced by the FIB
+    uint32_t GetNNextHops() const;
+
+    /// The underlying trie, e.g. for memory statistics
+    const LpmTrie& GetTrie() const;
+
+    /// Call f(network, length, gateway, interface) for every route, in no particular order
+    template <class F>
+    void ForEachRoute(F f) const
+    {
+        m_trie.ForEach([this, &f](uint32_t address, uint8_t length, uint32_t index) {
+            f(Ipv4Address(address), length, m_nextHops[index].gateway, m_nextHops[index].interface);
+        });
+    }
+
+    // Inherited from Ipv4RoutingProtocol
+    Ptr<Ipv4Route> RouteOutput(Ptr<Packet> p,
+                               const Ipv4Header& header,
+                               Ptr<NetDevice> oif,
+                               Socket::SocketErrno& sockerr) override;
+    bool RouteInput(Ptr<const Packet> p,
+                    const Ipv4Header& header,
+                    Ptr<const NetDevice> idev,
+                    const UnicastForwardCallback& ucb,
+                    const MulticastForwardCallback& mcb,
+                    const LocalDeliverCallback& lcb,
+                    const ErrorCallback& ecb) override;
+    void NotifyInterfaceUp(uint32_t interface) override;
+    void NotifyInterfaceDown(uint32_t interface) override;
+    void NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address) override;
+    void SetIpv4(Ptr<Ipv4> ipv4) override;
+    void PrintRoutingTable(Ptr<OutputStreamWrapper> stream,
+                           Time::Unit unit = Time::S) const override;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    struct NextHop
+    {
+        Ipv4Address gateway; ///< 0.0.0.0 for on-link routes
+        uint32_t interface{0};
+        uint32_t refs{0};
+    };
+
+    void AddRoute(uint32_t address, uint8_t length, Ipv4Address gateway, uint32_t interface);
+    bool RemoveRoute(uint32_t address, uint8_t length);
+    uint32_t AcquireNextHop(Ipv4Address gateway, uint32_t interface);
+    void ReleaseNextHop(uint32_t index);
+    Ptr<Ipv4Route> Lookup(Ipv4Address destination, Ptr<NetDevice> oif) const;
+
+    Ptr<Ipv4> m_ipv4;
+    LpmTrie m_trie;
+    std::vector<NextHop> m_nextHops;
+    std::vector<uint32_t> m_freeNextHops;
+    std::map<std::pair<uint32_t, uint32_t>, uint32_t> m_nextHopIndex; ///< (gateway, interface) -> index
+};
+
+NS_OBJECT_ENSURE_REGISTERED(Ipv4LpmRouting);
+
+inline TypeId
+Ipv4LpmRouting::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::Ipv4LpmRouting")
+                            .SetParent<Ipv4RoutingProtocol>()
+                            .SetGroupName("Internet")
+                            .AddConstructor<Ipv4LpmRouting>();
+    return tid;
+}
+
+inline Ipv4LpmRouting::Ipv4LpmRouting()
+{
+}
+
+inline Ipv4LpmRouting::~Ipv4LpmRouting()
+{
+}
+
+inline void
+Ipv4LpmRouting::DoDispose()
+{
+    m_trie.Clear();
+    m_nextHops.clear();
+    m_freeNextHops.clear();
+    m_nextHopIndex.clear();
+    m_ipv4 = nullptr;
+    Ipv4RoutingProtocol::DoDispose();
+}
+
+inline uint32_t
+Ipv4LpmRouting::AcquireNextHop(Ipv4Address gateway, uint32_t interface)
+{
+    auto key = std::make_pair(gateway.Get(), interface);
+    auto it = m_nextHopIndex.find(key);
+    uint32_t index;
+    if (it != m_nextHopIndex.end())
+    {
+        index = it->second;
+    }
+    else
+    {
+        if (!m_freeNextHops.empty())
+        {
+            index = m_freeNextHops.back();
+            m_freeNextHops.pop_back();
+        }
+        else
+        {
+            index = m_nextHops.size();
+            m_nextHops.emplace_back();
+        }
+        m_nextHops[index].gateway = gateway;
+        m_nextHops[index].interface = interface;
+        m_nextHops[index].refs = 0;
+        m_nextHopIndex[key] = index;
+    }
+    m_nextHops[index].refs++;
+    return index;
+}
+
+inline void
+Ipv4LpmRouting::ReleaseNextHop(uint32_t index)
+{
+    NextHop& nextHop = m_nextHops[index];
+    if (--nextHop.refs == 0)
+    {
+        m_nextHopIndex.erase(std::make_pair(nextHop.gateway.Get(), nextHop.interface));
+        m_freeNextHops.push_back(index);
+    }
+}
+
+inline void
+Ipv4LpmRouting::AddRoute(uint32_t address, uint8_t length, Ipv4Address gateway, uint32_t interface)
+{
+    uint32_t index = AcquireNextHop(gateway, interface);
+    uint32_t previous;
+    if (m_trie.Find(address, length, previous))
+    {
+        ReleaseNextHop(previous);
+    }
+    m_trie.Insert(address, length, index);
+}
+
+inline bool
+Ipv4LpmRouting::RemoveRoute(uint32_t address, uint8_t length)
+{
+    uint32_t index;
+    if (!m_trie.Find(address, length, index))
+    {
+        return false;
+    }
+    m_trie.Remove(address, length);
+    ReleaseNextHop(index);
+    return true;
+}
+
+inline void
+Ipv4LpmRouting::AddNetworkRouteTo(Ipv4Address network,
+                                  Ipv4Mask networkMask,
+                                  Ipv4Address nextHop,
+                                  uint32_t interface)
+{
+    AddRoute(network.Get(), networkMask.GetPrefixLength(), nextHop, interface);
+}
+
+inline void
+Ipv4LpmRouting::AddNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask, uint32_t interface)
+{
+    AddRoute(network.Get(), networkMask.GetPrefixLength(), Ipv4Address::GetZero(), interface);
+}
+
+inline void
+Ipv4LpmRouting::AddHostRouteTo(Ipv4Address dest, Ipv4Address nextHop, uint32_t interface)
+{
+    AddRoute(dest.Get(), 32, nextHop, interface);
+}
+
+inline void
+Ipv4LpmRouting::SetDefaultRoute(Ipv4Address nextHop, uint32_t interface)
+{
+    AddRoute(0, 0, nextHop, interface);
+}
+
+inline bool
+Ipv4LpmRouting::RemoveNetworkRouteTo(Ipv4Address network, Ipv4Mask networkMask)
+{
+    return RemoveRoute(network.Get(), networkMask.GetPrefixLength());
+}
+
+inline uint32_t
+Ipv4LpmRouting::GetNRoutes() const
+{
+    return m_trie.GetNPrefixes();
+}
+
+inline uint32_t
+Ipv4LpmRouting::GetNNextHops() const
+{
+    return m_nextHopIndex.size();
+}
+
+inline const LpmTrie&
+Ipv4LpmRouting::GetTrie() const
+{
+    return m_trie;
+}
+
+inline Ptr<Ipv4Route>
+Ipv4LpmRouting::Lookup(Ipv4Address destination, Ptr<NetDevice> oif) const
+{
+    uint32_t index = m_trie.Lookup(destination.Get());
+    if (index == LpmTrie::NO_ROUTE)
+    {
+        return nullptr;
+    }
+    const NextHop& nextHop = m_nextHops[index];
+    Ptr<NetDevice> device = m_ipv4->GetNetDevice(nextHop.interface);
+    if (oif && oif != device)
+    {
+        return nullptr;
+    }
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(destination);
+    route->SetGateway(nextHop.gateway);
+    route->SetOutputDevice(device);
+    route->SetSource(m_ipv4->SourceAddressSelection(nextHop.interface, destination));
+    return route;
+}
+
+inline Ptr<Ipv4Route>
+Ipv4LpmRouting::RouteOutput(Ptr<Packet> p,
+                            const Ipv4Header& header,
+                            Ptr<NetDevice> oif,
+                            Socket::SocketErrno& sockerr)
+{
+    Ptr<Ipv4Route> route;
+    if (!header.GetDestination().IsMulticast())
+    {
+        route = Lookup(header.GetDestination(), oif);
+    }
+    sockerr = route ? Socket::ERROR_NOTERROR : Socket::ERROR_NOROUTETOHOST;
+    return route;
+}
+
+inline bool
+Ipv4LpmRouting::RouteInput(Ptr<const Packet> p,
+                           const Ipv4Header& header,
+                           Ptr<const NetDevice> idev,
+                           const UnicastForwardCallback& ucb,
+                           const MulticastForwardCallback& mcb,
+                           const LocalDeliverCallback& lcb,
+                           const ErrorCallback& ecb)
+{
+    NS_ASSERT(m_ipv4->GetInterfaceForDevice(idev) >= 0);
+    uint32_t iif = m_ipv4->GetInterfaceForDevice(idev);
+
+    if (header.GetDestination().IsMulticast())
+    {
+        return false;
+    }
+    if (m_ipv4->IsDestinationAddress(header.GetDestination(), iif))
+    {
+        if (!lcb.IsNull())
+        {
+            lcb(p, header, iif);
+            return true;
+        }
+        return false;
+    }
+    if (!m_ipv4->IsForwarding(iif))
+    {
+        ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+        return true;
+    }
+    Ptr<Ipv4Route> route = Lookup(header.GetDestination(), nullptr);
+    if (route)
+    {
+        ucb(route, p, header);
+        return true;
+    }
+    return false;
+}
+
+inline void
+Ipv4LpmRouting::NotifyInterfaceUp(uint32_t interface)
+{
+    for (uint32_t j = 0; j < m_ipv4->GetNAddresses(interface); ++j)
+    {
+        NotifyAddAddress(interface, m_ipv4->GetAddress(interface, j));
+    }
+}
+
+inline void
+Ipv4LpmRouting::NotifyInterfaceDown(uint32_t interface)
+{
+    // Like Ipv4StaticRouting: every route out of the interface goes away
+    std::vector<std::pair<uint32_t, uint8_t>> stale;
+    m_trie.ForEach([this, interface, &stale](uint32_t address, uint8_t length, uint32_t index) {
+        if (m_nextHops[index].interface == interface)
+        {
+            stale.emplace_back(address, length);
+        }
+    });
+    for (const auto& prefix : stale)
+    {
+        RemoveRoute(prefix.first, prefix.second);
+    }
+}
+
+inline void
+Ipv4LpmRouting::NotifyAddAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    // Same connected routes as Ipv4StaticRouting, loopback included
+    Ipv4Mask mask = address.GetMask();
+    if (!m_ipv4->IsUp(interface) || address.GetLocal() == Ipv4Address() || mask == Ipv4Mask())
+    {
+        return;
+    }
+    AddNetworkRouteTo(address.GetLocal().CombineMask(mask), mask, interface);
+}
+
+inline void
+Ipv4LpmRouting::NotifyRemoveAddress(uint32_t interface, Ipv4InterfaceAddress address)
+{
+    uint32_t index;
+    Ipv4Mask mask = address.GetMask();
+    uint32_t network = address.GetLocal().CombineMask(mask).Get();
+    uint8_t length = mask.GetPrefixLength();
+    if (m_trie.Find(network, length, index) && m_nextHops[index].interface == interface &&
+        m_nextHops[index].gateway == Ipv4Address::GetZero())
+    {
+        RemoveRoute(network, length);
+    }
+}
+
+inline void
+Ipv4LpmRouting::SetIpv4(Ptr<Ipv4> ipv4)
+{
+    NS_ASSERT(!m_ipv4 && ipv4);
+    m_ipv4 = ipv4;
+    for (uint32_t i = 0; i < m_ipv4->GetNInterfaces(); ++i)
+    {
+        if (m_ipv4->IsUp(i))
+        {
+            NotifyInterfaceUp(i);
+        }
+    }
+}
+
+inline void
+Ipv4LpmRouting::PrintRoutingTable(Ptr<OutputStreamWrapper> stream, Time::Unit unit) const
+{
+    std::ostream* os = stream->GetStream();
+    *os << "Node: " << m_ipv4->GetObject<Node>()->GetId() << ", Time: " << Simulator::Now().As(unit)
+        << ", Ipv4LpmRouting table (" << m_trie.GetNPrefixes() << " prefixes, "
+        << m_trie.GetNChunks() << " chunks)\n";
+
+    std::map<std::pair<uint32_t, uint8_t>, uint32_t> sorted;
+    m_trie.ForEach([&sorted](uint32_t address, uint8_t length, uint32_t index) {
+        sorted[std::make_pair(address, length)] = index;
+    });
+    *os << "Destination        Gateway          Iface\n";
+    for (const auto& entry : sorted)
+    {
+        std::ostringstream destination;
+        destination << Ipv4Address(entry.first.first) << "/" << static_cast<uint32_t>(entry.first.second);
+        const NextHop& nextHop = m_nextHops[entry.second];
+        *os << std::left << std::setw(19) << destination.str() << std::setw(17) << nextHop.gateway
+            << nextHop.interface << "\n";
+    }
+    *os << std::right << "\n";
+}
+
+/**
+ * Creates Ipv4LpmRouting instances, either through Ipv4ListRoutingHelper /
+ * InternetStackHelper::SetRoutingHelper or directly on a node that already
+ * has an Internet stack.
+ */
+class Ipv4LpmRoutingHelper : public Ipv4RoutingHelper
+{
+  public:
+    Ipv4LpmRoutingHelper()
+        : m_priority(5)
+    {
+    }
+
+    Ipv4LpmRoutingHelper* Copy() const override
+    {
+        return new Ipv4LpmRoutingHelper(*this);
+    }
+
+    Ptr<Ipv4RoutingProtocol> Create(Ptr<Node> node) const override
+    {
+        return CreateObject<Ipv4LpmRouting>();
+    }
+
+    /// List routing priority used by Install() (static routing is 0)
+    void SetPriority(int16_t priority)
+    {
+        m_priority = priority;
+    }
+
+    /// Add an Ipv4LpmRouting to the node's Ipv4ListRouting
+    Ptr<Ipv4LpmRouting> Install(Ptr<Node> node) const
+    {
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(ipv4->GetRoutingProtocol());
+        NS_ABORT_MSG_UNLESS(list, "Ipv4LpmRoutingHelper needs the default Ipv4ListRouting on the node");
+        Ptr<Ipv4LpmRouting> lpm = CreateObject<Ipv4LpmRouting>();
+        list->AddRoutingProtocol(lpm, m_priority);
+        return lpm;
+    }
+
+    /// Find the Ipv4LpmRouting of a node, or nullptr
+    static Ptr<Ipv4LpmRouting> GetLpmRouting(Ptr<Ipv4> ipv4)
+    {
+        Ptr<Ipv4RoutingProtocol> protocol = ipv4->GetRoutingProtocol();
+        Ptr<Ipv4LpmRouting> lpm = DynamicCast<Ipv4LpmRouting>(protocol);
+        Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(protocol);
+        for (uint32_t i = 0; !lpm && list && i < list->GetNRoutingProtocols(); ++i)
+        {
+            int16_t priority;
+            lpm = DynamicCast<Ipv4LpmRouting>(list->GetRoutingProtocol(i, priority));
+        }
+        return lpm;
+    }
+
+  private:
+    int16_t m_priority;
+};
+
+} // namespace ns3
+
+#endif /* WAN_LPM_FIB_H */
@@ -0,0 +1,316 @@
+/*
+ * Parallel Monte Carlo runs for the WAN exercises
+ *
+ * An availability estimate needs thousands of independent simulations of
+ * the same topology under different random failures. ns-3's simulator,
+ * node list and configuration are process-wide singletons, so scenarios
+ * cannot run side by side in threads. MonteCarloRunner forks one worker
+ * process per core instead. Worker w runs scenarios w, w + W, w + 2W, ...
+ * one after another, calling Simulator::Destroy() between them. After each
+ * scenario it writes a fixed-size ScenarioResult to a pipe shared by all
+ * workers. The record is smaller than PIPE_BUF, so records from different
+ * workers never interleave.
+ *
+ * The parent only reads the pipe and hands every result to a callback as
+ * it arrives, typically an AvailabilityAggregate. Progress and confidence
+ * intervals are therefore available while the run is going, and the
+ * parent never holds a simulator of its own. Scenarios are statistically
+ * alike, so the static round-robin split keeps the workers equally busy
+ * without a work queue.
+ *
+ * A scenario must be reproducible from its number alone, whichever worker
+ * runs it and whatever ran before it in that process. Set RngRun from the
+ * scenario number and give every random variable a fixed stream
+ * (SetStream()); ns-3 otherwise numbers streams in creation order per
+ * process.
+ *
+ * Usage: copy this header next to the exercise script in scratch/ (POSIX
+ * only: fork() and pipe()).
+ */
+
+#ifndef WAN_MONTE_CARLO_H
+#define WAN_MONTE_CARLO_H
+
+#include "ns3/core-module.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+/// Outcome of one scenario, as sent from a worker to the parent
+struct ScenarioResult
+{
+    uint32_t scenario;
+    uint32_t faults;        ///< failures and repairs applied
+    uint64_t sent;          ///< probe packets sent
+    uint64_t delivered;     ///< probe packets received
+    double linkDownSeconds; ///< time links spent down, summed over the links
+
+    /// Fraction of the probes delivered (1 if none was sent)
+    double GetAvailability() const
+    {
+        return sent == 0 ? 1.0 : double(delivered) / sent;
+    }
+};
+
+/**
+ * Streaming statistics of per-scenario availabilities: running mean and
+ * variance (Welford), so a confidence interval is available after every
+ * result, and the values themselves for percentiles.
+ */
+class AvailabilityAggregate
+{
+  public:
+    AvailabilityAggregate()
+        : m_mean(0),
+          m_m2(0),
+          m_sent(0),
+          m_delivered(0),
+          m_faults(0),
+          m_perfect(0)
+    {
+    }
+
+    void Add(const ScenarioResult& result)
+    {
+        double availability = result.GetAvailability();
+        m_values.push_back(availability);
+        double delta = availability - m_mean;
+        m_mean += delta / m_values.size();
+        m_m2 += delta * (availability - m_mean);
+        m_sent += result.sent;
+        m_delivered += result.delivered;
+        m_faults += result.faults;
+        m_perfect += result.delivered == result.sent;
+    }
+
+    uint64_t GetN() const
+    {
+        return m_values.size();
+    }
+
+    /// Mean of the per-scenario availabilities
+    double GetMean() const
+    {
+        return m_mean;
+    }
+
+    double GetStdDev() const
+    {
+        return m_values.size() < 2 ? 0 : std::sqrt(m_m2 / (m_values.size() - 1));
+    }
+
+    /// Half width of the confidence interval of the mean (z = 1.96: 95%)
+    double GetHalfWidth(double z = 1.96) const
+    {
+        return m_values.empty() ? 0 : z * GetStdDev() / std::sqrt(double(m_values.size()));
+    }
+
+    /// All delivered probes over all sent probes
+    double GetPooled() const
+    {
+        return m_sent == 0 ? 1.0 : double(m_delivered) / m_sent;
+    }
+
+    /// Availability not exceeded by the fraction q of the scenarios (nearest rank)
+    double GetPercentile(double q) const
+    {
+        if (m_values.empty())
+        {
+            return 0;
+        }
+        std::vector<double> sorted(m_values);
+        std::size_t rank = std::min<std::size_t>(sorted.size() - 1, std::floor(q * sorted.size()));
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+    /// Scenarios that lost no probe
+    uint64_t GetNPerfect() const
+    {
+        return m_perfect;
+    }
+
+    double GetMeanFaults() const
+    {
+        return m_values.empty() ? 0 : double(m_faults) / m_values.size();
+    }
+
+  private:
+    std::vector<double> m_values;
+    double m_mean;
+    double m_m2;
+    uint64_t m_sent;
+    uint64_t m_delivered;
+    uint64_t m_faults;
+    uint64_t m_perfect;
+};
+
+/**
+ * Runs independent scenarios in worker processes and streams their
+ * results back to the calling process.
+ */
+class MonteCarloRunner
+{
+  public:
+    typedef std::function<ScenarioResult(uint32_t)> Scenario;
+    typedef std::function<void(const ScenarioResult&)> ResultCallback;
+
+    MonteCarloRunner()
+        : m_workers(0)
+    {
+    }
+
+    /// Number of worker processes (0: one per core)
+    void SetWorkers(uint32_t workers)
+    {
+        m_workers = workers;
+    }
+
+    /// Workers a run of the given size uses
+    uint32_t GetWorkers(uint32_t scenarios) const
+    {
+        uint32_t workers = m_workers ? m_workers : std::max(1u, std::thread::hardware_concurrency());
+        return std::max(1u, std::min(workers, scenarios));
+    }
+
+    /**
+     * Run scenarios 0 .. scenarios - 1. Call it before this process has
+     * built any simulation: the workers start as copies of it.
+     * \param scenario builds, runs and destroys one simulation
+     * \param callback called in this process for every result, in arrival order
+     * \return false (see GetError()) if a worker failed or results are missing
+     */
+    bool Run(uint32_t scenarios, Scenario scenario, ResultCallback callback)
+    {
+        static_assert(sizeof(ScenarioResult) <= PIPE_BUF, "ScenarioResult writes must be atomic");
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            m_error = "pipe() failed";
+            return false;
+        }
+        uint32_t workers = GetWorkers(scenarios);
+        std::cout.flush();
+        std::fflush(nullptr); // or the workers would print what is buffered again
+        std::vector<pid_t> pids;
+        for (uint32_t w = 0; w < workers; ++w)
+        {
+            pid_t pid = fork();
+            if (pid == 0)
+            {
+                close(fds[0]);
+                for (uint32_t s = w; s < scenarios; s += workers)
+                {
+                    ScenarioResult result = scenario(s);
+                    result.scenario = s;
+                    if (!WriteAll(fds[1], &result, sizeof(result)))
+                    {
+                        _exit(2);
+                    }
+                }
+                std::cout.flush();
+                _exit(0);
+            }
+            if (pid < 0)
+            {
+                m_error = "fork() failed";
+                break;
+            }
+            pids.push_back(pid);
+        }
+        close(fds[1]);
+
+        // Records are whole (atomic writes), but a read may still end mid-record
+        uint32_t received = 0;
+        std::vector<char> buffer(sizeof(ScenarioResult) * 256);
+        std::size_t filled = 0;
+        while (true)
+        {
+            ssize_t n = read(fds[0], buffer.data() + filled, buffer.size() - filled);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                break;
+            }
+            filled += n;
+            std::size_t whole = filled / sizeof(ScenarioResult);
+            for (std::size_t i = 0; i < whole; ++i)
+            {
+                ScenarioResult result;
+                std::copy_n(buffer.data() + i * sizeof(result), sizeof(result), reinterpret_cast<char*>(&result));
+                callback(result);
+                received++;
+            }
+            std::copy(buffer.begin() + whole * sizeof(ScenarioResult), buffer.begin() + filled, buffer.begin());
+            filled -= whole * sizeof(ScenarioResult);
+        }
+        close(fds[0]);
+
+        bool failed = false;
+        for (pid_t pid : pids)
+        {
+            int status;
+            waitpid(pid, &status, 0);
+            failed = failed || !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+        }
+        if (failed || pids.size() < workers || received < scenarios)
+        {
+            if (m_error.empty())
+            {
+                m_error = std::to_string(scenarios - received) + " of " + std::to_string(scenarios) +
+                          " scenarios produced no result (a worker failed)";
+            }
+            return false;
+        }
+        return true;
+    }
+
+    const std::string& GetError() const
+    {
+        return m_error;
+    }
+
+  private:
+    static bool WriteAll(int fd, const void* data, std::size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0)
+        {
+            ssize_t n = write(fd, bytes, size);
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return false;
+            }
+            bytes += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    uint32_t m_workers;
+    std::string m_error;
+};
+
+} // namespace ns3
+
+#endif /* WAN_MONTE_CARLO_H */
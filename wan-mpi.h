@@ -0,0 +1,174 @@
+/*
+ * Distributed (MPI) execution support for the WAN exercises
+ *
+ * ns-3's distributed simulator runs one process per MPI rank. Every rank
+ * builds the whole topology, but only simulates the nodes whose system id
+ * is its rank; point-to-point links between nodes of different ranks become
+ * PointToPointRemoteChannels and their delay is the lookahead the ranks
+ * synchronise on. Cutting a WAN topology at its inter-AS links therefore
+ * gives a lookahead of one IXP link delay.
+ *
+ * WanMpi hides the #ifdef NS3_MPI plumbing from the scripts: without MPI
+ * support in the ns-3 build every call degrades to a single rank 0, so the
+ * same script runs sequentially. The reduction helpers combine per-rank
+ * counters for the final report; they are collective, so every rank must
+ * call them in the same order.
+ *
+ * Usage: copy this header next to the exercise script in scratch/ and run
+ * with e.g. "mpirun -np 4 ./ns3 run --no-build 'scratch/<script> --mpi'"
+ * (ns-3 configured with --enable-mpi).
+ */
+
+#ifndef WAN_MPI_H
+#define WAN_MPI_H
+
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+
+#include <mpi.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Static helpers around MpiInterface.
+ */
+class WanMpi
+{
+  public:
+    /// True if ns-3 was built with MPI support
+    static bool IsAvailable();
+
+    /**
+     * Switch to the distributed simulator and initialise MPI. Call before
+     * any node is created. Aborts if ns-3 has no MPI support.
+     * \param nullMessage use the null message algorithm instead of the
+     *        granted-time-window one (better when ranks are unevenly loaded)
+     */
+    static void Enable(int* argc, char*** argv, bool nullMessage = false);
+
+    /// Finalise MPI (after Simulator::Destroy())
+    static void Disable();
+
+    static bool IsEnabled();
+
+    /// This process' rank (0 when not distributed)
+    static uint32_t GetRank();
+
+    /// Number of ranks (1 when not distributed)
+    static uint32_t GetSize();
+
+    /// True if the node is simulated by this rank
+    static bool IsLocal(Ptr<Node> node);
+
+    /// Element-wise sum over all ranks
+    static void Sum(std::vector<uint64_t>& values);
+
+    /// Maximum over all ranks
+    static double Max(double value);
+};
+
+inline bool
+WanMpi::IsAvailable()
+{
+#ifdef NS3_MPI
+    return true;
+#else
+    return false;
+#endif
+}
+
+inline void
+WanMpi::Enable(int* argc, char*** argv, bool nullMessage)
+{
+#ifdef NS3_MPI
+    GlobalValue::Bind("SimulatorImplementationType",
+                      StringValue(nullMessage ? "ns3::NullMessageSimulatorImpl"
+                                              : "ns3::DistributedSimulatorImpl"));
+    MpiInterface::Enable(argc, argv);
+#else
+    NS_ABORT_MSG("ns-3 was built without MPI; reconfigure with --enable-mpi");
+#endif
+}
+
+inline void
+WanMpi::Disable()
+{
+#ifdef NS3_MPI
+    if (MpiInterface::IsEnabled())
+    {
+        MpiInterface::Disable();
+    }
+#endif
+}
+
+inline bool
+WanMpi::IsEnabled()
+{
+#ifdef NS3_MPI
+    return MpiInterface::IsEnabled();
+#else
+    return false;
+#endif
+}
+
+inline uint32_t
+WanMpi::GetRank()
+{
+#ifdef NS3_MPI
+    return MpiInterface::IsEnabled() ? MpiInterface::GetSystemId() : 0;
+#else
+    return 0;
+#endif
+}
+
+inline uint32_t
+WanMpi::GetSize()
+{
+#ifdef NS3_MPI
+    return MpiInterface::IsEnabled() ? MpiInterface::GetSize() : 1;
+#else
+    return 1;
+#endif
+}
+
+inline bool
+WanMpi::IsLocal(Ptr<Node> node)
+{
+    return !IsEnabled() || node->GetSystemId() == GetRank();
+}
+
+inline void
+WanMpi::Sum(std::vector<uint64_t>& values)
+{
+#ifdef NS3_MPI
+    if (MpiInterface::IsEnabled() && !values.empty())
+    {
+        MPI_Allreduce(MPI_IN_PLACE, values.data(), values.size(), MPI_UINT64_T, MPI_SUM,
+                      MpiInterface::GetCommunicator());
+    }
+#endif
+}
+
+inline double
+WanMpi::Max(double value)
+{
+#ifdef NS3_MPI
+    if (MpiInterface::IsEnabled())
+    {
+        MPI_Allreduce(MPI_IN_PLACE, &value, 1, MPI_DOUBLE, MPI_MAX, MpiInterface::GetCommunicator());
+    }
+#endif
+    return value;
+}
+
+} // namespace ns3
+
+#endif /* WAN_MPI_H */
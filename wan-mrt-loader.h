@@ -0,0 +1,690 @@
+/*
+ * Streaming loader for BGP RIB dumps
+ *
+ * Seeds BgpSpeakers with a real-size table instead of a handful of made-up
+ * prefixes. The file is mmap()ed read-only and parsed in place: records are
+ * decoded straight from the mapping into one reused BgpPrefix /
+ * BgpPathAttributes pair, so nothing but the delivered route is copied and a
+ * full table loads in seconds.
+ *
+ * Supported formats (detected from the first bytes of the file):
+ *  - MRT TABLE_DUMP_V2 (RFC 6396), e.g. RouteViews / RIPE RIS "rib.*" files
+ *    after decompression. IPv4 unicast RIB records are read; the peer index
+ *    table is counted, everything else (IPv6, BGP4MP, ...) is skipped.
+ *  - "bgpdump -m" text: TABLE_DUMP2|time|B|peer|peerAs|prefix|path|origin|nexthop|lp|med|...
+ *  - compact text: one route per line, "prefix AS AS AS ...", '#' comments.
+ *
+ * A dump holds one entry per (prefix, collector peer). By default the first
+ * entry of every prefix is delivered; SetPeerIndex() selects the entries of
+ * one MRT peer instead, i.e. that peer's full view. An MRT RIB record holds
+ * all entries of its prefix; text dumps need not be sorted (several dumps
+ * may be concatenated), so the prefixes delivered from text are kept in a
+ * hash set and any later entry of one of them is dropped.
+ *
+ * Compressed dumps (.bz2/.gz) are not read directly: decompress them first,
+ * mapping a compressed file would defeat the zero-copy parse.
+ *
+ * Usage: copy this header next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_MRT_LOADER_H
+#define WAN_MRT_LOADER_H
+
+#include "wan-bgp-speaker.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <string>
+#include <unordered_set>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace ns3
+{
+
+/**
+ * Reads IPv4 routes from an MRT TABLE_DUMP_V2 or text RIB dump.
+ */
+class MrtRibLoader
+{
+  public:
+    /// Called once per delivered route; the references are only valid during the call
+    typedef std::function<void(const BgpPrefix& prefix, const BgpPathAttributes& attributes)>
+        RouteCallback;
+
+    enum Format
+    {
+        FORMAT_UNKNOWN,
+        FORMAT_MRT,
+        FORMAT_BGPDUMP,
+        FORMAT_COMPACT
+    };
+
+    struct Statistics
+    {
+        uint64_t bytes{0};          ///< size of the mapped file
+        uint64_t records{0};        ///< MRT records or text lines read
+        uint64_t ribEntries{0};     ///< per-peer RIB entries seen
+        uint64_t routes{0};         ///< routes delivered to the callback
+        uint64_t skipped{0};        ///< records of other types / address families
+        uint64_t malformed{0};      ///< records that could not be parsed
+        uint64_t duplicates{0};     ///< text entries of a prefix already delivered
+        uint32_t peers{0};          ///< peers in the MRT peer index table
+    };
+
+    MrtRibLoader();
+    ~MrtRibLoader();
+
+    MrtRibLoader(const MrtRibLoader&) = delete;
+    MrtRibLoader& operator=(const MrtRibLoader&) = delete;
+
+    /// Map a dump file; returns false (see GetError()) if it cannot be read
+    bool Open(const std::string& path);
+
+    /// Unmap the file
+    void Close();
+
+    /// Only deliver the RIB entries of this MRT peer index (-1: first entry of each prefix)
+    void SetPeerIndex(int32_t peerIndex);
+
+    /// Stop after this many routes (0: no limit)
+    void SetMaxRoutes(uint64_t maxRoutes);
+
+    /**
+     * Parse the whole file and deliver every selected route.
+     * \return the number of routes delivered
+     */
+    uint64_t Load(RouteCallback callback);
+
+    Format GetFormat() const;
+    const Statistics& GetStatistics() const;
+    const std::string& GetError() const;
+
+  private:
+    static constexpr uint16_t MRT_TABLE_DUMP_V2 = 13;
+    static constexpr uint16_t PEER_INDEX_TABLE = 1;
+    static constexpr uint16_t RIB_IPV4_UNICAST = 2;
+    static constexpr uint32_t MRT_HEADER_SIZE = 12;
+
+    void LoadMrt(const RouteCallback& callback);
+    bool ParseRibIpv4(const uint8_t* data, uint32_t size, const RouteCallback& callback);
+    bool ParseAttributes(const uint8_t* data, uint32_t size);
+    void LoadText(const RouteCallback& callback);
+    bool ParseBgpdumpLine(const char* begin, const char* end);
+    bool ParseCompactLine(const char* begin, const char* end);
+    bool Done() const;
+
+    static uint16_t ReadU16(const uint8_t* p);
+    static uint32_t ReadU32(const uint8_t* p);
+    static bool ParsePrefix(const char*& p, const char* end, BgpPrefix& prefix);
+    static bool ParseUnsigned(const char*& p, const char* end, uint32_t& value);
+    static bool ParseIpv4(const char*& p, const char* end, uint32_t& address);
+
+    const uint8_t* m_data;
+    std::size_t m_size;
+    int m_fd;
+    Format m_format;
+    int32_t m_peerIndex;
+    uint64_t m_maxRoutes;
+    Statistics m_stats;
+    std::string m_error;
+
+    // Decoding scratch space, reused for every route
+    BgpPrefix m_prefix;
+    BgpPathAttributes m_attributes;
+    std::unordered_set<uint64_t> m_textPrefixes; ///< (address << 8 | length) delivered from text
+};
+
+inline MrtRibLoader::MrtRibLoader()
+    : m_data(nullptr),
+      m_size(0),
+      m_fd(-1),
+      m_format(FORMAT_UNKNOWN),
+      m_peerIndex(-1),
+      m_maxRoutes(0)
+{
+}
+
+inline MrtRibLoader::~MrtRibLoader()
+{
+    Close();
+}
+
+inline bool
+MrtRibLoader::Open(const std::string& path)
+{
+    Close();
+    m_stats = Statistics();
+    m_fd = open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        m_error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || st.st_size == 0)
+    {
+        m_error = "cannot stat " + path + " or it is empty";
+        Close();
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (map == MAP_FAILED)
+    {
+        m_error = "cannot mmap " + path;
+        Close();
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t*>(map);
+    m_size = st.st_size;
+    m_stats.bytes = m_size;
+
+    // MRT starts with a 4-byte timestamp and type 13; text starts printable
+    if (m_size >= MRT_HEADER_SIZE && ReadU16(m_data + 4) == MRT_TABLE_DUMP_V2)
+    {
+        m_format = FORMAT_MRT;
+    }
+    else if (m_size >= 11 && std::string(reinterpret_cast<const char*>(m_data), 11) == "TABLE_DUMP2")
+    {
+        m_format = FORMAT_BGPDUMP;
+    }
+    else if (m_data[0] == 0x1f || (m_size >= 3 && memcmp(m_data, "BZh", 3) == 0))
+    {
+        m_error = path + " looks compressed (gzip/bzip2); decompress it first";
+        Close();
+        return false;
+    }
+    else
+    {
+        m_format = FORMAT_COMPACT;
+    }
+    return true;
+}
+
+inline void
+MrtRibLoader::Close()
+{
+    if (m_data)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+inline void
+MrtRibLoader::SetPeerIndex(int32_t peerIndex)
+{
+    m_peerIndex = peerIndex;
+}
+
+inline void
+MrtRibLoader::SetMaxRoutes(uint64_t maxRoutes)
+{
+    m_maxRoutes = maxRoutes;
+}
+
+inline MrtRibLoader::Format
+MrtRibLoader::GetFormat() const
+{
+    return m_format;
+}
+
+inline const MrtRibLoader::Statistics&
+MrtRibLoader::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline const std::string&
+MrtRibLoader::GetError() const
+{
+    return m_error;
+}
+
+inline bool
+MrtRibLoader::Done() const
+{
+    return m_maxRoutes != 0 && m_stats.routes >= m_maxRoutes;
+}
+
+inline uint64_t
+MrtRibLoader::Load(RouteCallback callback)
+{
+    if (!m_data)
+    {
+        return 0;
+    }
+    uint64_t before = m_stats.routes;
+    m_textPrefixes.clear();
+    if (m_format == FORMAT_MRT)
+    {
+        LoadMrt(callback);
+    }
+    else
+    {
+        LoadText(callback);
+    }
+    return m_stats.routes - before;
+}
+
+inline void
+MrtRibLoader::LoadMrt(const RouteCallback& callback)
+{
+    std::size_t pos = 0;
+    while (pos + MRT_HEADER_SIZE <= m_size && !Done())
+    {
+        const uint8_t* header = m_data + pos;
+        uint16_t type = ReadU16(header + 4);
+        uint16_t subtype = ReadU16(header + 6);
+        uint32_t length = ReadU32(header + 8);
+        if (pos + MRT_HEADER_SIZE + length > m_size)
+        {
+            m_stats.malformed++; // truncated file
+            break;
+        }
+        const uint8_t* body = header + MRT_HEADER_SIZE;
+        pos += MRT_HEADER_SIZE + length;
+        m_stats.records++;
+
+        if (type != MRT_TABLE_DUMP_V2)
+        {
+            m_stats.skipped++;
+        }
+        else if (subtype == PEER_INDEX_TABLE)
+        {
+            // collector id (4), view name length (2) + name, peer count (2)
+            if (length >= 8 && 6u + ReadU16(body + 4) + 2 <= length)
+            {
+                m_stats.peers = ReadU16(body + 6 + ReadU16(body + 4));
+            }
+        }
+        else if (subtype == RIB_IPV4_UNICAST)
+        {
+            if (!ParseRibIpv4(body, length, callback))
+            {
+                m_stats.malformed++;
+            }
+        }
+        else
+        {
+            m_stats.skipped++;
+        }
+    }
+}
+
+inline bool
+MrtRibLoader::ParseRibIpv4(const uint8_t* data, uint32_t size, const RouteCallback& callback)
+{
+    // sequence (4), prefix length (1), prefix, entry count (2)
+    if (size < 5 || data[4] > 32)
+    {
+        return false;
+    }
+    uint8_t length = data[4];
+    uint32_t bytes = (length + 7u) / 8;
+    if (5 + bytes + 2 > size)
+    {
+        return false;
+    }
+    uint32_t address = 0;
+    for (uint32_t i = 0; i < bytes; ++i)
+    {
+        address |= static_cast<uint32_t>(data[5 + i]) << (24 - 8 * i);
+    }
+    m_prefix = BgpPrefix(address, length);
+
+    uint32_t pos = 5 + bytes;
+    uint16_t entries = ReadU16(data + pos);
+    pos += 2;
+    for (uint16_t i = 0; i < entries; ++i)
+    {
+        // peer index (2), originated time (4), attribute length (2), attributes
+        if (pos + 8 > size)
+        {
+            return false;
+        }
+        uint16_t peer = ReadU16(data + pos);
+        uint16_t attributeLength = ReadU16(data + pos + 6);
+        pos += 8;
+        if (pos + attributeLength > size)
+        {
+            return false;
+        }
+        m_stats.ribEntries++;
+        bool selected = m_peerIndex < 0 ? i == 0 : peer == m_peerIndex;
+        if (selected)
+        {
+            if (!ParseAttributes(data + pos, attributeLength))
+            {
+                return false;
+            }
+            callback(m_prefix, m_attributes);
+            m_stats.routes++;
+            if (m_peerIndex < 0)
+            {
+                return true; // the remaining entries are not needed
+            }
+        }
+        pos += attributeLength;
+    }
+    return true;
+}
+
+inline bool
+MrtRibLoader::ParseAttributes(const uint8_t* data, uint32_t size)
+{
+    m_attributes.origin = 0;
+    m_attributes.asPath.clear(); // keeps its capacity across routes
+    m_attributes.nextHop = Ipv4Address::GetZero();
+    m_attributes.med = 0;
+    m_attributes.localPref = 100;
+
+    uint32_t pos = 0;
+    while (pos + 3 <= size)
+    {
+        uint8_t flags = data[pos];
+        uint8_t type = data[pos + 1];
+        uint32_t length;
+        if (flags & 0x10)
+        {
+            if (pos + 4 > size)
+            {
+                return false;
+            }
+            length = ReadU16(data + pos + 2);
+            pos += 4;
+        }
+        else
+        {
+            length = data[pos + 2];
+            pos += 3;
+        }
+        if (pos + length > size)
+        {
+            return false;
+        }
+        const uint8_t* value = data + pos;
+        switch (type)
+        {
+        case BGP_ATTR_ORIGIN:
+            if (length >= 1)
+            {
+                m_attributes.origin = value[0];
+            }
+            break;
+        case BGP_ATTR_AS_PATH:
+            // TABLE_DUMP_V2 always encodes 4-octet AS numbers; AS_SETs are flattened
+            for (uint32_t seg = 0; seg + 2 <= length;)
+            {
+                uint32_t count = value[seg + 1];
+                if (seg + 2 + 4 * count > length)
+                {
+                    return false;
+                }
+                for (uint32_t k = 0; k < count; ++k)
+                {
+                    m_attributes.asPath.push_back(ReadU32(value + seg + 2 + 4 * k));
+                }
+                seg += 2 + 4 * count;
+            }
+            break;
+        case BGP_ATTR_NEXT_HOP:
+            if (length == 4)
+            {
+                m_attributes.nextHop = Ipv4Address(ReadU32(value));
+            }
+            break;
+        case BGP_ATTR_MED:
+            if (length == 4)
+            {
+                m_attributes.med = ReadU32(value);
+            }
+            break;
+        case BGP_ATTR_LOCAL_PREF:
+            if (length == 4)
+            {
+                m_attributes.localPref = ReadU32(value);
+            }
+            break;
+        default:
+            break;
+        }
+        pos += length;
+    }
+    return pos == size;
+}
+
+inline void
+MrtRibLoader::LoadText(const RouteCallback& callback)
+{
+    const char* p = reinterpret_cast<const char*>(m_data);
+    const char* end = p + m_size;
+    while (p < end && !Done())
+    {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        if (!eol)
+        {
+            eol = end;
+        }
+        const char* lineEnd = (eol > p && eol[-1] == '\r') ? eol - 1 : eol;
+        if (lineEnd > p && *p != '#')
+        {
+            m_stats.records++;
+            bool ok = m_format == FORMAT_BGPDUMP ? ParseBgpdumpLine(p, lineEnd)
+                                                 : ParseCompactLine(p, lineEnd);
+            if (ok)
+            {
+                m_stats.ribEntries++;
+                // Keep the first entry of every prefix, wherever the others are
+                if (m_textPrefixes.insert(uint64_t(m_prefix.address) << 8 | m_prefix.length).second)
+                {
+                    callback(m_prefix, m_attributes);
+                    m_stats.routes++;
+                }
+                else
+                {
+                    m_stats.duplicates++;
+                }
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+inline bool
+MrtRibLoader::ParseBgpdumpLine(const char* begin, const char* end)
+{
+    // Split on '|' without copying; fields 5..10 are used
+    const char* field[12];
+    const char* fieldEnd[12];
+    uint32_t n = 0;
+    const char* p = begin;
+    while (n < 12)
+    {
+        const char* bar = static_cast<const char*>(memchr(p, '|', end - p));
+        field[n] = p;
+        fieldEnd[n] = bar ? bar : end;
+        n++;
+        if (!bar)
+        {
+            break;
+        }
+        p = bar + 1;
+    }
+    if (n < 11)
+    {
+        m_stats.malformed++;
+        return false;
+    }
+    if (memchr(field[5], ':', fieldEnd[5] - field[5]))
+    {
+        m_stats.skipped++; // IPv6
+        return false;
+    }
+
+    p = field[5];
+    if (!ParsePrefix(p, fieldEnd[5], m_prefix))
+    {
+        m_stats.malformed++;
+        return false;
+    }
+
+    m_attributes.asPath.clear();
+    for (p = field[6]; p < fieldEnd[6];)
+    {
+        uint32_t as;
+        if (ParseUnsigned(p, fieldEnd[6], as))
+        {
+            m_attributes.asPath.push_back(as);
+        }
+        else
+        {
+            ++p; // separators and AS_SET braces
+        }
+    }
+
+    // IGP, EGP or INCOMPLETE
+    std::size_t originLength = fieldEnd[7] - field[7];
+    m_attributes.origin = originLength == 0 || (originLength == 3 && *field[7] == 'I')
+                              ? 0
+                              : (*field[7] == 'E' ? 1 : 2);
+
+    uint32_t nextHop = 0;
+    p = field[8];
+    ParseIpv4(p, fieldEnd[8], nextHop);
+    m_attributes.nextHop = Ipv4Address(nextHop);
+
+    p = field[9];
+    if (!ParseUnsigned(p, fieldEnd[9], m_attributes.localPref) || m_attributes.localPref == 0)
+    {
+        m_attributes.localPref = 100;
+    }
+    p = field[10];
+    if (!ParseUnsigned(p, fieldEnd[10], m_attributes.med))
+    {
+        m_attributes.med = 0;
+    }
+    return true;
+}
+
+inline bool
+MrtRibLoader::ParseCompactLine(const char* begin, const char* end)
+{
+    const char* p = begin;
+    if (memchr(begin, ':', end - begin))
+    {
+        m_stats.skipped++; // IPv6
+        return false;
+    }
+    if (!ParsePrefix(p, end, m_prefix))
+    {
+        m_stats.malformed++;
+        return false;
+    }
+    m_attributes.origin = 0;
+    m_attributes.asPath.clear();
+    m_attributes.nextHop = Ipv4Address::GetZero();
+    m_attributes.med = 0;
+    m_attributes.localPref = 100;
+    while (p < end)
+    {
+        uint32_t as;
+        if (ParseUnsigned(p, end, as))
+        {
+            m_attributes.asPath.push_back(as);
+        }
+        else
+        {
+            ++p;
+        }
+    }
+    return true;
+}
+
+inline uint16_t
+MrtRibLoader::ReadU16(const uint8_t* p)
+{
+    return (static_cast<uint16_t>(p[0]) << 8) | p[1];
+}
+
+inline uint32_t
+MrtRibLoader::ReadU32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline bool
+MrtRibLoader::ParseUnsigned(const char*& p, const char* end, uint32_t& value)
+{
+    if (p >= end || *p < '0' || *p > '9')
+    {
+        return false;
+    }
+    uint64_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9')
+    {
+        v = v * 10 + (*p++ - '0');
+    }
+    value = static_cast<uint32_t>(v);
+    return v <= 0xffffffffu;
+}
+
+inline bool
+MrtRibLoader::ParseIpv4(const char*& p, const char* end, uint32_t& address)
+{
+    address = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        uint32_t octet;
+        if (!ParseUnsigned(p, end, octet) || octet > 255)
+        {
+            return false;
+        }
+        address = (address << 8) | octet;
+        if (i < 3)
+        {
+            if (p >= end || *p != '.')
+            {
+                return false;
+            }
+            ++p;
+        }
+    }
+    return true;
+}
+
+inline bool
+MrtRibLoader::ParsePrefix(const char*& p, const char* end, BgpPrefix& prefix)
+{
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        ++p;
+    }
+    uint32_t address;
+    uint32_t length;
+    if (!ParseIpv4(p, end, address) || p >= end || *p != '/')
+    {
+        return false;
+    }
+    ++p;
+    if (!ParseUnsigned(p, end, length) || length > 32)
+    {
+        return false;
+    }
+    prefix = BgpPrefix(address, length);
+    return true;
+}
+
+} // namespace ns3
+
+#endif /* WAN_MRT_LOADER_H */
@@ -0,0 +1,601 @@
+/*
+ * Declarative static route tables
+ *
+ * The exercises configure static routing with a hand-written
+ * AddNetworkRouteTo() call per route, each with its node, interface index
+ * and metric hardcoded next to it. RouteTable reads the routes of every
+ * node from one specification instead, checks them against the topology
+ * that was built and installs them in one pass.
+ *
+ * Two formats are read, detected from the first bytes of the file:
+ *
+ *  - the text Ipv4StaticRouting prints (PrintRoutingTableAllAt), as in
+ *    exercise02-triad-wan.routes. "Node: N, ..." lines select the node and
+ *    only the rows of an "Ipv4StaticRouting table" section (or of an
+ *    Ipv4IndexedStaticRouting one, which prints the same) are used:
+ *
+ *      Destination     Gateway         Genmask         Flags Metric Ref    Use Iface
+ *      10.1.3.0        10.1.1.2        255.255.255.0   UGS   0      -      -   1
+ *
+ *    Rows without a gateway that match an address of their interface are
+ *    the connected routes the stack adds by itself (loopback included) and
+ *    are skipped at install time. Anything that is not a row, a header or
+ *    a "Node:" line is ignored, so a saved routing table is a valid
+ *    specification as it is;
+ *  - a binary form written by Save(): a 24-byte header, then 24-byte
+ *    route records in native byte order, read with one read() for
+ *    generated meshes with many thousands of routes per node. The route
+ *    count of the header must match the file size before anything is
+ *    allocated.
+ *
+ * Loading is O(routes): routes are bucketed by node with a counting sort
+ * into one array with per-node offsets, and exact duplicates (same node,
+ * prefix, gateway and interface) are dropped through a hash set; the first
+ * one's metric wins. The offsets are indexed by node id, so ids of
+ * MAX_NODES and above are rejected when loading. Install() validates every
+ * route before touching any node: the node must exist and have an Internet
+ * stack, the interface must exist, the prefix must have no host bits set
+ * and a gateway must be on a subnet of the interface. The routing protocol
+ * of a node is looked up once, not once per route. Ipv4StaticRouting keeps
+ * its routes in a list; for big tables install into
+ * Ipv4IndexedStaticRouting instead (wan-indexed-static-routing.h):
+ *
+ *   routes.Install<Ipv4IndexedStaticRouting>(&Ipv4IndexedStaticRoutingHelper::GetIndexedStaticRouting);
+ *
+ * Usage: copy this header next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_ROUTE_TABLE_H
+#define WAN_ROUTE_TABLE_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Static routes of a set of nodes, loaded from a specification and
+ * installed in bulk.
+ */
+class RouteTable
+{
+  public:
+    struct Route
+    {
+        uint32_t node;
+        uint32_t network;   ///< host byte order
+        uint32_t gateway;   ///< 0 for an on-link route
+        uint32_t interface;
+        uint32_t length;    ///< prefix length
+        uint32_t metric;
+    };
+
+    struct Statistics
+    {
+        uint64_t lines{0};      ///< text lines read
+        uint64_t routes{0};     ///< routes in the table
+        uint64_t duplicates{0}; ///< routes dropped as duplicates
+        uint64_t connected{0};  ///< connected routes skipped by Install()
+        uint64_t installed{0};  ///< routes added by Install()
+        uint32_t nodes{0};      ///< nodes with at least one route
+    };
+
+    /// Node ids are indices into a dense offset array; larger ones are rejected
+    static constexpr uint32_t MAX_NODES = 1u << 24;
+
+    /// Add a route (node < MAX_NODES); call Compile() (or Load) before reading the table back
+    void AddRoute(uint32_t node,
+                  Ipv4Address network,
+                  uint8_t length,
+                  Ipv4Address gateway,
+                  uint32_t interface,
+                  uint32_t metric = 0);
+
+    /// Replace the routes by those of a text or binary specification; false on error (see GetError())
+    bool Load(const std::string& path);
+
+    /// Replace the routes by those of a text specification
+    bool LoadText(std::istream& input);
+
+    /// Write the routes in the binary form
+    bool Save(const std::string& path) const;
+
+    /// Bucket the routes by node and drop duplicates
+    void Compile();
+
+    /**
+     * Check every route against the built topology (see the file comment).
+     * \return false (see GetError()) at the first invalid route
+     */
+    bool Validate() const;
+
+    /**
+     * Validate, then add the routes to each node's Ipv4StaticRouting.
+     * \return false (see GetError()) if a route is invalid; nothing is installed then
+     */
+    bool Install();
+
+    /**
+     * Validate, then add the routes through get(ipv4), which returns the
+     * routing protocol of a node. Routing needs the Ipv4StaticRouting route
+     * API: AddNetworkRouteTo(network, mask, gateway, interface, metric) and
+     * AddNetworkRouteTo(network, mask, interface, metric).
+     */
+    template <class Routing>
+    bool Install(std::function<Ptr<Routing>(Ptr<Ipv4>)> get);
+
+    /// Routes of one node, sorted as loaded
+    std::pair<const Route*, const Route*> GetRoutes(uint32_t node) const;
+
+    uint64_t GetNRoutes() const;
+    const Statistics& GetStatistics() const;
+    const std::string& GetError() const;
+
+  private:
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static constexpr uint32_t VERSION = 1;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t byteOrder;
+        uint32_t version;
+        uint64_t routes;
+    };
+
+    /// (network, gateway) and (interface, length) of a route, for duplicate detection
+    struct RouteKey
+    {
+        uint64_t high;
+        uint64_t low;
+
+        bool operator==(const RouteKey& other) const
+        {
+            return high == other.high && low == other.low;
+        }
+    };
+
+    struct RouteKeyHash
+    {
+        std::size_t operator()(const RouteKey& key) const
+        {
+            return std::hash<uint64_t>()(key.high * 0x9e3779b97f4a7c15ull ^ key.low);
+        }
+    };
+
+    static bool ParseAddress(const std::string& text, uint32_t& address);
+    static uint32_t MaskOf(uint32_t length);
+    static bool IsConnected(Ptr<Ipv4> ipv4, const Route& route);
+    bool Check(const Route& route) const;
+
+    std::vector<Route> m_routes;    ///< grouped by node after Compile()
+    std::vector<uint64_t> m_offset; ///< first route of node i is m_routes[m_offset[i]]
+    bool m_compiled{true};
+    Statistics m_stats;
+    mutable std::string m_error;
+};
+
+inline void
+RouteTable::AddRoute(uint32_t node,
+                     Ipv4Address network,
+                     uint8_t length,
+                     Ipv4Address gateway,
+                     uint32_t interface,
+                     uint32_t metric)
+{
+    NS_ABORT_MSG_IF(node >= MAX_NODES, "RouteTable: node " << node << " out of range");
+    m_routes.push_back({node, network.Get(), gateway.Get(), interface, length, metric});
+    m_compiled = false;
+}
+
+inline uint32_t
+RouteTable::MaskOf(uint32_t length)
+{
+    return length == 0 ? 0 : ~uint32_t(0) << (32 - length);
+}
+
+inline bool
+RouteTable::ParseAddress(const std::string& text, uint32_t& address)
+{
+    unsigned int b[4];
+    char trailing;
+    if (std::sscanf(text.c_str(), "%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &trailing) != 4 ||
+        b[0] > 255 || b[1] > 255 || b[2] > 255 || b[3] > 255)
+    {
+        return false;
+    }
+    address = b[0] << 24 | b[1] << 16 | b[2] << 8 | b[3];
+    return true;
+}
+
+inline bool
+RouteTable::Load(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        m_error = "cannot open " + path;
+        return false;
+    }
+    FileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (file.gcount() == sizeof(header) && memcmp(header.magic, "WANROUTE", 8) == 0)
+    {
+        if (header.byteOrder != BYTE_ORDER_MARK || header.version != VERSION)
+        {
+            m_error = path + " is not a version " + std::to_string(VERSION) +
+                      " route table of this byte order";
+            return false;
+        }
+        // Trust the route count only once the file size agrees with it
+        file.seekg(0, std::ios::end);
+        uint64_t records = uint64_t(file.tellg()) - sizeof(header);
+        file.seekg(sizeof(header));
+        if (!file || records % sizeof(Route) != 0 || header.routes != records / sizeof(Route))
+        {
+            m_error = path + " is truncated or corrupt";
+            return false;
+        }
+        m_stats = Statistics();
+        m_routes.resize(header.routes);
+        file.read(reinterpret_cast<char*>(m_routes.data()), header.routes * sizeof(Route));
+        if (uint64_t(file.gcount()) != header.routes * sizeof(Route) || file.peek() != EOF)
+        {
+            m_routes.clear();
+            m_error = path + " is truncated or corrupt";
+            return false;
+        }
+        for (const Route& route : m_routes)
+        {
+            if (route.node >= MAX_NODES)
+            {
+                m_routes.clear();
+                m_error = path + ": node " + std::to_string(route.node) + " out of range";
+                return false;
+            }
+        }
+        m_compiled = false;
+        Compile();
+        return true;
+    }
+    file.clear();
+    file.seekg(0);
+    if (!LoadText(file))
+    {
+        m_error = path + ": " + m_error;
+        return false;
+    }
+    return true;
+}
+
+inline bool
+RouteTable::LoadText(std::istream& input)
+{
+    m_routes.clear();
+    m_stats = Statistics();
+    std::string line;
+    bool node = false;
+    bool staticTable = false;
+    uint32_t nodeId = 0;
+    while (std::getline(input, line))
+    {
+        m_stats.lines++;
+        if (line.compare(0, 6, "Node: ") == 0)
+        {
+            unsigned long id = std::strtoul(line.c_str() + 6, nullptr, 10);
+            if (id >= MAX_NODES)
+            {
+                m_error = "line " + std::to_string(m_stats.lines) + ": node " + std::to_string(id) + " out of range";
+                return false;
+            }
+            nodeId = id;
+            node = true;
+            staticTable = line.find("StaticRouting table") != std::string::npos;
+            continue;
+        }
+        if (!staticTable || line.empty() || line[0] < '0' || line[0] > '9')
+        {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string destination, gateway, mask, flags, ref, use;
+        uint32_t metric, interface;
+        Route route;
+        uint32_t maskBits;
+        if (!(fields >> destination >> gateway >> mask >> flags >> metric >> ref >> use >> interface) ||
+            !ParseAddress(destination, route.network) || !ParseAddress(gateway, route.gateway) ||
+            !ParseAddress(mask, maskBits))
+        {
+            m_error = "line " + std::to_string(m_stats.lines) + ": cannot parse \"" + line + "\"";
+            return false;
+        }
+        route.length = 32 - __builtin_ctzll(uint64_t(maskBits) | (uint64_t(1) << 32));
+        if (maskBits != MaskOf(route.length))
+        {
+            m_error = "line " + std::to_string(m_stats.lines) + ": " + mask + " is not a prefix mask";
+            return false;
+        }
+        if (!node)
+        {
+            m_error = "line " + std::to_string(m_stats.lines) + ": route before the first \"Node:\" line";
+            return false;
+        }
+        route.node = nodeId;
+        route.interface = interface;
+        route.metric = metric;
+        m_routes.push_back(route);
+    }
+    m_compiled = false;
+    Compile();
+    return true;
+}
+
+inline void
+RouteTable::Compile()
+{
+    if (m_compiled)
+    {
+        return;
+    }
+    // Counting sort by node: stable, so every node keeps the order of its routes
+    uint32_t nodes = 0;
+    for (const Route& route : m_routes)
+    {
+        nodes = std::max(nodes, route.node + 1);
+    }
+    m_offset.assign(nodes + 1, 0);
+    for (const Route& route : m_routes)
+    {
+        m_offset[route.node + 1]++;
+    }
+    for (uint32_t i = 0; i < nodes; ++i)
+    {
+        m_offset[i + 1] += m_offset[i];
+    }
+    std::vector<Route> sorted(m_routes.size());
+    std::vector<uint64_t> next(m_offset.begin(), m_offset.end() - 1);
+    for (const Route& route : m_routes)
+    {
+        sorted[next[route.node]++] = route;
+    }
+
+    // Drop duplicates in place, per node, and close the gaps
+    std::unordered_set<RouteKey, RouteKeyHash> seen;
+    uint64_t out = 0;
+    uint64_t begin = 0;
+    m_stats.duplicates = 0;
+    m_stats.nodes = 0;
+    for (uint32_t n = 0; n < nodes; ++n)
+    {
+        uint64_t end = m_offset[n + 1];
+        m_offset[n] = out;
+        seen.clear();
+        seen.reserve(end - begin);
+        for (uint64_t i = begin; i < end; ++i)
+        {
+            const Route& route = sorted[i];
+            RouteKey key{uint64_t(route.network) << 32 | route.gateway,
+                         uint64_t(route.interface) << 8 | route.length};
+            if (!seen.insert(key).second)
+            {
+                m_stats.duplicates++;
+                continue;
+            }
+            sorted[out++] = route;
+        }
+        m_stats.nodes += out > m_offset[n];
+        begin = end;
+    }
+    m_offset[nodes] = out;
+    sorted.resize(out);
+    m_routes.swap(sorted);
+    m_stats.routes = m_routes.size();
+    m_compiled = true;
+}
+
+inline bool
+RouteTable::Save(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        m_error = "cannot create " + path;
+        return false;
+    }
+    FileHeader header;
+    memcpy(header.magic, "WANROUTE", 8);
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.version = VERSION;
+    header.routes = m_routes.size();
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(m_routes.data()), m_routes.size() * sizeof(Route));
+    if (!file.flush())
+    {
+        m_error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+inline bool
+RouteTable::IsConnected(Ptr<Ipv4> ipv4, const Route& route)
+{
+    if (route.gateway != 0)
+    {
+        return false;
+    }
+    for (uint32_t a = 0; a < ipv4->GetNAddresses(route.interface); ++a)
+    {
+        Ipv4InterfaceAddress address = ipv4->GetAddress(route.interface, a);
+        if (address.GetMask().GetPrefixLength() == route.length &&
+            (address.GetLocal().Get() & MaskOf(route.length)) == route.network)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool
+RouteTable::Check(const Route& route) const
+{
+    std::ostringstream where;
+    where << "node " << route.node << ", " << Ipv4Address(route.network) << "/" << route.length << " via "
+          << Ipv4Address(route.gateway) << " interface " << route.interface << ": ";
+    if (route.node >= NodeList::GetNNodes())
+    {
+        m_error = where.str() + "no such node";
+        return false;
+    }
+    Ptr<Ipv4> ipv4 = NodeList::GetNode(route.node)->GetObject<Ipv4>();
+    if (!ipv4)
+    {
+        m_error = where.str() + "node has no Internet stack";
+        return false;
+    }
+    if (route.length > 32 || (route.network & ~MaskOf(route.length)) != 0)
+    {
+        m_error = where.str() + "host bits set in the prefix";
+        return false;
+    }
+    if (route.interface >= ipv4->GetNInterfaces())
+    {
+        m_error = where.str() + "node has " + std::to_string(ipv4->GetNInterfaces()) + " interfaces";
+        return false;
+    }
+    if (route.gateway == 0)
+    {
+        return true;
+    }
+    for (uint32_t a = 0; a < ipv4->GetNAddresses(route.interface); ++a)
+    {
+        Ipv4InterfaceAddress address = ipv4->GetAddress(route.interface, a);
+        uint32_t mask = address.GetMask().Get();
+        if ((address.GetLocal().Get() & mask) == (route.gateway & mask) &&
+            address.GetLocal().Get() != route.gateway)
+        {
+            return true;
+        }
+    }
+    m_error = where.str() + "gateway is not on a subnet of the interface";
+    return false;
+}
+
+inline bool
+RouteTable::Validate() const
+{
+    NS_ASSERT_MSG(m_compiled, "RouteTable: Compile() after AddRoute()");
+    for (const Route& route : m_routes)
+    {
+        if (!Check(route))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool
+RouteTable::Install()
+{
+    Ipv4StaticRoutingHelper helper;
+    return Install<Ipv4StaticRouting>(
+        [&helper](Ptr<Ipv4> ipv4) { return helper.GetStaticRouting(ipv4); });
+}
+
+template <class Routing>
+bool
+RouteTable::Install(std::function<Ptr<Routing>(Ptr<Ipv4>)> get)
+{
+    Compile();
+    if (!Validate())
+    {
+        return false;
+    }
+    m_stats.connected = 0;
+    m_stats.installed = 0;
+    for (uint32_t n = 0; n + 1 < m_offset.size(); ++n)
+    {
+        if (m_offset[n] == m_offset[n + 1])
+        {
+            continue;
+        }
+        Ptr<Ipv4> ipv4 = NodeList::GetNode(n)->GetObject<Ipv4>();
+        Ptr<Routing> routing = get(ipv4);
+        if (!routing)
+        {
+            m_error = "node " + std::to_string(n) + " has no routing protocol to install into";
+            return false;
+        }
+        for (uint64_t i = m_offset[n]; i < m_offset[n + 1]; ++i)
+        {
+            const Route& route = m_routes[i];
+            if (IsConnected(ipv4, route))
+            {
+                m_stats.connected++;
+                continue;
+            }
+            Ipv4Mask mask(MaskOf(route.length));
+            if (route.gateway != 0)
+            {
+                routing->AddNetworkRouteTo(Ipv4Address(route.network),
+                                           mask,
+                                           Ipv4Address(route.gateway),
+                                           route.interface,
+                                           route.metric);
+            }
+            else
+            {
+                routing->AddNetworkRouteTo(Ipv4Address(route.network), mask, route.interface, route.metric);
+            }
+            m_stats.installed++;
+        }
+    }
+    return true;
+}
+
+inline std::pair<const RouteTable::Route*, const RouteTable::Route*>
+RouteTable::GetRoutes(uint32_t node) const
+{
+    NS_ASSERT_MSG(m_compiled, "RouteTable: Compile() after AddRoute()");
+    if (node + 1 >= m_offset.size())
+    {
+        return {nullptr, nullptr};
+    }
+    const Route* base = m_routes.data();
+    return {base + m_offset[node], base + m_offset[node + 1]};
+}
+
+inline uint64_t
+RouteTable::GetNRoutes() const
+{
+    return m_routes.size();
+}
+
+inline const RouteTable::Statistics&
+RouteTable::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline const std::string&
+RouteTable::GetError() const
+{
+    return m_error;
+}
+
+} // namespace ns3
+
+#endif /* WAN_ROUTE_TABLE_H */
@@ -0,0 +1,585 @@
+/*
+ * Import validation for BGP routes: RPKI origin validation and valley-free checks
+ *
+ * Meant as a BgpSpeaker import filter on border routers (see
+ * BgpSpeaker::SetImportFilter()), so every route received over eBGP is
+ * checked before it reaches the Adj-RIB-In:
+ *
+ *  - RoaTable holds validated ROA payloads (prefix, max length, origin AS)
+ *    and answers RFC 6811 origin validation: Valid, Invalid or NotFound.
+ *    The ROA prefixes are indexed in an LpmTrie (wan-lpm-fib.h); every
+ *    prefix also links to the next shorter ROA prefix covering it. One trie
+ *    lookup (at most three memory reads) finds the most specific ROA on the
+ *    route's address and the covering ROAs are reached by following the
+ *    links, so a check costs a handful of memory reads whatever the table
+ *    size (ROA prefixes rarely nest more than two or three deep).
+ *
+ *  - AsRelationships holds customer/provider and peer links between ASes
+ *    (CAIDA as-rel format) and checks that an AS_PATH is valley-free
+ *    (Gao-Rexford): climbing customer-to-provider links, crossing at most
+ *    one peer link, then only descending. A route breaking this was leaked
+ *    by some AS on the path. Links missing from the table are not judged.
+ *
+ * BgpRouteValidator combines both for one router and keeps the counters.
+ *
+ * Usage: copy this header next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_ROUTE_VALIDATION_H
+#define WAN_ROUTE_VALIDATION_H
+
+#include "wan-bgp-speaker.h"
+#include "wan-lpm-fib.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/// RFC 6811 validation state of a route
+enum RpkiState : uint8_t
+{
+    RPKI_NOT_FOUND,
+    RPKI_VALID,
+    RPKI_INVALID
+};
+
+/**
+ * Validated ROA payloads indexed for origin validation.
+ *
+ * Fill the table with Add() or Load(), then call Build() before validating.
+ */
+class RoaTable
+{
+  public:
+    RoaTable();
+
+    /// Authorize originAs to announce prefix and its more specifics up to maxLength
+    void Add(const BgpPrefix& prefix, uint8_t maxLength, uint32_t originAs);
+
+    /**
+     * Read a validator CSV export ("ASN,IP Prefix,Max Length[,...]", as written by
+     * Routinator or rpki-client). The header line and IPv6 entries are skipped.
+     * Calls Build(). Returns false (see GetError()) on a malformed line.
+     */
+    bool Load(const std::string& fileName);
+
+    /// Index the ROAs added so far
+    void Build();
+
+    /// Origin validation of a route (RFC 6811, section 2)
+    RpkiState Validate(const BgpPrefix& prefix, uint32_t originAs) const;
+
+    /// Number of ROA payloads
+    std::size_t GetNRoas() const;
+
+    /// Number of distinct ROA prefixes
+    std::size_t GetNPrefixes() const;
+
+    /// Bytes used by the lookup structures (trie, prefix links and ROA payloads)
+    std::size_t GetMemoryUsage() const;
+
+    const std::string& GetError() const;
+
+  private:
+    struct Entry
+    {
+        BgpPrefix prefix;
+        uint8_t maxLength;
+        uint32_t originAs;
+    };
+
+    /// ROA payloads sharing one prefix; m_roas[first, first + count)
+    struct PrefixGroup
+    {
+        uint32_t parent; ///< next shorter covering ROA prefix, or NONE
+        uint32_t first;
+        uint16_t count;
+        uint8_t length;
+    };
+
+    struct Roa
+    {
+        uint32_t originAs;
+        uint8_t maxLength;
+    };
+
+    static constexpr uint32_t NONE = 0xffffffff;
+
+    std::vector<Entry> m_entries;
+    LpmTrie m_trie;
+    std::vector<PrefixGroup> m_groups;
+    std::vector<Roa> m_roas;
+    bool m_built;
+    std::string m_error;
+};
+
+/**
+ * Business relationships between ASes.
+ */
+class AsRelationships
+{
+  public:
+    /// What an AS is to another one
+    enum Relationship : int8_t
+    {
+        UNKNOWN,
+        CUSTOMER,
+        PEER,
+        PROVIDER
+    };
+
+    void AddProviderCustomer(uint32_t provider, uint32_t customer);
+    void AddPeers(uint32_t a, uint32_t b);
+
+    /**
+     * Read a CAIDA AS relationship file: "a|b|-1" (a is provider of b) or
+     * "a|b|0" (peers), further fields and '#' comment lines are ignored.
+     * Returns false (see GetError()) on a malformed line.
+     */
+    bool Load(const std::string& fileName);
+
+    /// What b is to a
+    Relationship Get(uint32_t a, uint32_t b) const;
+
+    /**
+     * Check an AS_PATH received by localAs (first AS = neighbour, last =
+     * origin) for a valley. AS_PATH prepending is allowed.
+     */
+    bool IsValleyFree(uint32_t localAs, const std::vector<uint32_t>& asPath) const;
+
+    /// Number of known AS links
+    std::size_t GetNLinks() const;
+
+    /// Call f(a, b, what b is to a) for every link, with a < b, in no particular order
+    template <class F>
+    void ForEach(F f) const
+    {
+        for (const auto& link : m_links)
+        {
+            f(static_cast<uint32_t>(link.first >> 32), static_cast<uint32_t>(link.first), link.second);
+        }
+    }
+
+    const std::string& GetError() const;
+
+  private:
+    static uint64_t Key(uint32_t a, uint32_t b);
+
+    /// Keyed by (lower AS, higher AS): what the higher AS is to the lower one
+    std::unordered_map<uint64_t, Relationship> m_links;
+    std::string m_error;
+};
+
+/**
+ * Import filter of one border router: drops routes whose AS_PATH does not
+ * start with the neighbour's AS, RPKI-invalid routes and routes whose
+ * AS_PATH has a valley.
+ */
+class BgpRouteValidator
+{
+  public:
+    enum Result
+    {
+        ACCEPT,
+        REJECT_RPKI_INVALID,
+        REJECT_VALLEY
+    };
+
+    struct Statistics
+    {
+        uint64_t checked{0};
+        uint64_t rpkiValid{0};
+        uint64_t rpkiInvalid{0};
+        uint64_t rpkiNotFound{0};
+        uint64_t valleys{0};
+        uint64_t wrongFirstAs{0}; ///< AS_PATH not starting with the peer's AS (Accept() only)
+        uint64_t rejected{0};
+    };
+
+    /**
+     * \param localAs AS of the router
+     * \param roas ROA table, or nullptr to skip origin validation
+     * \param relationships AS relationships, or nullptr to skip the valley check
+     *
+     * Both tables are shared by reference and must outlive the validator.
+     */
+    BgpRouteValidator(uint32_t localAs, const RoaTable* roas, const AsRelationships* relationships);
+
+    /// Validate a route received from an eBGP peer (its AS first in the AS_PATH)
+    Result Validate(const BgpPrefix& prefix, const BgpPathAttributes& attributes);
+
+    /// BgpSpeaker::ImportFilterCallback: true if the path starts with peerAs and Validate() accepts it
+    bool Accept(uint32_t peerAs, const BgpPrefix& prefix, const BgpPathAttributes& attributes);
+
+    const Statistics& GetStatistics() const;
+
+  private:
+    uint32_t m_localAs;
+    const RoaTable* m_roas;
+    const AsRelationships* m_relationships;
+    Statistics m_stats;
+};
+
+// ==============================================
+// RoaTable
+// ==============================================
+
+inline RoaTable::RoaTable()
+    : m_built(true)
+{
+}
+
+inline void
+RoaTable::Add(const BgpPrefix& prefix, uint8_t maxLength, uint32_t originAs)
+{
+    m_entries.push_back({prefix, std::max(maxLength, prefix.length), originAs});
+    m_built = false;
+}
+
+inline bool
+RoaTable::Load(const std::string& fileName)
+{
+    std::ifstream in(fileName);
+    if (!in)
+    {
+        m_error = "cannot open " + fileName;
+        return false;
+    }
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#' || line.find(':') != std::string::npos)
+        {
+            continue; // comment or IPv6
+        }
+        const char* p = line.c_str();
+        if (p[0] == 'A' && p[1] == 'S')
+        {
+            p += 2;
+        }
+        if (*p < '0' || *p > '9')
+        {
+            continue; // header
+        }
+        char* end;
+        uint32_t originAs = std::strtoul(p, &end, 10);
+        unsigned a, b, c, d, length, maxLength;
+        if (*end != ',' ||
+            std::sscanf(end + 1, "%u.%u.%u.%u/%u,%u", &a, &b, &c, &d, &length, &maxLength) != 6 ||
+            a > 255 || b > 255 || c > 255 || d > 255 || length > 32 || maxLength > 32 ||
+            maxLength < length)
+        {
+            m_error = fileName + ":" + std::to_string(lineNumber) + ": malformed ROA";
+            return false;
+        }
+        Add(BgpPrefix((a << 24) | (b << 16) | (c << 8) | d, length), maxLength, originAs);
+    }
+    Build();
+    return true;
+}
+
+inline void
+RoaTable::Build()
+{
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry& x, const Entry& y) {
+        if (x.prefix != y.prefix)
+        {
+            return x.prefix < y.prefix;
+        }
+        return x.originAs != y.originAs ? x.originAs < y.originAs : x.maxLength < y.maxLength;
+    });
+
+    m_trie.Clear();
+    m_groups.clear();
+    m_roas.clear();
+    // Sorted by (address, length), a covering prefix comes before the prefixes
+    // it covers, so the chain of covering prefixes is a stack
+    std::vector<std::pair<BgpPrefix, uint32_t>> covering;
+    for (std::size_t i = 0; i < m_entries.size(); ++i)
+    {
+        const Entry& entry = m_entries[i];
+        if (i == 0 || entry.prefix != m_entries[i - 1].prefix || m_groups.back().count == 0xffff)
+        {
+            while (!covering.empty() &&
+                   BgpPrefix(entry.prefix.address, covering.back().first.length) != covering.back().first)
+            {
+                covering.pop_back();
+            }
+            uint32_t parent = covering.empty() ? NONE : covering.back().second;
+            uint32_t group = m_groups.size();
+            m_groups.push_back({parent, static_cast<uint32_t>(m_roas.size()), 0, entry.prefix.length});
+            m_trie.Insert(entry.prefix.address, entry.prefix.length, group);
+            covering.emplace_back(entry.prefix, group);
+        }
+        if (!m_roas.empty() && m_groups.back().count > 0 && m_roas.back().originAs == entry.originAs &&
+            m_roas.back().maxLength <= entry.maxLength)
+        {
+            m_roas.back().maxLength = entry.maxLength; // same origin: the longest maxLength wins
+            continue;
+        }
+        m_roas.push_back({entry.originAs, entry.maxLength});
+        m_groups.back().count++;
+    }
+    m_built = true;
+}
+
+inline RpkiState
+RoaTable::Validate(const BgpPrefix& prefix, uint32_t originAs) const
+{
+    NS_ASSERT_MSG(m_built, "RoaTable: call Build() after adding ROAs");
+    RpkiState state = RPKI_NOT_FOUND;
+    uint32_t group = m_trie.Lookup(prefix.address);
+    if (group == LpmTrie::NO_ROUTE)
+    {
+        return state;
+    }
+    while (group != NONE)
+    {
+        const PrefixGroup& g = m_groups[group];
+        if (g.length <= prefix.length)
+        {
+            state = RPKI_INVALID;
+            for (uint32_t i = g.first; i < g.first + g.count; ++i)
+            {
+                if (m_roas[i].originAs == originAs && prefix.length <= m_roas[i].maxLength)
+                {
+                    return RPKI_VALID;
+                }
+            }
+        }
+        group = g.parent;
+    }
+    return state;
+}
+
+inline std::size_t
+RoaTable::GetNRoas() const
+{
+    return m_roas.size();
+}
+
+inline std::size_t
+RoaTable::GetNPrefixes() const
+{
+    return m_groups.size();
+}
+
+inline std::size_t
+RoaTable::GetMemoryUsage() const
+{
+    return m_trie.GetLookupMemory() + m_groups.capacity() * sizeof(PrefixGroup) +
+           m_roas.capacity() * sizeof(Roa);
+}
+
+inline const std::string&
+RoaTable::GetError() const
+{
+    return m_error;
+}
+
+// ==============================================
+// AsRelationships
+// ==============================================
+
+inline uint64_t
+AsRelationships::Key(uint32_t a, uint32_t b)
+{
+    return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+inline void
+AsRelationships::AddProviderCustomer(uint32_t provider, uint32_t customer)
+{
+    m_links[Key(provider, customer)] = provider < customer ? CUSTOMER : PROVIDER;
+}
+
+inline void
+AsRelationships::AddPeers(uint32_t a, uint32_t b)
+{
+    m_links[Key(a, b)] = PEER;
+}
+
+inline bool
+AsRelationships::Load(const std::string& fileName)
+{
+    std::ifstream in(fileName);
+    if (!in)
+    {
+        m_error = "cannot open " + fileName;
+        return false;
+    }
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(in, line))
+    {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#')
+        {
+            continue;
+        }
+        unsigned long a, b;
+        int relationship;
+        if (std::sscanf(line.c_str(), "%lu|%lu|%d", &a, &b, &relationship) != 3 ||
+            (relationship != -1 && relationship != 0))
+        {
+            m_error = fileName + ":" + std::to_string(lineNumber) + ": malformed AS relationship";
+            return false;
+        }
+        if (relationship == -1)
+        {
+            AddProviderCustomer(a, b);
+        }
+        else
+        {
+            AddPeers(a, b);
+        }
+    }
+    return true;
+}
+
+inline AsRelationships::Relationship
+AsRelationships::Get(uint32_t a, uint32_t b) const
+{
+    auto it = m_links.find(Key(a, b));
+    if (it == m_links.end())
+    {
+        return UNKNOWN;
+    }
+    if (a < b || it->second == PEER)
+    {
+        return it->second;
+    }
+    return it->second == CUSTOMER ? PROVIDER : CUSTOMER;
+}
+
+inline bool
+AsRelationships::IsValleyFree(uint32_t localAs, const std::vector<uint32_t>& asPath) const
+{
+    // Follow the route from the origin towards us: up* peer? down*
+    bool descending = false;
+    for (std::size_t i = asPath.size(); i-- > 0;)
+    {
+        uint32_t from = asPath[i];
+        uint32_t to = i == 0 ? localAs : asPath[i - 1];
+        if (from == to)
+        {
+            continue;
+        }
+        switch (Get(from, to))
+        {
+        case PROVIDER:
+            if (descending)
+            {
+                return false;
+            }
+            break;
+        case PEER:
+            if (descending)
+            {
+                return false;
+            }
+            descending = true;
+            break;
+        case CUSTOMER:
+            descending = true;
+            break;
+        case UNKNOWN:
+            break;
+        }
+    }
+    return true;
+}
+
+inline std::size_t
+AsRelationships::GetNLinks() const
+{
+    return m_links.size();
+}
+
+inline const std::string&
+AsRelationships::GetError() const
+{
+    return m_error;
+}
+
+// ==============================================
+// BgpRouteValidator
+// ==============================================
+
+inline BgpRouteValidator::BgpRouteValidator(uint32_t localAs,
+                                            const RoaTable* roas,
+                                            const AsRelationships* relationships)
+    : m_localAs(localAs),
+      m_roas(roas),
+      m_relationships(relationships)
+{
+}
+
+inline BgpRouteValidator::Result
+BgpRouteValidator::Validate(const BgpPrefix& prefix, const BgpPathAttributes& attributes)
+{
+    m_stats.checked++;
+    Result result = ACCEPT;
+    if (m_roas && !attributes.asPath.empty())
+    {
+        switch (m_roas->Validate(prefix, attributes.asPath.back()))
+        {
+        case RPKI_VALID:
+            m_stats.rpkiValid++;
+            break;
+        case RPKI_NOT_FOUND:
+            m_stats.rpkiNotFound++;
+            break;
+        case RPKI_INVALID:
+            m_stats.rpkiInvalid++;
+            result = REJECT_RPKI_INVALID;
+            break;
+        }
+    }
+    if (m_relationships && !m_relationships->IsValleyFree(m_localAs, attributes.asPath))
+    {
+        m_stats.valleys++;
+        if (result == ACCEPT)
+        {
+            result = REJECT_VALLEY;
+        }
+    }
+    if (result != ACCEPT)
+    {
+        m_stats.rejected++;
+    }
+    return result;
+}
+
+inline bool
+BgpRouteValidator::Accept(uint32_t peerAs, const BgpPrefix& prefix, const BgpPathAttributes& attributes)
+{
+    // RFC 4271, section 6.3: the neighbour must be the first AS of the path
+    if (attributes.asPath.empty() || attributes.asPath.front() != peerAs)
+    {
+        m_stats.checked++;
+        m_stats.wrongFirstAs++;
+        m_stats.rejected++;
+        return false;
+    }
+    return Validate(prefix, attributes) == ACCEPT;
+}
+
+inline const BgpRouteValidator::Statistics&
+BgpRouteValidator::GetStatistics() const
+{
+    return m_stats;
+}
+
+} // namespace ns3
+
+#endif /* WAN_ROUTE_VALIDATION_H */
@@ -0,0 +1,581 @@
+/*
+ * Warm start from a snapshot of converged routing state
+ *
+ * Every run of the exercises assigns addresses and computes routes before
+ * any traffic flows. On a small topology that takes no time. On a large
+ * one, global routing's Dijkstra per node or BGP convergence take much
+ * longer than the run itself. RoutingSnapshot saves what that warm-up
+ * produces into a compact binary file:
+ *
+ *   - per node: id and number of devices (to check the layout);
+ *   - per interface: index, device, metric, up and forwarding flags and
+ *     its addresses;
+ *   - per node: the FIB, as (network, length, gateway, interface) records.
+ *
+ * A later run builds the same nodes and devices, then maps the file
+ * (mmap(), records read in place) and Restore() puts the addresses back on
+ * the interfaces and loads the FIBs into an Ipv4LpmRouting per node
+ * (wan-lpm-fib.h). Address assignment and route computation are skipped.
+ *
+ * File layout, native byte order: a 48-byte header, then the node,
+ * interface, address and route records back to back, each array of
+ * fixed-size records. Loading is one pass over the mapping, with no
+ * parsing.
+ *
+ * Simplifications compared to checkpointing a real router:
+ *  - devices and channels are not in the file: the warm run must create
+ *    the same nodes with the same devices in the same order. Node ids,
+ *    device counts and interface indices are checked, and Restore() fails
+ *    if they differ. Before it changes any node, Restore() also checks
+ *    every record against the header totals and the devices, interfaces
+ *    and prefix lengths that exist, so a corrupt file is rejected, not
+ *    read past its end;
+ *  - FIBs are read from Ipv4LpmRouting, Ipv4StaticRouting and
+ *    Ipv4GlobalRouting, on their own or inside an Ipv4ListRouting.
+ *    BgpSpeaker resolves its next hops at lookup time and has no flat FIB
+ *    to save; it and any other protocol are skipped and counted;
+ *  - the protocols of a node are merged into one table. Where two of them
+ *    have the same prefix, the higher-priority route is kept. Routes of
+ *    different lengths compete by longest match, not by list priority;
+ *  - one route per prefix, no metric: what Ipv4LpmRouting holds;
+ *  - ns-3 reads static and global routes with GetRoute(i), which walks a
+ *    list, so saving those tables is quadratic in their size. Saving is
+ *    done once, restoring at every run.
+ *
+ * Usage: copy this header and wan-lpm-fib.h next to the exercise script in
+ * scratch/.
+ */
+
+#ifndef WAN_ROUTING_SNAPSHOT_H
+#define WAN_ROUTING_SNAPSHOT_H
+
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "wan-lpm-fib.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Saves and restores interface addresses and FIBs of a set of nodes.
+ */
+class RoutingSnapshot
+{
+  public:
+    struct Statistics
+    {
+        uint64_t bytes{0};           ///< size of the snapshot file
+        uint32_t nodes{0};
+        uint64_t interfaces{0};
+        uint64_t addresses{0};
+        uint64_t routes{0};
+        uint64_t shadowed{0};        ///< routes dropped for a higher-priority route to the same prefix
+        uint32_t skippedProtocols{0}; ///< routing protocols whose routes could not be read
+    };
+
+    RoutingSnapshot();
+    ~RoutingSnapshot();
+
+    RoutingSnapshot(const RoutingSnapshot&) = delete;
+    RoutingSnapshot& operator=(const RoutingSnapshot&) = delete;
+
+    /// Write the state of the nodes to a file; returns false (see GetError()) on error
+    bool Save(const std::string& path, const NodeContainer& nodes);
+
+    /// Map a snapshot file; returns false (see GetError()) if it is not a valid snapshot
+    bool Open(const std::string& path);
+
+    /// Unmap the file
+    void Close();
+
+    /**
+     * Assign the saved addresses and load the saved FIBs. The nodes must
+     * have their devices and Internet stacks, and no addresses yet.
+     * \return false (see GetError()) if the nodes do not match the snapshot
+     */
+    bool Restore(const NodeContainer& nodes);
+
+    /// List routing priority of the Ipv4LpmRouting added by Restore() (static routing is 0)
+    void SetPriority(int16_t priority);
+
+    const Statistics& GetStatistics() const;
+    const std::string& GetError() const;
+
+  private:
+    static constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;
+    static constexpr uint32_t VERSION = 1;
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t byteOrder;
+        uint32_t version;
+        uint32_t nodes;
+        uint32_t reserved;
+        uint64_t interfaces;
+        uint64_t addresses;
+        uint64_t routes;
+    };
+
+    struct NodeRecord
+    {
+        uint32_t id;
+        uint32_t devices;
+        uint32_t interfaces;
+        uint32_t routes;
+    };
+
+    struct InterfaceRecord
+    {
+        uint32_t interface;
+        uint32_t device;
+        uint16_t metric;
+        uint8_t up;
+        uint8_t forwarding;
+        uint32_t addresses;
+    };
+
+    struct AddressRecord
+    {
+        uint32_t local;
+        uint32_t mask;
+    };
+
+    struct RouteRecord
+    {
+        uint32_t network;
+        uint32_t gateway;
+        uint32_t interface;
+        uint32_t length;
+    };
+
+    /// Check every record of the mapping against the header and the nodes
+    bool CheckRecords(const NodeContainer& nodes);
+    void CollectRoutes(Ptr<Ipv4RoutingProtocol> protocol,
+                       std::unordered_set<uint64_t>& seen,
+                       std::vector<RouteRecord>& routes);
+    void AddRoute(Ipv4Address network,
+                  uint8_t length,
+                  Ipv4Address gateway,
+                  uint32_t interface,
+                  std::unordered_set<uint64_t>& seen,
+                  std::vector<RouteRecord>& routes);
+
+    const uint8_t* m_data;
+    std::size_t m_size;
+    int m_fd;
+    int16_t m_priority;
+    Statistics m_stats;
+    std::string m_error;
+};
+
+inline RoutingSnapshot::RoutingSnapshot()
+    : m_data(nullptr),
+      m_size(0),
+      m_fd(-1),
+      m_priority(5)
+{
+}
+
+inline RoutingSnapshot::~RoutingSnapshot()
+{
+    Close();
+}
+
+inline void
+RoutingSnapshot::SetPriority(int16_t priority)
+{
+    m_priority = priority;
+}
+
+inline const RoutingSnapshot::Statistics&
+RoutingSnapshot::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline const std::string&
+RoutingSnapshot::GetError() const
+{
+    return m_error;
+}
+
+inline void
+RoutingSnapshot::AddRoute(Ipv4Address network,
+                          uint8_t length,
+                          Ipv4Address gateway,
+                          uint32_t interface,
+                          std::unordered_set<uint64_t>& seen,
+                          std::vector<RouteRecord>& routes)
+{
+    if (!seen.insert((uint64_t(network.Get()) << 8) | length).second)
+    {
+        m_stats.shadowed++;
+        return;
+    }
+    routes.push_back({network.Get(), gateway.Get(), interface, length});
+}
+
+inline void
+RoutingSnapshot::CollectRoutes(Ptr<Ipv4RoutingProtocol> protocol,
+                               std::unordered_set<uint64_t>& seen,
+                               std::vector<RouteRecord>& routes)
+{
+    if (Ptr<Ipv4ListRouting> list = DynamicCast<Ipv4ListRouting>(protocol))
+    {
+        // Highest priority first, so that it keeps the prefixes it shares
+        for (uint32_t i = 0; i < list->GetNRoutingProtocols(); ++i)
+        {
+            int16_t priority;
+            CollectRoutes(list->GetRoutingProtocol(i, priority), seen, routes);
+        }
+    }
+    else if (Ptr<Ipv4LpmRouting> lpm = DynamicCast<Ipv4LpmRouting>(protocol))
+    {
+        lpm->ForEachRoute([&](Ipv4Address network, uint8_t length, Ipv4Address gateway, uint32_t interface) {
+            AddRoute(network, length, gateway, interface, seen, routes);
+        });
+    }
+    else if (Ptr<Ipv4StaticRouting> staticRouting = DynamicCast<Ipv4StaticRouting>(protocol))
+    {
+        for (uint32_t i = 0; i < staticRouting->GetNRoutes(); ++i)
+        {
+            Ipv4RoutingTableEntry route = staticRouting->GetRoute(i);
+            AddRoute(route.GetDest(), route.GetDestNetworkMask().GetPrefixLength(), route.GetGateway(),
+                     route.GetInterface(), seen, routes);
+        }
+    }
+    else if (Ptr<Ipv4GlobalRouting> global = DynamicCast<Ipv4GlobalRouting>(protocol))
+    {
+        for (uint32_t i = 0; i < global->GetNRoutes(); ++i)
+        {
+            Ipv4RoutingTableEntry* route = global->GetRoute(i);
+            AddRoute(route->GetDest(), route->GetDestNetworkMask().GetPrefixLength(), route->GetGateway(),
+                     route->GetInterface(), seen, routes);
+        }
+    }
+    else
+    {
+        m_stats.skippedProtocols++;
+    }
+}
+
+inline bool
+RoutingSnapshot::Save(const std::string& path, const NodeContainer& nodes)
+{
+    m_stats = Statistics();
+    std::vector<NodeRecord> nodeRecords;
+    std::vector<InterfaceRecord> interfaces;
+    std::vector<AddressRecord> addresses;
+    std::vector<RouteRecord> routes;
+    std::unordered_set<uint64_t> seen;
+    for (uint32_t n = 0; n < nodes.GetN(); ++n)
+    {
+        Ptr<Node> node = nodes.Get(n);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        if (!ipv4)
+        {
+            m_error = "node " + std::to_string(node->GetId()) + " has no Internet stack";
+            return false;
+        }
+        NodeRecord record{node->GetId(), node->GetNDevices(), 0, 0};
+        for (uint32_t i = 0; i < ipv4->GetNInterfaces(); ++i)
+        {
+            // The loopback interface comes with the stack
+            if (ipv4->GetNAddresses(i) > 0 && ipv4->GetAddress(i, 0).GetLocal().IsLocalhost())
+            {
+                continue;
+            }
+            interfaces.push_back({i,
+                                  ipv4->GetNetDevice(i)->GetIfIndex(),
+                                  ipv4->GetMetric(i),
+                                  ipv4->IsUp(i),
+                                  ipv4->IsForwarding(i),
+                                  ipv4->GetNAddresses(i)});
+            for (uint32_t a = 0; a < ipv4->GetNAddresses(i); ++a)
+            {
+                addresses.push_back({ipv4->GetAddress(i, a).GetLocal().Get(), ipv4->GetAddress(i, a).GetMask().Get()});
+            }
+            record.interfaces++;
+        }
+        std::size_t firstRoute = routes.size();
+        seen.clear();
+        CollectRoutes(ipv4->GetRoutingProtocol(), seen, routes);
+        record.routes = routes.size() - firstRoute;
+        nodeRecords.push_back(record);
+    }
+
+    FileHeader header;
+    memcpy(header.magic, "WANSNAP\0", 8);
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.version = VERSION;
+    header.nodes = nodeRecords.size();
+    header.reserved = 0;
+    header.interfaces = interfaces.size();
+    header.addresses = addresses.size();
+    header.routes = routes.size();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        m_error = "cannot create " + path;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(nodeRecords.data()), nodeRecords.size() * sizeof(NodeRecord));
+    file.write(reinterpret_cast<const char*>(interfaces.data()), interfaces.size() * sizeof(InterfaceRecord));
+    file.write(reinterpret_cast<const char*>(addresses.data()), addresses.size() * sizeof(AddressRecord));
+    file.write(reinterpret_cast<const char*>(routes.data()), routes.size() * sizeof(RouteRecord));
+    if (!file.flush())
+    {
+        m_error = "cannot write " + path;
+        return false;
+    }
+
+    m_stats.bytes = file.tellp();
+    m_stats.nodes = header.nodes;
+    m_stats.interfaces = header.interfaces;
+    m_stats.addresses = header.addresses;
+    m_stats.routes = header.routes;
+    return true;
+}
+
+inline bool
+RoutingSnapshot::Open(const std::string& path)
+{
+    Close();
+    m_stats = Statistics();
+    m_fd = open(path.c_str(), O_RDONLY);
+    if (m_fd < 0)
+    {
+        m_error = "cannot open " + path;
+        return false;
+    }
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || std::size_t(st.st_size) < sizeof(FileHeader))
+    {
+        m_error = "cannot stat " + path + " or it is too short for a snapshot";
+        Close();
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+    if (map == MAP_FAILED)
+    {
+        m_error = "cannot mmap " + path;
+        Close();
+        return false;
+    }
+    madvise(map, st.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const uint8_t*>(map);
+    m_size = st.st_size;
+
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(m_data);
+    if (memcmp(header->magic, "WANSNAP\0", 8) != 0 || header->version != VERSION)
+    {
+        m_error = path + " is not a version " + std::to_string(VERSION) + " routing snapshot";
+        Close();
+        return false;
+    }
+    if (header->byteOrder != BYTE_ORDER_MARK)
+    {
+        m_error = path + " was written on a machine of the other byte order";
+        Close();
+        return false;
+    }
+    // Each count alone must fit, or the sum below could wrap around
+    if (header->interfaces > m_size / sizeof(InterfaceRecord) ||
+        header->addresses > m_size / sizeof(AddressRecord) || header->routes > m_size / sizeof(RouteRecord))
+    {
+        m_error = path + " is truncated or corrupt";
+        Close();
+        return false;
+    }
+    uint64_t expected = sizeof(FileHeader) + uint64_t(header->nodes) * sizeof(NodeRecord) +
+                        header->interfaces * sizeof(InterfaceRecord) +
+                        header->addresses * sizeof(AddressRecord) + header->routes * sizeof(RouteRecord);
+    if (expected != m_size)
+    {
+        m_error = path + " is truncated or corrupt";
+        Close();
+        return false;
+    }
+    m_stats.bytes = m_size;
+    m_stats.nodes = header->nodes;
+    m_stats.interfaces = header->interfaces;
+    m_stats.addresses = header->addresses;
+    m_stats.routes = header->routes;
+    return true;
+}
+
+inline void
+RoutingSnapshot::Close()
+{
+    if (m_data)
+    {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+        m_data = nullptr;
+        m_size = 0;
+    }
+    if (m_fd >= 0)
+    {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
+
+inline bool
+RoutingSnapshot::CheckRecords(const NodeContainer& nodes)
+{
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(m_data);
+    const NodeRecord* nodeRecord = reinterpret_cast<const NodeRecord*>(m_data + sizeof(FileHeader));
+    const InterfaceRecord* interfaces = reinterpret_cast<const InterfaceRecord*>(nodeRecord + header->nodes);
+    const RouteRecord* routes = reinterpret_cast<const RouteRecord*>(
+        reinterpret_cast<const AddressRecord*>(interfaces + header->interfaces) + header->addresses);
+
+    // Running sums of the per-record counts may never pass the header totals
+    uint64_t nInterfaces = 0;
+    uint64_t nAddresses = 0;
+    uint64_t nRoutes = 0;
+    for (uint32_t n = 0; n < header->nodes; ++n, ++nodeRecord)
+    {
+        std::string where = "snapshot node " + std::to_string(nodeRecord->id) + ": ";
+        if (nodeRecord->interfaces > header->interfaces - nInterfaces ||
+            nodeRecord->routes > header->routes - nRoutes)
+        {
+            m_error = where + "more interfaces or routes than the header holds";
+            return false;
+        }
+        Ptr<Ipv4> ipv4 = nodes.Get(n)->GetObject<Ipv4>();
+        uint32_t nodeInterfaces = ipv4 ? ipv4->GetNInterfaces() : 0;
+        for (uint32_t i = 0; i < nodeRecord->interfaces; ++i)
+        {
+            const InterfaceRecord& interface = interfaces[nInterfaces++];
+            if (interface.device >= nodeRecord->devices)
+            {
+                m_error = where + "device " + std::to_string(interface.device) + " out of range";
+                return false;
+            }
+            if (interface.addresses > header->addresses - nAddresses)
+            {
+                m_error = where + "more addresses than the header holds";
+                return false;
+            }
+            nAddresses += interface.addresses;
+            nodeInterfaces = std::max(nodeInterfaces, interface.interface + 1);
+        }
+        for (uint32_t r = 0; r < nodeRecord->routes; ++r)
+        {
+            const RouteRecord& route = routes[nRoutes++];
+            if (route.length > 32)
+            {
+                m_error = where + "prefix length " + std::to_string(route.length) + " out of range";
+                return false;
+            }
+            if (route.interface >= nodeInterfaces)
+            {
+                m_error = where + "route through interface " + std::to_string(route.interface) + " out of range";
+                return false;
+            }
+        }
+    }
+    if (nInterfaces != header->interfaces || nAddresses != header->addresses || nRoutes != header->routes)
+    {
+        m_error = "snapshot records do not add up to the header totals";
+        return false;
+    }
+    return true;
+}
+
+inline bool
+RoutingSnapshot::Restore(const NodeContainer& nodes)
+{
+    if (!m_data)
+    {
+        m_error = "no snapshot open";
+        return false;
+    }
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(m_data);
+    if (header->nodes != nodes.GetN())
+    {
+        m_error = "snapshot has " + std::to_string(header->nodes) + " nodes, the topology " +
+                  std::to_string(nodes.GetN());
+        return false;
+    }
+    if (!CheckRecords(nodes))
+    {
+        return false;
+    }
+    const NodeRecord* nodeRecord = reinterpret_cast<const NodeRecord*>(m_data + sizeof(FileHeader));
+    const InterfaceRecord* interface = reinterpret_cast<const InterfaceRecord*>(nodeRecord + header->nodes);
+    const AddressRecord* address = reinterpret_cast<const AddressRecord*>(interface + header->interfaces);
+    const RouteRecord* route = reinterpret_cast<const RouteRecord*>(address + header->addresses);
+
+    Ipv4LpmRoutingHelper lpmHelper;
+    lpmHelper.SetPriority(m_priority);
+    for (uint32_t n = 0; n < header->nodes; ++n, ++nodeRecord)
+    {
+        Ptr<Node> node = nodes.Get(n);
+        Ptr<Ipv4> ipv4 = node->GetObject<Ipv4>();
+        if (node->GetId() != nodeRecord->id || node->GetNDevices() != nodeRecord->devices || !ipv4)
+        {
+            m_error = "node " + std::to_string(node->GetId()) + " does not match the snapshot (node " +
+                      std::to_string(nodeRecord->id) + ", " + std::to_string(nodeRecord->devices) + " devices)";
+            return false;
+        }
+        for (uint32_t i = 0; i < nodeRecord->interfaces; ++i, ++interface)
+        {
+            Ptr<NetDevice> device = node->GetDevice(interface->device);
+            int32_t index = ipv4->GetInterfaceForDevice(device);
+            if (index == -1)
+            {
+                index = ipv4->AddInterface(device);
+            }
+            if (uint32_t(index) != interface->interface)
+            {
+                m_error = "interface " + std::to_string(interface->interface) + " of node " +
+                          std::to_string(nodeRecord->id) + " comes out as interface " + std::to_string(index);
+                return false;
+            }
+            for (uint32_t a = 0; a < interface->addresses; ++a, ++address)
+            {
+                ipv4->AddAddress(index, Ipv4InterfaceAddress(Ipv4Address(address->local), Ipv4Mask(address->mask)));
+            }
+            ipv4->SetMetric(index, interface->metric);
+            ipv4->SetForwarding(index, interface->forwarding);
+            if (interface->up)
+            {
+                ipv4->SetUp(index);
+            }
+        }
+
+        Ptr<Ipv4LpmRouting> lpm = Ipv4LpmRoutingHelper::GetLpmRouting(ipv4);
+        if (!lpm)
+        {
+            lpm = lpmHelper.Install(node);
+        }
+        for (uint32_t r = 0; r < nodeRecord->routes; ++r, ++route)
+        {
+            lpm->AddNetworkRouteTo(Ipv4Address(route->network),
+                                   Ipv4Mask(route->length == 0 ? 0 : ~uint32_t(0) << (32 - route->length)),
+                                   Ipv4Address(route->gateway),
+                                   route->interface);
+        }
+    }
+    return true;
+}
+
+} // namespace ns3
+
+#endif /* WAN_ROUTING_SNAPSHOT_H */
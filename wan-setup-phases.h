@@ -0,0 +1,61 @@
+/*
+ * Wall-clock time and memory of setup phases
+ *
+ * Large runs spend most of their start-up building the topology, and the
+ * interesting question is which step grows with it. RunSetupPhase() times
+ * one step and records how much the resident set size grew while it ran,
+ * read from /proc/self/statm. The growth is only an estimate: memory the
+ * allocator reuses does not show, and freed memory is rarely returned.
+ *
+ * Usage: copy this header next to the exercise script in scratch/ (Linux
+ * only: /proc).
+ */
+
+#ifndef WAN_SETUP_PHASES_H
+#define WAN_SETUP_PHASES_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+namespace ns3
+{
+
+/// Cost of one setup step
+struct SetupPhase
+{
+    std::string name;
+    double seconds;
+    int64_t residentBytes; ///< growth of the resident set size
+};
+
+/// Resident set size of this process in bytes
+inline int64_t
+GetResidentBytes()
+{
+    std::ifstream statm("/proc/self/statm");
+    int64_t size = 0;
+    int64_t resident = 0;
+    statm >> size >> resident;
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+/// Run f() and append its time and memory growth to phases
+template <class F>
+void
+RunSetupPhase(std::vector<SetupPhase>& phases, const std::string& name, F f)
+{
+    int64_t residentBefore = GetResidentBytes();
+    auto start = std::chrono::steady_clock::now();
+    f();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    phases.push_back({name, seconds, GetResidentBytes() - residentBefore});
+}
+
+} // namespace ns3
+
+#endif /* WAN_SETUP_PHASES_H */
@@ -0,0 +1,495 @@
+/*
+ * Hierarchical timer wheel for protocol timers
+ *
+ * Every BGP keepalive and hold timer and every BFD transmit and detection
+ * timer is an event in the simulator's scheduler heap. Most hold timers
+ * are cancelled and rearmed at every message. ns-3 does not remove a
+ * cancelled event; it only marks it. So each restart leaves another entry
+ * in the heap until its expiry time, and with 10k sessions the heap holds
+ * hundreds of thousands of dead entries. Every insertion into that heap
+ * costs O(log n).
+ *
+ * TimerWheel keeps the timers out of the scheduler. It uses four levels
+ * of 256 slots (a Linux-style hierarchical wheel). A timer is put in the
+ * slot of the level that its remaining time falls into. Arming and
+ * cancelling are O(1) unlinks in an index-linked pool. When the lower
+ * level wraps, a slot of the next level is cascaded down.
+ *
+ * The wheel is driven by one simulator event per tick, scheduled only
+ * while timers are armed. Ticks whose level-0 slot is empty are skipped,
+ * up to the next cascade point.
+ *
+ * Timers fire on tick boundaries. The delay is rounded up to a multiple
+ * of the resolution, so a timer fires late by less than one tick. With
+ * the default 1 ms resolution the wheel spans 2^32 ms (49 days); longer
+ * delays are parked in the top level and cascaded until due.
+ *
+ * ProtocolTimer lets a protocol use either a wheel or plain Simulator
+ * events behind the same Schedule()/Cancel() calls. BgpSpeaker and
+ * BfdAgent use it when they are given a wheel with SetTimerWheel().
+ *
+ * Usage: copy this header next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_TIMER_WHEEL_H
+#define WAN_TIMER_WHEEL_H
+
+#include "ns3/core-module.h"
+
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Hierarchical timing wheel scheduling callbacks at a fixed resolution.
+ */
+class TimerWheel
+{
+  public:
+    static constexpr uint32_t LEVELS = 4;
+    static constexpr uint32_t SLOT_BITS = 8;
+    static constexpr uint32_t SLOTS = 1 << SLOT_BITS;
+    static constexpr uint32_t NIL = UINT32_MAX;
+
+    /// Handle of an armed timer; 0 never names a timer
+    typedef uint64_t TimerId;
+
+    /// Counters for the benchmark reports
+    struct Statistics
+    {
+        uint64_t armed{0};
+        uint64_t cancelled{0};
+        uint64_t fired{0};
+        uint64_t cascaded{0};      ///< timers moved down a level
+        uint64_t ticks{0};         ///< simulator events used to drive the wheel
+        uint64_t maxPending{0};
+    };
+
+    explicit TimerWheel(Time resolution = MilliSeconds(1));
+    ~TimerWheel();
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /// Call callback after delay (rounded up to the resolution)
+    TimerId Schedule(Time delay, std::function<void()> callback);
+
+    /// Disarm a timer; harmless if it already fired or was cancelled
+    void Cancel(TimerId id);
+
+    bool IsPending(TimerId id) const;
+
+    Time GetResolution() const;
+    uint64_t GetNPending() const;
+    const Statistics& GetStatistics() const;
+
+    /// Bytes used by the timer pool and the slot heads
+    std::size_t GetMemoryUsage() const;
+
+  private:
+    struct Timer
+    {
+        uint64_t expiry{0}; ///< tick
+        std::function<void()> callback;
+        uint32_t prev{NIL};
+        uint32_t next{NIL};
+        uint32_t slot{NIL}; ///< index into m_heads, NIL while firing or free
+        uint32_t generation{0};
+        bool armed{false};
+    };
+
+    void Insert(uint32_t index);
+    void Unlink(uint32_t index);
+    void Release(uint32_t index);
+    /// Unlink a whole slot; returns (index, generation) of every timer in it
+    std::vector<std::pair<uint32_t, uint32_t>> Detach(uint32_t slot);
+    void Cascade(uint32_t level);
+    void Tick();
+    uint64_t NextTick() const;
+    void ScheduleTick();
+
+    Time m_resolution;
+    uint64_t m_now;      ///< last tick processed
+    uint64_t m_nextTick; ///< tick of m_tickEvent
+    std::vector<Timer> m_timers;
+    std::vector<uint32_t> m_free;
+    std::vector<uint32_t> m_heads; ///< LEVELS * SLOTS list heads
+    uint64_t m_levelCount[LEVELS];
+    uint64_t m_pending;
+    bool m_ticking; ///< inside Tick(), which schedules the next one itself
+    EventId m_tickEvent;
+    Statistics m_stats;
+};
+
+inline TimerWheel::TimerWheel(Time resolution)
+    : m_resolution(resolution),
+      m_now(resolution.IsStrictlyPositive() ? Simulator::Now().GetTimeStep() / resolution.GetTimeStep() : 0),
+      m_nextTick(0),
+      m_heads(LEVELS * SLOTS, NIL),
+      m_levelCount{},
+      m_pending(0),
+      m_ticking(false)
+{
+    NS_ABORT_MSG_UNLESS(resolution.IsStrictlyPositive(), "TimerWheel: resolution must be positive");
+}
+
+inline TimerWheel::~TimerWheel()
+{
+    m_tickEvent.Cancel();
+}
+
+inline TimerWheel::TimerId
+TimerWheel::Schedule(Time delay, std::function<void()> callback)
+{
+    int64_t step = m_resolution.GetTimeStep();
+    int64_t now = Simulator::Now().GetTimeStep();
+    if (!m_tickEvent.IsPending())
+    {
+        // Nothing is armed, so the ticks since the wheel went idle had nothing to do
+        m_now = std::max<uint64_t>(m_now, now / step);
+    }
+    else
+    {
+        // Ticks before the pending one are empty and cross no cascade point
+        m_now = std::max<uint64_t>(m_now, std::min<uint64_t>(now / step, m_nextTick - 1));
+    }
+
+    uint32_t index;
+    if (m_free.empty())
+    {
+        index = m_timers.size();
+        m_timers.emplace_back();
+    }
+    else
+    {
+        index = m_free.back();
+        m_free.pop_back();
+    }
+    Timer& timer = m_timers[index];
+    int64_t due = now + std::max<int64_t>(delay.GetTimeStep(), 0);
+    timer.expiry = std::max<uint64_t>((due + step - 1) / step, m_now + 1);
+    timer.callback = std::move(callback);
+    timer.armed = true;
+    Insert(index);
+
+    m_pending++;
+    m_stats.armed++;
+    m_stats.maxPending = std::max(m_stats.maxPending, m_pending);
+    if (m_tickEvent.IsPending())
+    {
+        if (timer.expiry < m_nextTick)
+        {
+            m_tickEvent.Cancel();
+            m_nextTick = timer.expiry;
+            ScheduleTick();
+        }
+    }
+    else if (!m_ticking)
+    {
+        m_nextTick = NextTick();
+        ScheduleTick();
+    }
+    return (uint64_t(timer.generation) << 32) | (index + 1);
+}
+
+inline void
+TimerWheel::Cancel(TimerId id)
+{
+    if (!IsPending(id))
+    {
+        return;
+    }
+    uint32_t index = (id & 0xffffffff) - 1;
+    Unlink(index);
+    Release(index);
+    m_stats.cancelled++;
+}
+
+inline bool
+TimerWheel::IsPending(TimerId id) const
+{
+    uint32_t index = (id & 0xffffffff) - 1;
+    return id != 0 && index < m_timers.size() && m_timers[index].armed &&
+           m_timers[index].generation == (id >> 32);
+}
+
+inline Time
+TimerWheel::GetResolution() const
+{
+    return m_resolution;
+}
+
+inline uint64_t
+TimerWheel::GetNPending() const
+{
+    return m_pending;
+}
+
+inline const TimerWheel::Statistics&
+TimerWheel::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline std::size_t
+TimerWheel::GetMemoryUsage() const
+{
+    return m_timers.capacity() * sizeof(Timer) + m_free.capacity() * sizeof(uint32_t) +
+           m_heads.capacity() * sizeof(uint32_t);
+}
+
+inline void
+TimerWheel::Insert(uint32_t index)
+{
+    Timer& timer = m_timers[index];
+    // Level: the first whose span covers the remaining ticks (Linux-style,
+    // slots are indexed by the expiry's own bits, not by the remaining time)
+    uint64_t delta = timer.expiry - m_now;
+    uint64_t expiry = timer.expiry;
+    uint32_t level = 0;
+    while (level < LEVELS - 1 && delta >= (uint64_t(1) << (SLOT_BITS * (level + 1))))
+    {
+        ++level;
+    }
+    uint64_t span = uint64_t(1) << (SLOT_BITS * LEVELS);
+    if (delta >= span)
+    {
+        expiry = m_now + span - 1; // parked; reinserted when this slot cascades
+    }
+    uint32_t slot = level * SLOTS + ((expiry >> (SLOT_BITS * level)) & (SLOTS - 1));
+    timer.slot = slot;
+    timer.prev = NIL;
+    timer.next = m_heads[slot];
+    if (timer.next != NIL)
+    {
+        m_timers[timer.next].prev = index;
+    }
+    m_heads[slot] = index;
+    m_levelCount[level]++;
+}
+
+inline void
+TimerWheel::Unlink(uint32_t index)
+{
+    Timer& timer = m_timers[index];
+    if (timer.slot == NIL)
+    {
+        return; // detached for firing
+    }
+    if (timer.prev != NIL)
+    {
+        m_timers[timer.prev].next = timer.next;
+    }
+    else
+    {
+        m_heads[timer.slot] = timer.next;
+    }
+    if (timer.next != NIL)
+    {
+        m_timers[timer.next].prev = timer.prev;
+    }
+    m_levelCount[timer.slot / SLOTS]--;
+    timer.slot = NIL;
+}
+
+inline void
+TimerWheel::Release(uint32_t index)
+{
+    Timer& timer = m_timers[index];
+    timer.armed = false;
+    timer.callback = nullptr;
+    timer.generation++;
+    m_free.push_back(index);
+    m_pending--;
+}
+
+inline std::vector<std::pair<uint32_t, uint32_t>>
+TimerWheel::Detach(uint32_t slot)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> indices;
+    for (uint32_t index = m_heads[slot]; index != NIL; index = m_timers[index].next)
+    {
+        indices.emplace_back(index, m_timers[index].generation);
+        m_timers[index].slot = NIL;
+    }
+    m_levelCount[slot / SLOTS] -= indices.size();
+    m_heads[slot] = NIL;
+    return indices;
+}
+
+inline void
+TimerWheel::Cascade(uint32_t level)
+{
+    uint32_t slot = level * SLOTS + ((m_now >> (SLOT_BITS * level)) & (SLOTS - 1));
+    for (const auto& detached : Detach(slot))
+    {
+        Insert(detached.first);
+        m_stats.cascaded++;
+    }
+}
+
+inline void
+TimerWheel::Tick()
+{
+    m_now = m_nextTick;
+    m_stats.ticks++;
+    // Refill the lower levels whenever they wrap around
+    for (uint32_t level = 1; level < LEVELS; ++level)
+    {
+        if ((m_now & ((uint64_t(1) << (SLOT_BITS * level)) - 1)) != 0)
+        {
+            break;
+        }
+        Cascade(level);
+    }
+    m_ticking = true;
+    for (const auto& detached : Detach(m_now & (SLOTS - 1)))
+    {
+        uint32_t index = detached.first;
+        Timer& timer = m_timers[index];
+        // A callback earlier in this slot may have cancelled this timer and
+        // Schedule() may have reused its index for a timer linked elsewhere
+        if (!timer.armed || timer.generation != detached.second)
+        {
+            continue;
+        }
+        if (timer.expiry > m_now)
+        {
+            Insert(index); // parked beyond the span
+            continue;
+        }
+        std::function<void()> callback = std::move(timer.callback);
+        Release(index);
+        m_stats.fired++;
+        callback(); // may arm or cancel timers, including ones in this slot
+    }
+    m_ticking = false;
+    if (m_pending > 0)
+    {
+        m_nextTick = NextTick();
+        ScheduleTick();
+    }
+}
+
+inline uint64_t
+TimerWheel::NextTick() const
+{
+    // The next tick with something in level 0, or the next cascade point
+    uint64_t boundary = (m_now | (SLOTS - 1)) + 1;
+    if (m_levelCount[0] == 0)
+    {
+        return boundary;
+    }
+    uint64_t next = m_now + 1;
+    while (next < boundary && m_heads[next & (SLOTS - 1)] == NIL)
+    {
+        ++next;
+    }
+    return next;
+}
+
+inline void
+TimerWheel::ScheduleTick()
+{
+    int64_t at = int64_t(m_nextTick) * m_resolution.GetTimeStep();
+    m_tickEvent = Simulator::Schedule(TimeStep(std::max<int64_t>(at - Simulator::Now().GetTimeStep(), 0)),
+                                      &TimerWheel::Tick,
+                                      this);
+}
+
+/**
+ * A protocol timer on a TimerWheel, or on the simulator's event queue when
+ * no wheel is given. Scheduling replaces a pending expiry, like ns3::Timer.
+ */
+class ProtocolTimer
+{
+  public:
+    template <typename MEM, typename OBJ, typename... Ts>
+    void Schedule(TimerWheel* wheel, Time delay, MEM method, OBJ object, Ts... args)
+    {
+        Cancel();
+        m_wheel = wheel;
+        if (wheel)
+        {
+            m_timer = wheel->Schedule(delay, [method, object, args...]() { (object->*method)(args...); });
+        }
+        else
+        {
+            m_event = Simulator::Schedule(delay, method, object, args...);
+            TrackQueued(delay);
+        }
+    }
+
+    void Cancel()
+    {
+        if (m_wheel)
+        {
+            m_wheel->Cancel(m_timer);
+        }
+        m_event.Cancel();
+    }
+
+    bool IsPending() const
+    {
+        return m_wheel ? m_wheel->IsPending(m_timer) : m_event.IsPending();
+    }
+
+    /**
+     * Count the scheduler heap entries of timers without a wheel, cancelled
+     * ones included (ns-3 only removes them when their time comes). Costs a
+     * heap operation per Schedule(), so it is off unless a benchmark asks.
+     */
+    static void EnableQueueTracking()
+    {
+        QueueTracker().enabled = true;
+    }
+
+    /// Peak number of tracked heap entries
+    static uint64_t GetMaxQueued()
+    {
+        return QueueTracker().maxQueued;
+    }
+
+  private:
+    struct Tracker
+    {
+        bool enabled{false};
+        uint64_t maxQueued{0};
+        std::priority_queue<int64_t, std::vector<int64_t>, std::greater<int64_t>> expiries;
+    };
+
+    static Tracker& QueueTracker()
+    {
+        static Tracker tracker;
+        return tracker;
+    }
+
+    static void TrackQueued(Time delay)
+    {
+        Tracker& tracker = QueueTracker();
+        if (!tracker.enabled)
+        {
+            return;
+        }
+        int64_t now = Simulator::Now().GetTimeStep();
+        while (!tracker.expiries.empty() && tracker.expiries.top() < now)
+        {
+            tracker.expiries.pop();
+        }
+        tracker.expiries.push(now + delay.GetTimeStep());
+        tracker.maxQueued = std::max<uint64_t>(tracker.maxQueued, tracker.expiries.size());
+    }
+
+    TimerWheel* m_wheel{nullptr};
+    TimerWheel::TimerId m_timer{0};
+    EventId m_event;
+};
+
+} // namespace ns3
+
+#endif /* WAN_TIMER_WHEEL_H */
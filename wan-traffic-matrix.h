@@ -0,0 +1,670 @@
+/*
+ * Traffic matrix between host prefixes, driven by pooled senders
+ *
+ * A TrafficMatrix holds the offered rate between every pair of endpoints
+ * (a host address with the node behind it and its AS). It is filled either
+ * by the gravity model - the demand from i to j is proportional to the
+ * product of their masses, the usual first approximation of inter-domain
+ * traffic - or from a file, and scaled to a target load afterwards.
+ *
+ * TrafficMatrixHelper drives it without one Application and one event
+ * chain per flow: every source node gets a single TrafficMatrixSender
+ * that owns all flows leaving the node and one timer. Its flows sit in a
+ * min-heap of departure times; each expiry sends every packet due within
+ * Granularity and re-arms the timer at the next departure, so a node with
+ * a thousand flows costs one pending event and, at high rates, far fewer
+ * expiries than packets. Each destination node gets one TrafficMatrixSink.
+ * Packets carry their demand index in a FlowIdTag, so sent and received
+ * bytes are counted per demand.
+ *
+ * Flows are constant bit rate UDP to port 5300 with a random phase.
+ * Sending up to Granularity early bunches packets into bursts of that
+ * length, which the device queues absorb at the default of 100 us.
+ *
+ * Matrix file format, one demand per line ('#' starts a comment):
+ *
+ *   <source address> <destination address> <rate>
+ *   10.2.2.2 10.1.2.2 250Mbps
+ *
+ * The rate is in bit/s, optionally with a bps, kbps, Mbps or Gbps unit.
+ * Both addresses must be endpoints added before Load().
+ *
+ * Usage: copy this header and wan-mpi.h next to the exercise script in scratch/.
+ */
+
+#ifndef WAN_TRAFFIC_MATRIX_H
+#define WAN_TRAFFIC_MATRIX_H
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/network-module.h"
+#include "wan-mpi.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <queue>
+#include <sstream>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Offered load between endpoints, in bit/s.
+ */
+class TrafficMatrix
+{
+  public:
+    struct Endpoint
+    {
+        Ptr<Node> node;
+        Ipv4Address address;
+        uint32_t as{0};
+        double mass{1.0}; ///< weight in the gravity model
+    };
+
+    struct Demand
+    {
+        uint32_t source;      ///< endpoint index
+        uint32_t destination; ///< endpoint index
+        double bitRate;
+    };
+
+    /// Add an endpoint; returns its index
+    uint32_t AddEndpoint(Ptr<Node> node, Ipv4Address address, uint32_t as, double mass = 1.0);
+
+    /**
+     * Replace the demands by a gravity model: every ordered pair of distinct
+     * endpoints gets totalBitRate * m_i * m_j / sum of m_k * m_l.
+     * \param interAsOnly leave out pairs within the same AS
+     */
+    void Gravity(double totalBitRate, bool interAsOnly = false);
+
+    /// Replace the demands by those of a matrix file; false on error (see GetError())
+    bool Load(const std::string& path);
+
+    /// Multiply every demand by factor
+    void Scale(double factor);
+
+    /// Sum of the demands from fromAs to toAs
+    double GetRate(uint32_t fromAs, uint32_t toAs) const;
+
+    double GetTotalRate() const;
+
+    const std::vector<Endpoint>& GetEndpoints() const;
+    const std::vector<Demand>& GetDemands() const;
+    const std::string& GetError() const;
+
+  private:
+    static bool ParseRate(const std::string& text, double& bitRate);
+    static bool ParseAddress(const std::string& text, Ipv4Address& address);
+
+    std::vector<Endpoint> m_endpoints;
+    std::vector<Demand> m_demands;
+    std::string m_error;
+};
+
+/**
+ * Sends every flow leaving one node from a single socket and timer.
+ */
+class TrafficMatrixSender : public Application
+{
+  public:
+    /// Per-sender counters
+    struct Statistics
+    {
+        uint64_t packetsSent{0};
+        uint64_t bytesSent{0};
+        uint64_t sendFailures{0}; ///< packets the socket refused (e.g. no route)
+        uint64_t timerEvents{0};
+    };
+
+    static TypeId GetTypeId();
+
+    TrafficMatrixSender();
+    ~TrafficMatrixSender() override;
+
+    /// Send bitRate of PacketSize datagrams to destination, tagged with id
+    void AddFlow(uint32_t id, Ipv4Address destination, double bitRate);
+
+    /// Count bytes sent per flow id into counters (the vector must outlive the simulation)
+    void SetCounters(std::vector<uint64_t>* counters);
+
+    uint32_t GetNFlows() const;
+    const Statistics& GetStatistics() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    struct Flow
+    {
+        uint32_t id;
+        Ipv4Address destination;
+        int64_t interval; ///< time steps between two packets
+    };
+
+    /// (departure time step, flow index), earliest on top
+    typedef std::pair<int64_t, uint32_t> Departure;
+
+    void StartApplication() override;
+    void StopApplication() override;
+    void SendDue();
+
+    std::vector<Flow> m_flows;
+    std::priority_queue<Departure, std::vector<Departure>, std::greater<Departure>> m_departures;
+    uint32_t m_packetSize;
+    Time m_granularity;
+    Ptr<Socket> m_socket;
+    EventId m_timer;
+    Ptr<UniformRandomVariable> m_phase;
+    std::vector<uint64_t>* m_counters;
+    Statistics m_stats;
+};
+
+/**
+ * Receives the matrix traffic of one node and counts it per flow id.
+ */
+class TrafficMatrixSink : public Application
+{
+  public:
+    static constexpr uint16_t PORT = 5300;
+
+    static TypeId GetTypeId();
+
+    TrafficMatrixSink();
+    ~TrafficMatrixSink() override;
+
+    /// Count bytes received per flow id into counters (the vector must outlive the simulation)
+    void SetCounters(std::vector<uint64_t>* counters);
+
+    uint64_t GetBytesReceived() const;
+
+  protected:
+    void DoDispose() override;
+
+  private:
+    void StartApplication() override;
+    void StopApplication() override;
+    void HandleRead(Ptr<Socket> socket);
+
+    Ptr<Socket> m_socket;
+    std::vector<uint64_t>* m_counters;
+    uint64_t m_bytesReceived;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(TrafficMatrixSender);
+NS_OBJECT_ENSURE_REGISTERED(TrafficMatrixSink);
+
+// ==============================================
+// TrafficMatrix
+// ==============================================
+
+inline uint32_t
+TrafficMatrix::AddEndpoint(Ptr<Node> node, Ipv4Address address, uint32_t as, double mass)
+{
+    m_endpoints.push_back({node, address, as, mass});
+    return m_endpoints.size() - 1;
+}
+
+inline void
+TrafficMatrix::Gravity(double totalBitRate, bool interAsOnly)
+{
+    m_demands.clear();
+    double sum = 0;
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        for (uint32_t i = 0; i < m_endpoints.size(); ++i)
+        {
+            for (uint32_t j = 0; j < m_endpoints.size(); ++j)
+            {
+                if (i == j || (interAsOnly && m_endpoints[i].as == m_endpoints[j].as))
+                {
+                    continue;
+                }
+                double product = m_endpoints[i].mass * m_endpoints[j].mass;
+                if (pass == 0)
+                {
+                    sum += product;
+                }
+                else if (product > 0)
+                {
+                    m_demands.push_back({i, j, totalBitRate * product / sum});
+                }
+            }
+        }
+    }
+}
+
+inline bool
+TrafficMatrix::ParseRate(const std::string& text, double& bitRate)
+{
+    char* end = nullptr;
+    bitRate = std::strtod(text.c_str(), &end);
+    std::string unit(end);
+    static const std::map<std::string, double> units{{"", 1},
+                                                     {"bps", 1},
+                                                     {"kbps", 1e3},
+                                                     {"Kbps", 1e3},
+                                                     {"Mbps", 1e6},
+                                                     {"Gbps", 1e9}};
+    auto it = units.find(unit);
+    if (end == text.c_str() || it == units.end() || bitRate < 0)
+    {
+        return false;
+    }
+    bitRate *= it->second;
+    return true;
+}
+
+inline bool
+TrafficMatrix::ParseAddress(const std::string& text, Ipv4Address& address)
+{
+    unsigned int b[4];
+    char trailing;
+    if (std::sscanf(text.c_str(), "%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &trailing) != 4 ||
+        b[0] > 255 || b[1] > 255 || b[2] > 255 || b[3] > 255)
+    {
+        return false;
+    }
+    address = Ipv4Address(b[0] << 24 | b[1] << 16 | b[2] << 8 | b[3]);
+    return true;
+}
+
+inline bool
+TrafficMatrix::Load(const std::string& path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        m_error = "cannot open " + path;
+        return false;
+    }
+    std::map<Ipv4Address, uint32_t> index;
+    for (uint32_t i = 0; i < m_endpoints.size(); ++i)
+    {
+        index[m_endpoints[i].address] = i;
+    }
+    std::vector<Demand> demands;
+    std::string line;
+    for (uint32_t number = 1; std::getline(in, line); ++number)
+    {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields(line);
+        std::string source;
+        std::string destination;
+        std::string rate;
+        if (!(fields >> source))
+        {
+            continue;
+        }
+        double bitRate = 0;
+        Ipv4Address sourceAddress;
+        Ipv4Address destinationAddress;
+        fields >> destination >> rate;
+        bool valid = ParseAddress(source, sourceAddress) && ParseAddress(destination, destinationAddress);
+        auto from = index.find(sourceAddress);
+        auto to = index.find(destinationAddress);
+        if (!valid || from == index.end() || to == index.end() || !ParseRate(rate, bitRate))
+        {
+            std::ostringstream error;
+            error << path << ":" << number << ": expected <endpoint> <endpoint> <rate>, got \"" << line << "\"";
+            m_error = error.str();
+            return false;
+        }
+        demands.push_back({from->second, to->second, bitRate});
+    }
+    m_demands.swap(demands);
+    return true;
+}
+
+inline void
+TrafficMatrix::Scale(double factor)
+{
+    for (auto& demand : m_demands)
+    {
+        demand.bitRate *= factor;
+    }
+}
+
+inline double
+TrafficMatrix::GetRate(uint32_t fromAs, uint32_t toAs) const
+{
+    double rate = 0;
+    for (const auto& demand : m_demands)
+    {
+        if (m_endpoints[demand.source].as == fromAs && m_endpoints[demand.destination].as == toAs)
+        {
+            rate += demand.bitRate;
+        }
+    }
+    return rate;
+}
+
+inline double
+TrafficMatrix::GetTotalRate() const
+{
+    double rate = 0;
+    for (const auto& demand : m_demands)
+    {
+        rate += demand.bitRate;
+    }
+    return rate;
+}
+
+inline const std::vector<TrafficMatrix::Endpoint>&
+TrafficMatrix::GetEndpoints() const
+{
+    return m_endpoints;
+}
+
+inline const std::vector<TrafficMatrix::Demand>&
+TrafficMatrix::GetDemands() const
+{
+    return m_demands;
+}
+
+inline const std::string&
+TrafficMatrix::GetError() const
+{
+    return m_error;
+}
+
+// ==============================================
+// TrafficMatrixSender
+// ==============================================
+
+inline TypeId
+TrafficMatrixSender::GetTypeId()
+{
+    static TypeId tid =
+        TypeId("ns3::TrafficMatrixSender")
+            .SetParent<Application>()
+            .SetGroupName("Applications")
+            .AddConstructor<TrafficMatrixSender>()
+            .AddAttribute("PacketSize",
+                          "UDP payload of every packet",
+                          UintegerValue(1000),
+                          MakeUintegerAccessor(&TrafficMatrixSender::m_packetSize),
+                          MakeUintegerChecker<uint32_t>(1, 65507))
+            .AddAttribute("Granularity",
+                          "Packets due within this time of a timer expiry are sent with it",
+                          TimeValue(MicroSeconds(100)),
+                          MakeTimeAccessor(&TrafficMatrixSender::m_granularity),
+                          MakeTimeChecker(Time(0)));
+    return tid;
+}
+
+inline TrafficMatrixSender::TrafficMatrixSender()
+    : m_packetSize(1000),
+      m_granularity(MicroSeconds(100)),
+      m_phase(CreateObject<UniformRandomVariable>()),
+      m_counters(nullptr)
+{
+}
+
+inline TrafficMatrixSender::~TrafficMatrixSender()
+{
+}
+
+inline void
+TrafficMatrixSender::DoDispose()
+{
+    m_timer.Cancel();
+    m_socket = nullptr;
+    m_flows.clear();
+    Application::DoDispose();
+}
+
+inline void
+TrafficMatrixSender::AddFlow(uint32_t id, Ipv4Address destination, double bitRate)
+{
+    NS_ABORT_MSG_UNLESS(bitRate > 0, "TrafficMatrixSender: flow " << id << " has no rate");
+    int64_t interval = std::max<int64_t>(1, Seconds(m_packetSize * 8.0 / bitRate).GetTimeStep());
+    m_flows.push_back({id, destination, interval});
+}
+
+inline void
+TrafficMatrixSender::SetCounters(std::vector<uint64_t>* counters)
+{
+    m_counters = counters;
+}
+
+inline uint32_t
+TrafficMatrixSender::GetNFlows() const
+{
+    return m_flows.size();
+}
+
+inline const TrafficMatrixSender::Statistics&
+TrafficMatrixSender::GetStatistics() const
+{
+    return m_stats;
+}
+
+inline void
+TrafficMatrixSender::StartApplication()
+{
+    m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+    m_socket->Bind();
+    m_departures = decltype(m_departures)();
+    int64_t now = Simulator::Now().GetTimeStep();
+    for (uint32_t i = 0; i < m_flows.size(); ++i)
+    {
+        // Random phase, so flows of the same rate do not leave in lockstep
+        m_departures.push({now + int64_t(m_phase->GetValue(0, m_flows[i].interval)), i});
+    }
+    if (!m_departures.empty())
+    {
+        m_timer = Simulator::Schedule(TimeStep(m_departures.top().first - now), &TrafficMatrixSender::SendDue, this);
+    }
+}
+
+inline void
+TrafficMatrixSender::StopApplication()
+{
+    m_timer.Cancel();
+    if (m_socket)
+    {
+        m_socket->Close();
+        m_socket = nullptr;
+    }
+}
+
+inline void
+TrafficMatrixSender::SendDue()
+{
+    m_stats.timerEvents++;
+    int64_t now = Simulator::Now().GetTimeStep();
+    int64_t horizon = now + m_granularity.GetTimeStep();
+    while (m_departures.top().first <= horizon)
+    {
+        Departure next = m_departures.top();
+        m_departures.pop();
+        const Flow& flow = m_flows[next.second];
+        Ptr<Packet> packet = Create<Packet>(m_packetSize);
+        packet->AddPacketTag(FlowIdTag(flow.id));
+        if (m_socket->SendTo(packet, 0, InetSocketAddress(flow.destination, TrafficMatrixSink::PORT)) >= 0)
+        {
+            m_stats.packetsSent++;
+            m_stats.bytesSent += m_packetSize;
+            if (m_counters)
+            {
+                (*m_counters)[flow.id] += m_packetSize;
+            }
+        }
+        else
+        {
+            m_stats.sendFailures++;
+        }
+        // Keep the long-run rate exact: the next departure follows the schedule, not now
+        m_departures.push({next.first + flow.interval, next.second});
+    }
+    m_timer = Simulator::Schedule(TimeStep(m_departures.top().first - now), &TrafficMatrixSender::SendDue, this);
+}
+
+// ==============================================
+// TrafficMatrixSink
+// ==============================================
+
+inline TypeId
+TrafficMatrixSink::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::TrafficMatrixSink")
+                            .SetParent<Application>()
+                            .SetGroupName("Applications")
+                            .AddConstructor<TrafficMatrixSink>();
+    return tid;
+}
+
+inline TrafficMatrixSink::TrafficMatrixSink()
+    : m_counters(nullptr),
+      m_bytesReceived(0)
+{
+}
+
+inline TrafficMatrixSink::~TrafficMatrixSink()
+{
+}
+
+inline void
+TrafficMatrixSink::DoDispose()
+{
+    m_socket = nullptr;
+    Application::DoDispose();
+}
+
+inline void
+TrafficMatrixSink::SetCounters(std::vector<uint64_t>* counters)
+{
+    m_counters = counters;
+}
+
+inline uint64_t
+TrafficMatrixSink::GetBytesReceived() const
+{
+    return m_bytesReceived;
+}
+
+inline void
+TrafficMatrixSink::StartApplication()
+{
+    m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+    m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), PORT));
+    m_socket->SetRecvCallback(MakeCallback(&TrafficMatrixSink::HandleRead, this));
+}
+
+inline void
+TrafficMatrixSink::StopApplication()
+{
+    if (m_socket)
+    {
+        m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        m_socket->Close();
+        m_socket = nullptr;
+    }
+}
+
+inline void
+TrafficMatrixSink::HandleRead(Ptr<Socket> socket)
+{
+    while (Ptr<Packet> packet = socket->Recv())
+    {
+        m_bytesReceived += packet->GetSize();
+        FlowIdTag tag;
+        if (m_counters && packet->PeekPacketTag(tag) && tag.GetFlowId() < m_counters->size())
+        {
+            (*m_counters)[tag.GetFlowId()] += packet->GetSize();
+        }
+    }
+}
+
+// ==============================================
+// TrafficMatrixHelper
+// ==============================================
+
+/**
+ * Installs one sender per source node and one sink per destination node
+ * for a TrafficMatrix, and keeps the per-demand byte counters.
+ */
+class TrafficMatrixHelper
+{
+  public:
+    /// Set an attribute on every sender created by Install()
+    void SetSenderAttribute(std::string name, const AttributeValue& value)
+    {
+        m_senderAttributes.emplace_back(name, value.Copy());
+    }
+
+    /**
+     * Create the applications of the matrix's current demands; the demand
+     * index is the flow id. Nodes on another MPI rank are skipped.
+     */
+    ApplicationContainer Install(const TrafficMatrix& matrix)
+    {
+        const auto& endpoints = matrix.GetEndpoints();
+        const auto& demands = matrix.GetDemands();
+        m_sent.assign(demands.size(), 0);
+        m_received.assign(demands.size(), 0);
+        std::map<Ptr<Node>, Ptr<TrafficMatrixSender>> senders;
+        std::map<Ptr<Node>, Ptr<TrafficMatrixSink>> sinks;
+        ApplicationContainer apps;
+        for (uint32_t d = 0; d < demands.size(); ++d)
+        {
+            Ptr<Node> source = endpoints[demands[d].source].node;
+            Ptr<Node> destination = endpoints[demands[d].destination].node;
+            if (demands[d].bitRate <= 0)
+            {
+                continue;
+            }
+            if (WanMpi::IsLocal(source))
+            {
+                Ptr<TrafficMatrixSender>& sender = senders[source];
+                if (!sender)
+                {
+                    sender = CreateObject<TrafficMatrixSender>();
+                    for (const auto& attribute : m_senderAttributes)
+                    {
+                        sender->SetAttribute(attribute.first, *attribute.second);
+                    }
+                    sender->SetCounters(&m_sent);
+                    source->AddApplication(sender);
+                    apps.Add(sender);
+                }
+                sender->AddFlow(d, endpoints[demands[d].destination].address, demands[d].bitRate);
+            }
+            if (WanMpi::IsLocal(destination) && !sinks[destination])
+            {
+                Ptr<TrafficMatrixSink> sink = CreateObject<TrafficMatrixSink>();
+                sink->SetCounters(&m_received);
+                destination->AddApplication(sink);
+                sinks[destination] = sink;
+                apps.Add(sink);
+            }
+        }
+        return apps;
+    }
+
+    /// Bytes sent and received per demand (this rank's share in a distributed run)
+    const std::vector<uint64_t>& GetSentBytes() const
+    {
+        return m_sent;
+    }
+
+    const std::vector<uint64_t>& GetReceivedBytes() const
+    {
+        return m_received;
+    }
+
+  private:
+    std::vector<std::pair<std::string, Ptr<AttributeValue>>> m_senderAttributes;
+    std::vector<uint64_t> m_sent;
+    std::vector<uint64_t> m_received;
+};
+
+} // namespace ns3
+
+#endif /* WAN_TRAFFIC_MATRIX_H */